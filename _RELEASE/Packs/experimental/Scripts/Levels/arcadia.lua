@@ -49,10 +49,11 @@ function mkVertWall(mY, mYVel, mX)
     local width = 3000
     local height = 40
 
-    cw_setVertexPos(cwHandle, 0, x,         y)
-    cw_setVertexPos(cwHandle, 1, x + width, y)
-    cw_setVertexPos(cwHandle, 2, x + width, y + height)
-    cw_setVertexPos(cwHandle, 3, x,         y + height)
+    cw_setVertexPos4(cwHandle,
+        x,         y,
+        x + width, y,
+        x + width, y + height,
+        x,         y + height)
 
     if nIncrement % 2 == 0 then
         cw_setVertexColor(cwHandle, 0, 0, 255, 0, 255)
@@ -84,10 +85,11 @@ function mkHalfHorizWall(mInv, mY, color, mXVel, mX)
     local width = 20
     local height = 800
 
-    cw_setVertexPos(cwHandle, 0, x,         y)
-    cw_setVertexPos(cwHandle, 1, x + width, y)
-    cw_setVertexPos(cwHandle, 2, x + width, y + height)
-    cw_setVertexPos(cwHandle, 3, x,         y + height)
+    cw_setVertexPos4(cwHandle,
+        x,         y,
+        x + width, y,
+        x + width, y + height,
+        x,         y + height)
 
     --[[
     if color == 0 then
@@ -18,6 +18,7 @@ namespace hg
 {
 
 class HexagonGame;
+class HexagonSimulation;
 
 class CCustomWall
 {
@@ -31,7 +32,7 @@ private:
 public:
     CCustomWall();
 
-    void update(HexagonGame& mHexagonGame, ssvu::FT mFT);
+    void update(HexagonSimulation& mSimulation, ssvu::FT mFT);
     void draw(HexagonGame& mHexagonGame);
 
     [[gnu::always_inline, nodiscard]] bool isOverlapping(
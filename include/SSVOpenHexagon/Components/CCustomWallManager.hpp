@@ -10,6 +10,8 @@
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Graphics/Color.hpp>
 
+#include <array>
+#include <cstddef>
 #include <vector>
 
 namespace hg
@@ -27,6 +29,13 @@ class CCustomWallManager
 
     [[nodiscard]] bool isValidHandle(const CCustomWallHandle h) const noexcept;
 
+    // Like `isValidHandle`, also checking that the wall was not destroyed.
+    // Logs on failure, `action` describes what was attempted.
+    [[nodiscard]] bool checkAliveHandle(
+        const CCustomWallHandle h, const char* action) const;
+
+    void growFreeHandles(const std::size_t minCount);
+
 public:
     [[nodiscard]] CCustomWallHandle create();
 
@@ -38,6 +47,19 @@ public:
     void setVertexColor(const CCustomWallHandle cwHandle, const int vertexIndex,
         const sf::Color& color);
 
+    // Batched versions of the functions above, checking every handle only
+    // once and without per-vertex bounds checks.
+    void createMany(
+        const std::size_t count, std::vector<CCustomWallHandle>& out);
+
+    void setVertexPos4(const CCustomWallHandle cwHandle,
+        const std::array<sf::Vector2f, 4>& positions);
+
+    // `coords` holds the 8 coordinates (x0, y0, ..., x3, y3) of every wall
+    // in `cwHandles`, in the same order.
+    void setManyVertexPos(const std::vector<CCustomWallHandle>& cwHandles,
+        const std::vector<float>& coords);
+
     [[nodiscard]] sf::Vector2f getVertexPos(
         const CCustomWallHandle cwHandle, const int vertexIndex);
 
@@ -11,11 +11,13 @@
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Graphics/Color.hpp>
 
+#include <array>
+
 namespace hg
 {
 
 class HexagonGame;
-class CWall;
+class HexagonSimulation;
 class CCustomWall;
 
 class CPlayer
@@ -25,6 +27,10 @@ private:
     sf::Vector2f pos;
     sf::Vector2f lastPos;
 
+    // State at the start of the current tick, only used for drawing.
+    sf::Vector2f prevTickPos;
+    float prevTickAngle;
+
     float hue;
     float angle;
     float lastAngle;
@@ -54,21 +60,23 @@ public:
     [[nodiscard]] float getPlayerAngle() const noexcept;
 
     void setPlayerAngle(const float newAng) noexcept;
-    void playerSwap(HexagonGame& mHexagonGame, bool mPlaySound);
+    void savePreviousState() noexcept;
+    void playerSwap(HexagonSimulation& mSimulation, bool mPlaySound);
 
-    void kill(HexagonGame& mHexagonGame);
+    void kill(HexagonSimulation& mSimulation);
 
-    void update(HexagonGame& mHexagonGame, ssvu::FT mFT);
-    void updateInput(HexagonGame& mHexagonGame, ssvu::FT mFT);
-    void updatePosition(HexagonGame& mHexagonGame, ssvu::FT mFT);
+    void update(HexagonSimulation& mSimulation, ssvu::FT mFT);
+    void updateInput(HexagonSimulation& mSimulation, ssvu::FT mFT);
+    void updatePosition(HexagonSimulation& mSimulation, ssvu::FT mFT);
 
     void draw(HexagonGame& mHexagonGame, const sf::Color& mCapColor);
 
-    [[nodiscard]] bool push(
-        HexagonGame& mHexagonGame, const hg::CWall& wall, ssvu::FT mFT);
+    [[nodiscard]] bool push(HexagonSimulation& mSimulation,
+        const std::array<sf::Vector2f, 4>& mWallVertices, float mCurveSpeed,
+        ssvu::FT mFT);
 
-    [[nodiscard]] bool push(
-        HexagonGame& mHexagonGame, const hg::CCustomWall& wall, ssvu::FT mFT);
+    [[nodiscard]] bool push(HexagonSimulation& mSimulation,
+        const hg::CCustomWall& wall, ssvu::FT mFT);
 
     [[nodiscard]] bool getJustSwapped() const noexcept;
 };
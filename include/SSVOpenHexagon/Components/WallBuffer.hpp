@@ -0,0 +1,183 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#pragma once
+
+#include "SSVOpenHexagon/Components/SpeedData.hpp"
+
+#include <SSVUtils/Core/Common/Frametime.hpp>
+
+#include <SFML/System/Vector2.hpp>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace hg
+{
+
+// All the walls of the simulation, as structure of arrays, so that they can
+// be moved all at once. The four vertices of a wall are contiguous: vertex `k`
+// of wall `i` is at index `i * 4 + k`.
+//
+// Every tick, `updateSpeeds` applies the accelerations, `moveTowardsCenter`
+// and `rotateAroundCenter` compute the new positions of all the walls, and
+// `applyMovement` makes them current once collisions have been resolved.
+//
+// The vectorized kernels perform the same IEEE operations, in the same order,
+// as the scalar ones, and produce bit-identical results.
+class WallBuffer
+{
+public:
+    using Vertices = std::array<sf::Vector2f, 4>;
+
+private:
+    // Speeds and accelerations of all the walls, see `SpeedData`.
+    struct SpeedArrays
+    {
+        std::vector<float> speeds;
+        std::vector<float> accels;
+        std::vector<float> mins;
+        std::vector<float> maxs;
+        std::vector<unsigned char> pingPongs;
+
+        void clear() noexcept;
+        void add(const SpeedData& mSpeedData);
+        void eraseKilled(const std::vector<unsigned char>& mKilled) noexcept;
+
+        // Same operations as `SpeedData::update`.
+        void update(ssvu::FT mFT) noexcept;
+    };
+
+    std::vector<float> xs; // Current positions
+    std::vector<float> ys; //
+
+    // Positions at the start of the current tick, only used for drawing.
+    std::vector<float> prevXs;
+    std::vector<float> prevYs;
+
+    SpeedArrays speeds;
+    SpeedArrays curves;
+    std::vector<float> hueMods;
+    std::vector<unsigned char> killed;
+
+    // Movement of the current tick, for the walls that existed when it was
+    // computed.
+    std::vector<float> steps;    // Distance moved towards the center
+    std::vector<float> angles;   // Angle rotated around the center
+    std::vector<float> movedXs;  // Positions, moved towards the center
+    std::vector<float> movedYs;  //
+    std::vector<float> curvedXs; // Positions, moved and curved
+    std::vector<float> curvedYs; //
+
+    [[gnu::always_inline, nodiscard]] static Vertices getVertices(
+        const std::vector<float>& mXs, const std::vector<float>& mYs,
+        const std::size_t mIdx) noexcept
+    {
+        const std::size_t k{mIdx * 4};
+
+        return {sf::Vector2f{mXs[k], mYs[k]},
+            sf::Vector2f{mXs[k + 1], mYs[k + 1]},
+            sf::Vector2f{mXs[k + 2], mYs[k + 2]},
+            sf::Vector2f{mXs[k + 3], mYs[k + 3]}};
+    }
+
+public:
+    void clear() noexcept;
+
+    void add(const Vertices& mVertexPositions, const SpeedData& mSpeed,
+        const SpeedData& mCurve, float mHueMod);
+
+    // Removes the killed walls, keeping the order of the remaining ones.
+    void eraseKilled() noexcept;
+
+    void savePreviousState();
+
+    // Applies the accelerations, and computes how much every wall moves and
+    // rotates in this tick.
+    void updateSpeeds(ssvu::FT mFT);
+
+    // Moves the vertices towards the center, except the ones already within
+    // `mRadius` of it. Walls with all of them within are killed.
+    void moveTowardsCenter(const sf::Vector2f& mCenterPos, float mRadius);
+    void moveTowardsCenterScalar(const sf::Vector2f& mCenterPos, float mRadius);
+
+    // Rotates the moved vertices around the center.
+    void rotateAroundCenter(const sf::Vector2f& mCenterPos);
+    void rotateAroundCenterScalar(const sf::Vector2f& mCenterPos);
+
+    // Makes the moved and curved positions current. Walls added since the
+    // movement was computed are left in place.
+    void applyMovement() noexcept;
+
+    [[gnu::always_inline, nodiscard]] std::size_t size() const noexcept
+    {
+        return hueMods.size();
+    }
+
+    [[gnu::always_inline, nodiscard]] bool empty() const noexcept
+    {
+        return hueMods.empty();
+    }
+
+    // Number of walls whose movement was computed in this tick.
+    [[gnu::always_inline, nodiscard]] std::size_t
+    getMovedCount() const noexcept
+    {
+        return steps.size();
+    }
+
+    [[gnu::always_inline, nodiscard]] Vertices getVertexPositions(
+        const std::size_t mIdx) const noexcept
+    {
+        return getVertices(xs, ys, mIdx);
+    }
+
+    [[gnu::always_inline, nodiscard]] Vertices getPrevVertexPositions(
+        const std::size_t mIdx) const noexcept
+    {
+        return getVertices(prevXs, prevYs, mIdx);
+    }
+
+    [[gnu::always_inline, nodiscard]] Vertices getMoved(
+        const std::size_t mIdx) const noexcept
+    {
+        return getVertices(movedXs, movedYs, mIdx);
+    }
+
+    [[gnu::always_inline, nodiscard]] Vertices getCurved(
+        const std::size_t mIdx) const noexcept
+    {
+        return getVertices(curvedXs, curvedYs, mIdx);
+    }
+
+    [[gnu::always_inline, nodiscard]] float getSpeed(
+        const std::size_t mIdx) const noexcept
+    {
+        return speeds.speeds[mIdx];
+    }
+
+    [[gnu::always_inline, nodiscard]] float getCurveSpeed(
+        const std::size_t mIdx) const noexcept
+    {
+        return curves.speeds[mIdx];
+    }
+
+    [[gnu::always_inline, nodiscard]] float getHueMod(
+        const std::size_t mIdx) const noexcept
+    {
+        return hueMods[mIdx];
+    }
+
+    [[gnu::always_inline, nodiscard]] bool isKilled(
+        const std::size_t mIdx) const noexcept
+    {
+        return killed[mIdx] != 0;
+    }
+
+    // Name of the instruction set used by the vectorized kernels.
+    [[nodiscard]] static const char* getKernelName() noexcept;
+};
+
+} // namespace hg
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "SSVOpenHexagon/Utils/ObfuscatedValue.hpp"
+#include "SSVOpenHexagon/Utils/TickClock.hpp"
 
 #include <SFML/Graphics/Color.hpp>
 
@@ -23,17 +24,25 @@ enum class StateChange
 struct HexagonGameStatus
 {
 public:
-    using Clock = std::chrono::high_resolution_clock;
-    using TimePoint = std::chrono::time_point<Clock>;
+    using Clock = Utils::tick_clock;
+    using TimePoint = Clock::time_point;
+    using Duration = Clock::duration;
 
 private:
-    double totalFrametimeAccumulator{};  // Total time (including pauses)
-    double playedFrametimeAccumulator{}; // Played time (no pauses)
-    double pausedFrametimeAccumulator{}; // Paused time (only pauses)
-    double currentPause{0.1 * 60};       // Current pause time
-    double currentIncrementTime{};       // Time since last increment
+    static constexpr Duration initialPause{Clock::ticks_per_second / 10};
+    static constexpr double legacyInitialPause{0.1 * 60};
+
+    Duration totalTime{};                // Total time (including pauses)
+    Duration playedTime{};               // Played time (no pauses)
+    Duration pausedTime{};               // Paused time (only pauses)
+    Duration currentPause{initialPause}; // Current pause time
+    Duration currentIncrementTime{};     // Time since last increment
     float customScore{};                 // Value for alternative scoring
 
+    // Clock of the replays recorded before `replay_version_tick_clock`
+    bool legacyClock{false};
+    double legacyPause{legacyInitialPause}; // Current pause time, in frames
+
 public:
     float pulse{75};
     float pulseDirection{1};
@@ -59,6 +68,19 @@ public:
     // Reset all the time points and signal that we started
     void start() noexcept;
 
+    // Use the clock older replays were recorded with: timeline time points
+    // and waits count whole milliseconds, truncated, instead of ticks, and
+    // pauses count down in frames.
+    void setLegacyClock(const bool legacy) noexcept;
+    [[nodiscard]] bool getLegacyClock() const noexcept;
+
+    // Timeline wait of `seconds`
+    [[nodiscard]] Duration getWaitFromSeconds(
+        const double seconds) const noexcept;
+
+    // Timeline wait of `ft` frames (under the assumption of 60 FPS)
+    [[nodiscard]] Duration getWaitFromFrametime(const double ft) const noexcept;
+
     // Number of seconds that have passed since last increment
     [[nodiscard]] double getIncrementTimeSeconds() noexcept;
 
@@ -86,6 +108,9 @@ public:
     // Accumulate the time spent in a frame into the total
     void accumulateFrametime(const double ft) noexcept;
 
+    // Accumulate the time spent in a step into the total
+    void accumulateTime(const Duration d) noexcept;
+
     // Update the custom score
     void updateCustomScore(const float score) noexcept;
 
@@ -5,25 +5,20 @@
 #pragma once
 
 #include "SSVOpenHexagon/Core/HGStatus.hpp"
+#include "SSVOpenHexagon/Core/HexagonSimulation.hpp"
 #include "SSVOpenHexagon/Core/Steam.hpp"
 #include "SSVOpenHexagon/Core/RandomNumberGenerator.hpp"
 #include "SSVOpenHexagon/Core/Replay.hpp"
+#include "SSVOpenHexagon/Core/ReplayKeyframes.hpp"
+#include "SSVOpenHexagon/Core/ReplayStreamWriter.hpp"
 #include "SSVOpenHexagon/Core/Discord.hpp"
 #include "SSVOpenHexagon/Data/LevelData.hpp"
-#include "SSVOpenHexagon/Data/MusicData.hpp"
 #include "SSVOpenHexagon/Data/StyleData.hpp"
-#include "SSVOpenHexagon/Components/CPlayer.hpp"
-#include "SSVOpenHexagon/Components/CWall.hpp"
 #include "SSVOpenHexagon/Global/Assets.hpp"
 #include "SSVOpenHexagon/Global/Config.hpp"
 #include "SSVOpenHexagon/Utils/Utils.hpp"
 #include "SSVOpenHexagon/Utils/FPSWatcher.hpp"
-#include "SSVOpenHexagon/Utils/LuaWrapper.hpp"
 #include "SSVOpenHexagon/Utils/FastVertexVector.hpp"
-#include "SSVOpenHexagon/Utils/LuaMetadata.hpp"
-#include "SSVOpenHexagon/Utils/LuaMetadataProxy.hpp"
-#include "SSVOpenHexagon/Utils/Timeline2.hpp"
-#include "SSVOpenHexagon/Components/CCustomWallManager.hpp"
 #include "SSVOpenHexagon/SSVUtilsJson/SSVUtilsJson.hpp"
 
 #include <SSVStart/GameSystem/GameSystem.hpp>
@@ -39,8 +34,9 @@
 #include <SFML/System.hpp>
 #include <SFML/Window.hpp>
 
+#include <array>
+#include <cstddef>
 #include <sstream>
-#include <unordered_set>
 #include <optional>
 
 namespace hg
@@ -57,15 +53,15 @@ private:
     Discord::discord_manager& discordManager;
 
     HGAssets& assets;
-    const LevelData* levelData;
 
     ssvs::GameState game;
     ssvs::GameWindow& window;
 
+    // Gameplay state lives here, this class only handles input, audio, and
+    // rendering on top of it.
+    HexagonSimulation simulation;
+
 public:
-    CPlayer player;
-    std::vector<CWall> walls;
-    CCustomWallManager cwManager;
     float timeUntilRichPresenceUpdate = 0.f;
 
 private:
@@ -79,24 +75,6 @@ private:
 
     ssvu::TimelineManager effectTimelineManager;
 
-    const sf::Vector2f centerPos{ssvs::zeroVec2f};
-
-    Lua::LuaContext lua;
-    std::unordered_set<std::string> calledDeprecatedFunctions;
-
-    LevelStatus levelStatus;
-    MusicData musicData;
-    StyleData styleData;
-
-    Utils::timeline2 timeline;
-    Utils::timeline2_runner timelineRunner;
-
-    Utils::timeline2 eventTimeline;
-    Utils::timeline2_runner eventTimelineRunner;
-
-    Utils::timeline2 messageTimeline;
-    Utils::timeline2_runner messageTimelineRunner;
-
     sf::Text messageText{"", assets.get<sf::Font>("forcedsquare.ttf"),
         ssvu::toNum<unsigned int>(38.f / Config::getZoomFactor())};
 
@@ -108,38 +86,62 @@ private:
     sf::Sprite keyIconSwap;
     sf::Sprite replayIcon;
 
-    bool firstPlay{true};
     bool restartFirstTime{true};
     bool inputFocused{false};
     bool inputSwap{false};
     bool mustTakeScreenshot{false};
-    bool mustChangeSides{false};
 
-    random_number_generator rng;
-    HexagonGameStatus status;
+    // Replay seeking: a keyframe every 5 seconds (in ticks), enough of them
+    // to cover runs longer than 10 minutes.
+    inline static constexpr std::size_t replayKeyframeInterval{
+        5 * Utils::tick_clock::ticks_per_second /
+        HexagonSimulation::tickDuration.count()};
+    inline static constexpr std::size_t replayKeyframeCapacity{128};
+    inline static constexpr double replaySeekStepSeconds{5.0};
 
     struct ActiveReplay
     {
         replay_file replayFile;
         replay_player replayPlayer;
+        replay_keyframes keyframes;
         std::string replayPackName;
         std::string replayLevelName;
 
+        // Number of played inputs after which the simulation state first
+        // differed from the recorded one, if it did.
+        std::optional<std::size_t> desyncTick;
+
         ActiveReplay(const replay_file& mReplayFile)
-            : replayFile{mReplayFile}, replayPlayer{replayFile._data}
+            : replayFile{mReplayFile}, replayPlayer{replayFile._data},
+              keyframes{replayKeyframeInterval, replayKeyframeCapacity}
         {
         }
     };
 
     std::optional<ActiveReplay> activeReplay;
 
+    // Replay playback speeds. One past the last index means "as fast as
+    // possible": ticks are run for a fixed time budget every frame.
+    inline static constexpr std::array<float, 6> replaySpeeds{
+        0.25f, 0.5f, 1.f, 2.f, 4.f, 8.f};
+
+    inline static constexpr std::size_t defaultReplaySpeedIndex{2};
+
+    std::size_t replaySpeedIndex{defaultReplaySpeedIndex};
+
+    // Set while seeking, to skip sounds of the re-simulated ticks.
+    bool fastForwarding{false};
+
     random_number_generator::seed_type lastSeed;
     replay_data lastReplayData;
+    std::vector<std::uint32_t> lastStateHashes;
     bool lastFirstPlay;
     double lastPlayedScore;
 
+    // Streams the run in progress to disk, so that it survives a crash.
+    replay_stream_writer replayStreamWriter{"Replays/recording.ohreplay.part"};
+
     std::string restartId;
-    float difficultyMult{1};
     int inputImplLastMovement{0};
     int inputMovement{0};
     bool inputImplCW{false};
@@ -147,6 +149,11 @@ private:
     bool inputImplBothCWCCW{false};
     std::ostringstream os;
 
+    // Frametime not yet consumed by simulation ticks, and how far drawing is
+    // between the previous tick and the current one (`[0, 1]`).
+    ssvu::FT tickAccumulator{0.f};
+    float interpolationAlpha{1.f};
+
     FPSWatcher fpsWatcher;
     sf::Text fpsText{"0", assets.get<sf::Font>("forcedsquare.ttf"),
         ssvu::toNum<unsigned int>(25.f / Config::getZoomFactor())};
@@ -166,92 +173,9 @@ private:
         float y;
     };
 
-    Utils::LuaMetadata luaMetadata;
-
-    std::string packId;
-    std::string levelId;
-
-    // Lua related methods
-    void redefineLuaFunctions();
-    void destroyMaliciousFunctions();
-    void initLua_Utils();
-    void initLua_AudioControl();
-    void initLua_MainTimeline();
-    void initLua_EventTimeline();
-    void initLua_LevelControl();
-    void initLua_StyleControl();
-    void initLua_WallCreation();
-    void initLua_Steam();
-    void initLua_CustomWalls();
-    void initLua_Deprecated();
-
-    void initLua();
-    void runLuaFile(const std::string& mFileName)
-    {
-        try
-        {
-            Utils::runLuaFile(lua, mFileName);
-        }
-        catch(...)
-        {
-            death();
-        }
-    }
-
-    // Wall creation
-    void createWall(int mSide, float mThickness, const SpeedData& mSpeed,
-        const SpeedData& mCurve = SpeedData{}, float mHueMod = 0);
+    void initSimulationHooks();
 
 public:
-    template <typename T, typename... TArgs>
-    T runLuaFunction(const std::string& mName, const TArgs&... mArgs)
-    {
-        try
-        {
-            return Utils::runLuaFunction<T, TArgs...>(lua, mName, mArgs...);
-        }
-        catch(const std::runtime_error& mError)
-        {
-            std::cout << "[runLuaFunction] Runtime error on \"" << mName
-                      << "\" with level \"" << levelData->name << "\": \n"
-                      << ssvu::toStr(mError.what()) << "\n"
-                      << std::endl;
-
-            if(!Config::getDebug())
-            {
-                goToMenu(false /* mSendScores */, true /* mError */);
-            }
-        }
-        return T();
-    }
-
-    template <typename T, typename... TArgs>
-    auto runLuaFunctionIfExists(const std::string& mName, const TArgs&... mArgs)
-    {
-        try
-        {
-            return Utils::runLuaFunctionIfExists<T, TArgs...>(
-                lua, mName, mArgs...);
-        }
-        catch(std::runtime_error& mError)
-        {
-            std::cout << "[runLuaFunctionIfExists] Runtime error on \"" << mName
-                      << "\" with level \"" << levelData->name << "\": \n"
-                      << ssvu::toStr(mError.what()) << "\n"
-                      << std::endl;
-
-            if(!Config::getDebug())
-            {
-                goToMenu(false /* mSendScores */, true /* mError */);
-            }
-        }
-
-        return decltype(
-            Utils::runLuaFunctionIfExists<T, TArgs...>(lua, mName, mArgs...)){};
-    }
-
-    void raiseWarning(
-        const std::string& mFunctionName, const std::string& mAdditionalInfo);
     void setLastReplay(const replay_file& mReplayFile);
 
 private:
@@ -262,42 +186,35 @@ private:
 
     // Update methods
     void update(ssvu::FT mFT);
-    void updateInput();
-    void updateWalls(ssvu::FT mFT);
-    void updateIncrement();
-    void updateEvents(ssvu::FT mFT);
-    void updateLevel(ssvu::FT mFT);
-    void updateCustomWalls(ssvu::FT mFT);
-    void updatePulse(ssvu::FT mFT);
-    void updateBeatPulse(ssvu::FT mFT);
-    void updateRotation(ssvu::FT mFT);
-    void updateFlash(ssvu::FT mFT);
-    void update3D(ssvu::FT mFT);
+    void updateTicks(ssvu::FT mFT);
+    void updateTicksTurbo();
+    void updateTick();
+    [[nodiscard]] input_bitset updateInput();
+    void updatePulse();
+    void updateFlash();
     void updateText();
     void updateKeyIcons();
 
     // Draw methods
     void draw();
-
-    // Gameplay methods
-    void incrementDifficulty();
-    void sideChange(unsigned int mSideNumber);
-
-    // Draw methods
+    void drawWalls();
     void drawText_TimeAndStatus(const sf::Color& offsetColor);
     void drawText_Message(const sf::Color& offsetColor);
     void drawText();
     void drawKeyIcons();
 
     // Data-related methods
-    void setLevelData(const LevelData& mLevelData, bool mMusicFirstPlay);
     void playLevelMusic();
     void playLevelMusicAtTime(float mSeconds);
     void stopLevelMusic();
+    void resetLevelAudio();
+
+    // Applies the current pitch, which follows the replay speed, to the
+    // level music. The music is kept paused during turbo replay playback.
+    void refreshLevelMusic();
+    void resumeLevelMusicAtCurrentTime();
 
-    // Message-related methods
-    void addMessage(std::string mMessage, double mDuration, bool mSoundToggle);
-    void clearMessages();
+    void onDeath();
 
     enum class CheckSaveScoreResult
     {
@@ -317,30 +234,6 @@ private:
 
     void invalidateScore(const std::string& mReason);
 
-
-    template <typename F>
-    Utils::LuaMetadataProxy addLuaFn(const std::string& name, F&& f)
-    {
-        lua.writeVariable(name, std::forward<F>(f));
-        return Utils::LuaMetadataProxy{f, luaMetadata, name};
-    }
-
-    void printLuaDocs()
-    {
-        for(std::size_t i = 0; i < luaMetadata.getNumCategories(); ++i)
-        {
-            std::cout << '\n' << luaMetadata.prefixHeaders.at(i) << "\n\n";
-
-            luaMetadata.forFnEntries(
-                [](const std::string& ret, const std::string& name,
-                    const std::string& args, const std::string& docs) {
-                    std::cout << "* **`" << ret << " " << name << "(" << args
-                              << ")`**: " << docs << "\n\n";
-                },
-                i);
-        }
-    }
-
 public:
     Utils::FastVertexVector<sf::PrimitiveType::Quads> wallQuads;
     Utils::FastVertexVector<sf::PrimitiveType::Triangles> playerTris;
@@ -364,103 +257,56 @@ public:
         bool mFirstPlay, float mDifficultyMult, bool executeLastReplay);
     void death(bool mForce = false);
 
-    // Other methods
-    void executeEvents(ssvuj::Obj& mRoot, float mTime);
-
     // Graphics-related methods
     void render(sf::Drawable& mDrawable)
     {
         window.draw(mDrawable);
     }
 
-    // Setters
-    void setSides(unsigned int mSides);
-
     // Getters
     [[nodiscard]] ssvs::GameState& getGame() noexcept
     {
         return game;
     }
 
-    [[nodiscard]] float getRadius() const noexcept
-    {
-        return status.radius;
-    }
-
-    [[nodiscard]] const sf::Color& getColor(int mIdx) const noexcept
+    [[nodiscard]] HexagonSimulation& getSimulation() noexcept
     {
-        return styleData.getColor(mIdx);
+        return simulation;
     }
 
-    [[nodiscard]] float getSpeedMultDM() const noexcept
-    {
-        const auto res =
-            levelStatus.speedMult * (std::pow(difficultyMult, 0.65f));
-
-        if(!levelStatus.hasSpeedMaxLimit())
-        {
-            return res;
-        }
-
-        return (res < levelStatus.speedMax) ? res : levelStatus.speedMax;
-    }
-
-    [[nodiscard]] float getDelayMultDM() const noexcept
+    [[nodiscard]] float getRadius() const noexcept
     {
-        const auto res =
-            levelStatus.delayMult / (std::pow(difficultyMult, 0.10f));
-
-        if(!levelStatus.hasDelayMaxLimit())
-        {
-            return res;
-        }
-
-        return (res < levelStatus.delayMax) ? res : levelStatus.delayMax;
+        return simulation.getRadius();
     }
 
-    [[nodiscard]] float getRotationSpeed() const noexcept
+    [[nodiscard]] const sf::Color& getColor(int mIdx) const noexcept
     {
-        return levelStatus.rotationSpeed;
+        return simulation.getStyleData().getColor(mIdx);
     }
 
     [[nodiscard]] unsigned int getSides() const noexcept
     {
-        return levelStatus.sides;
-    }
-
-    [[nodiscard]] float getWallSkewLeft() const noexcept
-    {
-        return levelStatus.wallSkewLeft;
-    }
-
-    [[nodiscard]] float getWallSkewRight() const noexcept
-    {
-        return levelStatus.wallSkewRight;
-    }
-
-    [[nodiscard]] float getWallAngleLeft() const noexcept
-    {
-        return levelStatus.wallAngleLeft;
+        return simulation.getSides();
     }
 
-    [[nodiscard]] float getWallAngleRight() const noexcept
+    [[nodiscard]] float getInterpolationAlpha() const noexcept
     {
-        return levelStatus.wallAngleRight;
+        return interpolationAlpha;
     }
 
     [[nodiscard]] float get3DEffectMult() const noexcept
     {
-        return levelStatus._3dEffectMultiplier;
+        return simulation.getLevelStatus()._3dEffectMultiplier;
     }
 
     [[nodiscard]] HexagonGameStatus& getStatus()
     {
-        return status;
+        return simulation.getStatus();
     }
 
     [[nodiscard]] LevelStatus& getLevelStatus()
     {
-        return levelStatus;
+        return simulation.getLevelStatus();
     }
 
     [[nodiscard]] HGAssets& getAssets()
@@ -472,30 +318,28 @@ public:
     [[nodiscard]] sf::Color getColorPlayer() const;
     [[nodiscard]] sf::Color getColorText() const;
 
-    [[nodiscard]] float getMusicDMSyncFactor() const
-    {
-        return levelStatus.syncMusicToDM ? std::pow(difficultyMult, 0.12f)
-                                         : 1.f;
-    }
-
     void setMusicPitch(sf::Music& current)
     {
-        current.setPitch((getMusicDMSyncFactor()) *
-                         Config::getMusicSpeedMult() * levelStatus.musicPitch);
+        current.setPitch(simulation.getMusicDMSyncFactor() *
+                         Config::getMusicSpeedMult() *
+                         simulation.getLevelStatus().musicPitch *
+                         getReplaySpeed());
     }
 
-    // Input
+    // Replay playback speed
+    [[nodiscard]] bool isReplayTurbo() const noexcept;
+    [[nodiscard]] float getReplaySpeed() const noexcept;
+    void changeReplaySpeed(int mOffset);
+
+    // Replay seeking, `mTick` is the number of replay inputs consumed
+    void seekReplay(std::size_t mTick);
+    void seekReplayBy(double mSeconds);
+
+    // Input, as last fed to the simulation
     [[nodiscard]] bool getInputFocused() const;
-    [[nodiscard]] float getPlayerSpeedMult() const;
     [[nodiscard]] bool getInputSwap() const;
     [[nodiscard]] int getInputMovement() const;
 
-    template <typename F>
-    [[nodiscard]] bool anyCustomWall(F&& f)
-    {
-        return cwManager.anyCustomWall(std::forward<F>(f));
-    }
-
     // Pack information
     [[nodiscard]] const std::string& getPackId() const noexcept;
     [[nodiscard]] const std::string& getPackDisambiguator() const noexcept;
@@ -506,8 +350,6 @@ public:
     [[nodiscard]] bool inReplay() const noexcept;
     [[nodiscard]] bool mustReplayInput() const noexcept;
     [[nodiscard]] bool mustShowReplayUI() const noexcept;
-
-    [[nodiscard]] float getSwapCooldown() const noexcept;
 };
 
 } // namespace hg
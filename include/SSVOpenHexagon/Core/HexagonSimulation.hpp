@@ -0,0 +1,859 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#pragma once
+
+#include "SSVOpenHexagon/Core/HGStatus.hpp"
+#include "SSVOpenHexagon/Core/RandomNumberGenerator.hpp"
+#include "SSVOpenHexagon/Core/Replay.hpp"
+#include "SSVOpenHexagon/Data/LevelData.hpp"
+#include "SSVOpenHexagon/Data/MusicData.hpp"
+#include "SSVOpenHexagon/Data/StyleData.hpp"
+#include "SSVOpenHexagon/Components/CPlayer.hpp"
+#include "SSVOpenHexagon/Components/WallBuffer.hpp"
+#include "SSVOpenHexagon/Components/CCustomWallManager.hpp"
+#include "SSVOpenHexagon/Global/Config.hpp"
+#include "SSVOpenHexagon/Utils/Utils.hpp"
+#include "SSVOpenHexagon/Utils/LuaWrapper.hpp"
+#include "SSVOpenHexagon/Utils/LuaBytecodeCache.hpp"
+#include "SSVOpenHexagon/Utils/LuaMetadata.hpp"
+#include "SSVOpenHexagon/Utils/LuaMetadataProxy.hpp"
+#include "SSVOpenHexagon/Utils/LuaPoolAllocator.hpp"
+#include "SSVOpenHexagon/Utils/LuaProfiler.hpp"
+#include "SSVOpenHexagon/Utils/LuaSnapshot.hpp"
+#include "SSVOpenHexagon/Utils/TickClock.hpp"
+#include "SSVOpenHexagon/Utils/Timeline2.hpp"
+
+#include <SSVStart/Utils/Vector2.hpp>
+
+#include <SSVUtils/Core/Common/Frametime.hpp>
+
+#include <SFML/System/Vector2.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace hg
+{
+
+class HGAssets;
+
+// Headless gameplay core of a level: owns everything that affects the
+// outcome of a run (player, walls, Lua, timelines, RNG, status) and advances
+// it by one tick at a time from an `input_bitset`. It never touches a window,
+// camera, or audio device: presentation side effects are routed through the
+// optional `Hooks` below, which are left empty when running without a window
+// (e.g. replay verification).
+class HexagonSimulation
+{
+public:
+    // Length of a simulation tick (120 Hz). Replays store one input per tick,
+    // so this must not change without bumping the replay format.
+    inline static constexpr ssvu::FT tickFT{0.5f};
+
+    // The same tick on the game clock, which timelines and the timer use.
+    inline static constexpr Utils::tick_clock::duration tickDuration{
+        Utils::tick_clock::ticks_per_second / 120};
+
+    static_assert(tickDuration.count() ==
+                  tickFT * Utils::tick_clock::ticks_per_frametime);
+
+    struct Hooks
+    {
+        // Invoked by `newGame` once the level data has been loaded and the
+        // state has been reset, right before the level's Lua script runs.
+        std::function<void()> onNewGame;
+
+        std::function<void(const std::string&)> playSound;
+        std::function<void(const std::string&, const std::string&)>
+            playPackSound;
+
+        std::function<void()> playLevelMusic;
+        std::function<void(float)> playLevelMusicAtTime;
+        std::function<void()> stopLevelMusic;
+        std::function<void()> refreshMusicPitch;
+
+        std::function<void(const std::string&)> unlockAchievement;
+
+        std::function<bool(int)> isKeyPressed;
+        std::function<bool(int)> isMouseButtonPressed;
+
+        // Invoked whenever the player is hit, even if invincible.
+        std::function<void()> onPreDeath;
+
+        // Invoked once the player actually died.
+        std::function<void()> onDeath;
+
+        // Invoked when a Lua function raises an error outside of debug mode.
+        std::function<void()> onLuaError;
+    };
+
+    // Copy of the whole gameplay state, used to jump around in replays. The
+    // Lua part refers to the current Lua state, so snapshots must be
+    // discarded before calling `newGame`, which may replace it. Lua threads
+    // cannot be copied, so there is no pattern coroutine in a snapshot (see
+    // `canMakeSnapshot`).
+    struct Snapshot
+    {
+        LevelStatus levelStatus;
+        MusicData musicData;
+        StyleData styleData;
+
+        CPlayer player;
+        WallBuffer walls;
+        CCustomWallManager cwManager;
+
+        Utils::timeline2 timeline;
+        Utils::timeline2_runner timelineRunner;
+        Utils::timeline2 eventTimeline;
+        Utils::timeline2_runner eventTimelineRunner;
+        Utils::timeline2 messageTimeline;
+        Utils::timeline2_runner messageTimelineRunner;
+        unsigned int nextPatternId;
+
+        random_number_generator rng;
+        HexagonGameStatus status;
+        std::string message;
+
+        float rotation;
+        float lastRotation;
+        bool mustChangeSides;
+
+        int inputMovement;
+        bool inputFocused;
+        bool inputSwap;
+
+        Utils::LuaSnapshot luaSnapshot;
+    };
+
+    // Level callback run on every tick or gameplay event, called through a
+    // reference resolved from its global when the level is (re)loaded.
+    struct LuaCallback
+    {
+        const char* name;
+        Lua::LuaFunctionRef ref;
+    };
+
+    struct LuaCallbacks
+    {
+        LuaCallback onInput{"onInput", {}};
+        LuaCallback onUpdate{"onUpdate", {}};
+        LuaCallback onStep{"onStep", {}};
+        LuaCallback onCursorSwap{"onCursorSwap", {}};
+        LuaCallback onIncrement{"onIncrement", {}};
+        LuaCallback onDeath{"onDeath", {}};
+    };
+
+    struct LuaMemoryStats
+    {
+        std::size_t heapBytes{0};
+        std::size_t allocationsPerFrame{0};
+        std::chrono::microseconds gcStepDuration{0};
+    };
+
+    // Maximum number of distinct `t_eval`/`e_eval` code strings kept
+    // compiled, in case a level generates them at runtime.
+    static constexpr std::size_t maxEvalChunks{1024};
+
+    // Upper bound for `newGame` to feel instantaneous on restarts.
+    static constexpr std::chrono::milliseconds newGameBudget{16};
+
+private:
+    // State right after running the level script, restored by `newGame` on
+    // restarts of the same level instead of rebuilding the Lua state.
+    struct PreparedLevel
+    {
+        std::string packId;
+        std::string levelId;
+        float difficultyMult;
+        bool firstPlay;
+        bool legacyClock;
+        Snapshot snapshot;
+    };
+
+    HGAssets& assets;
+    const LevelData* levelData{nullptr};
+
+    Hooks hooks;
+
+    const sf::Vector2f centerPos{ssvs::zeroVec2f};
+
+    LevelStatus levelStatus;
+    MusicData musicData;
+    StyleData styleData;
+
+    CPlayer player;
+    WallBuffer walls;
+    CCustomWallManager cwManager;
+
+    // Per-level arena of the Lua state, released after the state is closed.
+    std::unique_ptr<Utils::LuaPoolAllocator> luaAllocator;
+    Lua::LuaContext lua;
+    Utils::LuaBytecodeCache luaBytecodeCache; // Survives restarts.
+    Utils::LuaProfiler luaProfiler; // Accumulates until `flushLuaProfile`.
+    std::optional<PreparedLevel> preparedLevel;
+    // Lua data right after the level script ran, shared by later snapshots.
+    std::optional<Utils::LuaSnapshot> luaLoadSnapshot;
+    bool seedQueried{false}; // If Lua read the seed since `prepareLevel`.
+
+    // Registry references to the compiled `t_eval`/`e_eval` code strings.
+    std::unordered_map<std::string, int> evalChunkRefs;
+
+    LuaCallbacks luaCallbacks;
+
+    // Coroutines spawned with `t_spawnPattern`, resumed by the main timeline.
+    // `runningPattern` is the thread being resumed, if any, and `patternWait`
+    // the wait it requested before yielding.
+    std::unordered_map<unsigned int, Lua::LuaCoroutine> patternCoroutines;
+    unsigned int nextPatternId{0};
+    lua_State* runningPattern{nullptr};
+    std::optional<Utils::timeline2::wait_action> patternWait;
+
+    // Heap size under which `stepLuaGC` never forces a full collection.
+    static constexpr int luaGCMinBackstopKB{16 * 1024};
+
+    // Ticks paid for by a single `stepLuaGC` call at most.
+    static constexpr std::size_t luaGCMaxStepTicks{1024};
+
+    bool luaGCStepped{false}; // If the automatic collector is stopped.
+    std::size_t luaTicksSinceGCStep{0};
+    int luaGCBackstopKB{luaGCMinBackstopKB};
+    std::size_t luaAllocationsAtLastGCStep{0};
+    LuaMemoryStats luaMemoryStats;
+
+    std::chrono::microseconds lastNewGameDuration{0};
+    bool lastNewGameReusedLevel{false};
+    std::unordered_set<std::string> calledDeprecatedFunctions;
+    Utils::LuaMetadata luaMetadata;
+
+    Utils::timeline2 timeline;
+    Utils::timeline2_runner timelineRunner;
+
+    Utils::timeline2 eventTimeline;
+    Utils::timeline2_runner eventTimelineRunner;
+
+    Utils::timeline2 messageTimeline;
+    Utils::timeline2_runner messageTimelineRunner;
+
+    random_number_generator rng;
+    HexagonGameStatus status;
+
+    std::string packId;
+    std::string levelId;
+    std::string message;
+
+    float difficultyMult{1};
+    float rotation{0.f};
+    float lastRotation{0.f};
+
+    bool firstPlay{true};
+    bool mustChangeSides{false};
+    bool luaErrorRaised{false};
+
+    int inputMovement{0};
+    bool inputFocused{false};
+    bool inputSwap{false};
+
+    // Lua related methods
+    void redefineLuaFunctions();
+    void destroyMaliciousFunctions();
+    void initLua_Utils();
+    void initLua_AudioControl();
+    void initLua_MainTimeline();
+    void initLua_EventTimeline();
+    void initLua_LevelControl();
+    void initLua_StyleControl();
+    void initLua_WallCreation();
+    void initLua_Steam();
+    void initLua_CustomWalls();
+    void initLua_Patterns();
+    void initLua_Deprecated();
+
+    void initLua();
+    void prepareLevel();
+    void resolveLuaCallbacks();
+    void runLuaFile(const std::string& mFileName)
+    {
+        const Utils::LuaProfiler::Scope profilerScope{
+            luaProfiler, mFileName.c_str()};
+
+        try
+        {
+            Utils::runLuaFile(lua, luaBytecodeCache, mFileName);
+        }
+        catch(...)
+        {
+            death();
+        }
+    }
+
+    void raiseLuaError();
+    void luaCallbackError(
+        const LuaCallback& mCallback, const std::runtime_error& mError);
+    void runEvalChunk(const std::string& mCode);
+
+    // Pattern coroutines
+    [[nodiscard]] bool inPatternCoroutine() noexcept;
+    void spawnPattern(const Lua::LuaFunctionRef& mFn);
+    [[nodiscard]] std::optional<Utils::timeline2::wait_action> resumePattern(
+        unsigned int mId);
+    [[nodiscard]] bool waitInPattern(Utils::timeline2::wait_action mWait);
+    void clearPatterns();
+
+    // Adds `mFn` to the main timeline. From a pattern coroutine it runs right
+    // away instead, as the coroutine is only resumed once it is due.
+    template <typename F>
+    void timelineDo(F&& mFn)
+    {
+        if(inPatternCoroutine())
+        {
+            mFn();
+            return;
+        }
+
+        timeline.append_do(std::forward<F>(mFn));
+    }
+
+    // Adds a wait of `mFrames` frames (at 60 FPS) to the main timeline, with
+    // the conversion of `t_wait`.
+    void timelineWait(const double mFrames)
+    {
+        timeline.append_wait_for(status.getWaitFromFrametime(mFrames));
+    }
+
+    // Wall creation
+    void createWall(int mSide, float mThickness, const SpeedData& mSpeed,
+        const SpeedData& mCurve = SpeedData{}, float mHueMod = 0);
+
+    // Native pattern library, mirrors the packs' `common.lua` and
+    // `commonpatterns.lua` (see `HGPatterns.cpp`)
+    [[nodiscard]] double getPatternThickness() const;
+    [[nodiscard]] int getHalfSides() const noexcept;
+    [[nodiscard]] int getRandomSide();
+    [[nodiscard]] int getRandomDir();
+    [[nodiscard]] double getPerfectDelay(double mThickness) const noexcept;
+    [[nodiscard]] double getPerfectThickness(double mThickness) const noexcept;
+    [[nodiscard]] int getSideDistance(int mSide1, int mSide2) const noexcept;
+    // Whether the `mName` pattern is called from a pattern coroutine, where
+    // it cannot run (logs a warning if so).
+    [[nodiscard]] bool rejectInPattern(const char* mName);
+
+    void cWall(int mSide, double mThickness);
+    void oWall(int mSide, double mThickness);
+    void rWall(int mSide, double mThickness);
+    void cWallEx(int mSide, int mExtra, double mThickness);
+    void oWallEx(int mSide, int mExtra, double mThickness);
+    void rWallEx(int mSide, int mExtra, double mThickness);
+    void cBarrageN(int mSide, int mNeighbors, double mThickness);
+    void cBarrage(int mSide, double mThickness);
+    void cBarrageOnlyN(int mSide, int mNeighbors, double mThickness);
+    void cAltBarrage(int mSide, int mStep, double mThickness);
+
+    void pAltBarrage(int mTimes, int mStep);
+    void pSpiral(int mTimes, int mExtra);
+    void pMirrorSpiral(int mTimes, int mExtra);
+    void pMirrorSpiralDouble(int mTimes, int mExtra);
+    void pBarrageSpiral(int mTimes, double mDelayMult, int mStep);
+    void pDMBarrageSpiral(int mTimes, double mDelayMult, int mStep);
+    void pWallExVortex(int mTimes, int mStep, int mExtraMult);
+    void pInverseBarrage(int mTimes);
+    void pRandomBarrage(int mTimes, double mDelayMult);
+    void pMirrorWallStrip(int mTimes, int mExtra);
+    void pTunnel(int mTimes);
+
+    // Update methods
+    void savePreviousState() noexcept;
+    void applyInput(const input_bitset& mInput) noexcept;
+    void updateWalls(ssvu::FT mFT);
+    void updateIncrement();
+    void updateEvents(ssvu::FT mFT);
+    void updateLevel(ssvu::FT mFT);
+    void updateCustomWalls(ssvu::FT mFT);
+    void updatePulse(ssvu::FT mFT);
+    void updateBeatPulse(ssvu::FT mFT);
+    void updateRotation(ssvu::FT mFT);
+    void updateFlash(ssvu::FT mFT);
+    void update3D(ssvu::FT mFT);
+
+    // Gameplay methods
+    void incrementDifficulty();
+    void sideChange(unsigned int mSideNumber);
+
+    // Data-related methods
+    void setLevelData(const LevelData& mLevelData, bool mMusicFirstPlay);
+    void playLevelMusic();
+    void playLevelMusicAtTime(float mSeconds);
+    void stopLevelMusic();
+    void refreshMusicPitch();
+
+    // Message-related methods
+    void addMessage(std::string mMessage, double mDuration, bool mSoundToggle);
+    void clearMessages();
+
+    template <typename F>
+    void writeLuaFn(const std::string& name, F f)
+    {
+        // Bindings only capture pointers, so they can be called through a
+        // plain C closure instead of a userdata with a `__call` metatable
+        if constexpr(std::is_trivially_destructible_v<F>)
+        {
+            lua.writeStaticFunction(name, f);
+        }
+        else
+        {
+            lua.writeVariable(name, f);
+        }
+    }
+
+    template <typename F>
+    Utils::LuaMetadataProxy addLuaFn(const std::string& name, F&& f)
+    {
+        if(luaProfiler.isAttached())
+        {
+            writeLuaFn(name, luaProfiler.wrapNative(name, f));
+        }
+        else
+        {
+            writeLuaFn(name, f);
+        }
+
+        return Utils::LuaMetadataProxy{f, luaMetadata, name};
+    }
+
+public:
+    explicit HexagonSimulation(HGAssets& mAssets);
+
+    HexagonSimulation(const HexagonSimulation&) = delete;
+    HexagonSimulation& operator=(const HexagonSimulation&) = delete;
+
+    void setHooks(Hooks mHooks)
+    {
+        hooks = std::move(mHooks);
+    }
+
+    // Resets the simulation and loads the given level. All randomness of the
+    // run is derived from `mSeed`. A replay is played back with the timing
+    // rules of the version it was recorded with, `mReplayVersion`.
+    void newGame(const std::string& mPackId, const std::string& mId,
+        bool mFirstPlay, float mDifficultyMult,
+        random_number_generator::seed_type mSeed,
+        std::uint32_t mReplayVersion = replay_version_latest);
+
+    void start();
+
+    // Makes the next `newGame` rebuild the Lua state and re-run the level
+    // script, e.g. because level files might have been reloaded.
+    void discardPreparedLevel() noexcept;
+
+    // Performs an incremental garbage collection step of the Lua state,
+    // meant to be called once per frame. The step pays for what was
+    // allocated since the previous one plus `mStepKB` kilobytes for every
+    // tick simulated since then, so that collection work is spread evenly
+    // and keeps up with fast replays. If the heap still grows past a limit,
+    // a full collection is forced. A non-positive value hands the
+    // collection back to Lua's automatic collector.
+    void stepLuaGC(int mStepKB);
+
+    [[nodiscard]] const LuaMemoryStats& getLuaMemoryStats() const noexcept
+    {
+        return luaMemoryStats;
+    }
+
+    // Writes the time profile of the level scripts collected since the last
+    // call, if the `lua_profiler` option is enabled.
+    void flushLuaProfile();
+
+    // Time spent in the last `newGame` call, and whether it could reuse the
+    // state prepared by a previous call.
+    [[nodiscard]] std::chrono::microseconds getLastNewGameDuration()
+        const noexcept
+    {
+        return lastNewGameDuration;
+    }
+
+    [[nodiscard]] bool getLastNewGameReusedLevel() const noexcept
+    {
+        return lastNewGameReusedLevel;
+    }
+
+    // Advances the simulation by one tick using `mInput` as the state of the
+    // player's controls. Does nothing gameplay-related until `start()` has
+    // been called. The state before the tick is kept for interpolation.
+    void step(const input_bitset& mInput, ssvu::FT mFT = tickFT);
+
+    void death(bool mForce = false);
+
+    // Snapshots can only be taken while no pattern coroutine is alive, as
+    // the main timeline would resume one from where it is now rather than
+    // from where it was.
+    [[nodiscard]] bool canMakeSnapshot() const noexcept;
+    [[nodiscard]] Snapshot makeSnapshot();
+    void restoreSnapshot(const Snapshot& mSnapshot);
+
+    void setSides(unsigned int mSides);
+    void raiseWarning(
+        const std::string& mFunctionName, const std::string& mAdditionalInfo);
+
+    template <typename T, typename... TArgs>
+    T runLuaFunction(const std::string& mName, const TArgs&... mArgs)
+    {
+        const Utils::LuaProfiler::Scope profilerScope{
+            luaProfiler, mName.c_str()};
+
+        try
+        {
+            return Utils::runLuaFunction<T, TArgs...>(lua, mName, mArgs...);
+        }
+        catch(const std::runtime_error& mError)
+        {
+            std::cout << "[runLuaFunction] Runtime error on \"" << mName
+                      << "\" with level \"" << levelData->name << "\": \n"
+                      << ssvu::toStr(mError.what()) << "\n"
+                      << std::endl;
+
+            raiseLuaError();
+        }
+        return T();
+    }
+
+    template <typename T, typename... TArgs>
+    auto runLuaFunctionIfExists(const std::string& mName, const TArgs&... mArgs)
+    {
+        const Utils::LuaProfiler::Scope profilerScope{
+            luaProfiler, mName.c_str()};
+
+        try
+        {
+            return Utils::runLuaFunctionIfExists<T, TArgs...>(
+                lua, mName, mArgs...);
+        }
+        catch(std::runtime_error& mError)
+        {
+            std::cout << "[runLuaFunctionIfExists] Runtime error on \"" << mName
+                      << "\" with level \"" << levelData->name << "\": \n"
+                      << ssvu::toStr(mError.what()) << "\n"
+                      << std::endl;
+
+            raiseLuaError();
+        }
+
+        return decltype(
+            Utils::runLuaFunctionIfExists<T, TArgs...>(lua, mName, mArgs...)){};
+    }
+
+    // Like `runLuaFunction`, an unresolved callback raises a Lua error.
+    template <typename T, typename... TArgs>
+    T runLuaCallback(const LuaCallback& mCallback, const TArgs&... mArgs)
+    {
+        const Utils::LuaProfiler::Scope profilerScope{
+            luaProfiler, mCallback.name};
+
+        try
+        {
+            return lua.callLuaFunction<T>(mCallback.ref, mArgs...);
+        }
+        catch(const std::runtime_error& mError)
+        {
+            luaCallbackError(mCallback, mError);
+        }
+
+        return T();
+    }
+
+    // Like `runLuaFunctionIfExists`, for callbacks that are optional.
+    template <typename T, typename... TArgs>
+    std::optional<Utils::VoidToNothing<T>> runLuaCallbackIfExists(
+        const LuaCallback& mCallback, const TArgs&... mArgs)
+    {
+        using Ret = std::optional<Utils::VoidToNothing<T>>;
+
+        if(!mCallback.ref)
+        {
+            return Ret{};
+        }
+
+        const Utils::LuaProfiler::Scope profilerScope{
+            luaProfiler, mCallback.name};
+
+        try
+        {
+            if constexpr(std::is_same_v<T, void>)
+            {
+                lua.callLuaFunction<void>(mCallback.ref, mArgs...);
+                return Ret{Utils::Nothing{}};
+            }
+            else
+            {
+                return Ret{lua.callLuaFunction<T>(mCallback.ref, mArgs...)};
+            }
+        }
+        catch(const std::runtime_error& mError)
+        {
+            luaCallbackError(mCallback, mError);
+        }
+
+        return Ret{};
+    }
+
+    [[nodiscard]] const LuaCallbacks& getLuaCallbacks() const noexcept
+    {
+        return luaCallbacks;
+    }
+
+    void printLuaDocs()
+    {
+        for(std::size_t i = 0; i < luaMetadata.getNumCategories(); ++i)
+        {
+            std::cout << '\n' << luaMetadata.prefixHeaders.at(i) << "\n\n";
+
+            luaMetadata.forFnEntries(
+                [](const std::string& ret, const std::string& name,
+                    const std::string& args, const std::string& docs) {
+                    std::cout << "* **`" << ret << " " << name << "(" << args
+                              << ")`**: " << docs << "\n\n";
+                },
+                i);
+        }
+    }
+
+    // Presentation side effects
+    void playSound(const std::string& mId);
+    void playPackSound(const std::string& mPackId, const std::string& mId);
+    void unlockAchievement(const std::string& mId);
+
+    // Getters
+    [[nodiscard]] const LevelData& getLevelData() const noexcept
+    {
+        return *levelData;
+    }
+
+    [[nodiscard]] HexagonGameStatus& getStatus() noexcept
+    {
+        return status;
+    }
+
+    [[nodiscard]] const HexagonGameStatus& getStatus() const noexcept
+    {
+        return status;
+    }
+
+    [[nodiscard]] LevelStatus& getLevelStatus() noexcept
+    {
+        return levelStatus;
+    }
+
+    [[nodiscard]] const LevelStatus& getLevelStatus() const noexcept
+    {
+        return levelStatus;
+    }
+
+    [[nodiscard]] MusicData& getMusicData() noexcept
+    {
+        return musicData;
+    }
+
+    [[nodiscard]] StyleData& getStyleData() noexcept
+    {
+        return styleData;
+    }
+
+    [[nodiscard]] const StyleData& getStyleData() const noexcept
+    {
+        return styleData;
+    }
+
+    [[nodiscard]] CPlayer& getPlayer() noexcept
+    {
+        return player;
+    }
+
+    [[nodiscard]] const WallBuffer& getWalls() const noexcept
+    {
+        return walls;
+    }
+
+    [[nodiscard]] CCustomWallManager& getCustomWallManager() noexcept
+    {
+        return cwManager;
+    }
+
+    [[nodiscard]] Lua::LuaContext& getLua() noexcept
+    {
+        return lua;
+    }
+
+    [[nodiscard]] const random_number_generator& getRng() const noexcept
+    {
+        return rng;
+    }
+
+    [[nodiscard]] std::size_t getNumCalledDeprecatedFunctions() const noexcept
+    {
+        return calledDeprecatedFunctions.size();
+    }
+
+    void clearCalledDeprecatedFunctions()
+    {
+        calledDeprecatedFunctions.clear();
+    }
+
+    [[nodiscard]] const std::string& getPackId() const noexcept
+    {
+        return packId;
+    }
+
+    [[nodiscard]] const std::string& getLevelId() const noexcept
+    {
+        return levelId;
+    }
+
+    [[nodiscard]] const std::string& getMessage() const noexcept
+    {
+        return message;
+    }
+
+    [[nodiscard]] float getDifficultyMult() const noexcept
+    {
+        return difficultyMult;
+    }
+
+    [[nodiscard]] bool getFirstPlay() const noexcept
+    {
+        return firstPlay;
+    }
+
+    [[nodiscard]] bool getLuaErrorRaised() const noexcept
+    {
+        return luaErrorRaised;
+    }
+
+    // Rotation of the background, in degrees, in the `[0, 360)` range.
+    [[nodiscard]] float getRotation() const noexcept
+    {
+        return rotation;
+    }
+
+    void setRotation(float mDegrees) noexcept;
+
+    // Rotation between the previous tick (`mAlpha == 0`) and the current one
+    // (`mAlpha == 1`), for drawing in between ticks.
+    [[nodiscard]] float getInterpolatedRotation(float mAlpha) const noexcept;
+
+    [[nodiscard]] float getRadius() const noexcept
+    {
+        return status.radius;
+    }
+
+    [[nodiscard]] float getSpeedMultDM() const noexcept
+    {
+        const auto res =
+            levelStatus.speedMult * (std::pow(difficultyMult, 0.65f));
+
+        if(!levelStatus.hasSpeedMaxLimit())
+        {
+            return res;
+        }
+
+        return (res < levelStatus.speedMax) ? res : levelStatus.speedMax;
+    }
+
+    [[nodiscard]] float getDelayMultDM() const noexcept
+    {
+        const auto res =
+            levelStatus.delayMult / (std::pow(difficultyMult, 0.10f));
+
+        if(!levelStatus.hasDelayMaxLimit())
+        {
+            return res;
+        }
+
+        return (res < levelStatus.delayMax) ? res : levelStatus.delayMax;
+    }
+
+    [[nodiscard]] float getRotationSpeed() const noexcept
+    {
+        return levelStatus.rotationSpeed;
+    }
+
+    [[nodiscard]] unsigned int getSides() const noexcept
+    {
+        return levelStatus.sides;
+    }
+
+    [[nodiscard]] float getWallSkewLeft() const noexcept
+    {
+        return levelStatus.wallSkewLeft;
+    }
+
+    [[nodiscard]] float getWallSkewRight() const noexcept
+    {
+        return levelStatus.wallSkewRight;
+    }
+
+    [[nodiscard]] float getWallAngleLeft() const noexcept
+    {
+        return levelStatus.wallAngleLeft;
+    }
+
+    [[nodiscard]] float getWallAngleRight() const noexcept
+    {
+        return levelStatus.wallAngleRight;
+    }
+
+    [[nodiscard]] float getMusicDMSyncFactor() const noexcept
+    {
+        return levelStatus.syncMusicToDM ? std::pow(difficultyMult, 0.12f)
+                                         : 1.f;
+    }
+
+    [[nodiscard]] float getPlayerSpeedMult() const noexcept
+    {
+        return levelStatus.playerSpeedMult;
+    }
+
+    [[nodiscard]] float getSwapCooldown() const noexcept;
+
+    // Score as stored in replay files: the custom score if the level sets
+    // one, otherwise the played time in frames.
+    [[nodiscard]] double getReplayScore() const noexcept;
+
+    // Hash of the player, walls, RNG and played time, recorded in replays to
+    // detect desyncs during playback.
+    [[nodiscard]] std::uint32_t computeStateHash() const noexcept;
+
+    // Input
+    [[nodiscard]] int getInputMovement() const noexcept
+    {
+        return inputMovement;
+    }
+
+    [[nodiscard]] bool getInputFocused() const noexcept
+    {
+        return inputFocused;
+    }
+
+    [[nodiscard]] bool getInputSwap() const noexcept
+    {
+        return inputSwap;
+    }
+
+    template <typename F>
+    [[nodiscard]] bool anyCustomWall(F&& f)
+    {
+        return cwManager.anyCustomWall(std::forward<F>(f));
+    }
+};
+
+} // namespace hg
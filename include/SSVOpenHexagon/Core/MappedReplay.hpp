@@ -0,0 +1,62 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#pragma once
+
+#include "SSVOpenHexagon/Core/Replay.hpp"
+
+#include <cstddef>
+#include <filesystem>
+
+namespace hg
+{
+
+// Read-only memory mapping of a whole file.
+class mapped_file
+{
+private:
+    const std::byte* _data{nullptr};
+    std::size_t _size{0};
+
+#ifdef _WIN32
+    void* _file_handle{nullptr};
+    void* _mapping_handle{nullptr};
+#endif
+
+public:
+    mapped_file() noexcept = default;
+    ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    [[nodiscard]] bool open(const std::filesystem::path& p);
+    void close() noexcept;
+
+    [[nodiscard]] const std::byte* data() const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept;
+};
+
+// Replay file read through a memory mapping. The input data of uncompressed
+// replays is not copied: players decode it directly from the mapping, which
+// must thus outlive them. Compressed input data is decoded into
+// `get_replay_file()._data` instead.
+class mapped_replay_file
+{
+private:
+    mapped_file _file;
+    replay_file _replay_file;
+    packed_inputs _inputs;
+
+public:
+    [[nodiscard]] bool open(const std::filesystem::path& p);
+
+    // Input data is empty unless the replay is compressed.
+    [[nodiscard]] const replay_file& get_replay_file() const noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] replay_player make_player() const noexcept;
+};
+
+} // namespace hg
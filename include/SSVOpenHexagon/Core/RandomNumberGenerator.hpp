@@ -7,6 +7,7 @@
 #include <SSVUtils/Internal/PCG/PCG.hpp>
 
 #include <cassert>
+#include <cstdint>
 #include <random>
 
 namespace hg
@@ -26,6 +27,9 @@ public:
 
     [[nodiscard]] seed_type seed() const noexcept;
 
+    // Next value the generator would produce, without advancing it.
+    [[nodiscard]] std::uint32_t fingerprint() const noexcept;
+
     template <typename T>
     [[nodiscard]] T get_int(const T min, const T max) noexcept
     {
@@ -27,9 +27,41 @@ enum class input_bit : unsigned int
     k_count
 };
 
-// TODO: optimize size - `sizeof` this is `4`
 using input_bitset = std::bitset<static_cast<unsigned int>(input_bit::k_count)>;
 
+[[nodiscard]] input_bitset make_input_bitset(const bool left, const bool right,
+    const bool swap, const bool focus) noexcept;
+
+// Replay format versions, stored in `replay_file::_version`:
+// * `0`: one byte per input.
+// * `1` and later: inputs packed in 4 bits, long runs run-length encoded.
+// * `2` and later: a flags byte follows the version, and the input data is
+//   stored after all the other fields, optionally zlib-compressed.
+// * `3` and later: same format, recorded with timeline waits rounded to
+//   ticks of `Utils::tick_clock`. Earlier replays are played back with the
+//   millisecond clock they were recorded with.
+inline constexpr std::uint32_t replay_version_unpacked{0};
+inline constexpr std::uint32_t replay_version_packed{1};
+inline constexpr std::uint32_t replay_version_header_first{2};
+inline constexpr std::uint32_t replay_version_tick_clock{3};
+inline constexpr std::uint32_t replay_version_latest{
+    replay_version_tick_clock};
+
+// Bits of the flags byte. Streamed input data is a sequence of packed
+// `replay_data` chunks running until the end of the file, an incomplete last
+// chunk is ignored. It cannot be compressed. State hashes are stored after
+// the score, as their interval, their count and then the hashes.
+inline constexpr std::uint8_t replay_flag_compressed{1 << 0};
+inline constexpr std::uint8_t replay_flag_streamed{1 << 1};
+inline constexpr std::uint8_t replay_flag_state_hashes{1 << 2};
+
+// Upper bound of the declared size of compressed input data, well above
+// what hours of inputs take.
+inline constexpr std::size_t replay_max_uncompressed_size{64 * 1024 * 1024};
+
+// Number of recorded inputs between two simulation state hashes.
+inline constexpr std::uint32_t replay_state_hash_interval{240};
+
 struct serialization_result
 {
     std::size_t _written_bytes{0};
@@ -65,43 +97,113 @@ struct deserialization_result
 class replay_data
 {
 private:
-    std::vector<input_bitset> _inputs;
+    // Inputs are stored as runs of equal inputs: run `i` repeats
+    // `_run_inputs[i]` until (excluding) the input at index `_run_ends[i]`.
+    std::vector<std::uint32_t> _run_ends;
+    std::vector<std::uint8_t> _run_inputs;
+
+    void append_run(const std::uint8_t input, const std::size_t count);
 
 public:
     void record_input(const bool left, const bool right, const bool swap,
         const bool focus) noexcept;
 
+    // Random access, a binary search over the runs.
     [[nodiscard]] input_bitset at(const std::size_t index) const noexcept;
     [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] std::size_t run_count() const noexcept;
+
+    [[nodiscard]] std::size_t run_containing(
+        const std::size_t index) const noexcept;
+    [[nodiscard]] std::size_t run_end(const std::size_t run) const noexcept;
+    [[nodiscard]] input_bitset run_input(const std::size_t run) const noexcept;
+
+    void append(const replay_data& rhs);
+
+    // Inputs in the `[begin, end)` range.
+    [[nodiscard]] replay_data slice(
+        const std::size_t begin, const std::size_t end) const;
 
     [[nodiscard]] bool operator==(const replay_data& rhs) const noexcept;
     [[nodiscard]] bool operator!=(const replay_data& rhs) const noexcept;
 
-    [[nodiscard]] serialization_result serialize(
-        std::byte* buffer, const std::size_t buffer_size) const;
+    [[nodiscard]] serialization_result serialize(std::byte* buffer,
+        const std::size_t buffer_size,
+        const std::uint32_t version = replay_version_latest) const;
 
-    [[nodiscard]] deserialization_result deserialize(
-        const std::byte* buffer, const std::size_t buffer_size);
+    [[nodiscard]] deserialization_result deserialize(const std::byte* buffer,
+        const std::size_t buffer_size,
+        const std::uint32_t version = replay_version_latest);
 
-    [[nodiscard]] serialization_result serialize(
-        std::byte* buffer, const std::byte* const buffer_end) const;
+    [[nodiscard]] serialization_result serialize(std::byte* buffer,
+        const std::byte* const buffer_end,
+        const std::uint32_t version = replay_version_latest) const;
 
-    [[nodiscard]] deserialization_result deserialize(
-        const std::byte* buffer, const std::byte* const buffer_end);
+    [[nodiscard]] deserialization_result deserialize(const std::byte* buffer,
+        const std::byte* const buffer_end,
+        const std::uint32_t version = replay_version_latest);
+};
+
+// View of serialized input data, e.g. in a memory-mapped replay file. The
+// bytes are validated when the view is created, and decoded on the fly by
+// `packed_input_cursor`.
+struct packed_inputs
+{
+    const std::byte* _begin{nullptr};
+    const std::byte* _end{nullptr};
+    std::uint32_t _version{replay_version_latest};
+    bool _streamed{false};
+    std::size_t _size{0}; // Number of inputs.
+};
+
+class packed_input_cursor
+{
+private:
+    packed_inputs _inputs;
+    const std::byte* _pos;
+    std::size_t _index;
+
+    std::uint64_t _chunk_left;    // Inputs of the chunk not yet in a run.
+    std::size_t _literals_left;   // Literals not yet decoded.
+    bool _high_nibble;            // If the next literal is in the high bits.
+    std::uint8_t _run_input;      // Input of the current run.
+    std::uint64_t _run_left;      // Inputs of the current run not consumed.
+
+    void load_run() noexcept;
+
+public:
+    explicit packed_input_cursor(const packed_inputs& inputs) noexcept;
+
+    [[nodiscard]] input_bitset next() noexcept;
+    void skip(std::size_t count) noexcept;
+    void reset() noexcept;
+
+    [[nodiscard]] bool done() const noexcept;
+    [[nodiscard]] std::size_t index() const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept;
 };
 
 class replay_player
 {
 private:
-    const replay_data& _replay_data;
+    // Inputs are read from `_replay_data` if set, from `_cursor` otherwise.
+    const replay_data* _replay_data;
+    packed_input_cursor _cursor;
     std::size_t _current_index;
+    std::size_t _current_run; // Run of `_replay_data`, advanced in order.
 
 public:
     explicit replay_player(const replay_data& rd) noexcept;
+    explicit replay_player(const packed_inputs& inputs) noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
 
     [[nodiscard]] input_bitset get_current_and_move_forward() noexcept;
     [[nodiscard]] bool done() const noexcept;
     void reset() noexcept;
+
+    [[nodiscard]] std::size_t get_current_index() const noexcept;
+    void seek(const std::size_t index) noexcept;
 };
 
 struct replay_file
@@ -118,6 +220,10 @@ struct replay_file
     float _difficulty_mult;   // Played difficulty multiplier.
     double _played_score; // Played score (This can be an overridden score or
                           // frametime, excluding pauses).
+    bool _compressed{false}; // If input data is compressed (version 2+).
+    bool _streamed{false};   // If input data is chunked (version 2+).
+    std::uint32_t _state_hash_interval{0}; // Inputs between state hashes.
+    std::vector<std::uint32_t> _state_hashes; // State hashes (version 2+).
 
     [[nodiscard]] bool operator==(const replay_file& rhs) const noexcept;
     [[nodiscard]] bool operator!=(const replay_file& rhs) const noexcept;
@@ -134,10 +240,48 @@ struct replay_file
     [[nodiscard]] deserialization_result deserialize(
         const std::byte* buffer, const std::byte* const buffer_end);
 
+    // Reads every field except the input data, which is left empty. Input
+    // data is validated but not decoded for uncompressed replays: `inputs`
+    // is set to view it in the buffer.
+    [[nodiscard]] deserialization_result deserialize_view(
+        const std::byte* buffer, const std::byte* const buffer_end,
+        packed_inputs& inputs);
+
+    // Reads every field except the input data, which is left empty. From
+    // version 2 onwards this does not need to touch the input data at all.
+    [[nodiscard]] deserialization_result deserialize_header(
+        const std::byte* buffer, const std::size_t buffer_size);
+
+    [[nodiscard]] deserialization_result deserialize_header(
+        const std::byte* buffer, const std::byte* const buffer_end);
+
+    [[nodiscard]] bool serialize_to_buffer(std::vector<std::byte>& buf) const;
     [[nodiscard]] bool serialize_to_file(const std::filesystem::path& p) const;
     [[nodiscard]] bool deserialize_from_file(const std::filesystem::path& p);
+    [[nodiscard]] bool deserialize_header_from_file(
+        const std::filesystem::path& p);
 
     [[nodiscard]] std::string create_filename() const;
+
+    // Hash `k` is the simulation state after `(k + 1) * _state_hash_interval`
+    // inputs have been played. Returns whether a hash was recorded after
+    // `n_inputs` inputs, and if so whether `hash` differs from it.
+    [[nodiscard]] bool has_state_hash(
+        const std::size_t n_inputs) const noexcept;
+    [[nodiscard]] bool state_hash_mismatch(
+        const std::size_t n_inputs, const std::uint32_t hash) const noexcept;
+
+private:
+    enum class input_handling
+    {
+        decode,
+        view,
+        skip
+    };
+
+    [[nodiscard]] deserialization_result deserialize_impl(
+        const std::byte* buffer, const std::byte* const buffer_end,
+        const input_handling handling, packed_inputs* const view);
 };
 
 } // namespace hg
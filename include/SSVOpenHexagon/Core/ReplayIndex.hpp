@@ -0,0 +1,62 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#pragma once
+
+#include "SSVOpenHexagon/Core/Replay.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hg
+{
+
+// Headers of the replay files in a folder, persisted in an index file in that
+// folder. Refreshing only reads the headers of files that are new or whose
+// modification time or size changed since they were indexed.
+//
+// Library only for now: the game has no replay browser yet, so nothing builds
+// or refreshes `Replays/replay_index.ohri`. A browser should `load`, then
+// `refresh` and `save` when it opens.
+class replay_index
+{
+public:
+    struct entry
+    {
+        std::string _filename;    // Relative to the indexed folder.
+        std::int64_t _write_time; // Last modification time.
+        std::uint64_t _file_size; // Size in bytes.
+        replay_file _header;      // Fields without the input data.
+    };
+
+    static constexpr std::string_view index_filename{"replay_index.ohri"};
+
+private:
+    std::filesystem::path _folder;
+    std::vector<entry> _entries; // Sorted by filename.
+
+public:
+    explicit replay_index(std::filesystem::path folder);
+
+    // Loads the persisted index, if any, discarding the current entries.
+    [[nodiscard]] bool load();
+    [[nodiscard]] bool save() const;
+
+    // Returns the number of replay headers that had to be read.
+    std::size_t refresh();
+
+    [[nodiscard]] const std::vector<entry>& entries() const noexcept;
+
+    // Up to `max_count` replays of the given level and difficulty, best
+    // score first.
+    [[nodiscard]] std::vector<const entry*> best_for_level(
+        const std::string_view pack_id, const std::string_view level_id,
+        const float difficulty_mult, const std::size_t max_count) const;
+};
+
+} // namespace hg
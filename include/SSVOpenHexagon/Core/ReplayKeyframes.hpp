@@ -0,0 +1,56 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#pragma once
+
+#include "SSVOpenHexagon/Core/HexagonSimulation.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace hg
+{
+
+// Ring of simulation snapshots taken at regular tick intervals while a replay
+// plays, so that seeking restores the nearest one and only re-simulates the
+// remaining ticks. When full, the oldest keyframe is overwritten. A keyframe
+// is taken at the first tick of each interval at which the simulation can be
+// snapshotted, which is not the case while a pattern coroutine is alive.
+//
+// Snapshots refer to the simulation's Lua state: `clear` must be called
+// before the simulation starts a new game.
+class replay_keyframes
+{
+public:
+    struct keyframe
+    {
+        std::size_t _tick; // Number of replay inputs consumed.
+        HexagonSimulation::Snapshot _snapshot;
+    };
+
+private:
+    std::size_t _interval;
+    std::size_t _capacity;
+    std::vector<keyframe> _keyframes;
+    std::size_t _next_slot{0};
+
+    [[nodiscard]] bool contains_interval_of(
+        const std::size_t tick) const noexcept;
+
+public:
+    explicit replay_keyframes(
+        const std::size_t interval, const std::size_t capacity);
+
+    [[nodiscard]] bool should_capture(const std::size_t tick,
+        const HexagonSimulation& simulation) const noexcept;
+    void capture(const std::size_t tick, HexagonSimulation& simulation);
+
+    // Latest keyframe at or before `tick`, if any.
+    [[nodiscard]] const keyframe* find_nearest(
+        const std::size_t tick) const noexcept;
+
+    void clear() noexcept;
+};
+
+} // namespace hg
@@ -0,0 +1,88 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#pragma once
+
+#include "SSVOpenHexagon/Core/Replay.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace hg
+{
+
+// Records the replay of the run in progress to a streamed replay file (see
+// `replay_flag_streamed`), appending a chunk of inputs every
+// `chunk_inputs` recorded inputs. If the game is interrupted, the file is
+// still a playable replay of the run up to the last chunk.
+//
+// All file operations happen in order on a background thread: the game
+// thread only queues jobs.
+class replay_stream_writer
+{
+public:
+    // Inputs per chunk, 2 seconds of gameplay.
+    static constexpr std::size_t chunk_inputs{240};
+
+private:
+    std::filesystem::path _part_path;
+
+    // Only accessed by the game thread.
+    bool _recording{false};
+    std::size_t _streamed_inputs{0};
+
+    // Only accessed by the I/O thread.
+    std::ofstream _os;
+    std::streamoff _score_offset{0};
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque<std::function<void()>> _jobs;
+    bool _busy{false};
+    bool _stopping{false};
+
+    std::thread _thread;
+
+    void enqueue(std::function<void()>&& job);
+    void run();
+
+    void write_header(const replay_file& header);
+    void write_chunk(const replay_data& chunk, const double score);
+    void close_and_remove();
+
+public:
+    // A file left at `part_path` by an interrupted session is kept, renamed
+    // to a `.ohreplay` file in the same folder.
+    explicit replay_stream_writer(std::filesystem::path part_path);
+    ~replay_stream_writer();
+
+    replay_stream_writer(const replay_stream_writer&) = delete;
+    replay_stream_writer& operator=(const replay_stream_writer&) = delete;
+
+    // Starts a new recording, discarding the current one. The input data of
+    // `header` is ignored.
+    void begin(const replay_file& header);
+
+    // To be called after every recorded input, `data` being all of them.
+    void update(const replay_data& data, const double score);
+
+    // Writes `rf` to `path` and removes the streamed file.
+    void finish(const replay_file& rf, const std::filesystem::path& path);
+
+    // Stops recording and removes the streamed file.
+    void discard();
+
+    [[nodiscard]] bool recording() const noexcept;
+
+    // Blocks until all queued jobs are done.
+    void wait_idle();
+};
+
+} // namespace hg
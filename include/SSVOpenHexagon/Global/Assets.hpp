@@ -37,7 +37,7 @@ class MusicData;
 class HGAssets
 {
 private:
-    Steam::steam_manager& steamManager;
+    Steam::steam_manager* steamManager; // Null when running without Steam.
 
     bool playingLocally{true};
     bool levelsOnly{false};
@@ -110,7 +110,7 @@ private:
     LoadInfo loadInfo;
 
 public:
-    HGAssets(Steam::steam_manager& mSteamManager, bool mLevelsOnly = false);
+    HGAssets(Steam::steam_manager* mSteamManager, bool mLevelsOnly = false);
 
     LoadInfo& getLoadResults()
     {
@@ -77,6 +77,9 @@ void setShowKeyIcons(bool mX);
 void setKeyIconsScale(float mX);
 void setFirstTimePlaying(bool mX);
 void setSaveLocalBestReplayToFile(bool mX);
+void setCompressReplayFiles(bool mX);
+void setLuaProfiler(bool mX);
+void setLuaGCStepKB(int mX);
 
 [[nodiscard]] bool getOnline();
 [[nodiscard]] bool getOfficial();
@@ -147,6 +150,9 @@ void setSaveLocalBestReplayToFile(bool mX);
 [[nodiscard]] float getKeyIconsScale();
 [[nodiscard]] bool getFirstTimePlaying();
 [[nodiscard]] bool getSaveLocalBestReplayToFile();
+[[nodiscard]] bool getCompressReplayFiles();
+[[nodiscard]] bool getLuaProfiler();
+[[nodiscard]] int getLuaGCStepKB();
 
 // keyboard binds
 void keyboardBindsSanityCheck();
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 #include <zlib.h>
 
@@ -17,4 +18,10 @@ std::string getZLibCompress(
 
 std::string getZLibDecompress(const std::string& mStr);
 
+// Decompresses `mSize` bytes at `mData` into `mOut`, which must hold
+// `mOutSize` bytes. Returns `false`, without writing past `mOutSize`, if the
+// data is invalid or does not decompress to exactly `mOutSize` bytes.
+[[nodiscard]] bool getZLibDecompressExact(const void* mData,
+    std::size_t mSize, void* mOut, std::size_t mOutSize) noexcept;
+
 } // namespace hg
@@ -0,0 +1,50 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace Lua
+{
+class LuaContext;
+}
+
+namespace hg::Utils
+{
+
+// Compiled Lua scripts, keyed by path and validated against a hash of the
+// file contents, so that edited scripts are recompiled. Scripts are only
+// parsed the first time they run; later runs load the cached bytecode.
+//
+// Bytecode is never persisted: Lua does not verify binary chunks, so only
+// bytecode this process produced itself is loaded.
+class LuaBytecodeCache
+{
+private:
+    struct Entry
+    {
+        std::uint64_t contentHash;
+        std::string bytecode;
+    };
+
+    std::unordered_map<std::string, Entry> entries;
+
+    [[nodiscard]] const Entry* find(
+        const std::string& mFileName, std::uint64_t mContentHash);
+
+public:
+    // Runs the script at `mFileName` in `mLua`. Throws like
+    // `Lua::LuaContext::executeCode`.
+    void runLuaFile(Lua::LuaContext& mLua, const std::string& mFileName);
+
+    void clear() noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+};
+
+} // namespace hg::Utils
@@ -21,12 +21,13 @@ private:
         std::string fnDocs;
     };
 
-    // There are 9 categories.
-    constexpr static std::size_t NUM_CATEGORIES = 9;
+    // There are 10 categories.
+    constexpr static std::size_t NUM_CATEGORIES = 10;
     std::array<std::vector<FnEntry>, NUM_CATEGORIES> fnEntries;
     constexpr static std::array<std::string_view, NUM_CATEGORIES>
         prefixCategories = {
-            "u_", "a_", "t_", "e_", "l_", "s_", "w_", "cw_", "Miscellaneous"};
+            "u_", "a_", "t_", "e_", "l_", "s_", "w_", "cw_", "p_",
+            "Miscellaneous"};
 
     [[nodiscard]] std::size_t getCategoryIndexFromName(
         const std::string_view fnName)
@@ -126,11 +127,20 @@ public:
             "to allow pack developers to customize individual walls and their "
             "properties and make the most out of them. ",
 
+            "## Pattern Functions (p_)\n\n"
+
+            "Below are the pattern functions, which can be identified with the "
+            "\"p_\" prefix. These are native versions of the helpers and "
+            "patterns found in the ``common.lua`` and ``commonpatterns.lua`` "
+            "scripts of the official packs, producing exactly the same walls "
+            "and delays. A whole pattern is added to the main timeline in a "
+            "single call.",
+
             "## Miscellaneous Functions\n\n"
 
             "Below are the miscellaneous functions, which can have a variable "
             "prefix or no prefix at all. These are other functions "
-            "that are listed that cannot qualify for one of the above eight "
+            "that are listed that cannot qualify for one of the above nine "
             "categories and achieve some other purpose, with some "
             "functions not meant to be used by pack developers at all."};
 
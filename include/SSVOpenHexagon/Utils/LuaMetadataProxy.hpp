@@ -6,6 +6,7 @@
 
 #include "SSVOpenHexagon/Utils/ArgExtractor.hpp"
 #include "SSVOpenHexagon/Utils/LuaMetadata.hpp"
+#include "SSVOpenHexagon/Utils/LuaWrapper.hpp"
 
 #include <SSVUtils/Core/Log/Log.hpp>
 
@@ -84,6 +85,18 @@ private:
         {
             return "tuple<float, float>";
         }
+        else if constexpr(std::is_same_v<Type, std::vector<int>>)
+        {
+            return "table<int>";
+        }
+        else if constexpr(std::is_same_v<Type, std::vector<float>>)
+        {
+            return "table<float>";
+        }
+        else if constexpr(std::is_same_v<Type, Lua::LuaFunctionRef>)
+        {
+            return "function";
+        }
         else
         {
             struct fail;
@@ -0,0 +1,97 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace hg::Utils
+{
+
+// `lua_Alloc` for a single Lua state. Small blocks, which are most of what
+// scripts allocate (strings, tables, closures), come from free lists of a
+// few size classes carved out of large chunks. Bigger blocks go to the
+// system allocator. All chunks are released at once when the allocator is
+// destroyed, which must happen after the state is closed.
+class LuaPoolAllocator
+{
+private:
+    static constexpr std::size_t alignment{alignof(std::max_align_t)};
+    static constexpr std::size_t chunkSize{64 * 1024};
+
+    static constexpr std::array<std::size_t, 6> sizeClasses{
+        16, 32, 64, 128, 256, 512};
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    // Blocks are carved contiguously, every one of them must stay aligned
+    static_assert(sizeClasses.front() % alignment == 0);
+    static_assert(sizeClasses.front() >= sizeof(FreeBlock));
+    static_assert(chunkSize % sizeClasses.back() == 0);
+
+    struct Pool
+    {
+        FreeBlock* freeList{nullptr};
+        std::byte* bump{nullptr};
+        std::byte* bumpEnd{nullptr};
+    };
+
+    std::array<Pool, sizeClasses.size()> pools;
+    std::vector<std::byte*> chunks;
+
+    std::size_t bytesInUse{0};
+    std::size_t allocationCount{0};
+
+    // System allocations that Lua now frees with a pool size, after a shrink
+    // that could not move them into a pool.
+    std::size_t foreignBlocks{0};
+
+    [[nodiscard]] static std::size_t sizeClassIndex(
+        std::size_t mSize) noexcept;
+
+    [[nodiscard]] bool isInChunk(const void* mPtr) const noexcept;
+
+    void pushFreeBlock(void* mPtr, std::size_t mIndex) noexcept;
+
+    [[nodiscard]] void* allocate(std::size_t mSize) noexcept;
+    void deallocate(void* mPtr, std::size_t mSize) noexcept;
+    [[nodiscard]] void* reallocate(
+        void* mPtr, std::size_t mOldSize, std::size_t mNewSize) noexcept;
+
+public:
+    LuaPoolAllocator() = default;
+    ~LuaPoolAllocator();
+
+    LuaPoolAllocator(const LuaPoolAllocator&) = delete;
+    LuaPoolAllocator& operator=(const LuaPoolAllocator&) = delete;
+
+    // Matches `lua_Alloc`, `mUserData` is the allocator.
+    static void* luaAlloc(void* mUserData, void* mPtr, std::size_t mOldSize,
+        std::size_t mNewSize) noexcept;
+
+    // Bytes currently allocated by the state.
+    [[nodiscard]] std::size_t getBytesInUse() const noexcept
+    {
+        return bytesInUse;
+    }
+
+    // Number of allocations since the allocator was created.
+    [[nodiscard]] std::size_t getAllocationCount() const noexcept
+    {
+        return allocationCount;
+    }
+
+    // Bytes reserved for the pools.
+    [[nodiscard]] std::size_t getPoolBytes() const noexcept
+    {
+        return chunks.size() * chunkSize;
+    }
+};
+
+} // namespace hg::Utils
@@ -0,0 +1,157 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#pragma once
+
+#include "SSVOpenHexagon/Utils/LuaWrapper.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hg::Utils
+{
+
+// Sampling profiler for level scripts. A count hook on the Lua state
+// attributes the wall-clock time elapsed since the previous sample to the
+// current Lua call stack, down to the source line. Time spent in C++
+// bindings wrapped with `wrapNative` is measured exactly, and the rest of
+// every tick is attributed to the engine.
+//
+// The result is written in the collapsed-stack format understood by
+// flamegraph tools, one line per stack with its time in microseconds.
+class LuaProfiler
+{
+private:
+    using Clock = std::chrono::steady_clock;
+
+    lua_State* state{nullptr};
+
+    // Folded stack -> accumulated time
+    std::unordered_map<std::string, Clock::duration> samples;
+    std::vector<std::string> nativeNames;
+
+    const char* rootName{nullptr}; // Outermost Lua entry point, if in Lua.
+    unsigned int scopeDepth{0};
+
+    Clock::time_point mark;     // Time accounted for up to here.
+    Clock::duration inLua{0};   // Time accounted to Lua and bindings.
+    Clock::time_point tickStart;
+    Clock::duration inLuaAtTickStart{0};
+
+    std::string lastStack; // Stack of the last sample.
+    std::string stackBuffer;
+
+    static void hook(lua_State* mL, lua_Debug* mAr);
+
+    void sample(lua_State* mL);
+    void account(const std::string& mStack, Clock::time_point mNow);
+
+    void enterNative();
+    void leaveNative(std::size_t mNativeId);
+
+public:
+    // Number of VM instructions between two samples.
+    static constexpr int sampleInterval{1000};
+
+    LuaProfiler() = default;
+
+    LuaProfiler(const LuaProfiler&) = delete;
+    LuaProfiler& operator=(const LuaProfiler&) = delete;
+
+    // Installs the hook on `mL`, replacing the previous state if any.
+    // Accumulated samples are kept.
+    void attach(lua_State* mL);
+
+    // Stops profiling, e.g. because the state is about to be closed.
+    void detach() noexcept
+    {
+        state = nullptr;
+    }
+
+    [[nodiscard]] bool isAttached() const noexcept
+    {
+        return state != nullptr;
+    }
+
+    // Marks a call from the engine into Lua, e.g. a level callback.
+    class Scope
+    {
+    private:
+        LuaProfiler* profiler;
+
+    public:
+        Scope(LuaProfiler& mProfiler, const char* mName);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // Marks a simulation tick, time outside Lua is attributed to the engine.
+    class TickScope
+    {
+    private:
+        LuaProfiler* profiler;
+
+    public:
+        explicit TickScope(LuaProfiler& mProfiler);
+        ~TickScope();
+
+        TickScope(const TickScope&) = delete;
+        TickScope& operator=(const TickScope&) = delete;
+    };
+
+    // Returns a functor with the same signature as `mFn` that records the
+    // time spent in it under `mName`.
+    template <typename F>
+    [[nodiscard]] auto wrapNative(const std::string& mName, const F& mFn)
+    {
+        using FnType =
+            typename Lua::RemoveMemberPtr<decltype(&F::operator())>::Type;
+
+        nativeNames.emplace_back("[C++] " + mName);
+
+        return wrapNativeImpl(
+            mFn, nativeNames.size() - 1, static_cast<FnType*>(nullptr));
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return samples.empty();
+    }
+
+    // Writes the collapsed stacks to `mPath` and clears them.
+    [[nodiscard]] bool writeAndClear(const std::filesystem::path& mPath);
+
+private:
+    template <typename F, typename R, typename... Args>
+    [[nodiscard]] auto wrapNativeImpl(
+        const F& mFn, const std::size_t mNativeId, R (*)(Args...))
+    {
+        return [this, mFn, mNativeId](Args... mArgs) -> R {
+            struct NativeScope
+            {
+                LuaProfiler& p;
+                std::size_t id;
+
+                ~NativeScope()
+                {
+                    p.leaveNative(id);
+                }
+            };
+
+            enterNative();
+            const NativeScope scope{*this, mNativeId};
+
+            return mFn(std::forward<Args>(mArgs)...);
+        };
+    }
+};
+
+} // namespace hg::Utils
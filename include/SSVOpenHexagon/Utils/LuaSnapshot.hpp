@@ -0,0 +1,56 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#pragma once
+
+extern "C"
+{
+#include <lua.h>
+#include <lauxlib.h>
+}
+
+namespace hg::Utils
+{
+
+// Copy of the script data reachable from the globals of a Lua state: the
+// contents and metatables of every table, and the upvalues of every Lua
+// function. Restoring writes the copy back in place, so tables keep their
+// identity and references held elsewhere (e.g. by C++ callbacks) stay
+// valid. Coroutines and userdata contents are not captured.
+//
+// Given a base snapshot, tables and functions left untouched since it was
+// taken share its copy, so the memory of a snapshot grows with what changed
+// since the base (e.g. the state at level load) rather than with everything
+// reachable, library tables included.
+//
+// The copy lives in the registry of the state it was taken from, so a
+// snapshot must not outlive that state.
+class LuaSnapshot
+{
+private:
+    lua_State* state{nullptr};
+    int ref{LUA_NOREF};
+
+public:
+    LuaSnapshot() noexcept = default;
+    explicit LuaSnapshot(
+        lua_State* mState, const LuaSnapshot* mBase = nullptr);
+
+    ~LuaSnapshot();
+
+    LuaSnapshot(const LuaSnapshot&) = delete;
+    LuaSnapshot& operator=(const LuaSnapshot&) = delete;
+
+    LuaSnapshot(LuaSnapshot&& mRhs) noexcept;
+    LuaSnapshot& operator=(LuaSnapshot&& mRhs) noexcept;
+
+    void restore() const;
+
+    [[nodiscard]] lua_State* getState() const noexcept
+    {
+        return state;
+    }
+};
+
+} // namespace hg::Utils
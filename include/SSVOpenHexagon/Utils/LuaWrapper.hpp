@@ -45,6 +45,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <sstream>
 #include <tuple>
 #include <type_traits>
+#include <vector>
 
 extern "C"
 {
@@ -98,6 +99,138 @@ struct FnTupleWrapper<R(TArgs...)>
     }
 };
 
+/**
+ * @brief Registry reference to a Lua function
+ *
+ * Obtained once from a global with LuaContext::getFunctionRef, and then
+ * called with LuaContext::callLuaFunction without looking the global up
+ * again. Later assignments to the global are not seen by the reference.
+ * References must be reset before the context they come from is destroyed.
+ */
+class LuaFunctionRef
+{
+private:
+    lua_State* _state{nullptr};
+    int _ref{LUA_NOREF};
+
+    friend class LuaContext;
+
+    LuaFunctionRef(lua_State* state, int ref) noexcept
+        : _state{state}, _ref{ref}
+    {
+    }
+
+public:
+    LuaFunctionRef() noexcept = default;
+
+    LuaFunctionRef(const LuaFunctionRef&) = delete;
+    LuaFunctionRef& operator=(const LuaFunctionRef&) = delete;
+
+    LuaFunctionRef(LuaFunctionRef&& s) noexcept : _state{s._state}, _ref{s._ref}
+    {
+        s._state = nullptr;
+        s._ref = LUA_NOREF;
+    }
+
+    LuaFunctionRef& operator=(LuaFunctionRef&& s) noexcept
+    {
+        std::swap(_state, s._state);
+        std::swap(_ref, s._ref);
+        return *this;
+    }
+
+    ~LuaFunctionRef()
+    {
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        if(_state != nullptr) luaL_unref(_state, LUA_REGISTRYINDEX, _ref);
+
+        _state = nullptr;
+        _ref = LUA_NOREF;
+    }
+
+    /// \brief Returns true if the global was not nil when resolved
+    [[nodiscard]] explicit operator bool() const noexcept
+    {
+        return _ref != LUA_NOREF;
+    }
+};
+
+/**
+ * @brief Lua thread running a function as a coroutine
+ *
+ * Created with LuaContext::createCoroutine and advanced with
+ * LuaContext::resumeCoroutine. The thread is kept alive by a registry
+ * reference, which is released once the coroutine finishes. Like
+ * LuaFunctionRef, it must be reset before the context it comes from is
+ * destroyed.
+ */
+class LuaCoroutine
+{
+private:
+    lua_State* _state{nullptr}; // main thread, owner of the registry
+    lua_State* _thread{nullptr};
+    int _ref{LUA_NOREF};
+
+    friend class LuaContext;
+
+    LuaCoroutine(lua_State* state, lua_State* thread, int ref) noexcept
+        : _state{state}, _thread{thread}, _ref{ref}
+    {
+    }
+
+public:
+    LuaCoroutine() noexcept = default;
+
+    LuaCoroutine(const LuaCoroutine&) = delete;
+    LuaCoroutine& operator=(const LuaCoroutine&) = delete;
+
+    LuaCoroutine(LuaCoroutine&& s) noexcept
+        : _state{s._state}, _thread{s._thread}, _ref{s._ref}
+    {
+        s._state = nullptr;
+        s._thread = nullptr;
+        s._ref = LUA_NOREF;
+    }
+
+    LuaCoroutine& operator=(LuaCoroutine&& s) noexcept
+    {
+        std::swap(_state, s._state);
+        std::swap(_thread, s._thread);
+        std::swap(_ref, s._ref);
+        return *this;
+    }
+
+    ~LuaCoroutine()
+    {
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        if(_state != nullptr) luaL_unref(_state, LUA_REGISTRYINDEX, _ref);
+
+        _state = nullptr;
+        _thread = nullptr;
+        _ref = LUA_NOREF;
+    }
+
+    /// \brief Returns the thread the coroutine runs on, null once finished
+    [[nodiscard]] lua_State* getThread() const noexcept
+    {
+        return _thread;
+    }
+
+    /// \brief Returns true if the coroutine has not finished yet
+    [[nodiscard]] explicit operator bool() const noexcept
+    {
+        return _thread != nullptr;
+    }
+};
+
 /**
  * @brief Defines a Lua context
  *
@@ -118,26 +251,17 @@ class LuaContext
 {
 public:
     explicit LuaContext(bool openDefaultLibs = true)
+        : LuaContext(&defaultAllocator, nullptr, openDefaultLibs)
     {
-        // we pass this allocator function to lua_newstate we use our custom
-        // allocator instead of luaL_newstate, to trace memory usage
-        struct Allocator
-        {
-            static void* allocator(
-                void*, void* ptr, std::size_t, std::size_t nsize)
-            {
-                if(nsize == 0)
-                {
-                    free(ptr);
-                    return nullptr;
-                }
-
-                return realloc(ptr, nsize);
-            }
-        };
+    }
 
+    /// \brief Creates a state whose memory is managed by the given
+    /// allocator \details The allocator must outlive the context
+    LuaContext(lua_Alloc allocator, void* allocatorData,
+        bool openDefaultLibs = true)
+    {
         // lua_newstate can return null if allocation failed
-        _state = lua_newstate(&Allocator::allocator, nullptr);
+        _state = lua_newstate(allocator, allocatorData);
         if(_state == nullptr)
         {
             throw std::bad_alloc();
@@ -169,6 +293,12 @@ public:
         if(_state != nullptr) lua_close(_state);
     }
 
+    /// \brief Returns the underlying Lua state, for direct use of the C API
+    [[nodiscard]] lua_State* getState() noexcept
+    {
+        return _state;
+    }
+
 
     /// \brief The table type can store any key and any value, and can be
     /// read or written by LuaContext
@@ -254,6 +384,51 @@ public:
         return executeCode<T>(str);
     }
 
+    /// \brief Executes lua source code and stores its compiled form in
+    /// `bytecode`, which can later be run again with `executeBytecode`
+    /// \param chunkName Name of the chunk in error messages
+    void executeCode(const std::string& code, const std::string& chunkName,
+        std::string& bytecode)
+    {
+        _loadBuffer(code, chunkName, "t");
+
+        bytecode.clear();
+        lua_dump(_state, &_dumpWriter, &bytecode, 0 /* strip */);
+
+        _call<std::tuple<>>(std::tuple<>());
+    }
+
+    /// \brief Executes bytecode previously produced by `executeCode`,
+    /// throws `SyntaxErrorException` if it cannot be loaded
+    /// \param chunkName Name of the chunk in error messages
+    void executeBytecode(
+        const std::string& bytecode, const std::string& chunkName)
+    {
+        _loadBuffer(bytecode, chunkName, "b");
+        _call<std::tuple<>>(std::tuple<>());
+    }
+
+    /// \brief Compiles lua code into a function kept in the registry, and
+    /// returns a reference to run it with `executeRef`
+    int compileToRef(const std::string& code)
+    {
+        _loadBuffer(code, "chunk", "bt");
+        return luaL_ref(_state, LUA_REGISTRYINDEX);
+    }
+
+    /// \brief Runs a function compiled by `compileToRef`
+    void executeRef(int ref)
+    {
+        lua_rawgeti(_state, LUA_REGISTRYINDEX, ref);
+        _call<std::tuple<>>(std::tuple<>());
+    }
+
+    /// \brief Releases a reference returned by `compileToRef`
+    void releaseRef(int ref)
+    {
+        luaL_unref(_state, LUA_REGISTRYINDEX, ref);
+    }
+
 
     /// \brief Tells that lua will be allowed to access an object's function
     template <typename T, typename R, typename... Args>
@@ -323,6 +498,93 @@ public:
         return _call<R>(std::make_tuple(args...));
     }
 
+    /// \brief Calls a function through a reference obtained from
+    /// getFunctionRef, an empty reference calls nil
+    template <typename R, typename... Args>
+    R callLuaFunction(const LuaFunctionRef& fn, const Args&... args)
+    {
+        assert(!fn || fn._state == _mainThread());
+
+        lua_rawgeti(_state, LUA_REGISTRYINDEX, fn._ref);
+        return _call<R>(std::make_tuple(args...));
+    }
+
+    /// \brief Resolves the function stored in a global variable into a
+    /// registry reference, which is empty if the variable is nil
+    [[nodiscard]] LuaFunctionRef getFunctionRef(const std::string& mVarName)
+    {
+        _getGlobal(mVarName);
+
+        if(lua_isnil(_state, -1))
+        {
+            lua_pop(_state, 1);
+            return LuaFunctionRef{};
+        }
+
+        return LuaFunctionRef{
+            _mainThread(), luaL_ref(_state, LUA_REGISTRYINDEX)};
+    }
+
+    /// \brief Creates a coroutine that runs the referenced function when
+    /// first resumed
+    [[nodiscard]] LuaCoroutine createCoroutine(const LuaFunctionRef& fn)
+    {
+        assert(fn);
+
+        lua_State* const thread = lua_newthread(_state);
+        const int ref = luaL_ref(_state, LUA_REGISTRYINDEX);
+
+        lua_rawgeti(thread, LUA_REGISTRYINDEX, fn._ref);
+        return LuaCoroutine{_mainThread(), thread, ref};
+    }
+
+    /// \brief Runs a coroutine until it yields or finishes \details Values
+    /// passed to `coroutine.yield` are discarded, and nothing is passed
+    /// back when resuming. A finished coroutine is reset. \return true if
+    /// the coroutine yielded \throw ExecutionErrorException if it raised
+    /// an error, after which it is reset as well
+    bool resumeCoroutine(LuaCoroutine& co)
+    {
+        assert(co);
+
+        const int status = lua_resume(co._thread, _state, 0);
+
+        if(status == LUA_YIELD)
+        {
+            lua_settop(co._thread, 0);
+            return true;
+        }
+
+        if(status == LUA_OK)
+        {
+            co.reset();
+            return false;
+        }
+
+        const char* const msg = lua_tostring(co._thread, -1);
+        const std::string errorMsg{msg != nullptr ? msg : "unknown error"};
+        co.reset();
+
+        if(status == LUA_ERRMEM) throw(std::bad_alloc());
+        throw(ExecutionErrorException(errorMsg));
+    }
+
+    /// \brief Returns true if the function being called from Lua can yield
+    /// the coroutine it runs in
+    [[nodiscard]] bool isYieldable() const noexcept
+    {
+        return lua_isyieldable(_state) != 0;
+    }
+
+    /// \brief Makes the function being called from Lua yield the coroutine
+    /// it runs in once it returns \details Only valid if isYieldable
+    /// returns true. The function's results are passed to the resumer.
+    void yieldAfterCall() noexcept
+    {
+        assert(isYieldable());
+        _yieldRequested = true;
+    }
+
     /// \brief Returns true if the value of the variable is an array \param
     /// mVarName Name of the variable to check
     bool isVariableArray(const std::string& mVarName) const
@@ -410,6 +672,29 @@ public:
         lua_pop(_state, pushedElems - 1);
     }
 
+    /// \brief Writes a functor into a global lua variable as a plain C
+    /// closure
+    /// \details Unlike writeVariable, the call goes straight through a
+    /// lua_CFunction generated for the functor type: the context and the
+    /// functor are upvalues, no metatable is involved and no tuple of
+    /// parameters is built. The functor must be trivially destructible, as
+    /// the garbage collector frees its storage without running destructors.
+    template <typename T>
+    void writeStaticFunction(const std::string& mVarName, T fn)
+    {
+        static_assert(std::is_trivially_destructible_v<T>,
+            "Error: LuaContext::writeStaticFunction requires a trivially "
+            "destructible functor");
+
+        using FnType = typename RemoveMemberPtr<decltype(&T::operator())>::Type;
+
+        lua_pushlightuserdata(_state, this);
+        new(lua_newuserdata(_state, sizeof(T))) T(std::move(fn));
+        lua_pushcclosure(_state, &StaticTrampoline<T, FnType>::call, 2);
+
+        _setGlobal(mVarName);
+    }
+
 private:
     // the state is the most important variable in the class since it is our
     // interface with Lua
@@ -420,6 +705,56 @@ private:
     // the mutex should be locked by all public functions that use the stack
     lua_State* _state;
 
+    // set by yieldAfterCall, checked by the C function of the binding once
+    // the C++ function has returned, as Lua's yield has to unwind it
+    bool _yieldRequested{false};
+
+    // functions written into the context can be called from any coroutine,
+    // whose stack is then the one the arguments and results go through
+    struct CallingThreadScope
+    {
+        LuaContext& ctx;
+        lua_State* const previous;
+
+        CallingThreadScope(LuaContext& mCtx, lua_State* mThread) noexcept
+            : ctx{mCtx}, previous{mCtx._state}
+        {
+            ctx._state = mThread;
+        }
+
+        ~CallingThreadScope()
+        {
+            ctx._state = previous;
+        }
+
+        CallingThreadScope(const CallingThreadScope&) = delete;
+        CallingThreadScope& operator=(const CallingThreadScope&) = delete;
+    };
+
+    // returns the thread created with the state, which is the one that
+    // registry references must be released from
+    lua_State* _mainThread() const
+    {
+        lua_rawgeti(_state, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+        lua_State* const mainThread = lua_tothread(_state, -1);
+        lua_pop(_state, 1);
+        return mainThread;
+    }
+
+    // we pass this allocator function to lua_newstate by default instead of
+    // using luaL_newstate, to trace memory usage
+    static void* defaultAllocator(
+        void*, void* ptr, std::size_t, std::size_t nsize)
+    {
+        if(nsize == 0)
+        {
+            free(ptr);
+            return nullptr;
+        }
+
+        return realloc(ptr, nsize);
+    }
+
     // all the user types in the _state must have the value of &typeid(T) in
     // their
     //   metatable at key "_typeid"
@@ -760,6 +1095,36 @@ private:
         }
     }
 
+    // loads a chunk of source code or bytecode, as allowed by `mode`, and
+    // pushes it as a function at the top of the stack
+    void _loadBuffer(const std::string& buffer, const std::string& chunkName,
+        const char* mode)
+    {
+        const auto loadReturnValue = luaL_loadbufferx(_state, buffer.data(),
+            buffer.size(), chunkName.c_str(), mode);
+
+        if(loadReturnValue != 0)
+        {
+            const std::string errorMsg = lua_tostring(_state, -1);
+            lua_pop(_state, 1);
+
+            if(loadReturnValue == LUA_ERRMEM)
+                throw(std::bad_alloc());
+            else
+                throw(SyntaxErrorException(errorMsg));
+        }
+    }
+
+    // lua_dump writer appending to the std::string pointed to by `data`
+    static int _dumpWriter(
+        lua_State*, const void* p, std::size_t size, void* data)
+    {
+        static_cast<std::string*>(data)->append(
+            static_cast<const char*>(p), size);
+
+        return 0;
+    }
+
     // this function calls what is on the top of the stack and removes it
     // (just like lua_call)
     // if an exception is triggered, the top of the stack will be removed
@@ -943,6 +1308,72 @@ public:
     };
 
 private:
+    // lua_CFunction generated for every functor written with
+    // writeStaticFunction
+    // upvalue 1 is the context (light userdata), upvalue 2 is the functor
+    // (full userdata without metatable)
+    template <typename T, typename FnType>
+    struct StaticTrampoline;
+
+    template <typename T, typename R, typename... Args>
+    struct StaticTrampoline<T, R(Args...)>
+    {
+        static int call(lua_State* state)
+        {
+            constexpr int paramsCount = sizeof...(Args);
+
+            // same rules as the userdata functors: the parameters are the
+            // last "paramsCount" values on the stack
+            const int top = lua_gettop(state);
+            if(top < paramsCount)
+            {
+                luaL_where(state, 1);
+                lua_pushstring(state, "this function requires at least ");
+                lua_pushnumber(state, paramsCount);
+                lua_pushstring(state, " parameter(s)");
+                lua_concat(state, 4);
+                return lua_error(state);
+            }
+
+            auto* const ctx = static_cast<LuaContext*>(
+                lua_touserdata(state, lua_upvalueindex(1)));
+            auto* const fn =
+                static_cast<T*>(lua_touserdata(state, lua_upvalueindex(2)));
+
+            assert(ctx);
+            assert(fn);
+
+            const int results = [&]<int... Is>(
+                std::integer_sequence<int, Is...>)
+            {
+                const CallingThreadScope threadScope{*ctx, state};
+                const int base = top - paramsCount + 1;
+
+                if constexpr(std::is_void_v<R>)
+                {
+                    (*fn)(ctx->_read(base + Is,
+                        static_cast<std::decay_t<Args>*>(nullptr))...);
+                    return 0;
+                }
+                else
+                {
+                    return ctx->_push((*fn)(ctx->_read(base + Is,
+                        static_cast<std::decay_t<Args>*>(nullptr))...));
+                }
+            }
+            (std::make_integer_sequence<int, paramsCount>{});
+
+            // nothing is left to destroy in this frame
+            if(ctx->_yieldRequested)
+            {
+                ctx->_yieldRequested = false;
+                return lua_yield(state, results);
+            }
+
+            return results;
+        }
+    };
+
     /**************************************************/
     /*                PUSH FUNCTIONS                  */
     /**************************************************/
@@ -1014,6 +1445,19 @@ private:
         return table._push(*this);
     }
 
+    // pushing vectors, as arrays starting at index 1
+    template <typename T>
+    int _push(const std::vector<T>& vec)
+    {
+        lua_createtable(_state, static_cast<int>(vec.size()), 0);
+        for(std::size_t i = 0; i < vec.size(); ++i)
+        {
+            _push(vec[i]);
+            lua_rawseti(_state, -2, static_cast<lua_Integer>(i + 1));
+        }
+        return 1;
+    }
+
     // pushing maps
     template <typename Key, typename Value>
     int _push(const std::map<Key, Value>& map)
@@ -1052,7 +1496,6 @@ private:
             // note that I'm using "this->" because of g++,
             // I don't know if it is required by standards or if it is a
             // bug
-            assert(this->_state == state);
 
             // FnTupleWrapper<FnType> is a specialized template
             // structure which defines
@@ -1079,6 +1522,8 @@ private:
                                          // C++
             }
 
+            const CallingThreadScope threadScope{*this, state};
+
 // reading parameters from the stack
 #ifdef _MSC_VER
             auto parameters = this->_read(-paramsCount,
@@ -1093,7 +1538,16 @@ private:
 
             // pushing the result on the stack and returning number of
             // pushed elements
-            return this->_push(std::move(result));
+            const int pushed = this->_push(std::move(result));
+
+            // a yield is signaled to callbackCall with a negative count
+            if(this->_yieldRequested)
+            {
+                this->_yieldRequested = false;
+                return -pushed - 1;
+            }
+
+            return pushed;
         });
 
         // typedefing the type of data we will push
@@ -1108,7 +1562,11 @@ private:
             FunctionPushType* function =
                 (FunctionPushType*)lua_touserdata(lua, 1);
             assert(function);
-            return (*function)(lua);
+            const int results = (*function)(lua);
+
+            // yielding unwinds the frames of the functor, so it must be done
+            // once it has returned
+            return results >= 0 ? results : lua_yield(lua, -results - 1);
         };
 
         auto callbackGarbage = [](lua_State* lua) {
@@ -1338,6 +1796,17 @@ private:
         return lua_tostring(_state, index);
     }
 
+    // functions are referenced from the registry, nil is an empty reference
+    LuaFunctionRef _read(int index, LuaFunctionRef const* = nullptr) const
+    {
+        if(lua_isnil(_state, index)) return LuaFunctionRef{};
+        if(!lua_isfunction(_state, index)) throw(WrongTypeException());
+
+        lua_pushvalue(_state, index);
+        return LuaFunctionRef{
+            _mainThread(), luaL_ref(_state, LUA_REGISTRYINDEX)};
+    }
+
     // maps
     template <typename Key, typename Value>
     std::map<Key, Value> _read(
@@ -1361,6 +1830,30 @@ private:
         return retValue;
     }
 
+    // vectors, from the array part of a table (indices 1 to #t)
+    template <typename T>
+    std::vector<T> _read(int index, std::vector<T> const* = nullptr) const
+    {
+        if(!lua_istable(_state, index)) throw(WrongTypeException());
+
+        // reading the elements pushes them, relative indices would shift
+        index = lua_absindex(_state, index);
+
+        const std::size_t size = lua_rawlen(_state, index);
+
+        std::vector<T> retValue;
+        retValue.reserve(size);
+
+        for(std::size_t i = 1; i <= size; ++i)
+        {
+            lua_rawgeti(_state, index, static_cast<lua_Integer>(i));
+            retValue.emplace_back(_read(-1, static_cast<T*>(nullptr)));
+            lua_pop(_state, 1);
+        }
+
+        return retValue;
+    }
+
     // reading array
     Table _read(int index, Table const* = nullptr) const
     {
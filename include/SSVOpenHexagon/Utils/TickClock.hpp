@@ -0,0 +1,55 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ratio>
+
+namespace hg::Utils
+{
+
+// Game time, counted in integer ticks of 1/960 s. A simulation step and a
+// frame of 60 FPS frametime are both whole numbers of ticks, so the game
+// timer, timeline waits, and replays agree exactly however long a level is
+// played, without converting through floating point on every step.
+struct tick_clock
+{
+    using rep = std::int64_t;
+    using period = std::ratio<1, 960>;
+    using duration = std::chrono::duration<rep, period>;
+    using time_point = std::chrono::time_point<tick_clock>;
+
+    static constexpr bool is_steady{true};
+
+    static constexpr rep ticks_per_second{period::den};
+    static constexpr rep ticks_per_frametime{ticks_per_second / 60};
+
+    // Rounded to the nearest tick.
+    [[nodiscard]] static duration from_seconds(const double s) noexcept
+    {
+        return duration{std::llround(s * ticks_per_second)};
+    }
+
+    // Rounded to the nearest tick, `ft` is in frames of 60 FPS.
+    [[nodiscard]] static duration from_frametime(const double ft) noexcept
+    {
+        return duration{std::llround(ft * ticks_per_frametime)};
+    }
+
+    [[nodiscard]] static constexpr double to_seconds(const duration d) noexcept
+    {
+        return static_cast<double>(d.count()) / ticks_per_second;
+    }
+
+    [[nodiscard]] static constexpr double to_frametime(
+        const duration d) noexcept
+    {
+        return static_cast<double>(d.count()) / ticks_per_frametime;
+    }
+};
+
+} // namespace hg::Utils
@@ -4,27 +4,332 @@
 
 #pragma once
 
+#include "SSVOpenHexagon/Utils/TickClock.hpp"
+
 #include <type_traits>
 #include <variant>
 #include <utility>
 #include <chrono>
-#include <functional>
 #include <optional>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
 
 namespace hg::Utils
 {
 
+// Bump allocator for the timeline callables too big to be stored inline.
+// Memory is never freed piecemeal: the chunks are reused once the owning
+// timeline holds no action anymore, and freed with the timeline.
+class timeline2_arena
+{
+private:
+    static constexpr std::size_t chunk_size{16 * 1024};
+
+    struct chunk
+    {
+        std::unique_ptr<std::byte[]> _data;
+        std::size_t _size;
+    };
+
+    std::vector<chunk> _chunks;
+    std::size_t _current_chunk{0};
+    std::size_t _used{0};
+
+public:
+    [[nodiscard]] void* allocate(
+        const std::size_t size, const std::size_t align);
+
+    // Makes all the chunks available again, without freeing them.
+    void reset() noexcept;
+
+    [[nodiscard]] std::size_t bytes_reserved() const noexcept;
+};
+
+template <typename Signature>
+class timeline2_function;
+
+// Type-erased callable of a timeline action. Small callables, which are most
+// of the ones created by the Lua bindings, are stored inline. Bigger ones go
+// to the arena of the timeline they are appended to, or to the heap when
+// created outside of a timeline.
+template <typename R>
+class timeline2_function<R()>
+{
+public:
+    static constexpr std::size_t buffer_size{48};
+
+private:
+    enum class storage : unsigned char
+    {
+        none,
+        buffer,
+        arena,
+        heap
+    };
+
+    struct vtable
+    {
+        R (*_invoke)(void*);
+        void (*_copy)(const void*, void*);
+        void (*_move)(void*, void*) noexcept;
+        void (*_destroy)(void*) noexcept;
+        std::size_t _size;
+        std::size_t _align;
+    };
+
+    template <typename F>
+    static constexpr vtable vtable_for{
+        [](void* obj) -> R { return (*static_cast<F*>(obj))(); },
+        [](const void* src, void* dst) {
+            ::new(dst) F(*static_cast<const F*>(src));
+        },
+        [](void* src, void* dst) noexcept {
+            ::new(dst) F(std::move(*static_cast<F*>(src)));
+        },
+        [](void* obj) noexcept { static_cast<F*>(obj)->~F(); }, //
+        sizeof(F), alignof(F)};
+
+    template <typename F>
+    static constexpr bool fits_inline{sizeof(F) <= buffer_size &&
+                                      alignof(F) <= alignof(std::max_align_t) &&
+                                      std::is_nothrow_move_constructible_v<F>};
+
+    union
+    {
+        alignas(std::max_align_t) std::byte _buffer[buffer_size];
+        void* _external;
+    };
+
+    const vtable* _vtable{nullptr};
+    storage _storage{storage::none};
+
+    [[nodiscard]] static void* allocate(
+        const vtable& vt, timeline2_arena* const arena)
+    {
+        if(arena != nullptr)
+        {
+            return arena->allocate(vt._size, vt._align);
+        }
+
+        return ::operator new(vt._size, std::align_val_t{vt._align});
+    }
+
+    static void deallocate(const vtable& vt, void* const ptr) noexcept
+    {
+        ::operator delete(ptr, std::align_val_t{vt._align});
+    }
+
+    [[nodiscard]] void* object() const noexcept
+    {
+        if(_storage == storage::buffer)
+        {
+            return const_cast<std::byte*>(_buffer);
+        }
+
+        return _external;
+    }
+
+    template <typename F>
+    void construct(F&& f, timeline2_arena* const arena)
+    {
+        using T = std::decay_t<F>;
+
+        if constexpr(fits_inline<T>)
+        {
+            ::new(static_cast<void*>(_buffer)) T(std::forward<F>(f));
+            _storage = storage::buffer;
+        }
+        else
+        {
+            void* const ptr = allocate(vtable_for<T>, arena);
+
+            try
+            {
+                ::new(ptr) T(std::forward<F>(f));
+            }
+            catch(...)
+            {
+                if(arena == nullptr)
+                {
+                    deallocate(vtable_for<T>, ptr);
+                }
+
+                throw;
+            }
+
+            _external = ptr;
+            _storage = arena != nullptr ? storage::arena : storage::heap;
+        }
+
+        _vtable = &vtable_for<T>;
+    }
+
+    void copy_from(
+        const timeline2_function& other, timeline2_arena* const arena)
+    {
+        if(other._storage == storage::none)
+        {
+            return;
+        }
+
+        if(other._storage == storage::buffer)
+        {
+            other._vtable->_copy(other._buffer, _buffer);
+            _storage = storage::buffer;
+        }
+        else
+        {
+            void* const ptr = allocate(*other._vtable, arena);
+
+            try
+            {
+                other._vtable->_copy(other._external, ptr);
+            }
+            catch(...)
+            {
+                if(arena == nullptr)
+                {
+                    deallocate(*other._vtable, ptr);
+                }
+
+                throw;
+            }
+
+            _external = ptr;
+            _storage = arena != nullptr ? storage::arena : storage::heap;
+        }
+
+        _vtable = other._vtable;
+    }
+
+    void move_from(timeline2_function& other) noexcept
+    {
+        if(other._storage == storage::buffer)
+        {
+            other._vtable->_move(other._buffer, _buffer);
+            other._vtable->_destroy(other._buffer);
+        }
+        else
+        {
+            // Arena and heap callables are not moved, only their owner is.
+            _external = other._external;
+        }
+
+        _vtable = other._vtable;
+        _storage = other._storage;
+
+        other._vtable = nullptr;
+        other._storage = storage::none;
+    }
+
+public:
+    timeline2_function() noexcept = default;
+
+    template <typename F,
+        typename = std::enable_if_t<
+            !std::is_same_v<std::decay_t<F>, timeline2_function> &&
+            std::is_invocable_r_v<R, std::decay_t<F>&>>>
+    timeline2_function(F&& f, timeline2_arena* const arena = nullptr)
+    {
+        construct(std::forward<F>(f), arena);
+    }
+
+    // Copies `other`, storing the copy in `arena` if it does not fit inline.
+    timeline2_function(
+        const timeline2_function& other, timeline2_arena* const arena)
+    {
+        copy_from(other, arena);
+    }
+
+    timeline2_function(const timeline2_function& other)
+    {
+        copy_from(other, nullptr);
+    }
+
+    timeline2_function(timeline2_function&& other) noexcept
+    {
+        move_from(other);
+    }
+
+    timeline2_function& operator=(const timeline2_function& other)
+    {
+        if(this != &other)
+        {
+            timeline2_function copy{other};
+            *this = std::move(copy);
+        }
+
+        return *this;
+    }
+
+    timeline2_function& operator=(timeline2_function&& other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+            move_from(other);
+        }
+
+        return *this;
+    }
+
+    ~timeline2_function()
+    {
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        if(_storage == storage::none)
+        {
+            return;
+        }
+
+        void* const obj = object();
+        _vtable->_destroy(obj);
+
+        if(_storage == storage::heap)
+        {
+            deallocate(*_vtable, obj);
+        }
+
+        _vtable = nullptr;
+        _storage = storage::none;
+    }
+
+    [[nodiscard]] explicit operator bool() const noexcept
+    {
+        return _storage != storage::none;
+    }
+
+    [[nodiscard]] bool stored_inline() const noexcept
+    {
+        return _storage == storage::buffer;
+    }
+
+    R operator()() const
+    {
+        return _vtable->_invoke(object());
+    }
+};
+
+class timeline2_runner;
+
 class timeline2
 {
+    friend timeline2_runner;
+
 public:
-    using clock = std::chrono::high_resolution_clock;
+    using clock = tick_clock;
     using time_point = clock::time_point;
     using duration = clock::duration;
 
     struct action_do
     {
-        std::function<void()> _func;
+        timeline2_function<void()> _func;
     };
 
     struct action_wait_for
@@ -39,31 +344,120 @@ public:
 
     struct action_wait_until_fn
     {
-        std::function<time_point()> _time_point_fn;
+        timeline2_function<time_point()> _time_point_fn;
+    };
+
+    using wait_action =
+        std::variant<action_wait_for, action_wait_until, action_wait_until_fn>;
+
+    // Runs a coroutine until its next wait, which is honored before resuming
+    // it. Returns nothing once the coroutine has finished.
+    struct action_coroutine
+    {
+        timeline2_function<std::optional<wait_action>()> _resume_fn;
     };
 
     struct action
     {
         std::variant<action_do, action_wait_for, action_wait_until,
-            action_wait_until_fn>
+            action_wait_until_fn, action_coroutine>
             _inner;
     };
 
 private:
+    static constexpr std::size_t initial_capacity{16};
+
+    // Declared first, the callables stored in it are destroyed before it.
+    timeline2_arena _arena;
+
+    // Ring buffer of the pending actions, executed ones are popped by the
+    // runner. Its size is zero or a power of two.
     std::vector<action> _actions;
+    std::size_t _head{0};
+    std::size_t _count{0};
+
+    // Callables being run by a runner. They might live in the arena, which
+    // cannot be reused until they return.
+    std::size_t _executing{0};
+
+    // Changes whenever the front action is replaced by something other than
+    // a runner, i.e. on clear and on assignment.
+    std::uint64_t _generation{next_generation()};
+
+    [[nodiscard]] static std::uint64_t next_generation() noexcept;
+
+    class execution_guard
+    {
+    private:
+        timeline2& _timeline;
+
+    public:
+        explicit execution_guard(timeline2& timeline) noexcept;
+        ~execution_guard();
+
+        execution_guard(const execution_guard&) = delete;
+        execution_guard& operator=(const execution_guard&) = delete;
+    };
+
+    [[nodiscard]] action& slot(const std::size_t i) noexcept;
+    [[nodiscard]] action clone(const action& a);
+
+    void grow();
+    void push_back(action&& a);
+    void push_front(action&& a);
+    void pop_front();
+    void reclaim() noexcept;
 
 public:
+    timeline2() = default;
+    ~timeline2() = default;
+
+    // Copies store their big callables in their own arena.
+    timeline2(const timeline2& other);
+    timeline2(timeline2&& other) noexcept;
+    timeline2& operator=(const timeline2& other);
+    timeline2& operator=(timeline2&& other) noexcept;
+
     void clear();
 
-    void append_do(const std::function<void()>& func);
+    template <typename F>
+    void append_do(F&& func)
+    {
+        push_back(action{action_do{{std::forward<F>(func), &_arena}}});
+    }
+
     void append_wait_for(const duration d);
     void append_wait_for_seconds(const double s);
     void append_wait_for_sixths(const double s);
     void append_wait_until(const time_point tp);
-    void append_wait_until_fn(const std::function<time_point()>& tp_fn);
+
+    template <typename F>
+    void append_wait_until_fn(F&& tp_fn)
+    {
+        push_back(
+            action{action_wait_until_fn{{std::forward<F>(tp_fn), &_arena}}});
+    }
+
+    template <typename F>
+    void append_coroutine(F&& resume_fn)
+    {
+        push_back(
+            action{action_coroutine{{std::forward<F>(resume_fn), &_arena}}});
+    }
+
+    [[nodiscard]] static duration duration_from_seconds(const double s);
+    [[nodiscard]] static duration duration_from_sixths(const double s);
 
     [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] bool empty() const noexcept;
+
+    // Pending actions, starting from the next one to run.
     [[nodiscard]] action& action_at(const std::size_t i) noexcept;
+
+    // Bytes used by the ring buffer and the arena.
+    [[nodiscard]] std::size_t memory_usage() const noexcept;
+
+    [[nodiscard]] std::uint64_t generation() const noexcept;
 };
 
 class timeline2_runner
@@ -80,11 +474,35 @@ public:
     };
 
 private:
-    std::size_t _current_idx{0};
     std::optional<time_point> _wait_start_tp;
+    std::optional<timeline2::wait_action> _coroutine_wait;
+
+    // End of the wait blocking the timeline, when it only depends on the
+    // clock. The timeline is not looked at again before then.
+    std::optional<time_point> _due_tp;
+    std::uint64_t _due_generation{0};
+
+    [[nodiscard]] outcome wait_for(
+        const timeline2::action_wait_for& x, const time_point tp);
+    [[nodiscard]] outcome wait_until(
+        const timeline2::action_wait_until& x, const time_point tp);
+    [[nodiscard]] outcome wait_until_fn(
+        const timeline2::action_wait_until_fn& x, const time_point tp);
+    [[nodiscard]] outcome wait(
+        const timeline2::wait_action& x, const time_point tp);
+    [[nodiscard]] outcome resume(
+        const timeline2::action_coroutine& x, const time_point tp);
+
+    [[nodiscard]] std::optional<time_point> due(
+        const timeline2::wait_action& x) const;
+    [[nodiscard]] std::optional<time_point> due(
+        const timeline2::action& x) const;
 
 public:
     outcome update(timeline2& timeline, const time_point tp);
+
+    // Time point at which the wait blocking the timeline ends, if known.
+    [[nodiscard]] std::optional<time_point> next_due() const noexcept;
 };
 
 } // namespace hg::Utils
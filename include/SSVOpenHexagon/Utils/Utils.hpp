@@ -9,15 +9,19 @@
 #include "SSVOpenHexagon/Data/MusicData.hpp"
 #include "SSVOpenHexagon/Global/Version.hpp"
 #include "SSVOpenHexagon/Utils/LuaWrapper.hpp"
+#include "SSVOpenHexagon/Utils/LuaBytecodeCache.hpp"
 #include "SSVOpenHexagon/SSVUtilsJson/SSVUtilsJson.hpp"
 
 #include <SSVStart/Camera/Camera.hpp>
 
 #include <SSVUtils/Core/FileSystem/FileSystem.hpp>
+#include <SSVUtils/Core/Utils/Math.hpp>
 #include <SSVUtils/Timeline/Timeline.hpp>
 
 #include <SFML/Graphics/Color.hpp>
+#include <SFML/System/Vector2.hpp>
 
+#include <cmath>
 #include <string>
 #include <sstream>
 #include <set>
@@ -66,6 +70,25 @@ inline float getFontHeight(sf::Text& font, const unsigned int charSize)
     return x * x * x * (x * (x * 6 - 15) + 10);
 }
 
+[[nodiscard, gnu::pure]] inline float getLerped(
+    float mFrom, float mTo, float mT)
+{
+    return mFrom + (mTo - mFrom) * mT;
+}
+
+[[nodiscard, gnu::pure]] inline sf::Vector2f getLerped(
+    const sf::Vector2f& mFrom, const sf::Vector2f& mTo, float mT)
+{
+    return mFrom + (mTo - mFrom) * mT;
+}
+
+// Signed difference between two angles in radians, taking the shortest way
+// around the circle. The result is in the `[-pi, pi]` range.
+[[nodiscard, gnu::pure]] inline float getAngleDiffRad(float mFrom, float mTo)
+{
+    return std::remainder(mTo - mFrom, ssvu::tau);
+}
+
 MusicData loadMusicFromJson(const ssvuj::Obj& mRoot);
 GameVersion loadVersionFromJson(const ssvuj::Obj& mRoot);
 ProfileData loadProfileFromJson(const ssvuj::Obj& mRoot);
@@ -82,13 +105,12 @@ void recursiveFillIncludedLuaFileNames(std::set<std::string>& mLuaScriptNames,
 
 [[gnu::pure]] sf::Color transformHue(const sf::Color& in, float H);
 
-inline void runLuaFile(Lua::LuaContext& mLua, const std::string& mFileName)
+template <typename F>
+void runLuaFileImpl(const std::string& mFileName, F&& mRun)
 {
-    std::ifstream s{mFileName};
-
     try
     {
-        mLua.executeCode(s);
+        mRun();
     }
     catch(std::runtime_error& mError)
     {
@@ -100,6 +122,19 @@ inline void runLuaFile(Lua::LuaContext& mLua, const std::string& mFileName)
     }
 }
 
+inline void runLuaFile(Lua::LuaContext& mLua, const std::string& mFileName)
+{
+    std::ifstream s{mFileName};
+    runLuaFileImpl(mFileName, [&] { mLua.executeCode(s); });
+}
+
+// Same as above, but only parses the script if it is not in `mCache`.
+inline void runLuaFile(Lua::LuaContext& mLua, LuaBytecodeCache& mCache,
+    const std::string& mFileName)
+{
+    runLuaFileImpl(mFileName, [&] { mCache.runLuaFile(mLua, mFileName); });
+}
+
 struct Nothing
 {
 };
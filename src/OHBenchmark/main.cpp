@@ -0,0 +1,716 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+// ----------------------------------------------------------------------------
+// Open Hexagon includes.
+#include "SSVOpenHexagon/Components/SpeedData.hpp"
+#include "SSVOpenHexagon/Components/WallBuffer.hpp"
+#include "SSVOpenHexagon/Core/RandomNumberGenerator.hpp"
+#include "SSVOpenHexagon/Utils/LuaWrapper.hpp"
+#include "SSVOpenHexagon/Utils/PointInPolygon.hpp"
+#include "SSVOpenHexagon/Utils/Timeline2.hpp"
+
+// ----------------------------------------------------------------------------
+// SSVStart includes.
+#include <SSVStart/Utils/Vector2.hpp>
+
+// ----------------------------------------------------------------------------
+// Standard includes.
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Heap accounting.
+// Every allocation is prefixed with its size, so that the bytes alive at any
+// point can be measured.
+namespace
+{
+
+std::size_t live_heap_bytes{0};
+
+constexpr std::size_t heap_prefix_size{alignof(std::max_align_t)};
+
+} // namespace
+
+void* operator new(const std::size_t n)
+{
+    auto* const p = static_cast<std::byte*>(std::malloc(n + heap_prefix_size));
+    if(p == nullptr)
+    {
+        throw std::bad_alloc{};
+    }
+
+    *reinterpret_cast<std::size_t*>(p) = n;
+    live_heap_bytes += n;
+
+    return p + heap_prefix_size;
+}
+
+void operator delete(void* const ptr) noexcept
+{
+    if(ptr == nullptr)
+    {
+        return;
+    }
+
+    auto* const p = static_cast<std::byte*>(ptr) - heap_prefix_size;
+    live_heap_bytes -= *reinterpret_cast<std::size_t*>(p);
+
+    std::free(p);
+}
+
+void operator delete(void* const ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+namespace
+{
+
+// ----------------------------------------------------------------------------
+// Utilities.
+template <typename F>
+[[nodiscard]] double seconds_taken(F&& f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+void report(const std::string_view name, const std::string_view variant,
+    const std::size_t ops, const double seconds)
+{
+    std::cout << std::left << std::setw(24) << name << std::setw(10)
+              << variant << std::right << std::setw(16) << std::fixed
+              << std::setprecision(0) << (ops / seconds) << " ops/s\n";
+}
+
+// ----------------------------------------------------------------------------
+// Lua bindings.
+// Stand-in for the simulation state touched by the benchmarked bindings. The
+// bindings capture a pointer to it, as the real ones capture `this`.
+struct binding_state
+{
+    std::vector<std::pair<int, float>> walls;
+    std::array<std::array<float, 2>, 4> vertices{};
+    hg::random_number_generator rng{0};
+};
+
+struct lua_binding_bench
+{
+    const char* name;
+    const char* call;
+};
+
+constexpr std::array lua_binding_benches{
+    lua_binding_bench{"w_wall", "w_wall(i % 6, 40)"},
+    lua_binding_bench{"cw_setVertexPos", "cw_setVertexPos(0, i % 4, i, -i)"},
+    lua_binding_bench{"u_rndInt", "x = u_rndInt(0, 5)"}};
+
+template <bool Static>
+void register_bindings(Lua::LuaContext& lua, binding_state& s)
+{
+    const auto add = [&](const std::string& name, auto f) {
+        if constexpr(Static)
+        {
+            lua.writeStaticFunction(name, f);
+        }
+        else
+        {
+            lua.writeVariable(name, f);
+        }
+    };
+
+    binding_state* const sp = &s;
+
+    add("w_wall", [sp](int mSide, float mThickness) {
+        if(sp->walls.size() == 1024)
+        {
+            sp->walls.clear();
+        }
+
+        sp->walls.emplace_back(mSide, mThickness);
+    });
+
+    add("cw_setVertexPos", [sp](int, int vertexIndex, float x, float y) {
+        sp->vertices[vertexIndex] = {x, y};
+    });
+
+    add("u_rndInt", [sp](int mLower, int mUpper) -> float {
+        return sp->rng.get_int<int>(mLower, mUpper);
+    });
+}
+
+void run_lua_binding_benches(const std::size_t iterations)
+{
+    std::cout << "Lua bindings (" << iterations << " calls each)\n";
+
+    for(const lua_binding_bench& b : lua_binding_benches)
+    {
+        const std::string code = "for i = 1, " + std::to_string(iterations) +
+                                 " do " + b.call + " end";
+
+        const auto run = [&]<bool Static>(const char* variant) {
+            binding_state s;
+            Lua::LuaContext lua;
+            register_bindings<Static>(lua, s);
+
+            report(b.name, variant, iterations,
+                seconds_taken([&] { lua.executeCode(code); }));
+        };
+
+        run.template operator()<false>("userdata");
+        run.template operator()<true>("static");
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Timelines.
+using time_point = hg::Utils::timeline2::time_point;
+using duration = hg::Utils::timeline2::duration;
+
+// The timeline before the ring buffer: `std::function`s in a vector walked by
+// an index, executed actions are kept until the timeline is cleared.
+struct vector_timeline
+{
+    using action = std::variant<std::function<void()>, duration>;
+
+    std::vector<action> actions;
+    std::size_t current_idx{0};
+    std::optional<time_point> wait_start_tp;
+
+    template <typename F>
+    void append_do(F&& f)
+    {
+        actions.emplace_back(std::function<void()>{std::forward<F>(f)});
+    }
+
+    void append_wait_for(const duration d)
+    {
+        actions.emplace_back(d);
+    }
+
+    void clear()
+    {
+        actions.clear();
+        current_idx = 0;
+    }
+
+    void update(const time_point tp)
+    {
+        while(current_idx < actions.size())
+        {
+            if(const auto* f =
+                    std::get_if<std::function<void()>>(&actions[current_idx]))
+            {
+                (*f)();
+                ++current_idx;
+                continue;
+            }
+
+            if(!wait_start_tp.has_value())
+            {
+                wait_start_tp = tp;
+            }
+
+            if(tp - *wait_start_tp < std::get<duration>(actions[current_idx]))
+            {
+                return;
+            }
+
+            wait_start_tp.reset();
+            ++current_idx;
+        }
+    }
+
+    [[nodiscard]] std::size_t pending() const
+    {
+        return actions.size() - current_idx;
+    }
+};
+
+struct ring_timeline
+{
+    hg::Utils::timeline2 timeline;
+    hg::Utils::timeline2_runner runner;
+
+    template <typename F>
+    void append_do(F&& f)
+    {
+        timeline.append_do(std::forward<F>(f));
+    }
+
+    void append_wait_for(const duration d)
+    {
+        timeline.append_wait_for(d);
+    }
+
+    void clear()
+    {
+        timeline.clear();
+    }
+
+    void update(const time_point tp)
+    {
+        (void)runner.update(timeline, tp);
+    }
+
+    [[nodiscard]] std::size_t pending() const
+    {
+        return timeline.size();
+    }
+};
+
+// What a `w_wall` action captures.
+[[nodiscard]] auto make_wall_action(binding_state& s, const int side)
+{
+    return [sp = &s, side, thickness = 40.f, speed = 1.f] {
+        if(sp->walls.size() == 1024)
+        {
+            sp->walls.clear();
+        }
+
+        sp->walls.emplace_back(side, thickness * speed);
+    };
+}
+
+// Bigger than the inline buffer of the timeline callables.
+[[nodiscard]] auto make_large_action(binding_state& s, const int side)
+{
+    std::array<float, 24> data{};
+    data[0] = static_cast<float>(side);
+
+    return [sp = &s, data] { sp->walls.emplace_back(0, data[0]); };
+}
+
+template <typename Timeline, typename MakeAction>
+[[nodiscard]] double time_appends(
+    const std::size_t iterations, const MakeAction& make_action)
+{
+    // Cleared every batch, like the main timeline at the end of a pattern
+    constexpr std::size_t batch_size{1024};
+
+    binding_state s;
+    Timeline tl;
+
+    return seconds_taken([&] {
+        for(std::size_t i = 0; i < iterations; ++i)
+        {
+            if(i % batch_size == 0)
+            {
+                tl.clear();
+            }
+
+            tl.append_do(make_action(s, static_cast<int>(i % 6)));
+        }
+    });
+}
+
+void run_timeline_benches(const std::size_t iterations)
+{
+    std::cout << "\nTimeline appends (" << iterations << " each)\n";
+
+    const auto wall = [](binding_state& s, const int side) {
+        return make_wall_action(s, side);
+    };
+
+    const auto large = [](binding_state& s, const int side) {
+        return make_large_action(s, side);
+    };
+
+    report("append_do (small)", "vector", iterations,
+        time_appends<vector_timeline>(iterations, wall));
+    report("append_do (small)", "ring", iterations,
+        time_appends<ring_timeline>(iterations, wall));
+    report("append_do (large)", "vector", iterations,
+        time_appends<vector_timeline>(iterations, large));
+    report("append_do (large)", "ring", iterations,
+        time_appends<ring_timeline>(iterations, large));
+}
+
+// Plays a level for 10 minutes at 60 ticks per second, with a script that
+// keeps a few spirals queued ahead of the player, as pattern coroutines and
+// event timelines do. Returns the peak of the bytes held by the timeline.
+template <typename Timeline>
+[[nodiscard]] std::size_t level_peak_memory(std::size_t& final_bytes)
+{
+    constexpr int ticks{60 * 60 * 10};
+    constexpr std::size_t queued_actions{64};
+
+    const duration tick = std::chrono::duration_cast<duration>(
+        std::chrono::duration<double>{1.0 / 60.0});
+
+    binding_state s;
+    s.walls.reserve(1024);
+
+    Timeline tl;
+
+    const std::size_t base_bytes = live_heap_bytes;
+    std::size_t peak_bytes{0};
+
+    time_point tp{};
+
+    for(int i = 0; i < ticks; ++i)
+    {
+        if(tl.pending() < queued_actions)
+        {
+            for(int side = 0; side < 12; ++side)
+            {
+                tl.append_do(make_wall_action(s, side % 6));
+                tl.append_wait_for(
+                    hg::Utils::timeline2::duration_from_sixths(4.0));
+            }
+        }
+
+        tl.update(tp);
+        tp += tick;
+
+        peak_bytes = std::max(peak_bytes, live_heap_bytes - base_bytes);
+    }
+
+    final_bytes = live_heap_bytes - base_bytes;
+    return peak_bytes;
+}
+
+void run_timeline_memory_bench()
+{
+    std::cout << "\nTimeline memory over a 10 minute level\n";
+
+    const auto run = [&]<typename Timeline>(const char* variant) {
+        std::size_t final_bytes{0};
+        const std::size_t peak_bytes = level_peak_memory<Timeline>(final_bytes);
+
+        std::cout << std::left << std::setw(24) << "peak / final"
+                  << std::setw(10) << variant << std::right << std::setw(16)
+                  << peak_bytes << std::setw(16) << final_bytes << " bytes\n";
+    };
+
+    run.template operator()<vector_timeline>("vector");
+    run.template operator()<ring_timeline>("ring");
+}
+
+template <typename Timeline>
+[[nodiscard]] double time_idle_updates(const std::size_t iterations)
+{
+    // Blocked for the whole run, as the event timeline usually is
+    Timeline tl;
+    tl.append_wait_for(hg::Utils::timeline2::duration_from_seconds(1e6));
+
+    const duration tick = hg::Utils::timeline2::duration_from_sixths(0.5);
+    time_point tp{};
+
+    return seconds_taken([&] {
+        for(std::size_t i = 0; i < iterations; ++i)
+        {
+            tl.update(tp);
+            tp += tick;
+        }
+    });
+}
+
+// An event script of `e_eventWaitUntilS` calls spread over a 10 minute level
+// played at 120 ticks per second. `e_eventWaitUntilS` used to append a
+// `wait_until_fn`, which has to be polled on every tick.
+template <bool Scheduled>
+[[nodiscard]] double time_event_script(
+    const std::size_t waits, const std::size_t ticks)
+{
+    binding_state s;
+    s.walls.reserve(1024);
+
+    ring_timeline tl;
+
+    for(std::size_t i = 0; i < waits; ++i)
+    {
+        const time_point until{hg::Utils::timeline2::duration_from_seconds(
+            600.0 * static_cast<double>(i) / static_cast<double>(waits))};
+
+        if constexpr(Scheduled)
+        {
+            tl.timeline.append_wait_until(until);
+        }
+        else
+        {
+            tl.timeline.append_wait_until_fn([until] { return until; });
+        }
+
+        tl.append_do(make_wall_action(s, static_cast<int>(i % 6)));
+    }
+
+    const duration tick = hg::Utils::timeline2::duration_from_sixths(0.5);
+    time_point tp{};
+
+    return seconds_taken([&] {
+        for(std::size_t i = 0; i < ticks; ++i)
+        {
+            tl.update(tp);
+            tp += tick;
+        }
+    });
+}
+
+void run_timeline_wait_benches(const std::size_t iterations)
+{
+    std::cout << "\nTimeline updates (" << iterations << " idle ticks)\n";
+
+    report("idle wait_for", "vector", iterations,
+        time_idle_updates<vector_timeline>(iterations));
+    report("idle wait_for", "ring", iterations,
+        time_idle_updates<ring_timeline>(iterations));
+
+    constexpr std::size_t waits{5000};
+    constexpr std::size_t ticks{120 * 60 * 10};
+
+    std::cout << "\nEvent script (" << waits << " waits, " << ticks
+              << " ticks)\n";
+
+    report("e_eventWaitUntilS", "polled", ticks,
+        time_event_script<false>(waits, ticks));
+    report("e_eventWaitUntilS", "scheduled", ticks,
+        time_event_script<true>(waits, ticks));
+}
+
+// ----------------------------------------------------------------------------
+// Wall movement.
+// The per-tick work of `updateWalls` for `walls` walls: speed updates,
+// movement towards the center, curving, and the overlap tests with the player
+// between every step. Pushes are left out, the player never touches a wall.
+
+constexpr float wall_bench_radius{48.f};
+const sf::Vector2f wall_bench_center{0.f, 0.f};
+const sf::Vector2f wall_bench_player{0.f, 60.f};
+
+[[nodiscard]] std::array<sf::Vector2f, 4> make_bench_wall_vertices(
+    const std::size_t i)
+{
+    const float angle = static_cast<float>(i) * 1.047f;
+    const float distance = 1600.f + static_cast<float>(i % 40) * 20.f;
+
+    const auto orbit = [&](const float a, const float d) {
+        return sf::Vector2f{std::cos(a) * d, std::sin(a) * d};
+    };
+
+    return {orbit(angle - 0.5f, distance), orbit(angle + 0.5f, distance),
+        orbit(angle + 0.5f, distance + 40.f),
+        orbit(angle - 0.5f, distance + 40.f)};
+}
+
+[[nodiscard]] hg::SpeedData make_bench_wall_speed(const std::size_t i)
+{
+    // Some walls accelerate, as with `w_wallAcc`
+    return i % 5 == 0 ? hg::SpeedData{0.01f, 0.0001f, 0.f, 0.02f, true}
+                      : hg::SpeedData{0.01f};
+}
+
+[[nodiscard]] hg::SpeedData make_bench_wall_curve(const std::size_t i)
+{
+    return hg::SpeedData{0.06f * static_cast<float>(i % 7)};
+}
+
+// Walls stored one by one, as `CWall` used to.
+struct per_wall_bench_wall
+{
+    std::array<sf::Vector2f, 4> vertexPositions;
+    hg::SpeedData speed;
+    hg::SpeedData curve;
+    bool killed;
+};
+
+[[nodiscard]] double time_wall_movement_per_wall(
+    const std::size_t walls, const std::size_t ticks, std::size_t& overlaps)
+{
+    std::vector<per_wall_bench_wall> ws;
+
+    for(std::size_t i = 0; i < walls; ++i)
+    {
+        ws.push_back({make_bench_wall_vertices(i), make_bench_wall_speed(i),
+            make_bench_wall_curve(i), false});
+    }
+
+    const auto isOverlapping = [&](const std::array<sf::Vector2f, 4>& v) {
+        return hg::Utils::pointInPolygon(
+            v, wall_bench_player.x, wall_bench_player.y);
+    };
+
+    const ssvu::FT ft{0.5f};
+
+    return seconds_taken([&] {
+        for(std::size_t t = 0; t < ticks; ++t)
+        {
+            for(per_wall_bench_wall& w : ws)
+            {
+                w.speed.update(ft);
+                w.curve.update(ft);
+            }
+
+            for(per_wall_bench_wall& w : ws)
+            {
+                overlaps += isOverlapping(w.vertexPositions);
+
+                int pointsOnCenter{0};
+                for(sf::Vector2f& vp : w.vertexPositions)
+                {
+                    if(std::abs(vp.x - wall_bench_center.x) <
+                            wall_bench_radius &&
+                        std::abs(vp.y - wall_bench_center.y) <
+                            wall_bench_radius)
+                    {
+                        ++pointsOnCenter;
+                    }
+                    else
+                    {
+                        ssvs::moveTowards(
+                            vp, wall_bench_center, w.speed.speed * 5.f * ft);
+                    }
+                }
+
+                w.killed = pointsOnCenter > 3;
+                overlaps += isOverlapping(w.vertexPositions);
+
+                for(sf::Vector2f& vp : w.vertexPositions)
+                {
+                    ssvs::rotateRadAround(
+                        vp, wall_bench_center, w.curve.speed / 60.f * ft);
+                }
+
+                overlaps += isOverlapping(w.vertexPositions);
+            }
+
+            for(const per_wall_bench_wall& w : ws)
+            {
+                overlaps += isOverlapping(w.vertexPositions);
+            }
+
+            std::erase_if(
+                ws, [](const per_wall_bench_wall& w) { return w.killed; });
+        }
+    });
+}
+
+template <bool Vectorized>
+[[nodiscard]] double time_wall_movement_buffer(
+    const std::size_t walls, const std::size_t ticks, std::size_t& overlaps)
+{
+    hg::WallBuffer wb;
+
+    for(std::size_t i = 0; i < walls; ++i)
+    {
+        wb.add(make_bench_wall_vertices(i), make_bench_wall_speed(i),
+            make_bench_wall_curve(i), 0.f);
+    }
+
+    const auto isOverlapping = [&](const hg::WallBuffer::Vertices& v) {
+        return hg::Utils::pointInPolygon(
+            v, wall_bench_player.x, wall_bench_player.y);
+    };
+
+    const ssvu::FT ft{0.5f};
+
+    return seconds_taken([&] {
+        for(std::size_t t = 0; t < ticks; ++t)
+        {
+            wb.updateSpeeds(ft);
+
+            if constexpr(Vectorized)
+            {
+                wb.moveTowardsCenter(wall_bench_center, wall_bench_radius);
+                wb.rotateAroundCenter(wall_bench_center);
+            }
+            else
+            {
+                wb.moveTowardsCenterScalar(
+                    wall_bench_center, wall_bench_radius);
+                wb.rotateAroundCenterScalar(wall_bench_center);
+            }
+
+            for(std::size_t i = 0; i < wb.getMovedCount(); ++i)
+            {
+                overlaps += isOverlapping(wb.getVertexPositions(i));
+                overlaps += isOverlapping(wb.getMoved(i));
+                overlaps += isOverlapping(wb.getCurved(i));
+            }
+
+            wb.applyMovement();
+
+            for(std::size_t i = 0; i < wb.size(); ++i)
+            {
+                overlaps += isOverlapping(wb.getVertexPositions(i));
+            }
+
+            wb.eraseKilled();
+        }
+    });
+}
+
+void run_wall_movement_benches(const std::size_t iterations)
+{
+    constexpr std::size_t walls{256};
+    const std::size_t ticks = std::max<std::size_t>(iterations / walls, 1);
+
+    std::cout << "\nWall movement (" << walls << " walls, " << ticks
+              << " ticks)\n";
+
+    // Overlap counts are printed so that the tests are not optimized away
+    std::size_t overlaps{0};
+
+    report("updateWalls", "per-wall", walls * ticks,
+        time_wall_movement_per_wall(walls, ticks, overlaps));
+    report("updateWalls", "scalar", walls * ticks,
+        time_wall_movement_buffer<false>(walls, ticks, overlaps));
+    report("updateWalls", hg::WallBuffer::getKernelName(), walls * ticks,
+        time_wall_movement_buffer<true>(walls, ticks, overlaps));
+
+    std::cout << "(" << overlaps << " overlaps)\n";
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// Entry point.
+int main(int argc, char* argv[])
+{
+    std::size_t iterations = 5'000'000;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        // Number of iterations of every benchmark
+        if(!std::strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            ++i;
+
+            const long long n = std::atoll(argv[i]);
+            if(n <= 0)
+            {
+                std::cerr << "Usage: " << argv[0] << " [-n iterations]\n";
+                return 1;
+            }
+
+            iterations = static_cast<std::size_t>(n);
+        }
+    }
+
+    run_lua_binding_benches(iterations);
+    run_timeline_benches(iterations);
+    run_timeline_memory_bench();
+    run_timeline_wait_benches(iterations);
+    run_wall_movement_benches(iterations);
+
+    return 0;
+}
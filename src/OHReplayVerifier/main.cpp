@@ -0,0 +1,392 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+// ----------------------------------------------------------------------------
+// Open Hexagon includes.
+#include "SSVOpenHexagon/Core/HexagonSimulation.hpp"
+#include "SSVOpenHexagon/Core/MappedReplay.hpp"
+#include "SSVOpenHexagon/Core/Replay.hpp"
+#include "SSVOpenHexagon/Global/Assets.hpp"
+#include "SSVOpenHexagon/Global/Config.hpp"
+
+// ----------------------------------------------------------------------------
+// Standard includes.
+#include <iostream>
+#include <atomic>
+#include <string_view>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <optional>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <memory>
+
+namespace
+{
+
+// ----------------------------------------------------------------------------
+// Utilities.
+std::mutex log_mutex;
+
+template <typename F>
+void log(const std::string_view category, F&& f)
+{
+    const std::lock_guard lock{log_mutex};
+
+    std::cout << "[" << category << "] ";
+    f(std::cout);
+}
+
+// ----------------------------------------------------------------------------
+// Argument parsing.
+struct parsed_args
+{
+    std::vector<std::string> args;
+    std::filesystem::path replay_folder;
+    std::size_t worker_count;
+};
+
+[[nodiscard]] std::optional<parsed_args> parse_args(int argc, char* argv[])
+{
+    parsed_args result;
+    result.worker_count =
+        std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+    bool got_replay_folder = false;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        // Number of worker threads
+        if(!std::strcmp(argv[i], "-j") && i + 1 < argc)
+        {
+            ++i;
+
+            const int worker_count = std::atoi(argv[i]);
+            if(worker_count <= 0)
+            {
+                return std::nullopt;
+            }
+
+            result.worker_count = static_cast<std::size_t>(worker_count);
+            continue;
+        }
+
+        // The first free argument is the replay folder, the remaining ones
+        // are forwarded to the configuration loader as overrides
+        if(!got_replay_folder)
+        {
+            got_replay_folder = true;
+            result.replay_folder = std::filesystem::absolute(argv[i]);
+            continue;
+        }
+
+        result.args.emplace_back(argv[i]);
+    }
+
+    if(!got_replay_folder)
+    {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+[[nodiscard]] std::vector<std::filesystem::path> find_replay_files(
+    const std::filesystem::path& folder)
+{
+    std::vector<std::filesystem::path> result;
+
+    for(const auto& entry : std::filesystem::directory_iterator{folder})
+    {
+        if(entry.is_regular_file() &&
+            entry.path().extension() == ".ohreplay")
+        {
+            result.emplace_back(entry.path());
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// Verification.
+
+// Settings every official replay is recorded with
+constexpr float default_spawn_distance{1600.f};
+constexpr float default_player_size{7.3f};
+
+enum class verdict
+{
+    ok,
+    mismatch,
+    desync,
+    error
+};
+
+[[nodiscard]] constexpr std::string_view verdict_to_string(
+    const verdict v) noexcept
+{
+    switch(v)
+    {
+        case verdict::ok: return "OK";
+        case verdict::mismatch: return "MISMATCH";
+        case verdict::desync: return "DESYNC";
+        case verdict::error: return "ERROR";
+    }
+
+    return "UNKNOWN";
+}
+
+struct verification_result
+{
+    verdict _verdict{verdict::error};
+    double _simulated_score{0.0};
+    std::uint64_t _simulated_ticks{0};
+};
+
+[[nodiscard]] verification_result verify_replay(
+    hg::HexagonSimulation& simulation, const hg::mapped_replay_file& mrf)
+{
+    verification_result result;
+
+    const hg::replay_file& rf = mrf.get_replay_file();
+    hg::replay_player player = mrf.make_player();
+
+    simulation.newGame(rf._pack_id, rf._level_id, rf._first_play,
+        rf._difficulty_mult, rf._seed, rf._version);
+
+    // Replays are recorded from the first started tick onwards
+    simulation.start();
+
+    const hg::HexagonGameStatus& status = simulation.getStatus();
+
+    while(!player.done())
+    {
+        if(status.hasDied || simulation.getLuaErrorRaised())
+        {
+            break;
+        }
+
+        simulation.step(player.get_current_and_move_forward());
+        ++result._simulated_ticks;
+
+        // No need to simulate the rest of a replay that already diverged
+        if(rf.has_state_hash(result._simulated_ticks) &&
+            rf.state_hash_mismatch(
+                result._simulated_ticks, simulation.computeStateHash()))
+        {
+            result._simulated_score = simulation.getReplayScore();
+            result._verdict = verdict::desync;
+            return result;
+        }
+    }
+
+    if(simulation.getLuaErrorRaised())
+    {
+        return result;
+    }
+
+    result._simulated_score = simulation.getReplayScore();
+    result._verdict =
+        status.hasDied && result._simulated_score == rf._played_score
+            ? verdict::ok
+            : verdict::mismatch;
+
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if(argc < 1)
+    {
+        std::cerr << "Fatal error: no executable specified" << std::endl;
+        return -1;
+    }
+
+    // ------------------------------------------------------------------------
+    // Parse arguments (before changing the working directory, so that relative
+    // replay folder paths are resolved correctly)
+    const std::optional<parsed_args> opt_args = parse_args(argc, argv);
+
+    if(!opt_args.has_value())
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " <replay folder> [-j <worker count>] [config overrides]"
+                  << std::endl;
+
+        return 1;
+    }
+
+    const std::filesystem::path& replay_folder = opt_args->replay_folder;
+    const std::size_t worker_count = opt_args->worker_count;
+
+    std::error_code ec;
+    if(!std::filesystem::is_directory(replay_folder, ec))
+    {
+        std::cerr << "'" << replay_folder.string()
+                  << "' is not a valid directory" << std::endl;
+
+        return 1;
+    }
+
+    const std::vector<std::filesystem::path> replay_files =
+        find_replay_files(replay_folder);
+
+    // ------------------------------------------------------------------------
+    // Set working directory to current executable location
+    std::filesystem::current_path(std::filesystem::path{argv[0]}.parent_path());
+
+    // ------------------------------------------------------------------------
+    // Load configuration and level data (no audio or graphical assets)
+    hg::Config::loadConfig(opt_args->args);
+
+    // The verdict must only depend on the replay file: official mode pins
+    // every setting read by the simulation (invincibility, rotation, pulse,
+    // player speed and size, ...) regardless of the local configuration
+    hg::Config::setOfficial(true);
+
+    if(!hg::Config::isEligibleForScore())
+    {
+        std::cerr << "Configuration does not match the official settings ("
+                  << hg::Config::getUneligibilityReason() << ")" << std::endl;
+
+        return 1;
+    }
+
+    // Wall spawn distance is not a setting at all, and the player size is
+    // only pinned by official mode: a change to either must not silently
+    // alter the verdicts
+    if(hg::Config::getSpawnDistance() != default_spawn_distance ||
+        hg::Config::getPlayerSize() != default_player_size)
+    {
+        std::cerr << "Spawn distance or player size differ from the official "
+                     "settings"
+                  << std::endl;
+
+        return 1;
+    }
+
+    // Workshop packs are not loaded, verification does not depend on Steam
+    hg::HGAssets assets{nullptr, true /* mLevelsOnly */};
+
+    // ------------------------------------------------------------------------
+    // Verify replays, work is distributed dynamically among workers
+    log("Main", [&](std::ostream& os) {
+        os << "Verifying " << replay_files.size() << " replay(s) with "
+           << worker_count << " worker(s)\n";
+    });
+
+    std::atomic<std::size_t> next_index{0};
+    std::atomic<std::size_t> ok_count{0};
+    std::atomic<std::size_t> mismatch_count{0};
+    std::atomic<std::size_t> desync_count{0};
+    std::atomic<std::size_t> error_count{0};
+    std::atomic<std::uint64_t> total_ticks{0};
+
+    const auto worker = [&] {
+        // Every worker owns its simulation (and thus its Lua state), level
+        // data from `assets` is only read
+        auto simulation = std::make_unique<hg::HexagonSimulation>(assets);
+
+        while(true)
+        {
+            const std::size_t index = next_index++;
+            if(index >= replay_files.size())
+            {
+                return;
+            }
+
+            const std::filesystem::path& p = replay_files[index];
+
+            // Inputs are decoded straight from the mapped file
+            hg::mapped_replay_file mrf;
+            verification_result vr;
+
+            if(mrf.open(p))
+            {
+                vr = verify_replay(*simulation, mrf);
+            }
+
+            total_ticks += vr._simulated_ticks;
+
+            switch(vr._verdict)
+            {
+                case verdict::ok: ++ok_count; break;
+                case verdict::mismatch: ++mismatch_count; break;
+                case verdict::desync: ++desync_count; break;
+                case verdict::error: ++error_count; break;
+            }
+
+            log(verdict_to_string(vr._verdict), [&](std::ostream& os) {
+                os << p.filename().string();
+
+                if(vr._verdict != verdict::error)
+                {
+                    os << std::setprecision(17) << " (expected "
+                       << mrf.get_replay_file()._played_score << ", got "
+                       << vr._simulated_score << ", " << vr._simulated_ticks
+                       << " ticks)";
+                }
+
+                if(vr._verdict == verdict::desync)
+                {
+                    os << " - state diverged at tick " << vr._simulated_ticks;
+                }
+
+                os << '\n';
+            });
+        }
+    };
+
+    const auto start_tp = std::chrono::steady_clock::now();
+
+    {
+        std::vector<std::thread> workers;
+        workers.reserve(worker_count);
+
+        for(std::size_t i = 0; i < worker_count; ++i)
+        {
+            workers.emplace_back(worker);
+        }
+
+        for(std::thread& t : workers)
+        {
+            t.join();
+        }
+    }
+
+    const double elapsed_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      start_tp)
+            .count();
+
+    // ------------------------------------------------------------------------
+    // Print summary and throughput
+    const double safe_elapsed = std::max(elapsed_seconds, 1e-9);
+
+    log("Main", [&](std::ostream& os) {
+        os << std::fixed << std::setprecision(2) << ok_count << " ok, "
+           << mismatch_count << " mismatch(es), " << desync_count
+           << " desync(s), " << error_count
+           << " error(s) in " << elapsed_seconds << "s ("
+           << replay_files.size() / safe_elapsed << " replays/s, "
+           << total_ticks / safe_elapsed << " ticks/s)\n";
+    });
+
+    const bool all_ok =
+        mismatch_count == 0 && desync_count == 0 && error_count == 0;
+
+    return all_ok ? 0 : 1;
+}
@@ -3,6 +3,7 @@
 // AFL License page: https://opensource.org/licenses/AFL-3.0
 
 #include "SSVOpenHexagon/Core/HexagonGame.hpp"
+#include "SSVOpenHexagon/Core/HexagonSimulation.hpp"
 #include "SSVOpenHexagon/Components/CCustomWall.hpp"
 #include "SSVOpenHexagon/Utils/Utils.hpp"
 
@@ -30,9 +31,9 @@ void CCustomWall::draw(HexagonGame& mHexagonGame)
         vertexPositions[3], vertexColors[3]);
 }
 
-void CCustomWall::update(HexagonGame& mHexagonGame, ssvu::FT mFT)
+void CCustomWall::update(HexagonSimulation& mSimulation, ssvu::FT mFT)
 {
-    (void)mHexagonGame;
+    (void)mSimulation;
     (void)mFT;
 }
 
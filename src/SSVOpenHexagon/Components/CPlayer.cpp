@@ -3,10 +3,12 @@
 // AFL License page: https://opensource.org/licenses/AFL-3.0
 
 #include "SSVOpenHexagon/Core/HexagonGame.hpp"
-#include "SSVOpenHexagon/Components/CWall.hpp"
+#include "SSVOpenHexagon/Core/HexagonSimulation.hpp"
 #include "SSVOpenHexagon/Components/CCustomWall.hpp"
 #include "SSVOpenHexagon/Utils/Color.hpp"
+#include "SSVOpenHexagon/Utils/PointInPolygon.hpp"
 #include "SSVOpenHexagon/Utils/Ticker.hpp"
+#include "SSVOpenHexagon/Utils/Utils.hpp"
 
 #include "SSVOpenHexagon/Global/Config.hpp"
 
@@ -25,7 +27,8 @@ namespace hg
 inline constexpr float baseThickness{5.f};
 
 CPlayer::CPlayer(const sf::Vector2f& mPos, const float swapCooldown) noexcept
-    : startPos{mPos}, pos{mPos}, lastPos{mPos}, hue{0}, angle{0}, lastAngle{0},
+    : startPos{mPos}, pos{mPos}, lastPos{mPos}, prevTickPos{mPos},
+      prevTickAngle{0}, hue{0}, angle{0}, lastAngle{0},
       size{Config::getPlayerSize()}, speed{Config::getPlayerSpeed()},
       focusSpeed{Config::getPlayerFocusSpeed()}, dead{false},
       justSwapped{false}, swapTimer{swapCooldown},
@@ -43,6 +46,12 @@ void CPlayer::setPlayerAngle(const float newAng) noexcept
     angle = newAng;
 }
 
+void CPlayer::savePreviousState() noexcept
+{
+    prevTickPos = pos;
+    prevTickAngle = angle;
+}
+
 void CPlayer::draw(HexagonGame& mHexagonGame, const sf::Color& mCapColor)
 {
     drawPivot(mHexagonGame, mCapColor);
@@ -57,11 +66,21 @@ void CPlayer::draw(HexagonGame& mHexagonGame, const sf::Color& mCapColor)
 
     const float triangleWidth = mHexagonGame.getInputFocused() ? -1.5f : 3.f;
 
+    // Interpolate between ticks, except for swaps which are instantaneous
+    const float alpha = mHexagonGame.getInterpolationAlpha();
+    const float angleDiff = Utils::getAngleDiffRad(prevTickAngle, angle);
+    const bool interpolate = std::abs(angleDiff) < ssvu::pi / 2.f;
+
+    const float drawAngle =
+        interpolate ? prevTickAngle + angleDiff * alpha : angle;
+    const sf::Vector2f drawPos =
+        interpolate ? Utils::getLerped(prevTickPos, pos, alpha) : pos;
+
     const sf::Vector2f pLeft = ssvs::getOrbitRad(
-        pos, angle - ssvu::toRad(100.f), size + triangleWidth);
+        drawPos, drawAngle - ssvu::toRad(100.f), size + triangleWidth);
 
     const sf::Vector2f pRight = ssvs::getOrbitRad(
-        pos, angle + ssvu::toRad(100.f), size + triangleWidth);
+        drawPos, drawAngle + ssvu::toRad(100.f), size + triangleWidth);
 
     if(!swapTimer.isRunning())
     {
@@ -71,7 +90,7 @@ void CPlayer::draw(HexagonGame& mHexagonGame, const sf::Color& mCapColor)
 
     mHexagonGame.playerTris.reserve_more(3);
     mHexagonGame.playerTris.batch_unsafe_emplace_back(
-        colorMain, ssvs::getOrbitRad(pos, angle, size), pLeft, pRight);
+        colorMain, ssvs::getOrbitRad(drawPos, drawAngle, size), pLeft, pRight);
 }
 
 void CPlayer::drawPivot(HexagonGame& mHexagonGame, const sf::Color& mCapColor)
@@ -142,19 +161,19 @@ void CPlayer::drawDeathEffect(HexagonGame& mHexagonGame)
     }
 }
 
-void CPlayer::playerSwap(HexagonGame& mHexagonGame, bool mPlaySound)
+void CPlayer::playerSwap(HexagonSimulation& mSimulation, bool mPlaySound)
 {
     angle += ssvu::pi;
-    mHexagonGame.runLuaFunctionIfExists<void>("onCursorSwap");
+    mSimulation.runLuaCallbackIfExists<void>(
+        mSimulation.getLuaCallbacks().onCursorSwap);
 
     if(mPlaySound)
     {
-        mHexagonGame.getAssets().playSound(
-            mHexagonGame.getLevelStatus().swapSound);
+        mSimulation.playSound(mSimulation.getLevelStatus().swapSound);
     }
 }
 
-void CPlayer::kill(HexagonGame& mHexagonGame)
+void CPlayer::kill(HexagonSimulation& mSimulation)
 {
     deadEffectTimer.restart();
 
@@ -163,7 +182,7 @@ void CPlayer::kill(HexagonGame& mHexagonGame)
         dead = true;
     }
 
-    mHexagonGame.death();
+    mSimulation.death();
 
     if(!getJustSwapped())
     {
@@ -171,8 +190,9 @@ void CPlayer::kill(HexagonGame& mHexagonGame)
     }
 }
 
-[[nodiscard]] bool CPlayer::push(
-    HexagonGame& mHexagonGame, const CWall& wall, ssvu::FT mFT)
+[[nodiscard]] bool CPlayer::push(HexagonSimulation& mSimulation,
+    const std::array<sf::Vector2f, 4>& mWallVertices, const float mCurveSpeed,
+    ssvu::FT mFT)
 {
     (void)mFT;
 
@@ -181,13 +201,12 @@ void CPlayer::kill(HexagonGame& mHexagonGame)
         return false;
     }
 
-    const auto& curveData = wall.getCurve();
-    const int curveDir = ssvu::getSign(curveData.speed);
-    const int movement{mHexagonGame.getInputMovement()};
+    const int curveDir = ssvu::getSign(mCurveSpeed);
+    const int movement{mSimulation.getInputMovement()};
 
     const unsigned int maxAttempts =
         5 + ((curveDir != 0)
-                    ? std::abs(curveData.speed + speed * (movement * curveDir))
+                    ? std::abs(mCurveSpeed + speed * (movement * curveDir))
                     : speed);
 
     const float pushDir = //
@@ -197,9 +216,9 @@ void CPlayer::kill(HexagonGame& mHexagonGame)
     const float pushAngle = ssvu::toRad(1.f) * pushDir;
 
     unsigned int attempt = 0;
-    const float radius{mHexagonGame.getRadius()};
+    const float radius{mSimulation.getRadius()};
 
-    while(wall.isOverlapping(pos))
+    while(Utils::pointInPolygon(mWallVertices, pos.x, pos.y))
     {
         angle += pushAngle;
         pos = ssvs::getOrbitRad(startPos, angle, radius);
@@ -221,7 +240,7 @@ void CPlayer::kill(HexagonGame& mHexagonGame)
 }
 
 [[nodiscard]] bool CPlayer::push(
-    HexagonGame& mHexagonGame, const CCustomWall& wall, ssvu::FT mFT)
+    HexagonSimulation& mSimulation, const CCustomWall& wall, ssvu::FT mFT)
 {
     (void)mFT; // Currently unused.
 
@@ -230,14 +249,14 @@ void CPlayer::kill(HexagonGame& mHexagonGame)
         return false;
     }
 
-    const int movement{mHexagonGame.getInputMovement()};
+    const int movement{mSimulation.getInputMovement()};
     const unsigned int maxAttempts = 5 + speed;
     const float pushDir = -movement;
 
     const float pushAngle = ssvu::toRad(1.f) * pushDir;
 
     unsigned int attempt = 0;
-    const float radius{mHexagonGame.getRadius()};
+    const float radius{mSimulation.getRadius()};
 
     while(wall.isOverlapping(pos))
     {
@@ -256,17 +275,17 @@ void CPlayer::kill(HexagonGame& mHexagonGame)
     return false;
 }
 
-void CPlayer::update(HexagonGame& mHexagonGame, ssvu::FT mFT)
+void CPlayer::update(HexagonSimulation& mSimulation, ssvu::FT mFT)
 {
     swapBlinkTimer.update(mFT);
 
     if(deadEffectTimer.update(mFT) &&
-        mHexagonGame.getLevelStatus().tutorialMode)
+        mSimulation.getLevelStatus().tutorialMode)
     {
         deadEffectTimer.stop();
     }
 
-    if(mHexagonGame.getLevelStatus().swapEnabled)
+    if(mSimulation.getLevelStatus().swapEnabled)
     {
         if(swapTimer.update(mFT))
         {
@@ -278,22 +297,22 @@ void CPlayer::update(HexagonGame& mHexagonGame, ssvu::FT mFT)
     lastAngle = angle;
 }
 
-void CPlayer::updateInput(HexagonGame& mHexagonGame, ssvu::FT mFT)
+void CPlayer::updateInput(HexagonSimulation& mSimulation, ssvu::FT mFT)
 {
-    const int movement{mHexagonGame.getInputMovement()};
+    const int movement{mSimulation.getInputMovement()};
 
     const float currentSpeed =
-        mHexagonGame.getPlayerSpeedMult() *
-        (mHexagonGame.getInputFocused() ? focusSpeed : speed);
+        mSimulation.getPlayerSpeedMult() *
+        (mSimulation.getInputFocused() ? focusSpeed : speed);
 
     angle += ssvu::toRad(currentSpeed * movement * mFT);
 
-    if(mHexagonGame.getLevelStatus().swapEnabled &&
-        mHexagonGame.getInputSwap() && !swapTimer.isRunning())
+    if(mSimulation.getLevelStatus().swapEnabled &&
+        mSimulation.getInputSwap() && !swapTimer.isRunning())
     {
-        playerSwap(mHexagonGame, true /* mPlaySound */);
-        swapTimer.restart(mHexagonGame.getSwapCooldown());
-        swapBlinkTimer.restart(mHexagonGame.getSwapCooldown() / 6.f);
+        playerSwap(mSimulation, true /* mPlaySound */);
+        swapTimer.restart(mSimulation.getSwapCooldown());
+        swapBlinkTimer.restart(mSimulation.getSwapCooldown() / 6.f);
         justSwapped = true;
     }
     else
@@ -302,11 +321,11 @@ void CPlayer::updateInput(HexagonGame& mHexagonGame, ssvu::FT mFT)
     }
 }
 
-void CPlayer::updatePosition(HexagonGame& mHexagonGame, ssvu::FT mFT)
+void CPlayer::updatePosition(HexagonSimulation& mSimulation, ssvu::FT mFT)
 {
     (void)mFT; // Currently unused.
 
-    pos = ssvs::getOrbitRad(startPos, angle, mHexagonGame.getRadius());
+    pos = ssvs::getOrbitRad(startPos, angle, mSimulation.getRadius());
 }
 
 [[nodiscard]] bool CPlayer::getJustSwapped() const noexcept
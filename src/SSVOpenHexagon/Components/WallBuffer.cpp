@@ -0,0 +1,496 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Components/WallBuffer.hpp"
+
+#include <SSVStart/Utils/Vector2.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Only instructions with exactly rounded results are used (no reciprocal
+// approximations), and FMA contraction must stay disabled, as for the rest
+// of the simulation. The build passes `-ffp-contract=off` (`/fp:precise` on
+// MSVC) for this file; the pragmas below also cover other build setups.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define HG_WALL_BUFFER_AVX
+#define HG_WALL_BUFFER_SSE
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HG_WALL_BUFFER_SSE
+#endif
+
+namespace hg
+{
+
+namespace
+{
+
+#ifdef HG_WALL_BUFFER_SSE
+
+[[nodiscard, gnu::always_inline]] inline __m128 select(
+    const __m128 mMask, const __m128 mIfTrue, const __m128 mIfFalse) noexcept
+{
+    return _mm_or_ps(
+        _mm_and_ps(mMask, mIfTrue), _mm_andnot_ps(mMask, mIfFalse));
+}
+
+// Moves the four vertices of wall `mIdx`, returns `true` if they are all
+// within the radius. Same operations as `ssvs::moveTowards`.
+[[gnu::always_inline]] inline bool moveWallSse(const float* mXs,
+    const float* mYs, float* mOutXs, float* mOutYs, const std::size_t mIdx,
+    const float mStep, const __m128 mCX, const __m128 mCY,
+    const __m128 mRadius) noexcept
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    const __m128 x = _mm_loadu_ps(mXs + mIdx * 4);
+    const __m128 y = _mm_loadu_ps(mYs + mIdx * 4);
+
+    const __m128 onCenter = _mm_and_ps(
+        _mm_cmplt_ps(_mm_and_ps(_mm_sub_ps(x, mCX), absMask), mRadius),
+        _mm_cmplt_ps(_mm_and_ps(_mm_sub_ps(y, mCY), absMask), mRadius));
+
+    __m128 dx = _mm_sub_ps(mCX, x);
+    __m128 dy = _mm_sub_ps(mCY, y);
+
+    const __m128 mag =
+        _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+    const __m128 nonZero = _mm_cmpneq_ps(mag, _mm_setzero_ps());
+
+    dx = select(nonZero, _mm_div_ps(dx, mag), dx);
+    dy = select(nonZero, _mm_div_ps(dy, mag), dy);
+
+    const __m128 step = _mm_set1_ps(mStep);
+
+    _mm_storeu_ps(mOutXs + mIdx * 4,
+        select(onCenter, x, _mm_add_ps(x, _mm_mul_ps(dx, step))));
+    _mm_storeu_ps(mOutYs + mIdx * 4,
+        select(onCenter, y, _mm_add_ps(y, _mm_mul_ps(dy, step))));
+
+    return _mm_movemask_ps(onCenter) == 0xF;
+}
+
+// Same operations as `ssvs::rotateRadAround`.
+[[gnu::always_inline]] inline void rotateWallSse(const float* mXs,
+    const float* mYs, float* mOutXs, float* mOutYs, const std::size_t mIdx,
+    const float mAngle, const __m128 mCX, const __m128 mCY) noexcept
+{
+    const __m128 s = _mm_set1_ps(std::sin(mAngle));
+    const __m128 c = _mm_set1_ps(std::cos(mAngle));
+
+    const __m128 x = _mm_sub_ps(_mm_loadu_ps(mXs + mIdx * 4), mCX);
+    const __m128 y = _mm_sub_ps(_mm_loadu_ps(mYs + mIdx * 4), mCY);
+
+    _mm_storeu_ps(mOutXs + mIdx * 4,
+        _mm_add_ps(_mm_sub_ps(_mm_mul_ps(x, c), _mm_mul_ps(y, s)), mCX));
+    _mm_storeu_ps(mOutYs + mIdx * 4,
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, s), _mm_mul_ps(y, c)), mCY));
+}
+
+#endif
+
+#ifdef HG_WALL_BUFFER_AVX
+
+[[nodiscard, gnu::always_inline]] inline __m256 select(
+    const __m256 mMask, const __m256 mIfTrue, const __m256 mIfFalse) noexcept
+{
+    // Not `_mm256_blendv_ps`: GCC turns it into a generic select, which it
+    // then lowers lane by lane without AVX2
+    return _mm256_or_ps(
+        _mm256_and_ps(mMask, mIfTrue), _mm256_andnot_ps(mMask, mIfFalse));
+}
+
+// Two walls per iteration, see `moveWallSse`. Returns the mask of the
+// vertices within the radius.
+[[nodiscard, gnu::always_inline]] inline int moveWallPairAvx(
+    const float* mXs, const float* mYs, float* mOutXs, float* mOutYs,
+    const std::size_t mIdx, const float mStep0, const float mStep1,
+    const __m256 mCX, const __m256 mCY, const __m256 mRadius) noexcept
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+    const __m256 x = _mm256_loadu_ps(mXs + mIdx * 4);
+    const __m256 y = _mm256_loadu_ps(mYs + mIdx * 4);
+
+    const __m256 onCenter = _mm256_and_ps(
+        _mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(x, mCX), absMask), mRadius,
+            _CMP_LT_OQ),
+        _mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(y, mCY), absMask), mRadius,
+            _CMP_LT_OQ));
+
+    __m256 dx = _mm256_sub_ps(mCX, x);
+    __m256 dy = _mm256_sub_ps(mCY, y);
+
+    const __m256 mag = _mm256_sqrt_ps(
+        _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+    const __m256 nonZero =
+        _mm256_cmp_ps(mag, _mm256_setzero_ps(), _CMP_NEQ_UQ);
+
+    dx = select(nonZero, _mm256_div_ps(dx, mag), dx);
+    dy = select(nonZero, _mm256_div_ps(dy, mag), dy);
+
+    const __m256 step = _mm256_setr_ps(
+        mStep0, mStep0, mStep0, mStep0, mStep1, mStep1, mStep1, mStep1);
+
+    _mm256_storeu_ps(mOutXs + mIdx * 4,
+        select(onCenter, x, _mm256_add_ps(x, _mm256_mul_ps(dx, step))));
+    _mm256_storeu_ps(mOutYs + mIdx * 4,
+        select(onCenter, y, _mm256_add_ps(y, _mm256_mul_ps(dy, step))));
+
+    return _mm256_movemask_ps(onCenter);
+}
+
+// Two walls per iteration, see `rotateWallSse`.
+[[gnu::always_inline]] inline void rotateWallPairAvx(const float* mXs,
+    const float* mYs, float* mOutXs, float* mOutYs, const std::size_t mIdx,
+    const float mAngle0, const float mAngle1, const __m256 mCX,
+    const __m256 mCY) noexcept
+{
+    const float s0 = std::sin(mAngle0);
+    const float s1 = std::sin(mAngle1);
+    const float c0 = std::cos(mAngle0);
+    const float c1 = std::cos(mAngle1);
+
+    const __m256 s = _mm256_setr_ps(s0, s0, s0, s0, s1, s1, s1, s1);
+    const __m256 c = _mm256_setr_ps(c0, c0, c0, c0, c1, c1, c1, c1);
+
+    const __m256 x = _mm256_sub_ps(_mm256_loadu_ps(mXs + mIdx * 4), mCX);
+    const __m256 y = _mm256_sub_ps(_mm256_loadu_ps(mYs + mIdx * 4), mCY);
+
+    _mm256_storeu_ps(mOutXs + mIdx * 4,
+        _mm256_add_ps(
+            _mm256_sub_ps(_mm256_mul_ps(x, c), _mm256_mul_ps(y, s)), mCX));
+    _mm256_storeu_ps(mOutYs + mIdx * 4,
+        _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(x, s), _mm256_mul_ps(y, c)), mCY));
+}
+
+#endif
+
+// Removes the elements of the killed walls, `mStride` per wall.
+template <typename T>
+void eraseKilledElements(std::vector<T>& mValues,
+    const std::vector<unsigned char>& mKilled,
+    const std::size_t mStride) noexcept
+{
+    std::size_t to{0};
+
+    for(std::size_t i = 0; i < mKilled.size(); ++i)
+    {
+        if(mKilled[i] != 0)
+        {
+            continue;
+        }
+
+        if(to != i)
+        {
+            std::copy_n(mValues.begin() + i * mStride, mStride,
+                mValues.begin() + to * mStride);
+        }
+
+        ++to;
+    }
+
+    mValues.resize(to * mStride);
+}
+
+} // namespace
+
+void WallBuffer::SpeedArrays::clear() noexcept
+{
+    speeds.clear();
+    accels.clear();
+    mins.clear();
+    maxs.clear();
+    pingPongs.clear();
+}
+
+void WallBuffer::SpeedArrays::add(const SpeedData& mSpeedData)
+{
+    speeds.emplace_back(mSpeedData.speed);
+    accels.emplace_back(mSpeedData.accel);
+    mins.emplace_back(mSpeedData.min);
+    maxs.emplace_back(mSpeedData.max);
+    pingPongs.emplace_back(mSpeedData.pingPong);
+}
+
+void WallBuffer::SpeedArrays::eraseKilled(
+    const std::vector<unsigned char>& mKilled) noexcept
+{
+    eraseKilledElements(speeds, mKilled, 1);
+    eraseKilledElements(accels, mKilled, 1);
+    eraseKilledElements(mins, mKilled, 1);
+    eraseKilledElements(maxs, mKilled, 1);
+    eraseKilledElements(pingPongs, mKilled, 1);
+}
+
+void WallBuffer::SpeedArrays::update(const ssvu::FT mFT) noexcept
+{
+    for(std::size_t i = 0; i < speeds.size(); ++i)
+    {
+        if(accels[i] == 0)
+        {
+            continue;
+        }
+
+        speeds[i] += accels[i] * mFT;
+
+        if(speeds[i] > maxs[i])
+        {
+            speeds[i] = maxs[i];
+            if(pingPongs[i] != 0)
+            {
+                accels[i] *= -1;
+            }
+        }
+        else if(speeds[i] < mins[i])
+        {
+            speeds[i] = mins[i];
+            if(pingPongs[i] != 0)
+            {
+                accels[i] *= -1;
+            }
+        }
+    }
+}
+
+void WallBuffer::clear() noexcept
+{
+    xs.clear();
+    ys.clear();
+    prevXs.clear();
+    prevYs.clear();
+    speeds.clear();
+    curves.clear();
+    hueMods.clear();
+    killed.clear();
+
+    steps.clear();
+    angles.clear();
+    movedXs.clear();
+    movedYs.clear();
+    curvedXs.clear();
+    curvedYs.clear();
+}
+
+void WallBuffer::add(const Vertices& mVertexPositions,
+    const SpeedData& mSpeed, const SpeedData& mCurve, const float mHueMod)
+{
+    for(const sf::Vector2f& vp : mVertexPositions)
+    {
+        xs.emplace_back(vp.x);
+        ys.emplace_back(vp.y);
+        prevXs.emplace_back(vp.x);
+        prevYs.emplace_back(vp.y);
+    }
+
+    speeds.add(mSpeed);
+    curves.add(mCurve);
+    hueMods.emplace_back(mHueMod);
+    killed.emplace_back(0);
+}
+
+void WallBuffer::eraseKilled() noexcept
+{
+    if(std::find(killed.begin(), killed.end(), 1) == killed.end())
+    {
+        return;
+    }
+
+    eraseKilledElements(xs, killed, 4);
+    eraseKilledElements(ys, killed, 4);
+    eraseKilledElements(prevXs, killed, 4);
+    eraseKilledElements(prevYs, killed, 4);
+    speeds.eraseKilled(killed);
+    curves.eraseKilled(killed);
+    eraseKilledElements(hueMods, killed, 1);
+    eraseKilledElements(killed, killed, 1);
+}
+
+void WallBuffer::savePreviousState()
+{
+    prevXs = xs;
+    prevYs = ys;
+}
+
+void WallBuffer::updateSpeeds(const ssvu::FT mFT)
+{
+    speeds.update(mFT);
+    curves.update(mFT);
+
+    steps.resize(size());
+    angles.resize(size());
+
+    for(std::size_t i = 0; i < size(); ++i)
+    {
+        steps[i] = speeds.speeds[i] * 5.f * mFT;
+        angles[i] = curves.speeds[i] / 60.f * mFT;
+    }
+}
+
+void WallBuffer::moveTowardsCenter(
+    const sf::Vector2f& mCenterPos, const float mRadius)
+{
+    movedXs.resize(getMovedCount() * 4);
+    movedYs.resize(getMovedCount() * 4);
+
+    std::size_t i{0};
+
+#ifdef HG_WALL_BUFFER_AVX
+    {
+        const __m256 cx = _mm256_set1_ps(mCenterPos.x);
+        const __m256 cy = _mm256_set1_ps(mCenterPos.y);
+        const __m256 radius = _mm256_set1_ps(mRadius);
+
+        for(; i + 2 <= getMovedCount(); i += 2)
+        {
+            const int onCenter = moveWallPairAvx(xs.data(), ys.data(),
+                movedXs.data(), movedYs.data(), i, steps[i], steps[i + 1],
+                cx, cy, radius);
+
+            killed[i] = (onCenter & 0xF) == 0xF;
+            killed[i + 1] = (onCenter >> 4) == 0xF;
+        }
+    }
+#endif
+
+#ifdef HG_WALL_BUFFER_SSE
+    {
+        const __m128 cx = _mm_set1_ps(mCenterPos.x);
+        const __m128 cy = _mm_set1_ps(mCenterPos.y);
+        const __m128 radius = _mm_set1_ps(mRadius);
+
+        for(; i < getMovedCount(); ++i)
+        {
+            killed[i] = moveWallSse(xs.data(), ys.data(), movedXs.data(),
+                movedYs.data(), i, steps[i], cx, cy, radius);
+        }
+    }
+#else
+    (void)i;
+    moveTowardsCenterScalar(mCenterPos, mRadius);
+#endif
+}
+
+void WallBuffer::moveTowardsCenterScalar(
+    const sf::Vector2f& mCenterPos, const float mRadius)
+{
+    movedXs.resize(getMovedCount() * 4);
+    movedYs.resize(getMovedCount() * 4);
+
+    for(std::size_t i = 0; i < getMovedCount(); ++i)
+    {
+        int pointsOnCenter{0};
+
+        for(std::size_t k = i * 4; k < i * 4 + 4; ++k)
+        {
+            sf::Vector2f vp{xs[k], ys[k]};
+
+            if(std::abs(vp.x - mCenterPos.x) < mRadius &&
+                std::abs(vp.y - mCenterPos.y) < mRadius)
+            {
+                ++pointsOnCenter;
+            }
+            else
+            {
+                ssvs::moveTowards(vp, mCenterPos, steps[i]);
+            }
+
+            movedXs[k] = vp.x;
+            movedYs[k] = vp.y;
+        }
+
+        killed[i] = pointsOnCenter > 3;
+    }
+}
+
+void WallBuffer::rotateAroundCenter(const sf::Vector2f& mCenterPos)
+{
+    curvedXs.resize(movedXs.size());
+    curvedYs.resize(movedYs.size());
+
+    std::size_t i{0};
+
+#ifdef HG_WALL_BUFFER_AVX
+    {
+        const __m256 cx = _mm256_set1_ps(mCenterPos.x);
+        const __m256 cy = _mm256_set1_ps(mCenterPos.y);
+
+        for(; i + 2 <= getMovedCount(); i += 2)
+        {
+            rotateWallPairAvx(movedXs.data(), movedYs.data(), curvedXs.data(),
+                curvedYs.data(), i, angles[i], angles[i + 1], cx, cy);
+        }
+    }
+#endif
+
+#ifdef HG_WALL_BUFFER_SSE
+    {
+        const __m128 cx = _mm_set1_ps(mCenterPos.x);
+        const __m128 cy = _mm_set1_ps(mCenterPos.y);
+
+        for(; i < getMovedCount(); ++i)
+        {
+            rotateWallSse(movedXs.data(), movedYs.data(), curvedXs.data(),
+                curvedYs.data(), i, angles[i], cx, cy);
+        }
+    }
+#else
+    (void)i;
+    rotateAroundCenterScalar(mCenterPos);
+#endif
+}
+
+void WallBuffer::rotateAroundCenterScalar(const sf::Vector2f& mCenterPos)
+{
+    curvedXs.resize(movedXs.size());
+    curvedYs.resize(movedYs.size());
+
+    for(std::size_t i = 0; i < getMovedCount(); ++i)
+    {
+        for(std::size_t k = i * 4; k < i * 4 + 4; ++k)
+        {
+            sf::Vector2f vp{movedXs[k], movedYs[k]};
+            ssvs::rotateRadAround(vp, mCenterPos, angles[i]);
+
+            curvedXs[k] = vp.x;
+            curvedYs[k] = vp.y;
+        }
+    }
+}
+
+void WallBuffer::applyMovement() noexcept
+{
+    std::copy(curvedXs.begin(), curvedXs.end(), xs.begin());
+    std::copy(curvedYs.begin(), curvedYs.end(), ys.begin());
+
+    steps.clear();
+    angles.clear();
+    movedXs.clear();
+    movedYs.clear();
+    curvedXs.clear();
+    curvedYs.clear();
+}
+
+[[nodiscard]] const char* WallBuffer::getKernelName() noexcept
+{
+#if defined(HG_WALL_BUFFER_AVX)
+    return "AVX";
+#elif defined(HG_WALL_BUFFER_SSE)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace hg
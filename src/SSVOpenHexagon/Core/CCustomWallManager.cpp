@@ -7,6 +7,8 @@
 #include <SSVUtils/Core/Log/Log.hpp>
 #include <SSVUtils/Core/Utils/Containers.hpp>
 
+#include <algorithm>
+
 namespace hg
 {
 
@@ -18,24 +20,48 @@ namespace hg
            h < (int)_handleAvailable.size();
 }
 
-[[nodiscard]] CCustomWallHandle CCustomWallManager::create()
+[[nodiscard]] bool CCustomWallManager::checkAliveHandle(
+    const CCustomWallHandle h, const char* action) const
 {
-    if(_freeHandles.empty())
+    if(!isValidHandle(h) || _handleAvailable[h])
     {
-        constexpr std::size_t reserveSize = 255;
-        const std::size_t maxHandleIndex = _nextFreeHandle + reserveSize;
+        ssvu::lo("CustomWallManager")
+            << "Attempted to " << action << " of invalid custom wall " << h
+            << '\n';
 
-        _freeHandles.reserve(maxHandleIndex);
-        _customWalls.resize(maxHandleIndex);
-        _handleAvailable.resize(maxHandleIndex);
+        return false;
+    }
 
-        for(std::size_t i = 0; i < reserveSize; ++i)
-        {
-            _freeHandles.emplace_back(_nextFreeHandle);
-            _handleAvailable[_nextFreeHandle] = true;
-            ++_nextFreeHandle;
-        }
+    return true;
+}
+
+void CCustomWallManager::growFreeHandles(const std::size_t minCount)
+{
+    if(_freeHandles.size() >= minCount)
+    {
+        return;
+    }
+
+    constexpr std::size_t reserveSize = 255;
+    const std::size_t growSize =
+        std::max(reserveSize, minCount - _freeHandles.size());
+    const std::size_t maxHandleIndex = _nextFreeHandle + growSize;
+
+    _freeHandles.reserve(maxHandleIndex);
+    _customWalls.resize(maxHandleIndex);
+    _handleAvailable.resize(maxHandleIndex);
+
+    for(std::size_t i = 0; i < growSize; ++i)
+    {
+        _freeHandles.emplace_back(_nextFreeHandle);
+        _handleAvailable[_nextFreeHandle] = true;
+        ++_nextFreeHandle;
     }
+}
+
+[[nodiscard]] CCustomWallHandle CCustomWallManager::create()
+{
+    growFreeHandles(1);
 
     const auto res = _freeHandles.back();
 
@@ -46,6 +72,25 @@ namespace hg
     return res;
 }
 
+void CCustomWallManager::createMany(
+    const std::size_t count, std::vector<CCustomWallHandle>& out)
+{
+    growFreeHandles(count);
+
+    out.reserve(out.size() + count);
+
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        const auto res = _freeHandles.back();
+
+        _freeHandles.pop_back();
+        _handleAvailable[res] = false;
+        out.emplace_back(res);
+    }
+
+    _count += count;
+}
+
 void CCustomWallManager::destroy(const CCustomWallHandle cwHandle)
 {
     if(_handleAvailable[cwHandle])
@@ -152,6 +197,57 @@ void CCustomWallManager::setVertexColor(const CCustomWallHandle cwHandle,
     _customWalls[cwHandle].setVertexColor(vertexIndex, color);
 }
 
+void CCustomWallManager::setVertexPos4(const CCustomWallHandle cwHandle,
+    const std::array<sf::Vector2f, 4>& positions)
+{
+    if(!checkAliveHandle(cwHandle, "set vertex positions"))
+    {
+        return;
+    }
+
+    CCustomWall& cw = _customWalls[cwHandle];
+
+    for(int i = 0; i < 4; ++i)
+    {
+        cw.setVertexPos(i, positions[i]);
+    }
+}
+
+void CCustomWallManager::setManyVertexPos(
+    const std::vector<CCustomWallHandle>& cwHandles,
+    const std::vector<float>& coords)
+{
+    std::size_t count = cwHandles.size();
+
+    if(coords.size() != count * 8)
+    {
+        ssvu::lo("CustomWallManager")
+            << "Expected " << count * 8 << " coordinates for " << count
+            << " custom walls, got " << coords.size() << '\n';
+
+        count = std::min(count, coords.size() / 8);
+    }
+
+    const float* c = coords.data();
+
+    for(std::size_t i = 0; i < count; ++i, c += 8)
+    {
+        const CCustomWallHandle cwHandle = cwHandles[i];
+
+        if(!checkAliveHandle(cwHandle, "set vertex positions"))
+        {
+            continue;
+        }
+
+        CCustomWall& cw = _customWalls[cwHandle];
+
+        for(int v = 0; v < 4; ++v)
+        {
+            cw.setVertexPos(v, sf::Vector2f{c[v * 2], c[v * 2 + 1]});
+        }
+    }
+}
+
 // TODO:
 [[nodiscard]] bool CCustomWallManager::isOverlappingPlayer(
     const CCustomWallHandle cwHandle)
@@ -25,6 +25,10 @@ namespace hg
 
 void HexagonGame::draw()
 {
+    HexagonGameStatus& status = simulation.getStatus();
+    const LevelStatus& levelStatus = simulation.getLevelStatus();
+    StyleData& styleData = simulation.getStyleData();
+
     styleData.computeColors(levelStatus);
 
     window.clear(Color::Black);
@@ -64,16 +68,12 @@ void HexagonGame::draw()
     playerTris.clear();
     capTris.clear();
 
-    for(CWall& w : walls)
-    {
-        w.draw(*this);
-    }
-
-    cwManager.draw(*this);
+    drawWalls();
+    simulation.getCustomWallManager().draw(*this);
 
     if(status.started)
     {
-        player.draw(*this, styleData.getCapColorResult());
+        simulation.getPlayer().draw(*this, styleData.getCapColorResult());
     }
 
     if(Config::get3D())
@@ -172,6 +172,31 @@ void HexagonGame::draw()
     }
 }
 
+void HexagonGame::drawWalls()
+{
+    const WallBuffer& walls = simulation.getWalls();
+    const sf::Color colorMain(getColorMain());
+
+    wallQuads.reserve_more(walls.size() * 4);
+
+    for(std::size_t i = 0; i < walls.size(); ++i)
+    {
+        const float hueMod = walls.getHueMod(i);
+        const sf::Color color =
+            hueMod != 0 ? Utils::transformHue(colorMain, hueMod) : colorMain;
+
+        const WallBuffer::Vertices prev = walls.getPrevVertexPositions(i);
+        const WallBuffer::Vertices curr = walls.getVertexPositions(i);
+
+        const auto getDrawPos = [&](const std::size_t k) {
+            return Utils::getLerped(prev[k], curr[k], interpolationAlpha);
+        };
+
+        wallQuads.batch_unsafe_emplace_back(color, getDrawPos(0),
+            getDrawPos(1), getDrawPos(2), getDrawPos(3));
+    }
+}
+
 void HexagonGame::initFlashEffect()
 {
     flashPolygon.clear();
@@ -217,6 +242,10 @@ void HexagonGame::drawKeyIcons()
 
 void HexagonGame::updateText()
 {
+    HexagonGameStatus& status = simulation.getStatus();
+    const LevelStatus& levelStatus = simulation.getLevelStatus();
+    Lua::LuaContext& lua = simulation.getLua();
+
     os.str("");
 
     if(levelStatus.tutorialMode)
@@ -231,7 +260,21 @@ void HexagonGame::updateText()
     if(Config::getDebug())
     {
         os << "DEBUG MODE\n";
-        os << "CUSTOM WALLS: " << cwManager.count() << "\n";
+        os << "CUSTOM WALLS: " << simulation.getCustomWallManager().count()
+           << "\n";
+        os << "RESTART TIME: "
+           << simulation.getLastNewGameDuration().count() / 1000.f << "MS"
+           << (simulation.getLastNewGameReusedLevel() ? " (REUSED)" : "")
+           << "\n";
+
+        const HexagonSimulation::LuaMemoryStats& luaMemoryStats =
+            simulation.getLuaMemoryStats();
+
+        os << "LUA HEAP: " << luaMemoryStats.heapBytes / 1024 << "KB\n";
+        os << "LUA ALLOCS/FRAME: " << luaMemoryStats.allocationsPerFrame
+           << "\n";
+        os << "LUA GC TIME: "
+           << luaMemoryStats.gcStepDuration.count() / 1000.f << "MS\n";
     }
 
     if(status.started)
@@ -262,12 +305,14 @@ void HexagonGame::updateText()
             os << status.replayInput;
         }
 
-        if(calledDeprecatedFunctions.size() > 1)
+        const std::size_t numWarnings =
+            simulation.getNumCalledDeprecatedFunctions();
+
+        if(numWarnings > 1)
         {
-            os << calledDeprecatedFunctions.size()
-               << " WARNINGS RAISED (CHECK CONSOLE)\n";
+            os << numWarnings << " WARNINGS RAISED (CHECK CONSOLE)\n";
         }
-        else if(calledDeprecatedFunctions.size() > 0)
+        else if(numWarnings > 0)
         {
             os << "1 WARNING RAISED (CHECK CONSOLE)\n";
         }
@@ -289,6 +334,8 @@ void HexagonGame::updateText()
                 os << name << ": " << var << "\n";
             }
         }
+
+        messageText.setString(simulation.getMessage());
     }
     else
     {
@@ -361,7 +408,26 @@ void HexagonGame::updateText()
         os << " BY " << rf._player_name << '\n'
            << activeReplay->replayPackName << " - "
            << activeReplay->replayLevelName << " (" << rf._difficulty_mult
-           << "x)";
+           << "x)\nSPEED ";
+
+        if(isReplayTurbo())
+        {
+            os << "MAX";
+        }
+        else
+        {
+            os << getReplaySpeed() << "x";
+        }
+
+        os << " (-/+) - SEEK ([/])";
+
+        if(activeReplay->desyncTick.has_value())
+        {
+            os << "\nDESYNC AFTER "
+               << formatTime(*activeReplay->desyncTick *
+                             HexagonSimulation::tickFT / 60.0)
+               << "s";
+        }
 
         os.flush();
 
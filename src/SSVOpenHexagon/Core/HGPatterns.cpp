@@ -0,0 +1,729 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Core/HexagonSimulation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Native versions of the helpers that every official pack ships in
+// `Scripts/common.lua` and `Scripts/commonpatterns.lua`. They must produce
+// exactly the same walls and waits as the Lua originals for the same random
+// number generator state: arithmetic is done in `double` like Lua does, the
+// generator is queried in the same order, and walls are created on the main
+// timeline with the same conversions as `w_wall` and `t_wait`.
+//
+// Within a pattern coroutine, walls are created right away like `w_wall`
+// does. The `p*` patterns wait several times from a single call, which a
+// coroutine cannot suspend in the middle of, so they are not available there.
+
+namespace hg
+{
+
+namespace
+{
+
+// Value of `THICKNESS` in `common.lua`
+constexpr double defaultPatternThickness{40.0};
+
+} // namespace
+
+[[nodiscard]] double HexagonSimulation::getPatternThickness() const
+{
+    // Packs are free to change the `THICKNESS` global, honor it if present
+    if(!lua.doesVariableExist("THICKNESS"))
+    {
+        return defaultPatternThickness;
+    }
+
+    return lua.readVariable<double>("THICKNESS");
+}
+
+[[nodiscard]] int HexagonSimulation::getHalfSides() const noexcept
+{
+    return (static_cast<int>(getSides()) + 1) / 2;
+}
+
+[[nodiscard]] int HexagonSimulation::getRandomSide()
+{
+    // Same draw as `math.random(0, l_getSides() - 1)`
+    return rng.get_int<int>(0, static_cast<int>(getSides()) - 1);
+}
+
+[[nodiscard]] int HexagonSimulation::getRandomDir()
+{
+    // Same draw as `math.random(1, 2) * 2 - 3`
+    return rng.get_int<int>(1, 2) * 2 - 3;
+}
+
+[[nodiscard]] double HexagonSimulation::getPerfectDelay(
+    const double mThickness) const noexcept
+{
+    return mThickness / (5.02 * static_cast<double>(getSpeedMultDM())) *
+           static_cast<double>(getDelayMultDM());
+}
+
+[[nodiscard]] double HexagonSimulation::getPerfectThickness(
+    const double mThickness) const noexcept
+{
+    return mThickness * static_cast<double>(getSpeedMultDM());
+}
+
+[[nodiscard]] int HexagonSimulation::getSideDistance(
+    const int mSide1, const int mSide2) const noexcept
+{
+    const int sides = static_cast<int>(getSides());
+
+    // Lua's `%` rounds towards negative infinity
+    const auto wrap = [sides](const int mSide) {
+        return ((mSide % sides) + sides) % sides;
+    };
+
+    return std::min(std::abs(wrap(mSide2) - wrap(mSide1)), getHalfSides());
+}
+
+[[nodiscard]] bool HexagonSimulation::rejectInPattern(const char* mName)
+{
+    if(!inPatternCoroutine())
+    {
+        return false;
+    }
+
+    ssvu::lo("hg::HexagonSimulation::rejectInPattern")
+        << "Cannot call `" << mName
+        << "` within a pattern, use its Lua version instead, ignoring\n";
+
+    return true;
+}
+
+void HexagonSimulation::cWall(const int mSide, const double mThickness)
+{
+    // Same narrowing as the `w_wall` binding
+    const float thickness = static_cast<float>(mThickness);
+
+    timelineDo([=, this] {
+        createWall(mSide, thickness, {getSpeedMultDM()});
+    });
+}
+
+void HexagonSimulation::oWall(const int mSide, const double mThickness)
+{
+    cWall(mSide + getHalfSides(), mThickness);
+}
+
+void HexagonSimulation::rWall(const int mSide, const double mThickness)
+{
+    cWall(mSide, mThickness);
+    oWall(mSide, mThickness);
+}
+
+void HexagonSimulation::cWallEx(
+    const int mSide, const int mExtra, const double mThickness)
+{
+    // The Lua version creates the wall at `mSide` twice, so do we
+    cWall(mSide, mThickness);
+
+    const int dir = mExtra < 0 ? -1 : 1;
+    for(int i = 0; dir > 0 ? i <= mExtra : i >= mExtra; i += dir)
+    {
+        cWall(mSide + i, mThickness);
+    }
+}
+
+void HexagonSimulation::oWallEx(
+    const int mSide, const int mExtra, const double mThickness)
+{
+    cWallEx(mSide + getHalfSides(), mExtra, mThickness);
+}
+
+void HexagonSimulation::rWallEx(
+    const int mSide, const int mExtra, const double mThickness)
+{
+    cWallEx(mSide, mExtra, mThickness);
+    oWallEx(mSide, mExtra, mThickness);
+}
+
+void HexagonSimulation::cBarrageN(
+    const int mSide, const int mNeighbors, const double mThickness)
+{
+    const int sides = static_cast<int>(getSides());
+    for(int i = mNeighbors; i <= sides - 2 - mNeighbors; ++i)
+    {
+        cWall(mSide + i + 1, mThickness);
+    }
+}
+
+void HexagonSimulation::cBarrage(const int mSide, const double mThickness)
+{
+    cBarrageN(mSide, 0, mThickness);
+}
+
+void HexagonSimulation::cBarrageOnlyN(
+    const int mSide, const int mNeighbors, const double mThickness)
+{
+    cWall(mSide, mThickness);
+    cBarrageN(mSide, mNeighbors, mThickness);
+}
+
+void HexagonSimulation::cAltBarrage(
+    const int mSide, const int mStep, const double mThickness)
+{
+    if(mStep == 0)
+    {
+        // The Lua version never terminates
+        return;
+    }
+
+    // Lua floors a fractional `for` limit
+    const int limit = static_cast<int>(
+        std::floor(static_cast<double>(getSides()) / mStep));
+
+    for(int i = 0; i <= limit; ++i)
+    {
+        cWall(mSide + i * mStep, mThickness);
+    }
+}
+
+void HexagonSimulation::pAltBarrage(const int mTimes, const int mStep)
+{
+    if(rejectInPattern("p_altBarrage"))
+    {
+        return;
+    }
+
+    const double thickness = getPatternThickness();
+    const double delay = getPerfectDelay(thickness) * 5.6;
+
+    for(int i = 0; i <= mTimes; ++i)
+    {
+        cAltBarrage(i, mStep, thickness);
+        timelineWait(delay);
+    }
+
+    timelineWait(delay);
+}
+
+void HexagonSimulation::pSpiral(const int mTimes, const int mExtra)
+{
+    if(rejectInPattern("p_spiral"))
+    {
+        return;
+    }
+
+    const double oldThickness = getPatternThickness();
+    const double thickness = getPerfectThickness(oldThickness);
+    const double delay = getPerfectDelay(thickness);
+    const int startSide = getRandomSide();
+    const int loopDir = getRandomDir();
+    int j = 0;
+
+    for(int i = 0; i <= mTimes; ++i)
+    {
+        cWallEx(startSide + j, mExtra, thickness);
+        j += loopDir;
+        timelineWait(delay);
+    }
+
+    timelineWait(getPerfectDelay(oldThickness) * 6.5);
+}
+
+void HexagonSimulation::pMirrorSpiral(const int mTimes, const int mExtra)
+{
+    if(rejectInPattern("p_mirrorSpiral"))
+    {
+        return;
+    }
+
+    const double oldThickness = getPatternThickness();
+    const double thickness = getPerfectThickness(oldThickness);
+    const double delay = getPerfectDelay(thickness);
+    const int startSide = getRandomSide();
+    const int loopDir = getRandomDir();
+    int j = 0;
+
+    for(int i = 0; i <= mTimes; ++i)
+    {
+        rWallEx(startSide + j, mExtra, thickness);
+        j += loopDir;
+        timelineWait(delay);
+    }
+
+    timelineWait(getPerfectDelay(oldThickness) * 6.5);
+}
+
+void HexagonSimulation::pMirrorSpiralDouble(const int mTimes, const int mExtra)
+{
+    if(rejectInPattern("p_mirrorSpiralDouble"))
+    {
+        return;
+    }
+
+    const double oldThickness = getPatternThickness();
+    const double thickness = getPerfectThickness(oldThickness);
+    const double delay = getPerfectDelay(thickness);
+    const int startSide = getRandomSide();
+    const int loopDir = getRandomDir();
+    int j = 0;
+
+    for(int i = 0; i <= mTimes; ++i)
+    {
+        rWallEx(startSide + j, mExtra, thickness);
+        j += loopDir;
+        timelineWait(delay);
+    }
+
+    rWallEx(startSide + j, mExtra, thickness);
+    timelineWait(delay * 0.9);
+
+    for(int i = 0; i <= mTimes + 1; ++i)
+    {
+        rWallEx(startSide + j, mExtra, thickness);
+        j -= loopDir;
+        timelineWait(delay);
+    }
+
+    timelineWait(getPerfectDelay(oldThickness) * 7.5);
+}
+
+void HexagonSimulation::pBarrageSpiral(
+    const int mTimes, const double mDelayMult, const int mStep)
+{
+    if(rejectInPattern("p_barrageSpiral"))
+    {
+        return;
+    }
+
+    const double thickness = getPatternThickness();
+    const double delay = getPerfectDelay(thickness) * 5.6 * mDelayMult;
+    const int startSide = getRandomSide();
+    const int loopDir = mStep * getRandomDir();
+    int j = 0;
+
+    for(int i = 0; i <= mTimes; ++i)
+    {
+        cBarrage(startSide + j, thickness);
+        j += loopDir;
+        timelineWait(delay);
+
+        if(getSides() < 6)
+        {
+            timelineWait(delay * 0.6);
+        }
+    }
+
+    timelineWait(getPerfectDelay(thickness) * 6.1);
+}
+
+void HexagonSimulation::pDMBarrageSpiral(
+    const int mTimes, const double mDelayMult, const int mStep)
+{
+    if(rejectInPattern("p_dmBarrageSpiral"))
+    {
+        return;
+    }
+
+    const double thickness = getPatternThickness();
+    const double dm = static_cast<double>(difficultyMult);
+
+    const double delay =
+        (getPerfectDelay(thickness) * 5.42) *
+        (mDelayMult / std::pow(dm, 0.4)) *
+        std::pow(static_cast<double>(getSpeedMultDM()), 0.35);
+
+    const int startSide = getRandomSide();
+    const int loopDir = mStep * getRandomDir();
+    int j = 0;
+
+    for(int i = 0; i <= mTimes; ++i)
+    {
+        cBarrage(startSide + j, thickness);
+        j += loopDir;
+        timelineWait(delay);
+
+        if(getSides() < 6)
+        {
+            timelineWait(delay * 0.49);
+        }
+    }
+
+    timelineWait(getPerfectDelay(thickness) * (6.7 * std::pow(dm, 0.7)));
+}
+
+void HexagonSimulation::pWallExVortex(
+    const int mTimes, const int mStep, const int mExtraMult)
+{
+    if(rejectInPattern("p_wallExVortex"))
+    {
+        return;
+    }
+
+    const double thickness = getPatternThickness();
+    const double delay = getPerfectDelay(thickness) * 5.0;
+    const int startSide = getRandomSide();
+    int loopDir = getRandomDir();
+    int currentSide = startSide;
+
+    for(int j = 0; j <= mTimes; ++j)
+    {
+        for(int i = 0; i <= mStep; ++i)
+        {
+            currentSide += loopDir;
+            rWallEx(currentSide, loopDir * mExtraMult, thickness);
+            timelineWait(delay);
+        }
+
+        loopDir *= -1;
+
+        for(int i = 0; i <= mStep + 1; ++i)
+        {
+            currentSide += loopDir;
+            rWallEx(currentSide, loopDir * mExtraMult, thickness);
+            timelineWait(delay);
+        }
+    }
+
+    timelineWait(getPerfectDelay(thickness) * 5.5);
+}
+
+void HexagonSimulation::pInverseBarrage(const int mTimes)
+{
+    if(rejectInPattern("p_inverseBarrage"))
+    {
+        return;
+    }
+
+    const double thickness = getPatternThickness();
+    const double delay = getPerfectDelay(thickness) * 9.9;
+    const int startSide = getRandomSide();
+
+    for(int i = 0; i <= mTimes; ++i)
+    {
+        cBarrage(startSide, thickness);
+        timelineWait(delay);
+
+        if(getSides() < 6)
+        {
+            timelineWait(delay * 0.8);
+        }
+
+        cBarrage(startSide + getHalfSides(), thickness);
+        timelineWait(delay);
+    }
+
+    timelineWait(getPerfectDelay(thickness) * 2.5);
+}
+
+void HexagonSimulation::pRandomBarrage(
+    const int mTimes, const double mDelayMult)
+{
+    if(rejectInPattern("p_randomBarrage"))
+    {
+        return;
+    }
+
+    const double thickness = getPatternThickness();
+    int side = getRandomSide();
+
+    for(int i = 0; i <= mTimes; ++i)
+    {
+        cBarrage(side, thickness);
+        const int oldSide = side;
+        side = getRandomSide();
+
+        const double distance = getSideDistance(side, oldSide);
+        timelineWait(
+            getPerfectDelay(thickness) * (2 + (distance * mDelayMult)));
+    }
+
+    timelineWait(getPerfectDelay(thickness) * 5.6);
+}
+
+void HexagonSimulation::pMirrorWallStrip(const int mTimes, const int mExtra)
+{
+    if(rejectInPattern("p_mirrorWallStrip"))
+    {
+        return;
+    }
+
+    const double thickness = getPatternThickness();
+    const double delay = getPerfectDelay(thickness) * 3.65;
+    const int startSide = getRandomSide();
+
+    for(int i = 0; i <= mTimes; ++i)
+    {
+        rWallEx(startSide, mExtra, thickness);
+        timelineWait(delay);
+    }
+
+    timelineWait(getPerfectDelay(thickness) * 5.0);
+}
+
+void HexagonSimulation::pTunnel(const int mTimes)
+{
+    if(rejectInPattern("p_tunnel"))
+    {
+        return;
+    }
+
+    const double thickness = getPerfectThickness(getPatternThickness());
+    const double delay = getPerfectDelay(thickness) * 5;
+    const int startSide = getRandomSide();
+    int loopDir = getRandomDir();
+
+    for(int i = 0; i <= mTimes; ++i)
+    {
+        if(i < mTimes)
+        {
+            cWall(startSide,
+                thickness +
+                    5 * static_cast<double>(getSpeedMultDM()) * delay);
+        }
+
+        cBarrage(startSide + loopDir, thickness);
+        timelineWait(delay);
+
+        loopDir *= -1;
+    }
+}
+
+void HexagonSimulation::initLua_Patterns()
+{
+    addLuaFn("p_getHalfSides", //
+        [this] { return getHalfSides(); })
+        .doc("Return half the number of sides, rounded up.");
+
+    addLuaFn("p_getRandomSide", //
+        [this] { return getRandomSide(); })
+        .doc(
+            "Return a random side, drawn from the level's random number "
+            "generator exactly like `getRandomSide` in `common.lua`.");
+
+    addLuaFn("p_getRandomDir", //
+        [this] { return getRandomDir(); })
+        .doc("Return either `1` or `-1` at random.");
+
+    addLuaFn("p_getPerfectDelay", //
+        [this](double mThickness) { return getPerfectDelay(mThickness); })
+        .arg("thickness")
+        .doc(
+            "Return the time to wait for two walls of thickness `$0` to be "
+            "next to each other, adjusted for the current difficulty "
+            "multiplier.");
+
+    addLuaFn("p_getPerfectThickness", //
+        [this](double mThickness) { return getPerfectThickness(mThickness); })
+        .arg("thickness")
+        .doc(
+            "Return the thickness `$0` scaled by the current speed "
+            "multiplier, adjusted for the difficulty multiplier.");
+
+    addLuaFn("p_getSideDistance", //
+        [this](int mSide1, int mSide2) {
+            return getSideDistance(mSide1, mSide2);
+        })
+        .arg("side1")
+        .arg("side2")
+        .doc("Return the shortest distance between sides `$0` and `$1`.");
+
+    // ------------------------------------------------------------------------
+    // Walls and barrages, using the `THICKNESS` global (or `40.0`)
+
+    addLuaFn("p_cWall", //
+        [this](int mSide) { cWall(mSide, getPatternThickness()); })
+        .arg("side")
+        .doc(
+            "*Add to the main timeline*: create a wall at side `$0`, with "
+            "thickness `THICKNESS`.");
+
+    addLuaFn("p_oWall", //
+        [this](int mSide) { oWall(mSide, getPatternThickness()); })
+        .arg("side")
+        .doc(
+            "*Add to the main timeline*: create a wall opposite to side "
+            "`$0`.");
+
+    addLuaFn("p_rWall", //
+        [this](int mSide) { rWall(mSide, getPatternThickness()); })
+        .arg("side")
+        .doc(
+            "*Add to the main timeline*: create a wall at side `$0` and one "
+            "opposite to it.");
+
+    addLuaFn("p_cWallEx", //
+        [this](int mSide, int mExtra) {
+            cWallEx(mSide, mExtra, getPatternThickness());
+        })
+        .arg("side")
+        .arg("extra")
+        .doc(
+            "*Add to the main timeline*: create a wall at side `$0` with "
+            "`$1` extra walls attached to it. Negative values of `$1` extend "
+            "it in the other direction.");
+
+    addLuaFn("p_oWallEx", //
+        [this](int mSide, int mExtra) {
+            oWallEx(mSide, mExtra, getPatternThickness());
+        })
+        .arg("side")
+        .arg("extra")
+        .doc(
+            "*Add to the main timeline*: like `p_cWallEx`, opposite to side "
+            "`$0`.");
+
+    addLuaFn("p_rWallEx", //
+        [this](int mSide, int mExtra) {
+            rWallEx(mSide, mExtra, getPatternThickness());
+        })
+        .arg("side")
+        .arg("extra")
+        .doc(
+            "*Add to the main timeline*: union of `p_cWallEx` and "
+            "`p_oWallEx`.");
+
+    addLuaFn("p_cBarrageN", //
+        [this](int mSide, int mNeighbors) {
+            cBarrageN(mSide, mNeighbors, getPatternThickness());
+        })
+        .arg("side")
+        .arg("neighbors")
+        .doc(
+            "*Add to the main timeline*: create a barrage of walls, leaving "
+            "side `$0` and `$1` of its neighbors free.");
+
+    addLuaFn("p_cBarrage", //
+        [this](int mSide) { cBarrage(mSide, getPatternThickness()); })
+        .arg("side")
+        .doc(
+            "*Add to the main timeline*: create a barrage of walls, leaving "
+            "only side `$0` free.");
+
+    addLuaFn("p_cBarrageOnlyN", //
+        [this](int mSide, int mNeighbors) {
+            cBarrageOnlyN(mSide, mNeighbors, getPatternThickness());
+        })
+        .arg("side")
+        .arg("neighbors")
+        .doc(
+            "*Add to the main timeline*: create a barrage of walls, leaving "
+            "only `$1` neighbors of side `$0` free.");
+
+    addLuaFn("p_cAltBarrage", //
+        [this](int mSide, int mStep) {
+            cAltBarrage(mSide, mStep, getPatternThickness());
+        })
+        .arg("side")
+        .arg("step")
+        .doc(
+            "*Add to the main timeline*: create a wall every `$1` sides, "
+            "starting from side `$0`.");
+
+    // ------------------------------------------------------------------------
+    // Whole patterns, identical to the ones in `commonpatterns.lua`
+
+    addLuaFn("p_altBarrage", //
+        [this](int mTimes, int mStep) { pAltBarrage(mTimes, mStep); })
+        .arg("times")
+        .arg("step")
+        .doc(
+            "*Add to the main timeline*: spawn `$0` + 1 alternating "
+            "barrages with step `$1`. Native version of `pAltBarrage`.");
+
+    addLuaFn("p_spiral", //
+        [this](int mTimes, int mExtra) { pSpiral(mTimes, mExtra); })
+        .arg("times")
+        .arg("extra")
+        .doc(
+            "*Add to the main timeline*: spawn a spiral of `$0` + 1 walls "
+            "with `$1` extra walls attached. Native version of `pSpiral`.");
+
+    addLuaFn("p_mirrorSpiral", //
+        [this](int mTimes, int mExtra) { pMirrorSpiral(mTimes, mExtra); })
+        .arg("times")
+        .arg("extra")
+        .doc(
+            "*Add to the main timeline*: spawn a mirrored spiral of `$0` + 1 "
+            "walls with `$1` extra walls attached. Native version of "
+            "`pMirrorSpiral`.");
+
+    addLuaFn("p_mirrorSpiralDouble", //
+        [this](int mTimes, int mExtra) { pMirrorSpiralDouble(mTimes, mExtra); })
+        .arg("times")
+        .arg("extra")
+        .doc(
+            "*Add to the main timeline*: spawn a mirrored spiral that "
+            "changes direction halfway. Native version of "
+            "`pMirrorSpiralDouble`.");
+
+    addLuaFn("p_barrageSpiral", //
+        [this](int mTimes, double mDelayMult, int mStep) {
+            pBarrageSpiral(mTimes, mDelayMult, mStep);
+        })
+        .arg("times")
+        .arg("delayMult")
+        .arg("step")
+        .doc(
+            "*Add to the main timeline*: spawn a spiral of `$0` + 1 "
+            "barrages, `$2` sides apart and with their delay scaled by "
+            "`$1`. Native version of `pBarrageSpiral`.");
+
+    addLuaFn("p_dmBarrageSpiral", //
+        [this](int mTimes, double mDelayMult, int mStep) {
+            pDMBarrageSpiral(mTimes, mDelayMult, mStep);
+        })
+        .arg("times")
+        .arg("delayMult")
+        .arg("step")
+        .doc(
+            "*Add to the main timeline*: like `p_barrageSpiral`, with a "
+            "delay that compensates for the difficulty multiplier. "
+            "Native version of `pDMBarrageSpiral`.");
+
+    addLuaFn("p_wallExVortex", //
+        [this](int mTimes, int mStep, int mExtraMult) {
+            pWallExVortex(mTimes, mStep, mExtraMult);
+        })
+        .arg("times")
+        .arg("step")
+        .arg("extraMult")
+        .doc(
+            "*Add to the main timeline*: spawn left-left right-right "
+            "spirals. Native version of `pWallExVortex`.");
+
+    addLuaFn("p_inverseBarrage", //
+        [this](int mTimes) { pInverseBarrage(mTimes); })
+        .arg("times")
+        .doc(
+            "*Add to the main timeline*: spawn `$0` + 1 pairs of opposite "
+            "barrages. Native version of `pInverseBarrage`.");
+
+    addLuaFn("p_randomBarrage", //
+        [this](int mTimes, double mDelayMult) {
+            pRandomBarrage(mTimes, mDelayMult);
+        })
+        .arg("times")
+        .arg("delayMult")
+        .doc(
+            "*Add to the main timeline*: spawn `$0` + 1 barrages on random "
+            "sides, waiting in proportion to the distance between them "
+            "scaled by `$1`. Native version of `pRandomBarrage`.");
+
+    addLuaFn("p_mirrorWallStrip", //
+        [this](int mTimes, int mExtra) { pMirrorWallStrip(mTimes, mExtra); })
+        .arg("times")
+        .arg("extra")
+        .doc(
+            "*Add to the main timeline*: spawn `$0` + 1 mirrored walls on "
+            "the same side. Native version of `pMirrorWallStrip`.");
+
+    addLuaFn("p_tunnel", //
+        [this](int mTimes) { pTunnel(mTimes); })
+        .arg("times")
+        .doc(
+            "*Add to the main timeline*: spawn a tunnel that forces the "
+            "player to circle around a thick wall `$0` times. Native version "
+            "of `pTunnel`.");
+}
+
+} // namespace hg
@@ -4,8 +4,7 @@
 
 #include "SSVOpenHexagon/Global/Assets.hpp"
 #include "SSVOpenHexagon/Utils/Utils.hpp"
-#include "SSVOpenHexagon/Core/HexagonGame.hpp"
-#include "SSVOpenHexagon/Components/CWall.hpp"
+#include "SSVOpenHexagon/Core/HexagonSimulation.hpp"
 #include "SSVOpenHexagon/Components/CCustomWallHandle.hpp"
 #include "SSVOpenHexagon/Components/CCustomWall.hpp"
 
@@ -18,7 +17,7 @@ using namespace ssvuj;
 
 namespace hg
 {
-void HexagonGame::redefineLuaFunctions()
+void HexagonSimulation::redefineLuaFunctions()
 {
     try
     {
@@ -28,12 +27,12 @@ void HexagonGame::redefineLuaFunctions()
     }
     catch(...)
     {
-        ssvu::lo("HexagonGame::redefineLuaFunctions")
+        ssvu::lo("HexagonSimulation::redefineLuaFunctions")
             << "Failure to redefine Lua's `io.open` function\n";
     }
 }
 
-void HexagonGame::destroyMaliciousFunctions()
+void HexagonSimulation::destroyMaliciousFunctions()
 {
     // This destroys the "os" library completely. This library is capable of
     // file manipulation, running shell commands, and messing up the replay
@@ -67,7 +66,7 @@ void HexagonGame::destroyMaliciousFunctions()
     lua.clearVariable("package.searchpath");
 }
 
-void HexagonGame::initLua_Utils()
+void HexagonSimulation::initLua_Utils()
 {
     addLuaFn("u_setFlashEffect", //
         [this](float mIntensity) { status.flashEffect = mIntensity; })
@@ -87,7 +86,9 @@ void HexagonGame::initLua_Utils()
         .doc("Execute the script located at `<pack>/Scripts/$0`.");
 
     addLuaFn("u_isKeyPressed",
-        [this](int mKey) { return window.getInputState()[KKey(mKey)]; })
+        [this](int mKey) {
+            return hooks.isKeyPressed && hooks.isKeyPressed(mKey);
+        })
         .arg("keyCode")
         .doc(
             "Return `true` if the keyboard key with code `$0` is being "
@@ -126,7 +127,10 @@ void HexagonGame::initLua_Utils()
         .doc("Set the current angle of the player to `$0`, in radians.");
 
     addLuaFn("u_isMouseButtonPressed",
-        [this](int mKey) { return window.getInputState()[MBtn(mKey)]; })
+        [this](int mKey) {
+            return hooks.isMouseButtonPressed &&
+                   hooks.isMouseButtonPressed(mKey);
+        })
         .arg("buttonCode")
         .doc(
             "Return `true` if the mouse button with code `$0` is being "
@@ -146,7 +150,7 @@ void HexagonGame::initLua_Utils()
             "chosen automatic increment parameters.");
 
     addLuaFn("u_kill", //
-        [this] { timeline.append_do([this] { death(true); }); })
+        [this] { timelineDo([this] { death(true); }); })
         .doc("*Add to the main timeline*: kill the player.");
 
     addLuaFn("u_eventKill", //
@@ -193,7 +197,7 @@ void HexagonGame::initLua_Utils()
         .doc("Returns the string representing the current version of the game");
 }
 
-void HexagonGame::initLua_AudioControl()
+void HexagonSimulation::initLua_AudioControl()
 {
     addLuaFn("a_setMusic", //
         [this](const std::string& mId) {
@@ -233,7 +237,7 @@ void HexagonGame::initLua_AudioControl()
             "at time `$1` (in seconds).");
 
     addLuaFn("a_playSound", //
-        [this](const std::string& mId) { assets.playSound(mId); })
+        [this](const std::string& mId) { playSound(mId); })
         .arg("soundId")
         .doc(
             "Play the sound with id `$0`. The id must be registered in "
@@ -241,7 +245,7 @@ void HexagonGame::initLua_AudioControl()
 
     addLuaFn("a_playPackSound", //
         [this](const std::string& fileName) {
-            assets.playPackSound(getPackId(), fileName);
+            playPackSound(getPackId(), fileName);
         })
         .arg("fileName")
         .doc(
@@ -251,14 +255,7 @@ void HexagonGame::initLua_AudioControl()
     addLuaFn("a_syncMusicToDM", //
         [this](bool value) {
             levelStatus.syncMusicToDM = value;
-
-            sf::Music* current(assets.getMusicPlayer().getCurrent());
-            if(current == nullptr)
-            {
-                return;
-            }
-
-            setMusicPitch(*current);
+            refreshMusicPitch();
         })
         .arg("value")
         .doc(
@@ -267,15 +264,7 @@ void HexagonGame::initLua_AudioControl()
             "for levels that rely on the music to time events.");
 
     addLuaFn("a_setMusicPitch", //
-        [this](float mPitch) {
-            levelStatus.musicPitch = mPitch;
-
-            sf::Music* current(assets.getMusicPlayer().getCurrent());
-            if(current == nullptr)
-            {
-                return;
-            }
-        })
+        [this](float mPitch) { levelStatus.musicPitch = mPitch; })
         .arg("pitch")
         .doc(
             "Manually adjusts the pitch of the music by multiplying it by "
@@ -325,11 +314,130 @@ void HexagonGame::initLua_AudioControl()
             "applies to the particular level where this function is called.");
 }
 
-void HexagonGame::initLua_MainTimeline()
+void HexagonSimulation::runEvalChunk(const std::string& mCode)
+{
+    const Utils::LuaProfiler::Scope profilerScope{luaProfiler, "eval"};
+
+    auto it = evalChunkRefs.find(mCode);
+
+    if(it == evalChunkRefs.end())
+    {
+        if(evalChunkRefs.size() >= maxEvalChunks)
+        {
+            for(const auto& [code, ref] : evalChunkRefs)
+            {
+                lua.releaseRef(ref);
+            }
+
+            evalChunkRefs.clear();
+        }
+
+        it = evalChunkRefs.emplace(mCode, lua.compileToRef(mCode)).first;
+    }
+
+    lua.executeRef(it->second);
+}
+
+[[nodiscard]] bool HexagonSimulation::inPatternCoroutine() noexcept
+{
+    // Coroutines created by the pattern itself do not count
+    return runningPattern != nullptr && lua.getState() == runningPattern;
+}
+
+void HexagonSimulation::spawnPattern(const Lua::LuaFunctionRef& mFn)
+{
+    const unsigned int id = nextPatternId++;
+    patternCoroutines.emplace(id, lua.createCoroutine(mFn));
+
+    timeline.append_coroutine([this, id] { return resumePattern(id); });
+}
+
+[[nodiscard]] std::optional<Utils::timeline2::wait_action>
+HexagonSimulation::resumePattern(const unsigned int mId)
+{
+    const auto it = patternCoroutines.find(mId);
+    if(it == patternCoroutines.end())
+    {
+        // Cleared, or the timeline was restored from a snapshot
+        return std::nullopt;
+    }
+
+    const Utils::LuaProfiler::Scope profilerScope{luaProfiler, "pattern"};
+
+    runningPattern = it->second.getThread();
+    patternWait.reset();
+
+    bool suspended{false};
+
+    try
+    {
+        suspended = lua.resumeCoroutine(it->second);
+    }
+    catch(const std::runtime_error& mError)
+    {
+        std::cout << "[resumePattern] Runtime error with level \""
+                  << levelData->name << "\": \n"
+                  << ssvu::toStr(mError.what()) << "\n"
+                  << std::endl;
+
+        raiseLuaError();
+    }
+
+    runningPattern = nullptr;
+
+    if(!suspended)
+    {
+        // The pattern might have spawned others, `it` can be invalidated
+        patternCoroutines.erase(mId);
+        return std::nullopt;
+    }
+
+    if(!patternWait.has_value())
+    {
+        // Plain `coroutine.yield()`, resume on the next tick
+        return Utils::timeline2::action_wait_for{
+            Utils::timeline2::duration{1}};
+    }
+
+    return std::move(patternWait);
+}
+
+[[nodiscard]] bool HexagonSimulation::waitInPattern(
+    Utils::timeline2::wait_action mWait)
+{
+    if(!inPatternCoroutine())
+    {
+        return false;
+    }
+
+    if(!lua.isYieldable())
+    {
+        // E.g. from a `t_eval` chunk, which runs as a C call
+        ssvu::lo("hg::HexagonSimulation::waitInPattern")
+            << "Cannot wait from a C call within a pattern, ignoring\n";
+
+        return true;
+    }
+
+    patternWait = std::move(mWait);
+    lua.yieldAfterCall();
+
+    return true;
+}
+
+void HexagonSimulation::clearPatterns()
+{
+    // A pattern clearing the timeline is still running
+    std::erase_if(patternCoroutines, [this](const auto& mPair) {
+        return mPair.second.getThread() != runningPattern;
+    });
+}
+
+void HexagonSimulation::initLua_MainTimeline()
 {
     addLuaFn("t_eval",
         [this](const std::string& mCode) {
-            timeline.append_do([=, this] { lua.executeCode(mCode); });
+            timelineDo([=, this] { runEvalChunk(mCode); });
         })
         .arg("code")
         .doc(
@@ -338,41 +446,86 @@ void HexagonGame::initLua_MainTimeline()
 
     addLuaFn("t_clear", [this]() {
         timeline.clear();
+        clearPatterns();
     }).doc("Clear the main timeline.");
 
     addLuaFn("t_wait",
-        [this](
-            double mDuration) { timeline.append_wait_for_sixths(mDuration); })
+        [this](double mDuration) {
+            if(waitInPattern(Utils::timeline2::action_wait_for{
+                   status.getWaitFromFrametime(mDuration)}))
+            {
+                return;
+            }
+
+            timelineWait(mDuration);
+        })
         .arg("duration")
         .doc(
             "*Add to the main timeline*: wait for `$0` frames (under the "
             "assumption of a 60 FPS frame rate).");
 
     addLuaFn("t_waitS", //
-        [this](
-            double mDuration) { timeline.append_wait_for_seconds(mDuration); })
+        [this](double mDuration) {
+            if(waitInPattern(Utils::timeline2::action_wait_for{
+                   status.getWaitFromSeconds(mDuration)}))
+            {
+                return;
+            }
+
+            timeline.append_wait_for(status.getWaitFromSeconds(mDuration));
+        })
         .arg("duration")
         .doc("*Add to the main timeline*: wait for `$0` seconds.");
 
     addLuaFn("t_waitUntilS", //
         [this](double mDuration) {
-            timeline.append_wait_until_fn([this, mDuration] {
-                return status.getLevelStartTP() +
-                       std::chrono::milliseconds(
-                           static_cast<int>(mDuration * 1000.0));
-            });
+            // The level start never moves, the runner can schedule the wait
+            const Utils::timeline2::time_point until =
+                status.getLevelStartTP() +
+                status.getWaitFromSeconds(mDuration);
+
+            if(waitInPattern(Utils::timeline2::action_wait_until{until}))
+            {
+                return;
+            }
+
+            timeline.append_wait_until(until);
         })
         .arg("duration")
         .doc(
             "*Add to the main timeline*: wait until the timer reaches `$0` "
             "seconds.");
+
+    addLuaFn("t_spawnPattern", //
+        [this](Lua::LuaFunctionRef mFn) {
+            if(!mFn)
+            {
+                ssvu::lo("hg::HexagonSimulation::t_spawnPattern")
+                    << "Expected a function, got nil\n";
+
+                return;
+            }
+
+            spawnPattern(mFn);
+        })
+        .arg("fn")
+        .doc(
+            "*Add to the main timeline*: run function `$0` as a coroutine. "
+            "Within it, `t_wait`, `t_waitS` and `t_waitUntilS` suspend the "
+            "coroutine until the wait is over, and wall creation and "
+            "`t_eval` take effect immediately, so no actions pile up on the "
+            "timeline however long the pattern is. The timeline proceeds "
+            "once the function returns. Walls created with `p_` functions "
+            "take effect immediately too, but native patterns that wait "
+            "(e.g. `p_spiral`) cannot be called from it: use their Lua "
+            "versions instead.");
 }
 
-void HexagonGame::initLua_EventTimeline()
+void HexagonSimulation::initLua_EventTimeline()
 {
     addLuaFn("e_eval",
         [this](const std::string& mCode) {
-            eventTimeline.append_do([=, this] { lua.executeCode(mCode); });
+            eventTimeline.append_do([=, this] { runEvalChunk(mCode); });
         })
         .arg("code")
         .doc(
@@ -401,7 +554,8 @@ void HexagonGame::initLua_EventTimeline()
 
     addLuaFn("e_eventWait",
         [this](double mDuration) {
-            eventTimeline.append_wait_for_sixths(mDuration);
+            eventTimeline.append_wait_for(
+                status.getWaitFromFrametime(mDuration));
         })
         .arg("duration")
         .doc(
@@ -410,18 +564,16 @@ void HexagonGame::initLua_EventTimeline()
 
     addLuaFn("e_eventWaitS", //
         [this](double mDuration) {
-            eventTimeline.append_wait_for_seconds(mDuration);
+            eventTimeline.append_wait_for(status.getWaitFromSeconds(mDuration));
         })
         .arg("duration")
         .doc("*Add to the event timeline*: wait for `$0` seconds.");
 
     addLuaFn("e_eventWaitUntilS", //
         [this](double mDuration) {
-            eventTimeline.append_wait_until_fn([this, mDuration] {
-                return status.getLevelStartTP() +
-                       std::chrono::milliseconds(
-                           static_cast<int>(mDuration * 1000.0));
-            });
+            eventTimeline.append_wait_until(
+                status.getLevelStartTP() +
+                status.getWaitFromSeconds(mDuration));
         })
         .arg("duration")
         .doc(
@@ -481,7 +633,7 @@ void HexagonGame::initLua_EventTimeline()
         .doc("Remove all previously scheduled messages.");
 }
 
-void HexagonGame::initLua_LevelControl()
+void HexagonSimulation::initLua_LevelControl()
 {
     const auto lsVar = [this](const std::string& name, auto pmd,
                            const std::string& getterDesc,
@@ -875,10 +1027,8 @@ void HexagonGame::initLua_LevelControl()
                     << "with level \"" << levelData->name << "\": \n"
                     << ssvu::toStr(mError.what()) << "\n"
                     << std::endl;
-                if(!Config::getDebug())
-                {
-                    goToMenu(false /* mSendScores */, true /* mError */);
-                }
+
+                raiseLuaError();
             };
         })
         .arg("variable")
@@ -900,12 +1050,12 @@ void HexagonGame::initLua_LevelControl()
             "timer. *NOTE: Your variable must be global for this to work.*");
 
     addLuaFn("l_setRotation", //
-        [this](float mValue) { backgroundCamera.setRotation(mValue); })
+        [this](float mValue) { setRotation(mValue); })
         .arg("angle")
         .doc("Set the background camera rotation to `$0` degrees.");
 
     addLuaFn("l_getRotation", //
-        [this] { return backgroundCamera.getRotation(); })
+        [this] { return getRotation(); })
         .doc("Return the background camera rotation, in degrees.");
 
     addLuaFn("l_getLevelTime", //
@@ -932,7 +1082,7 @@ void HexagonGame::initLua_LevelControl()
 
 
 
-void HexagonGame::initLua_StyleControl()
+void HexagonSimulation::initLua_StyleControl()
 {
     const auto sdVar = [this](const std::string& name, auto pmd,
                            const std::string& getterDesc,
@@ -1167,11 +1317,11 @@ void HexagonGame::initLua_StyleControl()
             "color with index `$0`.");
 }
 
-void HexagonGame::initLua_WallCreation()
+void HexagonSimulation::initLua_WallCreation()
 {
     addLuaFn("w_wall", //
         [this](int mSide, float mThickness) {
-            timeline.append_do([=, this] {
+            timelineDo([=, this] {
                 createWall(mSide, mThickness, {getSpeedMultDM()});
             });
         })
@@ -1184,7 +1334,7 @@ void HexagonGame::initLua_WallCreation()
 
     addLuaFn("w_wallAdj", //
         [this](int mSide, float mThickness, float mSpeedAdj) {
-            timeline.append_do([=, this] {
+            timelineDo([=, this] {
                 createWall(mSide, mThickness, mSpeedAdj * getSpeedMultDM());
             });
         })
@@ -1200,7 +1350,7 @@ void HexagonGame::initLua_WallCreation()
     addLuaFn("w_wallAcc", //
         [this](int mSide, float mThickness, float mSpeedAdj,
             float mAcceleration, float mMinSpeed, float mMaxSpeed) {
-            timeline.append_do([=, this] {
+            timelineDo([=, this] {
                 createWall(mSide, mThickness,
                     {mSpeedAdj * getSpeedMultDM(),
                         mAcceleration / (std::pow(difficultyMult, 0.65f)),
@@ -1225,7 +1375,7 @@ void HexagonGame::initLua_WallCreation()
     addLuaFn("w_wallHModSpeedData", //
         [this](float mHMod, int mSide, float mThickness, float mSAdj,
             float mSAcc, float mSMin, float mSMax, bool mSPingPong) {
-            timeline.append_do([=, this] {
+            timelineDo([=, this] {
                 createWall(mSide, mThickness,
                     {mSAdj * getSpeedMultDM(), mSAcc, mSMin, mSMax, mSPingPong},
                     mHMod);
@@ -1253,7 +1403,7 @@ void HexagonGame::initLua_WallCreation()
     addLuaFn("w_wallHModCurveData", //
         [this](float mHMod, int mSide, float mThickness, float mCAdj,
             float mCAcc, float mCMin, float mCMax, bool mCPingPong) {
-            timeline.append_do([=, this] {
+            timelineDo([=, this] {
                 createWall(mSide, mThickness, {getSpeedMultDM()},
                     {mCAdj, mCAcc, mCMin, mCMax, mCPingPong}, mHMod);
             });
@@ -1278,26 +1428,20 @@ void HexagonGame::initLua_WallCreation()
             "back and forth between its minimum and maximum speed.");
 }
 
-void HexagonGame::initLua_Steam()
+void HexagonSimulation::initLua_Steam()
 {
     addLuaFn("steam_unlockAchievement", //
         [this](const std::string& mId) {
-            if(!inReplay())
-            {
-                // Do not unlock achievements while watching a replay.
-                return;
-            }
-
             if(Config::getOfficial())
             {
-                steamManager.unlock_achievement(mId);
+                unlockAchievement(mId);
             }
         })
         .arg("achievementId")
         .doc("Unlock the Steam achievement with id `$0`.");
 }
 
-void HexagonGame::initLua_CustomWalls()
+void HexagonSimulation::initLua_CustomWalls()
 {
     addLuaFn("cw_create", //
         [this]() -> CCustomWallHandle { return cwManager.create(); })
@@ -1320,6 +1464,51 @@ void HexagonGame::initLua_CustomWalls()
             "Given the custom wall represented by `$0`, set the position of "
             "its vertex with index `$1` to `{$2, $3}`.");
 
+    addLuaFn("cw_createMany", //
+        [this](int count) -> std::vector<CCustomWallHandle> {
+            std::vector<CCustomWallHandle> result;
+            cwManager.createMany(std::max(count, 0), result);
+            return result;
+        })
+        .arg("count")
+        .doc(
+            "Create `$0` new custom walls at once and return a table with "
+            "their integer handles.");
+
+    addLuaFn("cw_setVertexPos4", //
+        [this](CCustomWallHandle cwHandle, float x0, float y0, float x1,
+            float y1, float x2, float y2, float x3, float y3) {
+            cwManager.setVertexPos4(cwHandle,
+                {sf::Vector2f{x0, y0}, sf::Vector2f{x1, y1},
+                    sf::Vector2f{x2, y2}, sf::Vector2f{x3, y3}});
+        })
+        .arg("cwHandle")
+        .arg("x0")
+        .arg("y0")
+        .arg("x1")
+        .arg("y1")
+        .arg("x2")
+        .arg("y2")
+        .arg("x3")
+        .arg("y3")
+        .doc(
+            "Given the custom wall represented by `$0`, set the positions of "
+            "its four vertices to `{$1, $2}`, `{$3, $4}`, `{$5, $6}` and "
+            "`{$7, $8}`. Faster than four calls to `cw_setVertexPos`.");
+
+    addLuaFn("cw_setManyVertexPos", //
+        [this](const std::vector<CCustomWallHandle>& cwHandles,
+            const std::vector<float>& coords) {
+            cwManager.setManyVertexPos(cwHandles, coords);
+        })
+        .arg("cwHandles")
+        .arg("coords")
+        .doc(
+            "Set the positions of the vertices of all the custom walls in the "
+            "array `$0`. The array `$1` contains the eight coordinates "
+            "`x0, y0, x1, y1, x2, y2, x3, y3` of every wall, in the same "
+            "order as `$0`.");
+
     addLuaFn("cw_setVertexColor", //
         [this](CCustomWallHandle cwHandle, int vertexIndex, int r, int g, int b,
             int a) {
@@ -1371,7 +1560,7 @@ void HexagonGame::initLua_CustomWalls()
 // These are all deprecated functions that are only being kept for the sake of
 // lessening the impact of incompatibility. Pack Developers have time to change
 // to the new functions before they get removed permanently
-void HexagonGame::initLua_Deprecated()
+void HexagonSimulation::initLua_Deprecated()
 {
     addLuaFn("u_playSound", //
         [this](const std::string& mId) {
@@ -1379,7 +1568,7 @@ void HexagonGame::initLua_Deprecated()
                 "This function will be removed in a future version of Open "
                 "Hexagon. Please replace all occurrences of this function with "
                 "\"a_playSound\" in your level files.");
-            assets.playSound(mId);
+            playSound(mId);
         })
         .arg("soundId")
         .doc(
@@ -1394,7 +1583,7 @@ void HexagonGame::initLua_Deprecated()
                 "This function will be removed in a future version of Open "
                 "Hexagon. Please replace all occurrences of this function with "
                 "\"a_playPackSound\" in your level files.");
-            assets.playPackSound(getPackId(), fileName);
+            playPackSound(getPackId(), fileName);
         })
         .arg("fileName")
         .doc(
@@ -1484,7 +1673,7 @@ void HexagonGame::initLua_Deprecated()
             "version. Please use e_clearMessages instead!**");
 }
 
-void HexagonGame::initLua()
+void HexagonSimulation::initLua()
 {
     // TODO: cleanup/refactor
     const auto rndReal = [this]() -> float {
@@ -1556,7 +1745,10 @@ end
     // ------------------------------------------------------------------------
     // Register Lua function to get random seed for the current attempt:
     addLuaFn("u_getAttemptRandomSeed", //
-        [this] { return rng.seed(); })
+        [this] {
+            seedQueried = true;
+            return rng.seed();
+        })
         .doc(
             "Obtain the current random seed, automatically generated at the "
             "beginning of the level. `math.randomseed` is automatically "
@@ -1572,7 +1764,7 @@ end
     }
     catch(...)
     {
-        ssvu::lo("HexagonGame::initLua")
+        ssvu::lo("HexagonSimulation::initLua")
             << "Failure to initialize Lua random generator seed\n";
     }
 
@@ -1589,14 +1781,15 @@ end
     initLua_WallCreation();
     initLua_Steam();
     initLua_CustomWalls();
+    initLua_Patterns();
     initLua_Deprecated();
 
     // TODO: refactor doc stuff and have a command line option to print this:
 #if 0
-    ssvu::lo("hg::HexagonGame::initLua") << "Printing Lua Markdown docs\n\n";
+    ssvu::lo("hg::HexagonSimulation::initLua") << "Printing Lua Markdown docs\n\n";
     printLuaDocs();
     std::cout << "\n\n";
-    ssvu::lo("hg::HexagonGame::initLua") << "Done\n";
+    ssvu::lo("hg::HexagonSimulation::initLua") << "Done\n";
 #endif
 }
 
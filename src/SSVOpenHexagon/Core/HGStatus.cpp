@@ -5,6 +5,7 @@
 #include "SSVOpenHexagon/Core/HGStatus.hpp"
 
 #include <chrono>
+#include <cstdint>
 
 namespace hg
 {
@@ -12,20 +13,53 @@ namespace hg
 void HexagonGameStatus::start() noexcept
 {
     // Reset everything to the current time:
-    totalFrametimeAccumulator = 0.0;
-    playedFrametimeAccumulator = 0.0;
-    pausedFrametimeAccumulator = 0.0;
-    currentPause = 0.1 * 60;
-    currentIncrementTime = 0.0;
+    totalTime = Duration::zero();
+    playedTime = Duration::zero();
+    pausedTime = Duration::zero();
+    currentPause = initialPause;
+    legacyPause = legacyInitialPause;
+    currentIncrementTime = Duration::zero();
     customScore = 0;
 
     // Signal that we started:
     started = true;
 }
 
+void HexagonGameStatus::setLegacyClock(const bool legacy) noexcept
+{
+    legacyClock = legacy;
+}
+
+[[nodiscard]] bool HexagonGameStatus::getLegacyClock() const noexcept
+{
+    return legacyClock;
+}
+
+[[nodiscard]] HexagonGameStatus::Duration HexagonGameStatus::getWaitFromSeconds(
+    const double seconds) const noexcept
+{
+    if(legacyClock)
+    {
+        return Duration{static_cast<std::int64_t>(seconds * 1000.0)};
+    }
+
+    return Clock::from_seconds(seconds);
+}
+
+[[nodiscard]] HexagonGameStatus::Duration
+HexagonGameStatus::getWaitFromFrametime(const double ft) const noexcept
+{
+    if(legacyClock)
+    {
+        return getWaitFromSeconds(ft / 60.0);
+    }
+
+    return Clock::from_frametime(ft);
+}
+
 [[nodiscard]] double HexagonGameStatus::getIncrementTimeSeconds() noexcept
 {
-    return currentIncrementTime / 60.0;
+    return Clock::to_seconds(currentIncrementTime);
 }
 
 [[nodiscard]] double HexagonGameStatus::getTimeSeconds() noexcept
@@ -36,15 +70,25 @@ void HexagonGameStatus::start() noexcept
 [[nodiscard]] HexagonGameStatus::TimePoint
 HexagonGameStatus::getCurrentTP() noexcept
 {
-    return HexagonGameStatus::TimePoint{std::chrono::milliseconds{
-        (int64_t)(getTotalAccumulatedFrametimeInSeconds() * 1000.0)}};
+    if(legacyClock)
+    {
+        return HexagonGameStatus::TimePoint{Duration{static_cast<std::int64_t>(
+            getTotalAccumulatedFrametimeInSeconds() * 1000.0)}};
+    }
+
+    return HexagonGameStatus::TimePoint{totalTime};
 }
 
 [[nodiscard]] HexagonGameStatus::TimePoint
 HexagonGameStatus::getTimeTP() noexcept
 {
-    return HexagonGameStatus::TimePoint{std::chrono::milliseconds{
-        (int64_t)(getPlayedAccumulatedFrametimeInSeconds() * 1000.0)}};
+    if(legacyClock)
+    {
+        return HexagonGameStatus::TimePoint{Duration{static_cast<std::int64_t>(
+            getPlayedAccumulatedFrametimeInSeconds() * 1000.0)}};
+    }
+
+    return HexagonGameStatus::TimePoint{playedTime};
 }
 
 [[nodiscard]] HexagonGameStatus::TimePoint
@@ -55,41 +99,65 @@ HexagonGameStatus::getLevelStartTP() noexcept
 
 [[nodiscard]] bool HexagonGameStatus::isTimePaused() noexcept
 {
-    return currentPause > 0.0;
+    if(legacyClock)
+    {
+        return legacyPause > 0.0;
+    }
+
+    return currentPause > Duration::zero();
 }
 
 void HexagonGameStatus::pauseTime(const double seconds) noexcept
 {
-    currentPause += seconds * 60.0;
+    if(legacyClock)
+    {
+        legacyPause += seconds * 60.0;
+        return;
+    }
+
+    currentPause += Clock::from_seconds(seconds);
 }
 
 void HexagonGameStatus::resetIncrementTime() noexcept
 {
-    currentIncrementTime = 0.0;
+    currentIncrementTime = Duration::zero();
 }
 
 void HexagonGameStatus::accumulateFrametime(const double ft) noexcept
+{
+    accumulateTime(Clock::from_frametime(ft));
+}
+
+void HexagonGameStatus::accumulateTime(const Duration d) noexcept
 {
     // TODO: double-check what to do with remainder
 
-    totalFrametimeAccumulator += ft;
+    totalTime += d;
 
-    // double pauseRemainder = 0.0;
-    if(currentPause > 0.0)
+    // Duration pauseRemainder{};
+    if(isTimePaused())
     {
-        currentPause -= ft;
-        // if(currentPause < 0.0)
+        if(legacyClock)
+        {
+            legacyPause -= Clock::to_frametime(d);
+        }
+        else
+        {
+            currentPause -= d;
+        }
+
+        // if(currentPause < Duration::zero())
         // {
         //     pauseRemainder = -currentPause;
         // }
     }
 
-    // if(currentPause <= 0.0)
+    // if(currentPause <= Duration::zero())
     else
     {
-        playedFrametimeAccumulator += ft;
-        currentIncrementTime += ft;
-        // playedFrametimeAccumulator += pauseRemainder;
+        playedTime += d;
+        currentIncrementTime += d;
+        // playedTime += pauseRemainder;
     }
 }
 
@@ -101,37 +169,37 @@ void HexagonGameStatus::updateCustomScore(const float score) noexcept
 [[nodiscard]] double
 HexagonGameStatus::getTotalAccumulatedFrametime() const noexcept
 {
-    return totalFrametimeAccumulator;
+    return Clock::to_frametime(totalTime);
 }
 
 [[nodiscard]] double
 HexagonGameStatus::getTotalAccumulatedFrametimeInSeconds() const noexcept
 {
-    return getTotalAccumulatedFrametime() / 60.0;
+    return Clock::to_seconds(totalTime);
 }
 
 [[nodiscard]] double
 HexagonGameStatus::getPlayedAccumulatedFrametime() const noexcept
 {
-    return playedFrametimeAccumulator;
+    return Clock::to_frametime(playedTime);
 }
 
 [[nodiscard]] double
 HexagonGameStatus::getPlayedAccumulatedFrametimeInSeconds() const noexcept
 {
-    return getPlayedAccumulatedFrametime() / 60.0;
+    return Clock::to_seconds(playedTime);
 }
 
 [[nodiscard]] double
 HexagonGameStatus::getPausedAccumulatedFrametime() const noexcept
 {
-    return pausedFrametimeAccumulator;
+    return Clock::to_frametime(pausedTime);
 }
 
 [[nodiscard]] double
 HexagonGameStatus::getPausedAccumulatedFrametimeInSeconds() const noexcept
 {
-    return getPausedAccumulatedFrametime() / 60.0;
+    return Clock::to_seconds(pausedTime);
 }
 
 [[nodiscard]] float HexagonGameStatus::getCustomScore() const noexcept
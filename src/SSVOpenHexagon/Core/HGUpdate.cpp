@@ -10,6 +10,9 @@
 
 #include <SSVUtils/Core/Common/Frametime.hpp>
 
+#include <chrono>
+#include <cmath>
+
 using namespace std;
 using namespace sf;
 using namespace ssvs;
@@ -42,9 +45,11 @@ void HexagonGame::update(ssvu::FT mFT)
 {
     mFT *= Config::getTimescale();
 
-    std::string nameStr = levelData->name;
+    HexagonGameStatus& status = simulation.getStatus();
+
+    std::string nameStr = simulation.getLevelData().name;
     nameFormat(nameStr);
-    const std::string diffStr = diffFormat(difficultyMult);
+    const std::string diffStr = diffFormat(simulation.getDifficultyMult());
     const std::string timeStr = timeFormat(status.getTimeSeconds());
 
     constexpr float DELAY_TO_UPDATE = 5.f; // X seconds
@@ -66,116 +71,31 @@ void HexagonGame::update(ssvu::FT mFT)
     discordManager.run_callbacks();
 
     updateText();
-    updateFlash(mFT);
     effectTimelineManager.update(mFT);
 
-    if(!mustReplayInput())
+    if(isReplayTurbo() && mustReplayInput())
     {
-        updateInput();
+        updateTicksTurbo();
     }
     else
     {
-        assert(activeReplay.has_value());
-
-        if(!status.started)
-        {
-            start();
-        }
-
-        const input_bitset ib =
-            activeReplay->replayPlayer.get_current_and_move_forward();
-
-        if(ib[static_cast<unsigned int>(input_bit::left)])
-        {
-            inputMovement = -1;
-        }
-        else if(ib[static_cast<unsigned int>(input_bit::right)])
-        {
-            inputMovement = 1;
-        }
-        else
-        {
-            inputMovement = 0;
-        }
-
-        inputSwap = ib[static_cast<unsigned int>(input_bit::swap)];
-        inputFocused = ib[static_cast<unsigned int>(input_bit::focus)];
+        updateTicks(mFT);
     }
 
+    // Spread the collection of the garbage produced by the level scripts
+    simulation.stepLuaGC(Config::getLuaGCStepKB());
+
     updateKeyIcons();
+    updateFlash();
 
-    if(status.started)
+    if(status.started && !status.hasDied && Config::getPulse())
     {
-        if(!status.hasDied)
-        {
-            player.update(*this, mFT);
-
-            const std::optional<bool> preventPlayerInput =
-                runLuaFunctionIfExists<bool, float, int, bool, bool>("onInput",
-                    mFT, getInputMovement(), getInputFocused(), getInputSwap());
-
-            if(!preventPlayerInput.has_value() || !(*preventPlayerInput))
-            {
-                player.updateInput(*this, mFT);
-            }
-
-            player.updatePosition(*this, mFT);
-
-            status.accumulateFrametime(mFT);
-            if(levelStatus.scoreOverridden)
-            {
-                status.updateCustomScore(
-                    lua.readVariable<float>(levelStatus.scoreOverride));
-            }
-            updateWalls(mFT);
-
-            ssvu::eraseRemoveIf(
-                walls, [](const CWall& w) { return w.isDead(); });
-
-            cwManager.cleanup();
-
-            updateEvents(mFT);
-            updateIncrement();
-
-            if(mustChangeSides && walls.empty())
-            {
-                sideChange(
-                    rng.get_int(levelStatus.sidesMin, levelStatus.sidesMax));
-            }
-
-            updateLevel(mFT);
-            updateCustomWalls(mFT);
-
-            if(Config::getBeatPulse())
-            {
-                updateBeatPulse(mFT);
-            }
-
-            if(Config::getPulse())
-            {
-                updatePulse(mFT);
-            }
-
-            if(!Config::getBlackAndWhite())
-            {
-                styleData.update(mFT, pow(difficultyMult, 0.8f));
-            }
-        }
-        else
-        {
-            levelStatus.rotationSpeed *= 0.99f;
-        }
-
-        if(Config::get3D())
-        {
-            update3D(mFT);
-        }
-        if(!Config::getNoRotation())
-        {
-            updateRotation(mFT);
-        }
+        updatePulse();
     }
 
+    backgroundCamera.setRotation(
+        simulation.getInterpolatedRotation(interpolationAlpha));
+
     overlayCamera.update(mFT);
     backgroundCamera.update(mFT);
 
@@ -188,8 +108,8 @@ void HexagonGame::update(ssvu::FT mFT)
             const bool executeLastReplay =
                 status.mustStateChange == StateChange::MustReplay;
 
-            newGame(getPackId(), restartId, restartFirstTime, difficultyMult,
-                executeLastReplay);
+            newGame(getPackId(), restartId, restartFirstTime,
+                simulation.getDifficultyMult(), executeLastReplay);
         }
 
         if(!status.scoreInvalid && Config::getOfficial() &&
@@ -198,7 +118,7 @@ void HexagonGame::update(ssvu::FT mFT)
             invalidateScore("PERFORMANCE ISSUES");
         }
         else if(!status.scoreInvalid && !Config::get3D() &&
-                levelStatus._3DRequired)
+                simulation.getLevelStatus()._3DRequired)
         {
             invalidateScore("3D REQUIRED");
         }
@@ -207,99 +127,114 @@ void HexagonGame::update(ssvu::FT mFT)
     }
 }
 
-void HexagonGame::updateWalls(ssvu::FT mFT)
+void HexagonGame::updateTicks(ssvu::FT mFT)
 {
-    cwManager.forCustomWalls([&](const CCustomWall& customWall) {
-        // After *only* the player has moved, push in case of overlap.
-        if(customWall.isOverlapping(player.getPosition()))
-        {
-            if(player.getJustSwapped())
-            {
-                player.kill(*this);
-                steamManager.unlock_achievement("a22_swapdeath");
-            }
-            else
-            {
-                if(player.push(*this, customWall, mFT))
-                {
-                    player.kill(*this);
-                }
-            }
-        }
-    });
+    // The simulation always advances in fixed ticks, independently from the
+    // rendering framerate. Time that does not fill a whole tick is carried
+    // over to the next frame and used to interpolate what is drawn.
+    constexpr ssvu::FT tickFT{HexagonSimulation::tickFT};
+    constexpr int baseMaxTicksPerUpdate{16};
 
-    for(CWall& wall : walls)
+    const float replaySpeed = getReplaySpeed();
+    const int maxTicksPerUpdate =
+        baseMaxTicksPerUpdate * static_cast<int>(std::ceil(replaySpeed));
+
+    tickAccumulator += mFT * replaySpeed;
+
+    for(int i = 0; i < maxTicksPerUpdate && tickAccumulator >= tickFT; ++i)
     {
-        wall.update(*this, mFT);
+        tickAccumulator -= tickFT;
+        updateTick();
 
-        // After *only* the player has moved, push in case of overlap.
-        if(wall.isOverlapping(player.getPosition()))
+        if(simulation.getStatus().mustStateChange != StateChange::None)
         {
-            if(player.getJustSwapped())
-            {
-                player.kill(*this);
-                steamManager.unlock_achievement("a22_swapdeath");
-            }
-            else
-            {
-                if(player.push(*this, wall, mFT))
-                {
-                    player.kill(*this);
-                }
-            }
+            break;
         }
+    }
 
-        // Move the wall towards the center. Overlap means sure death.
-        wall.moveTowardsCenter(*this, centerPos, mFT);
-        if(wall.isOverlapping(player.getPosition()))
-        {
-            player.kill(*this);
-        }
+    // Drop whatever could not be simulated in time instead of spiraling
+    if(tickAccumulator >= tickFT)
+    {
+        tickAccumulator = 0.f;
+    }
 
-        // Curve the wall. If an overlap happens, the player must be pushed.
-        wall.moveCurve(*this, centerPos, mFT);
-        if(wall.isOverlapping(player.getPosition()))
-        {
-            if(player.push(*this, wall, mFT))
-            {
-                player.kill(*this);
-            }
-        }
+    // A static timer feeds whole ticks at normal speed, draw the latest state
+    // as-is
+    interpolationAlpha = Config::getTimerStatic() && replaySpeed >= 1.f
+                             ? 1.f
+                             : tickAccumulator / tickFT;
+}
+
+void HexagonGame::updateTicksTurbo()
+{
+    // Simulate as many replay ticks as fit in the time budget, only the last
+    // one is drawn
+    constexpr auto budget = std::chrono::milliseconds{12};
+    const auto startTP = std::chrono::steady_clock::now();
+
+    while(mustReplayInput() &&
+          simulation.getStatus().mustStateChange == StateChange::None &&
+          std::chrono::steady_clock::now() - startTP < budget)
+    {
+        updateTick();
     }
 
-    // If there's still an overlap after collision resolution, kill the player.
-    for(const CWall& wall : walls)
+    tickAccumulator = 0.f;
+    interpolationAlpha = 1.f;
+}
+
+void HexagonGame::updateTick()
+{
+    if(!mustReplayInput())
     {
-        if(wall.isOverlapping(player.getPosition()))
+        const std::size_t recordedInputs = lastReplayData.size();
+        simulation.step(updateInput(), HexagonSimulation::tickFT);
+
+        // Periodically record the resulting state, to detect replay desyncs
+        if(lastReplayData.size() != recordedInputs &&
+            lastReplayData.size() % replay_state_hash_interval == 0)
         {
-            player.kill(*this);
+            lastStateHashes.emplace_back(simulation.computeStateHash());
         }
+
+        return;
     }
-}
 
+    assert(activeReplay.has_value());
 
-void HexagonGame::updateCustomWalls(ssvu::FT mFT)
-{
-    (void)mFT;
+    if(!simulation.getStatus().started)
+    {
+        start();
+    }
+
+    const std::size_t tick = activeReplay->replayPlayer.get_current_index();
+    if(activeReplay->keyframes.should_capture(tick, simulation))
+    {
+        activeReplay->keyframes.capture(tick, simulation);
+    }
+
+    simulation.step(activeReplay->replayPlayer.get_current_and_move_forward(),
+        HexagonSimulation::tickFT);
 
-    const bool customWallCollision =
-        cwManager.anyCustomWall([&](const CCustomWall& customWall) {
-            return customWall.isOverlapping(player.getPosition());
-        });
+    const replay_file& rf = activeReplay->replayFile;
+    const std::size_t playedInputs = tick + 1;
 
-    if(customWallCollision)
+    if(!activeReplay->desyncTick.has_value() &&
+        rf.has_state_hash(playedInputs) &&
+        rf.state_hash_mismatch(playedInputs, simulation.computeStateHash()))
     {
-        player.kill(*this);
+        activeReplay->desyncTick = playedInputs;
+
+        ssvu::lo("hg::HexagonGame::updateTick")
+            << "Replay desync detected after " << playedInputs << " inputs\n";
     }
 }
 
 void HexagonGame::start()
 {
-    status.start();
-    messageText.setString("");
     assets.playSound("go.ogg");
 
-    if(!Config::getNoMusic())
+    if(!Config::getNoMusic() && !isReplayTurbo())
     {
         assets.musicPlayer.resume();
     }
@@ -309,11 +244,13 @@ void HexagonGame::start()
         fpsWatcher.enable();
     }
 
-    runLuaFunction<void>("onLoad");
+    simulation.start();
 }
 
-void HexagonGame::updateInput()
+[[nodiscard]] input_bitset HexagonGame::updateInput()
 {
+    HexagonGameStatus& status = simulation.getStatus();
+
     // Joystick support
     hg::Joystick::update();
 
@@ -396,15 +333,16 @@ void HexagonGame::updateInput()
         }
     }
 
+    const bool left = inputMovement == -1;
+    const bool right = inputMovement == 1;
+    const bool swap = inputSwap || hg::Joystick::swapPressed();
+    const bool focus = inputFocused || hg::Joystick::focusPressed();
+
     // Replay support
     if(status.started && !status.hasDied)
     {
-        const bool left = getInputMovement() == -1;
-        const bool right = getInputMovement() == 1;
-        const bool swap = getInputSwap();
-        const bool focus = getInputFocused();
-
         lastReplayData.record_input(left, right, swap, focus);
+        replayStreamWriter.update(lastReplayData, simulation.getReplayScore());
     }
 
     // Joystick support
@@ -421,155 +359,25 @@ void HexagonGame::updateInput()
     {
         status.mustStateChange = StateChange::MustReplay;
     }
-}
-
-void HexagonGame::updateEvents(ssvu::FT)
-{
-    if(const auto o =
-            eventTimelineRunner.update(eventTimeline, status.getTimeTP());
-        o == hg::Utils::timeline2_runner::outcome::finished)
-    {
-        eventTimeline.clear();
-        eventTimelineRunner = {};
-    }
 
-    if(const auto o = messageTimelineRunner.update(
-           messageTimeline, status.getCurrentTP());
-        o == hg::Utils::timeline2_runner::outcome::finished)
-    {
-        messageTimeline.clear();
-        messageTimelineRunner = {};
-    }
+    return make_input_bitset(left, right, swap, focus);
 }
 
-void HexagonGame::updateIncrement()
+void HexagonGame::updatePulse()
 {
-    if(!levelStatus.incEnabled)
-    {
-        return;
-    }
-
-    if(status.getIncrementTimeSeconds() < levelStatus.incTime)
-    {
-        return;
-    }
-
-    ++levelStatus.currentIncrements;
-    incrementDifficulty();
-    status.resetIncrementTime();
-    mustChangeSides = true;
-}
+    const float p{
+        simulation.getStatus().pulse / simulation.getLevelStatus().pulseMin};
 
-void HexagonGame::updateLevel(ssvu::FT mFT)
-{
-    if(status.isTimePaused())
-    {
-        return;
-    }
-
-    runLuaFunction<float>("onUpdate", mFT);
-
-    const auto o = timelineRunner.update(timeline, status.getTimeTP());
-
-    if(o == hg::Utils::timeline2_runner::outcome::finished && !mustChangeSides)
-    {
-        timeline.clear();
-        runLuaFunction<void>("onStep");
-        timelineRunner = {};
-    }
-}
-void HexagonGame::updatePulse(ssvu::FT mFT)
-{
-    if(status.pulseDelay <= 0 && status.pulseDelayHalf <= 0)
-    {
-        float pulseAdd{status.pulseDirection > 0 ? levelStatus.pulseSpeed
-                                                 : -levelStatus.pulseSpeedR};
-        float pulseLimit{status.pulseDirection > 0 ? levelStatus.pulseMax
-                                                   : levelStatus.pulseMin};
-
-        status.pulse += pulseAdd * mFT * getMusicDMSyncFactor();
-        if((status.pulseDirection > 0 && status.pulse >= pulseLimit) ||
-            (status.pulseDirection < 0 && status.pulse <= pulseLimit))
-        {
-            status.pulse = pulseLimit;
-            status.pulseDirection *= -1;
-            status.pulseDelayHalf = levelStatus.pulseDelayHalfMax;
-            if(status.pulseDirection < 0)
-            {
-                status.pulseDelay = levelStatus.pulseDelayMax;
-            }
-        }
-    }
-
-    status.pulseDelay -= mFT;
-    status.pulseDelayHalf -= mFT;
-
-    float p{status.pulse / levelStatus.pulseMin};
-    float rotation{backgroundCamera.getRotation()};
     backgroundCamera.setView({ssvs::zeroVec2f,
         {(Config::getWidth() * Config::getZoomFactor()) * p,
             (Config::getHeight() * Config::getZoomFactor()) * p}});
-    backgroundCamera.setRotation(rotation);
-}
-void HexagonGame::updateBeatPulse(ssvu::FT mFT)
-{
-    if(status.beatPulseDelay <= 0)
-    {
-        status.beatPulse = levelStatus.beatPulseMax;
-        status.beatPulseDelay = levelStatus.beatPulseDelayMax;
-    }
-    else
-    {
-        status.beatPulseDelay -= 1 * mFT * getMusicDMSyncFactor();
-    }
-
-    if(status.beatPulse > 0)
-    {
-        status.beatPulse -= (2.f * mFT * getMusicDMSyncFactor()) *
-                            levelStatus.beatPulseSpeedMult;
-    }
-
-    float radiusMin{Config::getBeatPulse() ? levelStatus.radiusMin : 75};
-    status.radius =
-        radiusMin * (status.pulse / levelStatus.pulseMin) + status.beatPulse;
 }
-void HexagonGame::updateRotation(ssvu::FT mFT)
-{
-    auto nextRotation(getRotationSpeed() * 10.f);
-    if(status.fastSpin > 0)
-    {
-        nextRotation +=
-            abs((getSmootherStep(0, levelStatus.fastSpin, status.fastSpin) /
-                    3.5f) *
-                17.f) *
-            getSign(nextRotation);
-        status.fastSpin -= mFT;
-    }
 
-    backgroundCamera.turn(nextRotation);
-}
-void HexagonGame::updateFlash(ssvu::FT mFT)
+void HexagonGame::updateFlash()
 {
-    if(status.flashEffect > 0)
-    {
-        status.flashEffect -= 3 * mFT;
-    }
-    status.flashEffect = getClamped(status.flashEffect, 0.f, 255.f);
     for(auto i(0u); i < 4; ++i)
     {
-        flashPolygon[i].color.a = status.flashEffect;
-    }
-}
-void HexagonGame::update3D(ssvu::FT mFT)
-{
-    status.pulse3D += styleData._3dPulseSpeed * status.pulse3DDirection * mFT;
-    if(status.pulse3D > styleData._3dPulseMax)
-    {
-        status.pulse3DDirection = -1;
-    }
-    else if(status.pulse3D < styleData._3dPulseMin)
-    {
-        status.pulse3DDirection = 1;
+        flashPolygon[i].color.a = simulation.getStatus().flashEffect;
     }
 }
 
@@ -18,7 +18,9 @@
 
 #include <SFML/Graphics.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 
 using namespace hg::Utils;
 
@@ -26,31 +28,9 @@ using namespace hg::Utils;
 namespace hg
 {
 
-namespace
+[[nodiscard]] static random_number_generator::seed_type initializeSeed()
 {
-
-[[nodiscard]] double getReplayScore(const HexagonGameStatus& status)
-{
-    return status.getCustomScore() != 0.f
-               ? status.getCustomScore()
-               : status.getPlayedAccumulatedFrametime();
-}
-
-} // namespace
-
-[[nodiscard]] static random_number_generator initializeRng()
-{
-    const random_number_generator::seed_type seed = ssvu::getRndEngine()();
-    return random_number_generator{seed};
-}
-
-void HexagonGame::createWall(int mSide, float mThickness,
-    const SpeedData& mSpeed, const SpeedData& mCurve, float mHueMod)
-{
-    walls.emplace_back(*this, centerPos, mSide, mThickness,
-        Config::getSpawnDistance(), mSpeed, mCurve);
-
-    walls.back().setHueMod(mHueMod);
+    return ssvu::getRndEngine()();
 }
 
 void HexagonGame::initKeyIcons()
@@ -119,10 +99,11 @@ HexagonGame::HexagonGame(Steam::steam_manager& mSteamManager,
     Discord::discord_manager& mDiscordManager, HGAssets& mAssets,
     ssvs::GameWindow& mGameWindow)
     : steamManager(mSteamManager), discordManager(mDiscordManager),
-      assets(mAssets), window(mGameWindow),
-      player{ssvs::zeroVec2f, getSwapCooldown()}, rng{initializeRng()},
+      assets(mAssets), window(mGameWindow), simulation{mAssets},
       fpsWatcher(window)
 {
+    initSimulationHooks();
+
     game.onUpdate += [this](ssvu::FT mFT) { update(mFT); };
 
     game.onPostUpdate += [this] {
@@ -161,13 +142,15 @@ HexagonGame::HexagonGame(Steam::steam_manager& mSteamManager,
     game.addInput(
         Config::getTriggerForceRestart(),
         [this](ssvu::FT /*unused*/) {
-            status.mustStateChange = StateChange::MustRestart;
+            simulation.getStatus().mustStateChange = StateChange::MustRestart;
         },
         ssvs::Input::Type::Once, Tid::ForceRestart);
 
     game.addInput(
         Config::getTriggerRestart(),
         [this](ssvu::FT /*unused*/) {
+            HexagonGameStatus& status = simulation.getStatus();
+
             if(status.hasDied)
             {
                 status.mustStateChange = StateChange::MustRestart;
@@ -178,6 +161,8 @@ HexagonGame::HexagonGame(Steam::steam_manager& mSteamManager,
     game.addInput(
         Config::getTriggerReplay(),
         [this](ssvu::FT /*unused*/) {
+            HexagonGameStatus& status = simulation.getStatus();
+
             if(status.hasDied)
             {
                 status.mustStateChange = StateChange::MustReplay;
@@ -185,6 +170,30 @@ HexagonGame::HexagonGame(Steam::steam_manager& mSteamManager,
         },
         ssvs::Input::Type::Once, Tid::Replay);
 
+    game.addInput(
+        {{sf::Keyboard::Key::Add}, {sf::Keyboard::Key::Equal}},
+        [this](ssvu::FT /*unused*/) { changeReplaySpeed(1); }, // hardcoded
+        ssvs::Input::Type::Once);
+
+    game.addInput(
+        {{sf::Keyboard::Key::Subtract}, {sf::Keyboard::Key::Hyphen}},
+        [this](ssvu::FT /*unused*/) { changeReplaySpeed(-1); }, // hardcoded
+        ssvs::Input::Type::Once);
+
+    game.addInput(
+        {{sf::Keyboard::Key::LBracket}},
+        [this](ssvu::FT /*unused*/) {
+            seekReplayBy(-replaySeekStepSeconds);
+        }, // hardcoded
+        ssvs::Input::Type::Once);
+
+    game.addInput(
+        {{sf::Keyboard::Key::RBracket}},
+        [this](ssvu::FT /*unused*/) {
+            seekReplayBy(replaySeekStepSeconds);
+        }, // hardcoded
+        ssvs::Input::Type::Once);
+
     game.addInput(
         Config::getTriggerScreenshot(),
         [this](ssvu::FT /*unused*/) { mustTakeScreenshot = true; },
@@ -223,6 +232,74 @@ HexagonGame::HexagonGame(Steam::steam_manager& mSteamManager,
     initKeyIcons();
 }
 
+void HexagonGame::initSimulationHooks()
+{
+    HexagonSimulation::Hooks hooks;
+
+    hooks.onNewGame = [this] { resetLevelAudio(); };
+
+    hooks.playSound = [this](const std::string& mId) {
+        if(!fastForwarding)
+        {
+            assets.playSound(mId);
+        }
+    };
+
+    hooks.playPackSound = [this](const std::string& mPackId,
+                              const std::string& mId) {
+        if(!fastForwarding)
+        {
+            assets.playPackSound(mPackId, mId);
+        }
+    };
+
+    hooks.playLevelMusic = [this] { playLevelMusic(); };
+
+    hooks.playLevelMusicAtTime = [this](float mSeconds) {
+        playLevelMusicAtTime(mSeconds);
+    };
+
+    hooks.stopLevelMusic = [this] { stopLevelMusic(); };
+
+    hooks.refreshMusicPitch = [this] { refreshLevelMusic(); };
+
+    hooks.unlockAchievement = [this](const std::string& mId) {
+        if(inReplay())
+        {
+            // Do not unlock achievements while watching a replay.
+            return;
+        }
+
+        steamManager.unlock_achievement(mId);
+    };
+
+    hooks.isKeyPressed = [this](int mKey) {
+        return window.getInputState()[ssvs::KKey(mKey)];
+    };
+
+    hooks.isMouseButtonPressed = [this](int mKey) {
+        return window.getInputState()[ssvs::MBtn(mKey)];
+    };
+
+    hooks.onPreDeath = [this] {
+        fpsWatcher.disable();
+
+        if(!fastForwarding)
+        {
+            assets.playSound(simulation.getLevelStatus().deathSound,
+                ssvs::SoundPlayer::Mode::Abort);
+        }
+    };
+
+    hooks.onDeath = [this] { onDeath(); };
+
+    hooks.onLuaError = [this] {
+        goToMenu(false /* mSendScores */, true /* mError */);
+    };
+
+    simulation.setHooks(std::move(hooks));
+}
+
 void HexagonGame::setLastReplay(const replay_file& mReplayFile)
 {
     lastSeed = mReplayFile._seed;
@@ -243,38 +320,43 @@ void HexagonGame::newGame(const std::string& mPackId, const std::string& mId,
 
     initFlashEffect();
 
-    packId = mPackId;
-    levelId = mId;
-
-    if(executeLastReplay && activeReplay.has_value())
-    {
-        firstPlay = activeReplay->replayFile._first_play;
-    }
-    else
-    {
-        firstPlay = mFirstPlay;
-    }
+    const double tempReplayScore = simulation.getReplayScore();
 
-    setLevelData(assets.getLevelData(mId), mFirstPlay);
-    difficultyMult = mDifficultyMult;
-
-    const double tempReplayScore = getReplayScore(status);
-    status = HexagonGameStatus{};
+    random_number_generator::seed_type seed;
+    bool firstPlay = mFirstPlay;
+    std::uint32_t replayVersion = replay_version_latest;
 
     if(!executeLastReplay)
     {
-        // TODO: this can be used to restore normal speed
-        // window.setTimer<ssvs::TimerStatic>(0.5f, 0.5f);
-
-        rng = initializeRng();
+        seed = initializeSeed();
 
         // Save data for immediate replay.
-        lastSeed = rng.seed();
+        lastSeed = seed;
         lastReplayData = replay_data{};
+        lastStateHashes.clear();
         lastFirstPlay = mFirstPlay;
 
         // Clear any existing active replay.
         activeReplay.reset();
+
+        if(Config::getSaveLocalBestReplayToFile())
+        {
+            replayStreamWriter.begin(replay_file{
+                ._version{replay_version_latest},
+                ._player_name{assets.getCurrentLocalProfile().getName()},
+                ._seed{lastSeed},
+                ._data{},
+                ._pack_id{mPackId},
+                ._level_id{mId},
+                ._first_play{lastFirstPlay},
+                ._difficulty_mult{mDifficultyMult},
+                ._played_score{0.0},
+            });
+        }
+        else
+        {
+            replayStreamWriter.discard();
+        }
     }
     else
     {
@@ -283,7 +365,7 @@ void HexagonGame::newGame(const std::string& mPackId, const std::string& mId,
             lastPlayedScore = tempReplayScore;
 
             activeReplay.emplace(replay_file{
-                ._version{0},
+                ._version{replay_version_latest},
                 ._player_name{
                     assets.getCurrentLocalProfile().getName()}, // TODO
                 ._seed{lastSeed},
@@ -293,65 +375,50 @@ void HexagonGame::newGame(const std::string& mPackId, const std::string& mId,
                 ._first_play{lastFirstPlay},
                 ._difficulty_mult{mDifficultyMult},
                 ._played_score{lastPlayedScore},
+                ._state_hash_interval{replay_state_hash_interval},
+                ._state_hashes{lastStateHashes},
             });
         }
 
         activeReplay->replayPlayer.reset();
+        activeReplay->desyncTick.reset();
+
+        // Keyframes refer to the Lua state that is about to be replaced.
+        activeReplay->keyframes.clear();
 
         activeReplay->replayPackName =
             Utils::toUppercase(assets.getPackData(mPackId).name);
 
-        activeReplay->replayLevelName = Utils::toUppercase(levelData->name);
+        activeReplay->replayLevelName =
+            Utils::toUppercase(assets.getLevelData(mId).name);
 
-        // TODO: this can be used to speed up the replay
-        // window.setTimer<ssvs::TimerStatic>(0.5f, 0.1f);
-
-        rng = random_number_generator{activeReplay->replayFile._seed};
+        seed = activeReplay->replayFile._seed;
         firstPlay = activeReplay->replayFile._first_play;
+        replayVersion = activeReplay->replayFile._version;
     }
 
-    // Audio cleanup
-    assets.stopSounds();
-    stopLevelMusic();
-    // assets.playSound("go.ogg");
-    if(!Config::getNoMusic())
-    {
-        playLevelMusic();
-        assets.musicPlayer.pause();
+    // Audio cleanup is performed by the `onNewGame` hook, before the level's
+    // Lua script gets a chance to play any sound or music.
+    simulation.newGame(
+        mPackId, mId, firstPlay, mDifficultyMult, seed, replayVersion);
 
-        sf::Music* current(assets.getMusicPlayer().getCurrent());
-        if(current != nullptr)
-        {
-            setMusicPitch(*current);
-        }
+    // Tick timing cleanup
+    tickAccumulator = 0.f;
+    interpolationAlpha = 1.f;
+
+    if(!firstPlay)
+    {
+        assets.playSound("restart.ogg");
     }
     else
     {
-        assets.musicPlayer.stop();
+        assets.playSound("select.ogg");
     }
 
     // Events cleanup
     messageText.setString("");
 
-    // Event timeline cleanup
-    eventTimeline.clear();
-    eventTimelineRunner = {};
-
-    // Message timeline cleanup
-    messageTimeline.clear();
-    messageTimelineRunner = {};
-
-    // Manager cleanup
-    walls.clear();
-    cwManager.clear();
-    player = CPlayer{ssvs::zeroVec2f, getSwapCooldown()};
-
-    // Timeline cleanup
-    timeline.clear();
-    timelineRunner = {};
-
     effectTimelineManager.clear();
-    mustChangeSides = false;
 
     // FPSWatcher reset
     fpsWatcher.reset();
@@ -364,40 +431,22 @@ void HexagonGame::newGame(const std::string& mPackId, const std::string& mId,
     backgroundCamera.setView(
         {ssvs::zeroVec2f, {Config::getWidth() * Config::getZoomFactor(),
                               Config::getHeight() * Config::getZoomFactor()}});
-    backgroundCamera.setRotation(0);
+    backgroundCamera.setRotation(simulation.getRotation());
 
     // Reset skew
     overlayCamera.setSkew(sf::Vector2f{1.f, 1.f});
     backgroundCamera.setSkew(sf::Vector2f{1.f, 1.f});
 
-    // LUA context and game status cleanup
+    // Input cleanup
     inputImplCCW = inputImplCW = inputImplBothCWCCW = false;
 
-    lua = Lua::LuaContext{};
-    calledDeprecatedFunctions.clear();
-    initLua();
-    runLuaFile(levelData->luaScriptPath);
-
-    if(!firstPlay)
-    {
-        runLuaFunction<void>("onUnload");
-        assets.playSound("restart.ogg");
-    }
-    else
-    {
-        assets.playSound("select.ogg");
-    }
-
-    runLuaFunction<void>("onInit");
-
     restartId = mId;
     restartFirstTime = false;
-    setSides(levelStatus.sides);
 
-    // Set initial values for some status fields from Lua
-    status.beatPulseDelay += levelStatus.beatPulseInitialDelay;
     timeUntilRichPresenceUpdate = -1.f; // immediate update
 
+    HexagonGameStatus& status = simulation.getStatus();
+
     // Store the keys/buttons to be pressed to replay and restart after you die.
     status.restartInput = Config::getKeyboardBindNames(Tid::Restart);
     status.replayInput = Config::getKeyboardBindNames(Tid::Replay);
@@ -457,23 +506,13 @@ void HexagonGame::newGame(const std::string& mPackId, const std::string& mId,
 
 void HexagonGame::death(bool mForce)
 {
-    if(status.hasDied)
-    {
-        return;
-    }
-
-    fpsWatcher.disable();
-    assets.playSound(levelStatus.deathSound, ssvs::SoundPlayer::Mode::Abort);
-
-    if(!mForce && (Config::getInvincible() || levelStatus.tutorialMode))
-    {
-        return;
-    }
+    simulation.death(mForce);
+}
 
+void HexagonGame::onDeath()
+{
     assets.playSound("gameOver.ogg", ssvs::SoundPlayer::Mode::Abort);
-    runLuaFunctionIfExists<void>("onDeath");
 
-    status.flashEffect = 255;
     overlayCamera.setView(
         {{Config::getWidth() / 2.f, Config::getHeight() / 2.f},
             sf::Vector2f(Config::getWidth(), Config::getHeight())});
@@ -481,7 +520,6 @@ void HexagonGame::death(bool mForce)
     shakeCamera(effectTimelineManager, overlayCamera);
     shakeCamera(effectTimelineManager, backgroundCamera);
 
-    status.hasDied = true;
     stopLevelMusic();
 
     if(inReplay())
@@ -497,83 +535,50 @@ void HexagonGame::death(bool mForce)
     if(Config::getSaveLocalBestReplayToFile() && localNewBest)
     {
         const replay_file rf{
-            ._version{0},
+            ._version{replay_version_latest},
             ._player_name{assets.getCurrentLocalProfile().getName()}, // TODO
             ._seed{lastSeed},
             ._data{lastReplayData},
-            ._pack_id{packId},
-            ._level_id{levelId},
-            ._first_play{firstPlay},
-            ._difficulty_mult{difficultyMult},
-            ._played_score{getReplayScore(status)},
+            ._pack_id{simulation.getPackId()},
+            ._level_id{simulation.getLevelId()},
+            ._first_play{simulation.getFirstPlay()},
+            ._difficulty_mult{simulation.getDifficultyMult()},
+            ._played_score{simulation.getReplayScore()},
+            ._compressed{Config::getCompressReplayFiles()},
+            ._streamed{false},
+            ._state_hash_interval{replay_state_hash_interval},
+            ._state_hashes{lastStateHashes},
         };
 
-        const std::string filename = rf.create_filename();
-
         std::filesystem::create_directory("Replays/");
 
         std::filesystem::path p;
         p /= "Replays/";
-        p /= filename;
+        p /= rf.create_filename();
 
-        if(rf.serialize_to_file(p))
-        {
-            ssvu::lo("Replay")
-                << "Successfully saved new local best replay file '" << p
-                << "'\n";
-        }
-        else
-        {
-            ssvu::lo("Replay")
-                << "Failed to save new local best replay file '" << p << "'\n";
-        }
+        // Written in the background, replacing the streamed recording.
+        replayStreamWriter.finish(rf, p);
     }
-
-    if(Config::getAutoRestart())
-    {
-        status.mustStateChange = StateChange::MustRestart;
-    }
-}
-
-void HexagonGame::incrementDifficulty()
-{
-    assets.playSound("levelUp.ogg");
-
-    const float signMult = (levelStatus.rotationSpeed > 0.f) ? 1.f : -1.f;
-
-    levelStatus.rotationSpeed += levelStatus.rotationSpeedInc * signMult;
-
-    const auto& rotationSpeedMax(levelStatus.rotationSpeedMax);
-    if(abs(levelStatus.rotationSpeed) > rotationSpeedMax)
+    else
     {
-        levelStatus.rotationSpeed = rotationSpeedMax * signMult;
+        replayStreamWriter.discard();
     }
 
-    levelStatus.rotationSpeed *= -1.f;
-    status.fastSpin = levelStatus.fastSpin;
-}
-
-void HexagonGame::sideChange(unsigned int mSideNumber)
-{
-    levelStatus.speedMult += levelStatus.speedInc;
-    levelStatus.delayMult += levelStatus.delayInc;
-
-    if(levelStatus.rndSideChangesEnabled)
+    if(Config::getAutoRestart())
     {
-        setSides(mSideNumber);
+        simulation.getStatus().mustStateChange = StateChange::MustRestart;
     }
-
-    mustChangeSides = false;
-
-    assets.playSound(levelStatus.levelUpSound);
-    runLuaFunction<void>("onIncrement");
 }
 
 HexagonGame::CheckSaveScoreResult HexagonGame::checkAndSaveScore()
 {
-    const float score = levelStatus.scoreOverridden
-                            ? lua.readVariable<float>(levelStatus.scoreOverride)
-                            : status.getTimeSeconds();
+    HexagonGameStatus& status = simulation.getStatus();
+    const LevelStatus& levelStatus = simulation.getLevelStatus();
+
+    const float score =
+        levelStatus.scoreOverridden
+            ? simulation.getLua().readVariable<float>(levelStatus.scoreOverride)
+            : status.getTimeSeconds();
 
     // These are requirements that need to be met for a score to be valid
     if(!Config::isEligibleForScore())
@@ -595,8 +600,8 @@ HexagonGame::CheckSaveScoreResult HexagonGame::checkAndSaveScore()
 
     if(assets.pIsLocal())
     {
-        std::string localValidator{
-            getLocalValidator(levelData->id, difficultyMult)};
+        std::string localValidator{getLocalValidator(
+            simulation.getLevelData().id, simulation.getDifficultyMult())};
 
         // TODO: this crashes when going back to menu from replay drag and drop
         if(assets.getLocalScore(localValidator) < score)
@@ -623,10 +628,13 @@ void HexagonGame::goToMenu(bool mSendScores, bool mError)
         assets.playSound("beep.ogg");
     }
 
-    calledDeprecatedFunctions.clear();
+    simulation.clearCalledDeprecatedFunctions();
+    simulation.discardPreparedLevel();
+    simulation.flushLuaProfile();
     fpsWatcher.disable();
+    replayStreamWriter.discard();
 
-    if(mSendScores && !status.hasDied && !mError)
+    if(mSendScores && !simulation.getStatus().hasDied && !mError)
     {
         checkAndSaveScore();
     }
@@ -635,7 +643,7 @@ void HexagonGame::goToMenu(bool mSendScores, bool mError)
     // onUnload.
     if(!mError)
     {
-        runLuaFunction<void>("onUnload");
+        simulation.runLuaFunction<void>("onUnload");
     }
 
     window.setGameState(mgPtr->getGame());
@@ -643,55 +651,9 @@ void HexagonGame::goToMenu(bool mSendScores, bool mError)
     mgPtr->init(mError);
 }
 
-void HexagonGame::raiseWarning(
-    const std::string& mFunctionName, const std::string& mAdditionalInfo)
-{
-    // Only raise the warning once to avoid redundancy
-    if(!calledDeprecatedFunctions.contains(mFunctionName))
-    {
-        calledDeprecatedFunctions.emplace(mFunctionName);
-        // Raise warning to the console
-        std::cout << "[Lua] WARNING: The function \"" << mFunctionName
-                  << "\" (used in level \"" << levelData->name
-                  << "\") is deprecated. " << mAdditionalInfo << std::endl;
-    }
-}
-
-void HexagonGame::addMessage(
-    std::string mMessage, double mDuration, bool mSoundToggle)
-{
-    Utils::uppercasify(mMessage);
-
-    messageTimeline.append_do([this, mSoundToggle, mMessage] {
-        if(mSoundToggle)
-        {
-            assets.playSound(levelStatus.beepSound);
-        }
-        messageText.setString(mMessage);
-    });
-
-    messageTimeline.append_wait_for_sixths(mDuration);
-    messageTimeline.append_do([this] { messageText.setString(""); });
-}
-
-void HexagonGame::clearMessages()
-{
-    messageTimeline.clear();
-}
-
-void HexagonGame::setLevelData(
-    const LevelData& mLevelData, bool mMusicFirstPlay)
-{
-    levelData = &mLevelData;
-    levelStatus = LevelStatus{};
-    styleData = assets.getStyleData(levelData->packId, levelData->styleId);
-    musicData = assets.getMusicData(levelData->packId, levelData->musicId);
-    musicData.firstPlay = mMusicFirstPlay;
-}
-
 [[nodiscard]] const std::string& HexagonGame::getPackId() const noexcept
 {
-    return levelData->packId;
+    return simulation.getLevelData().packId;
 }
 
 [[nodiscard]] const std::string&
@@ -720,8 +682,10 @@ void HexagonGame::playLevelMusic()
     if(!Config::getNoMusic())
     {
         const MusicData::Segment segment =
-            musicData.playRandomSegment(getPackId(), assets);
-        status.beatPulseDelay += segment.beatPulseDelayOffset;
+            simulation.getMusicData().playRandomSegment(getPackId(), assets);
+        simulation.getStatus().beatPulseDelay += segment.beatPulseDelayOffset;
+
+        refreshLevelMusic();
     }
 }
 
@@ -729,7 +693,26 @@ void HexagonGame::playLevelMusicAtTime(float mSeconds)
 {
     if(!Config::getNoMusic())
     {
-        musicData.playSeconds(getPackId(), assets, mSeconds);
+        simulation.getMusicData().playSeconds(getPackId(), assets, mSeconds);
+        refreshLevelMusic();
+    }
+}
+
+void HexagonGame::refreshLevelMusic()
+{
+    sf::Music* current(assets.getMusicPlayer().getCurrent());
+    if(current == nullptr)
+    {
+        return;
+    }
+
+    setMusicPitch(*current);
+
+    // Music cannot follow turbo replay playback, it is resumed from the
+    // current time once a fixed speed is selected again
+    if(isReplayTurbo())
+    {
+        assets.musicPlayer.pause();
     }
 }
 
@@ -741,8 +724,26 @@ void HexagonGame::stopLevelMusic()
     }
 }
 
+void HexagonGame::resetLevelAudio()
+{
+    assets.stopSounds();
+    stopLevelMusic();
+    // assets.playSound("go.ogg");
+    if(!Config::getNoMusic())
+    {
+        playLevelMusic();
+        assets.musicPlayer.pause();
+    }
+    else
+    {
+        assets.musicPlayer.stop();
+    }
+}
+
 void HexagonGame::invalidateScore(const std::string& mReason)
 {
+    HexagonGameStatus& status = simulation.getStatus();
+
     status.scoreInvalid = true;
     status.invalidReason = mReason;
     ssvu::lo("HexagonGame::invalidateScore")
@@ -751,6 +752,8 @@ void HexagonGame::invalidateScore(const std::string& mReason)
 
 auto HexagonGame::getColorMain() const -> sf::Color
 {
+    const StyleData& styleData = simulation.getStyleData();
+
     if(Config::getBlackAndWhite())
     {
         //			if(status.drawing3D) return Color{255, 255, 255,
@@ -765,6 +768,8 @@ auto HexagonGame::getColorMain() const -> sf::Color
 
 auto HexagonGame::getColorPlayer() const -> sf::Color
 {
+    const StyleData& styleData = simulation.getStyleData();
+
     if(Config::getBlackAndWhite())
     {
         return sf::Color(255, 255, 255, styleData.getPlayerColor().a);
@@ -775,6 +780,8 @@ auto HexagonGame::getColorPlayer() const -> sf::Color
 
 auto HexagonGame::getColorText() const -> sf::Color
 {
+    const StyleData& styleData = simulation.getStyleData();
+
     if(Config::getBlackAndWhite())
     {
         return sf::Color(255, 255, 255, styleData.getTextColor().a);
@@ -783,40 +790,19 @@ auto HexagonGame::getColorText() const -> sf::Color
     return styleData.getTextColor();
 }
 
-void HexagonGame::setSides(unsigned int mSides)
-{
-    assets.playSound(levelStatus.beepSound);
-
-    if(mSides < 3)
-    {
-        mSides = 3;
-    }
-
-    levelStatus.sides = mSides;
-}
-
 [[nodiscard]] bool HexagonGame::getInputFocused() const
 {
-    // TODO: the joystick thing should be in updateInput, this should be a blind
-    // getter
-    return inputFocused || (!inReplay() && hg::Joystick::focusPressed());
-}
-
-[[nodiscard]] float HexagonGame::getPlayerSpeedMult() const
-{
-    return levelStatus.playerSpeedMult;
+    return simulation.getInputFocused();
 }
 
 [[nodiscard]] bool HexagonGame::getInputSwap() const
 {
-    // TODO: the joystick thing should be in updateInput, this should be a blind
-    // getter
-    return inputSwap || (!inReplay() && hg::Joystick::swapPressed());
+    return simulation.getInputSwap();
 }
 
 [[nodiscard]] int HexagonGame::getInputMovement() const
 {
-    return inputMovement;
+    return simulation.getInputMovement();
 }
 
 [[nodiscard]] bool HexagonGame::inReplay() const noexcept
@@ -834,9 +820,115 @@ void HexagonGame::setSides(unsigned int mSides)
     return inReplay();
 }
 
-[[nodiscard]] float HexagonGame::getSwapCooldown() const noexcept
+[[nodiscard]] bool HexagonGame::isReplayTurbo() const noexcept
+{
+    return inReplay() && replaySpeedIndex == replaySpeeds.size();
+}
+
+[[nodiscard]] float HexagonGame::getReplaySpeed() const noexcept
 {
-    return std::max(36.f * levelStatus.swapCooldownMult, 8.f);
+    if(!inReplay() || isReplayTurbo())
+    {
+        return 1.f;
+    }
+
+    return replaySpeeds[replaySpeedIndex];
+}
+
+void HexagonGame::seekReplay(std::size_t mTick)
+{
+    if(!inReplay())
+    {
+        return;
+    }
+
+    const replay_file& rf = activeReplay->replayFile;
+    mTick = std::min(mTick, rf._data.size());
+
+    const std::size_t currentTick =
+        activeReplay->replayPlayer.get_current_index();
+
+    // Jump to the nearest keyframe when going back, or when it is ahead of
+    // the current tick. Otherwise, simulate from where we are.
+    const replay_keyframes::keyframe* kf =
+        activeReplay->keyframes.find_nearest(mTick);
+
+    if(kf != nullptr && (mTick < currentTick || kf->_tick > currentTick))
+    {
+        simulation.restoreSnapshot(kf->_snapshot);
+        activeReplay->replayPlayer.seek(kf->_tick);
+    }
+    else if(mTick < currentTick)
+    {
+        // The start of the run was evicted from the ring, start over.
+        newGame(rf._pack_id, rf._level_id, rf._first_play,
+            rf._difficulty_mult, true /* executeLastReplay */);
+    }
+
+    fastForwarding = true;
+
+    while(mustReplayInput() &&
+          activeReplay->replayPlayer.get_current_index() < mTick)
+    {
+        updateTick();
+    }
+
+    fastForwarding = false;
+
+    tickAccumulator = 0.f;
+    interpolationAlpha = 1.f;
+
+    // Music cannot be rewound exactly, resume it from the current time.
+    resumeLevelMusicAtCurrentTime();
+}
+
+void HexagonGame::resumeLevelMusicAtCurrentTime()
+{
+    const HexagonGameStatus& status = simulation.getStatus();
+    if(status.started && !status.hasDied)
+    {
+        playLevelMusicAtTime(status.getTimeSeconds());
+    }
+}
+
+void HexagonGame::seekReplayBy(double mSeconds)
+{
+    if(!inReplay())
+    {
+        return;
+    }
+
+    const std::int64_t ticks = Utils::tick_clock::from_seconds(mSeconds) /
+                               HexagonSimulation::tickDuration;
+    const std::int64_t target =
+        static_cast<std::int64_t>(
+            activeReplay->replayPlayer.get_current_index()) +
+        ticks;
+
+    seekReplay(static_cast<std::size_t>(std::max<std::int64_t>(0, target)));
+}
+
+void HexagonGame::changeReplaySpeed(int mOffset)
+{
+    if(!inReplay())
+    {
+        return;
+    }
+
+    const bool wasTurbo = isReplayTurbo();
+
+    const int newIndex = static_cast<int>(replaySpeedIndex) + mOffset;
+    replaySpeedIndex = static_cast<std::size_t>(
+        std::clamp(newIndex, 0, static_cast<int>(replaySpeeds.size())));
+
+    // The music was paused during turbo playback and is now behind
+    if(wasTurbo && !isReplayTurbo())
+    {
+        resumeLevelMusicAtCurrentTime();
+        return;
+    }
+
+    refreshLevelMusic();
 }
 
 } // namespace hg
@@ -0,0 +1,1004 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Core/HexagonSimulation.hpp"
+#include "SSVOpenHexagon/Global/Assets.hpp"
+#include "SSVOpenHexagon/Utils/Utils.hpp"
+#include "SSVOpenHexagon/Utils/PointInPolygon.hpp"
+#include "SSVOpenHexagon/Utils/LuaWrapper.hpp"
+
+#include <SSVStart/Utils/Vector2.hpp>
+
+#include <SSVUtils/Core/Common/Frametime.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+using namespace hg::Utils;
+
+namespace hg
+{
+
+HexagonSimulation::HexagonSimulation(HGAssets& mAssets)
+    : assets(mAssets), player{ssvs::zeroVec2f, getSwapCooldown()}, rng{0}
+{
+}
+
+void HexagonSimulation::newGame(const std::string& mPackId,
+    const std::string& mId, bool mFirstPlay, float mDifficultyMult,
+    random_number_generator::seed_type mSeed,
+    const std::uint32_t mReplayVersion)
+{
+    const auto newGameStart = std::chrono::steady_clock::now();
+
+    packId = mPackId;
+    levelId = mId;
+    firstPlay = mFirstPlay;
+
+    setLevelData(assets.getLevelData(mId), mFirstPlay);
+    difficultyMult = mDifficultyMult;
+
+    status = HexagonGameStatus{};
+    status.setLegacyClock(mReplayVersion < replay_version_tick_clock);
+    rng = random_number_generator{mSeed};
+
+    // Events cleanup
+    message.clear();
+
+    // Event timeline cleanup
+    eventTimeline.clear();
+    eventTimelineRunner = {};
+
+    // Message timeline cleanup
+    messageTimeline.clear();
+    messageTimelineRunner = {};
+
+    // Manager cleanup
+    walls.clear();
+    cwManager.clear();
+    player = CPlayer{ssvs::zeroVec2f, getSwapCooldown()};
+
+    // Timeline cleanup
+    timeline.clear();
+    timelineRunner = {};
+    clearPatterns();
+
+    mustChangeSides = false;
+    luaErrorRaised = false;
+    rotation = 0.f;
+
+    inputMovement = 0;
+    inputFocused = inputSwap = false;
+
+    if(hooks.onNewGame)
+    {
+        hooks.onNewGame();
+    }
+
+    // LUA context cleanup
+    calledDeprecatedFunctions.clear();
+
+    lastNewGameReusedLevel = preparedLevel.has_value() &&
+                             preparedLevel->packId == mPackId &&
+                             preparedLevel->levelId == mId &&
+                             preparedLevel->difficultyMult == mDifficultyMult &&
+                             preparedLevel->firstPlay == mFirstPlay &&
+                             preparedLevel->legacyClock ==
+                                 status.getLegacyClock();
+
+    if(lastNewGameReusedLevel)
+    {
+        // Everything the level script did at load time is restored as-is
+        restoreSnapshot(preparedLevel->snapshot);
+        rng = random_number_generator{mSeed};
+    }
+    else
+    {
+        prepareLevel();
+    }
+
+    resolveLuaCallbacks();
+
+    if(!firstPlay)
+    {
+        runLuaFunction<void>("onUnload");
+    }
+
+    runLuaFunction<void>("onInit");
+    resolveLuaCallbacks();
+
+    setSides(levelStatus.sides);
+
+    // Set initial values for some status fields from Lua
+    status.beatPulseDelay += levelStatus.beatPulseInitialDelay;
+
+    // Nothing to interpolate from before the first tick
+    savePreviousState();
+
+    lastNewGameDuration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - newGameStart);
+
+    if(lastNewGameDuration > newGameBudget)
+    {
+        ssvu::lo("hg::HexagonSimulation::newGame")
+            << "Took " << lastNewGameDuration.count() << "us"
+            << (lastNewGameReusedLevel ? " (prepared level reused)" : "")
+            << ", over the " << newGameBudget.count() << "ms budget\n";
+    }
+}
+
+void HexagonSimulation::prepareLevel()
+{
+    // Snapshots and references refer to the Lua state about to be replaced
+    preparedLevel.reset();
+    luaLoadSnapshot.reset();
+    evalChunkRefs.clear();
+    luaCallbacks = LuaCallbacks{};
+    patternCoroutines.clear();
+    nextPatternId = 0;
+
+    // The previous state is closed before its arena is released
+    auto allocator = std::make_unique<Utils::LuaPoolAllocator>();
+    lua = Lua::LuaContext{&Utils::LuaPoolAllocator::luaAlloc, allocator.get()};
+    luaAllocator = std::move(allocator);
+
+    luaGCStepped = false;
+    luaTicksSinceGCStep = 0;
+    luaGCBackstopKB = luaGCMinBackstopKB;
+    luaAllocationsAtLastGCStep = 0;
+
+    if(Config::getLuaProfiler())
+    {
+        luaProfiler.attach(lua.getState());
+    }
+    else
+    {
+        luaProfiler.detach();
+    }
+
+    initLua();
+
+    const std::uint32_t rngBeforeScript = rng.fingerprint();
+    seedQueried = false;
+
+    runLuaFile(levelData->luaScriptPath);
+
+    // Most of the Lua data never changes after this point
+    luaLoadSnapshot.emplace(lua.getState());
+
+    // What a script does at load time can only be reused if it does not
+    // depend on the seed, and if it can be snapshotted
+    if(luaErrorRaised || status.hasDied || seedQueried ||
+        rng.fingerprint() != rngBeforeScript || !canMakeSnapshot())
+    {
+        return;
+    }
+
+    preparedLevel = PreparedLevel{.packId{packId},
+        .levelId{levelId},
+        .difficultyMult{difficultyMult},
+        .firstPlay{firstPlay},
+        .legacyClock{status.getLegacyClock()},
+        .snapshot{makeSnapshot()}};
+}
+
+void HexagonSimulation::discardPreparedLevel() noexcept
+{
+    preparedLevel.reset();
+}
+
+void HexagonSimulation::stepLuaGC(const int mStepKB)
+{
+    lua_State* const state = lua.getState();
+
+    // Fast and turbo replays simulate many ticks per frame, each producing
+    // its own garbage
+    const int ticks = static_cast<int>(std::clamp<std::size_t>(
+        luaTicksSinceGCStep, 1, luaGCMaxStepTicks));
+
+    luaTicksSinceGCStep = 0;
+
+    if(mStepKB <= 0)
+    {
+        if(luaGCStepped)
+        {
+            lua_gc(state, LUA_GCRESTART, 0);
+            luaGCStepped = false;
+        }
+
+        luaMemoryStats.gcStepDuration = std::chrono::microseconds{0};
+    }
+    else
+    {
+        if(!luaGCStepped)
+        {
+            lua_gc(state, LUA_GCSTOP, 0);
+            luaGCStepped = true;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        lua_gc(state, LUA_GCSTEP, mStepKB * ticks);
+
+        // Backstop in case the steps do not keep up with the level scripts
+        if(lua_gc(state, LUA_GCCOUNT, 0) > luaGCBackstopKB)
+        {
+            lua_gc(state, LUA_GCCOLLECT, 0);
+
+            luaGCBackstopKB = std::max(
+                luaGCMinBackstopKB, 2 * lua_gc(state, LUA_GCCOUNT, 0));
+        }
+
+        luaMemoryStats.gcStepDuration =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start);
+    }
+
+    if(luaAllocator == nullptr)
+    {
+        return;
+    }
+
+    const std::size_t allocations = luaAllocator->getAllocationCount();
+
+    luaMemoryStats.heapBytes = luaAllocator->getBytesInUse();
+    luaMemoryStats.allocationsPerFrame =
+        allocations - luaAllocationsAtLastGCStep;
+
+    luaAllocationsAtLastGCStep = allocations;
+}
+
+void HexagonSimulation::flushLuaProfile()
+{
+    if(!luaProfiler.isAttached() || luaProfiler.empty())
+    {
+        return;
+    }
+
+    const std::string path = "Profiles/" + packId + "_" + levelId + ".folded";
+
+    if(luaProfiler.writeAndClear(path))
+    {
+        ssvu::lo("hg::HexagonSimulation::flushLuaProfile")
+            << "Wrote Lua profile to '" << path << "'\n";
+    }
+    else
+    {
+        ssvu::lo("hg::HexagonSimulation::flushLuaProfile")
+            << "Failed to write Lua profile to '" << path << "'\n";
+    }
+}
+
+void HexagonSimulation::start()
+{
+    status.start();
+    message.clear();
+
+    runLuaFunction<void>("onLoad");
+    resolveLuaCallbacks();
+}
+
+void HexagonSimulation::luaCallbackError(
+    const LuaCallback& mCallback, const std::runtime_error& mError)
+{
+    std::cout << "[runLuaCallback] Runtime error on \"" << mCallback.name
+              << "\" with level \"" << levelData->name << "\": \n"
+              << ssvu::toStr(mError.what()) << "\n"
+              << std::endl;
+
+    raiseLuaError();
+}
+
+void HexagonSimulation::resolveLuaCallbacks()
+{
+    for(LuaCallback* c : {&luaCallbacks.onInput, &luaCallbacks.onUpdate,
+            &luaCallbacks.onStep, &luaCallbacks.onCursorSwap,
+            &luaCallbacks.onIncrement, &luaCallbacks.onDeath})
+    {
+        c->ref = lua.getFunctionRef(c->name);
+    }
+}
+
+void HexagonSimulation::step(const input_bitset& mInput, ssvu::FT mFT)
+{
+    const Utils::LuaProfiler::TickScope profilerTickScope{luaProfiler};
+
+    ++luaTicksSinceGCStep;
+    savePreviousState();
+    applyInput(mInput);
+    updateFlash(mFT);
+
+    if(!status.started)
+    {
+        return;
+    }
+
+    if(!status.hasDied)
+    {
+        player.update(*this, mFT);
+
+        const std::optional<bool> preventPlayerInput =
+            runLuaCallbackIfExists<bool>(luaCallbacks.onInput, mFT,
+                getInputMovement(), getInputFocused(), getInputSwap());
+
+        if(!preventPlayerInput.has_value() || !(*preventPlayerInput))
+        {
+            player.updateInput(*this, mFT);
+        }
+
+        player.updatePosition(*this, mFT);
+
+        status.accumulateFrametime(mFT);
+        if(levelStatus.scoreOverridden)
+        {
+            status.updateCustomScore(
+                lua.readVariable<float>(levelStatus.scoreOverride));
+        }
+        updateWalls(mFT);
+
+        walls.eraseKilled();
+
+        cwManager.cleanup();
+
+        updateEvents(mFT);
+        updateIncrement();
+
+        if(mustChangeSides && walls.empty())
+        {
+            sideChange(rng.get_int(levelStatus.sidesMin, levelStatus.sidesMax));
+        }
+
+        updateLevel(mFT);
+        updateCustomWalls(mFT);
+
+        if(Config::getBeatPulse())
+        {
+            updateBeatPulse(mFT);
+        }
+
+        if(Config::getPulse())
+        {
+            updatePulse(mFT);
+        }
+
+        if(!Config::getBlackAndWhite())
+        {
+            styleData.update(mFT, std::pow(difficultyMult, 0.8f));
+        }
+    }
+    else
+    {
+        levelStatus.rotationSpeed *= 0.99f;
+    }
+
+    if(Config::get3D())
+    {
+        update3D(mFT);
+    }
+
+    if(!Config::getNoRotation())
+    {
+        updateRotation(mFT);
+    }
+}
+
+[[nodiscard]] bool HexagonSimulation::canMakeSnapshot() const noexcept
+{
+    return patternCoroutines.empty();
+}
+
+[[nodiscard]] HexagonSimulation::Snapshot HexagonSimulation::makeSnapshot()
+{
+    assert(canMakeSnapshot());
+
+    return Snapshot{levelStatus, musicData, styleData, player, walls,
+        cwManager, timeline, timelineRunner, eventTimeline,
+        eventTimelineRunner, messageTimeline, messageTimelineRunner,
+        nextPatternId, rng, status, message, rotation, lastRotation,
+        mustChangeSides, inputMovement, inputFocused, inputSwap,
+        Utils::LuaSnapshot{lua.getState(),
+            luaLoadSnapshot.has_value() ? &*luaLoadSnapshot : nullptr}};
+}
+
+void HexagonSimulation::restoreSnapshot(const Snapshot& mSnapshot)
+{
+    assert(mSnapshot.luaSnapshot.getState() == lua.getState());
+
+    levelStatus = mSnapshot.levelStatus;
+    musicData = mSnapshot.musicData;
+    styleData = mSnapshot.styleData;
+
+    player = mSnapshot.player;
+    walls = mSnapshot.walls;
+    cwManager = mSnapshot.cwManager;
+
+    timeline = mSnapshot.timeline;
+    timelineRunner = mSnapshot.timelineRunner;
+    eventTimeline = mSnapshot.eventTimeline;
+    eventTimelineRunner = mSnapshot.eventTimelineRunner;
+    messageTimeline = mSnapshot.messageTimeline;
+    messageTimelineRunner = mSnapshot.messageTimelineRunner;
+
+    // None of the patterns alive now existed when the snapshot was taken
+    assert(runningPattern == nullptr);
+    patternCoroutines.clear();
+    nextPatternId = mSnapshot.nextPatternId;
+    patternWait.reset();
+
+    rng = mSnapshot.rng;
+    status = mSnapshot.status;
+    message = mSnapshot.message;
+
+    rotation = mSnapshot.rotation;
+    lastRotation = mSnapshot.lastRotation;
+    mustChangeSides = mSnapshot.mustChangeSides;
+
+    inputMovement = mSnapshot.inputMovement;
+    inputFocused = mSnapshot.inputFocused;
+    inputSwap = mSnapshot.inputSwap;
+
+    mSnapshot.luaSnapshot.restore();
+
+    // Globals might have been reassigned since the snapshot was taken
+    resolveLuaCallbacks();
+}
+
+void HexagonSimulation::savePreviousState() noexcept
+{
+    lastRotation = rotation;
+    player.savePreviousState();
+    walls.savePreviousState();
+}
+
+void HexagonSimulation::applyInput(const input_bitset& mInput) noexcept
+{
+    if(mInput[static_cast<unsigned int>(input_bit::left)])
+    {
+        inputMovement = -1;
+    }
+    else if(mInput[static_cast<unsigned int>(input_bit::right)])
+    {
+        inputMovement = 1;
+    }
+    else
+    {
+        inputMovement = 0;
+    }
+
+    inputSwap = mInput[static_cast<unsigned int>(input_bit::swap)];
+    inputFocused = mInput[static_cast<unsigned int>(input_bit::focus)];
+}
+
+void HexagonSimulation::updateWalls(ssvu::FT mFT)
+{
+    cwManager.forCustomWalls([&](const CCustomWall& customWall) {
+        // After *only* the player has moved, push in case of overlap.
+        if(customWall.isOverlapping(player.getPosition()))
+        {
+            if(player.getJustSwapped())
+            {
+                player.kill(*this);
+                unlockAchievement("a22_swapdeath");
+            }
+            else
+            {
+                if(player.push(*this, customWall, mFT))
+                {
+                    player.kill(*this);
+                }
+            }
+        }
+    });
+
+    // Wall movement does not depend on the player, so it is computed for all
+    // the walls at once. Collisions are still resolved one wall at a time.
+    walls.updateSpeeds(mFT);
+    walls.moveTowardsCenter(centerPos, getRadius() * 0.65f);
+    walls.rotateAroundCenter(centerPos);
+
+    const auto isOverlapping = [&](const WallBuffer::Vertices& mVertices) {
+        return Utils::pointInPolygon(
+            mVertices, player.getPosition().x, player.getPosition().y);
+    };
+
+    // Walls spawned by death hooks during the loop are moved next tick.
+    for(std::size_t i = 0; i < walls.getMovedCount(); ++i)
+    {
+        // After *only* the player has moved, push in case of overlap.
+        const WallBuffer::Vertices vertices = walls.getVertexPositions(i);
+        if(isOverlapping(vertices))
+        {
+            if(player.getJustSwapped())
+            {
+                player.kill(*this);
+                unlockAchievement("a22_swapdeath");
+            }
+            else
+            {
+                if(player.push(*this, vertices, walls.getCurveSpeed(i), mFT))
+                {
+                    player.kill(*this);
+                }
+            }
+        }
+
+        // A death hook might have removed all the walls.
+        if(i >= walls.getMovedCount())
+        {
+            break;
+        }
+
+        // Move the wall towards the center. Overlap means sure death.
+        if(isOverlapping(walls.getMoved(i)))
+        {
+            player.kill(*this);
+        }
+
+        if(i >= walls.getMovedCount())
+        {
+            break;
+        }
+
+        // Curve the wall. If an overlap happens, the player must be pushed.
+        const WallBuffer::Vertices curved = walls.getCurved(i);
+        if(isOverlapping(curved))
+        {
+            if(player.push(*this, curved, walls.getCurveSpeed(i), mFT))
+            {
+                player.kill(*this);
+            }
+        }
+    }
+
+    walls.applyMovement();
+
+    // If there's still an overlap after collision resolution, kill the player.
+    for(std::size_t i = 0; i < walls.size(); ++i)
+    {
+        if(isOverlapping(walls.getVertexPositions(i)))
+        {
+            player.kill(*this);
+        }
+    }
+}
+
+void HexagonSimulation::updateCustomWalls(ssvu::FT mFT)
+{
+    (void)mFT;
+
+    const bool customWallCollision =
+        cwManager.anyCustomWall([&](const CCustomWall& customWall) {
+            return customWall.isOverlapping(player.getPosition());
+        });
+
+    if(customWallCollision)
+    {
+        player.kill(*this);
+    }
+}
+
+void HexagonSimulation::updateEvents(ssvu::FT)
+{
+    if(const auto o =
+            eventTimelineRunner.update(eventTimeline, status.getTimeTP());
+        o == hg::Utils::timeline2_runner::outcome::finished)
+    {
+        eventTimeline.clear();
+        eventTimelineRunner = {};
+    }
+
+    if(const auto o = messageTimelineRunner.update(
+           messageTimeline, status.getCurrentTP());
+        o == hg::Utils::timeline2_runner::outcome::finished)
+    {
+        messageTimeline.clear();
+        messageTimelineRunner = {};
+    }
+}
+
+void HexagonSimulation::updateIncrement()
+{
+    if(!levelStatus.incEnabled)
+    {
+        return;
+    }
+
+    if(status.getIncrementTimeSeconds() < levelStatus.incTime)
+    {
+        return;
+    }
+
+    ++levelStatus.currentIncrements;
+    incrementDifficulty();
+    status.resetIncrementTime();
+    mustChangeSides = true;
+}
+
+void HexagonSimulation::updateLevel(ssvu::FT mFT)
+{
+    if(status.isTimePaused())
+    {
+        return;
+    }
+
+    runLuaCallback<float>(luaCallbacks.onUpdate, mFT);
+
+    const auto o = timelineRunner.update(timeline, status.getTimeTP());
+
+    if(o == hg::Utils::timeline2_runner::outcome::finished && !mustChangeSides)
+    {
+        timeline.clear();
+        clearPatterns();
+        runLuaCallback<void>(luaCallbacks.onStep);
+        timelineRunner = {};
+    }
+}
+
+void HexagonSimulation::updatePulse(ssvu::FT mFT)
+{
+    if(status.pulseDelay <= 0 && status.pulseDelayHalf <= 0)
+    {
+        float pulseAdd{status.pulseDirection > 0 ? levelStatus.pulseSpeed
+                                                 : -levelStatus.pulseSpeedR};
+        float pulseLimit{status.pulseDirection > 0 ? levelStatus.pulseMax
+                                                   : levelStatus.pulseMin};
+
+        status.pulse += pulseAdd * mFT * getMusicDMSyncFactor();
+        if((status.pulseDirection > 0 && status.pulse >= pulseLimit) ||
+            (status.pulseDirection < 0 && status.pulse <= pulseLimit))
+        {
+            status.pulse = pulseLimit;
+            status.pulseDirection *= -1;
+            status.pulseDelayHalf = levelStatus.pulseDelayHalfMax;
+            if(status.pulseDirection < 0)
+            {
+                status.pulseDelay = levelStatus.pulseDelayMax;
+            }
+        }
+    }
+
+    status.pulseDelay -= mFT;
+    status.pulseDelayHalf -= mFT;
+}
+
+void HexagonSimulation::updateBeatPulse(ssvu::FT mFT)
+{
+    if(status.beatPulseDelay <= 0)
+    {
+        status.beatPulse = levelStatus.beatPulseMax;
+        status.beatPulseDelay = levelStatus.beatPulseDelayMax;
+    }
+    else
+    {
+        status.beatPulseDelay -= 1 * mFT * getMusicDMSyncFactor();
+    }
+
+    if(status.beatPulse > 0)
+    {
+        status.beatPulse -= (2.f * mFT * getMusicDMSyncFactor()) *
+                            levelStatus.beatPulseSpeedMult;
+    }
+
+    float radiusMin{Config::getBeatPulse() ? levelStatus.radiusMin : 75};
+    status.radius =
+        radiusMin * (status.pulse / levelStatus.pulseMin) + status.beatPulse;
+}
+
+void HexagonSimulation::updateRotation(ssvu::FT mFT)
+{
+    auto nextRotation(getRotationSpeed() * 10.f);
+    if(status.fastSpin > 0)
+    {
+        nextRotation +=
+            std::abs((ssvu::getSmootherStep(
+                          0, levelStatus.fastSpin, status.fastSpin) /
+                         3.5f) *
+                     17.f) *
+            ssvu::getSign(nextRotation);
+        status.fastSpin -= mFT;
+    }
+
+    setRotation(rotation + nextRotation);
+}
+
+void HexagonSimulation::updateFlash(ssvu::FT mFT)
+{
+    if(status.flashEffect > 0)
+    {
+        status.flashEffect -= 3 * mFT;
+    }
+
+    status.flashEffect = ssvu::getClamped(status.flashEffect, 0.f, 255.f);
+}
+
+void HexagonSimulation::update3D(ssvu::FT mFT)
+{
+    status.pulse3D += styleData._3dPulseSpeed * status.pulse3DDirection * mFT;
+    if(status.pulse3D > styleData._3dPulseMax)
+    {
+        status.pulse3DDirection = -1;
+    }
+    else if(status.pulse3D < styleData._3dPulseMin)
+    {
+        status.pulse3DDirection = 1;
+    }
+}
+
+void HexagonSimulation::setRotation(float mDegrees) noexcept
+{
+    // Same normalization as `sf::View::setRotation`.
+    rotation = std::fmod(mDegrees, 360.f);
+    if(rotation < 0.f)
+    {
+        rotation += 360.f;
+    }
+}
+
+[[nodiscard]] float HexagonSimulation::getInterpolatedRotation(
+    float mAlpha) const noexcept
+{
+    const float diff = std::remainder(rotation - lastRotation, 360.f);
+    const float result = std::fmod(lastRotation + diff * mAlpha, 360.f);
+
+    return result < 0.f ? result + 360.f : result;
+}
+
+void HexagonSimulation::death(bool mForce)
+{
+    if(status.hasDied)
+    {
+        return;
+    }
+
+    if(hooks.onPreDeath)
+    {
+        hooks.onPreDeath();
+    }
+
+    if(!mForce && (Config::getInvincible() || levelStatus.tutorialMode))
+    {
+        return;
+    }
+
+    runLuaCallbackIfExists<void>(luaCallbacks.onDeath);
+
+    status.flashEffect = 255;
+    status.hasDied = true;
+
+    if(hooks.onDeath)
+    {
+        hooks.onDeath();
+    }
+}
+
+void HexagonSimulation::createWall(int mSide, float mThickness,
+    const SpeedData& mSpeed, const SpeedData& mCurve, float mHueMod)
+{
+    const float distance{Config::getSpawnDistance()};
+    const float div{ssvu::tau / getSides() * 0.5f};
+    const float angle{div * 2.f * mSide};
+
+    WallBuffer::Vertices vertexPositions;
+    vertexPositions[0] = ssvs::getOrbitRad(centerPos, angle - div, distance);
+    vertexPositions[1] = ssvs::getOrbitRad(centerPos, angle + div, distance);
+    vertexPositions[2] = ssvs::getOrbitRad(centerPos,
+        angle + div + getWallAngleLeft(),
+        distance + mThickness + getWallSkewLeft());
+    vertexPositions[3] = ssvs::getOrbitRad(centerPos,
+        angle - div + getWallAngleRight(),
+        distance + mThickness + getWallSkewRight());
+
+    walls.add(vertexPositions, mSpeed, mCurve, mHueMod);
+}
+
+void HexagonSimulation::incrementDifficulty()
+{
+    playSound("levelUp.ogg");
+
+    const float signMult = (levelStatus.rotationSpeed > 0.f) ? 1.f : -1.f;
+
+    levelStatus.rotationSpeed += levelStatus.rotationSpeedInc * signMult;
+
+    const auto& rotationSpeedMax(levelStatus.rotationSpeedMax);
+    if(std::abs(levelStatus.rotationSpeed) > rotationSpeedMax)
+    {
+        levelStatus.rotationSpeed = rotationSpeedMax * signMult;
+    }
+
+    levelStatus.rotationSpeed *= -1.f;
+    status.fastSpin = levelStatus.fastSpin;
+}
+
+void HexagonSimulation::sideChange(unsigned int mSideNumber)
+{
+    levelStatus.speedMult += levelStatus.speedInc;
+    levelStatus.delayMult += levelStatus.delayInc;
+
+    if(levelStatus.rndSideChangesEnabled)
+    {
+        setSides(mSideNumber);
+    }
+
+    mustChangeSides = false;
+
+    playSound(levelStatus.levelUpSound);
+    runLuaCallback<void>(luaCallbacks.onIncrement);
+}
+
+void HexagonSimulation::setSides(unsigned int mSides)
+{
+    playSound(levelStatus.beepSound);
+
+    if(mSides < 3)
+    {
+        mSides = 3;
+    }
+
+    levelStatus.sides = mSides;
+}
+
+void HexagonSimulation::raiseWarning(
+    const std::string& mFunctionName, const std::string& mAdditionalInfo)
+{
+    // Only raise the warning once to avoid redundancy
+    if(!calledDeprecatedFunctions.contains(mFunctionName))
+    {
+        calledDeprecatedFunctions.emplace(mFunctionName);
+        // Raise warning to the console
+        std::cout << "[Lua] WARNING: The function \"" << mFunctionName
+                  << "\" (used in level \"" << levelData->name
+                  << "\") is deprecated. " << mAdditionalInfo << std::endl;
+    }
+}
+
+void HexagonSimulation::raiseLuaError()
+{
+    luaErrorRaised = true;
+
+    if(!Config::getDebug() && hooks.onLuaError)
+    {
+        hooks.onLuaError();
+    }
+}
+
+void HexagonSimulation::addMessage(
+    std::string mMessage, double mDuration, bool mSoundToggle)
+{
+    Utils::uppercasify(mMessage);
+
+    messageTimeline.append_do([this, mSoundToggle, mMessage] {
+        if(mSoundToggle)
+        {
+            playSound(levelStatus.beepSound);
+        }
+        message = mMessage;
+    });
+
+    messageTimeline.append_wait_for(status.getWaitFromFrametime(mDuration));
+    messageTimeline.append_do([this] { message.clear(); });
+}
+
+void HexagonSimulation::clearMessages()
+{
+    messageTimeline.clear();
+}
+
+void HexagonSimulation::setLevelData(
+    const LevelData& mLevelData, bool mMusicFirstPlay)
+{
+    levelData = &mLevelData;
+    levelStatus = LevelStatus{};
+    styleData = assets.getStyleData(levelData->packId, levelData->styleId);
+    musicData = assets.getMusicData(levelData->packId, levelData->musicId);
+    musicData.firstPlay = mMusicFirstPlay;
+}
+
+void HexagonSimulation::playLevelMusic()
+{
+    if(hooks.playLevelMusic)
+    {
+        hooks.playLevelMusic();
+    }
+}
+
+void HexagonSimulation::playLevelMusicAtTime(float mSeconds)
+{
+    if(hooks.playLevelMusicAtTime)
+    {
+        hooks.playLevelMusicAtTime(mSeconds);
+    }
+}
+
+void HexagonSimulation::stopLevelMusic()
+{
+    if(hooks.stopLevelMusic)
+    {
+        hooks.stopLevelMusic();
+    }
+}
+
+void HexagonSimulation::refreshMusicPitch()
+{
+    if(hooks.refreshMusicPitch)
+    {
+        hooks.refreshMusicPitch();
+    }
+}
+
+void HexagonSimulation::playSound(const std::string& mId)
+{
+    if(hooks.playSound)
+    {
+        hooks.playSound(mId);
+    }
+}
+
+void HexagonSimulation::playPackSound(
+    const std::string& mPackId, const std::string& mId)
+{
+    if(hooks.playPackSound)
+    {
+        hooks.playPackSound(mPackId, mId);
+    }
+}
+
+void HexagonSimulation::unlockAchievement(const std::string& mId)
+{
+    if(hooks.unlockAchievement)
+    {
+        hooks.unlockAchievement(mId);
+    }
+}
+
+[[nodiscard]] float HexagonSimulation::getSwapCooldown() const noexcept
+{
+    return std::max(36.f * levelStatus.swapCooldownMult, 8.f);
+}
+
+[[nodiscard]] double HexagonSimulation::getReplayScore() const noexcept
+{
+    return status.getCustomScore() != 0.f
+               ? status.getCustomScore()
+               : status.getPlayedAccumulatedFrametime();
+}
+
+[[nodiscard]] std::uint32_t HexagonSimulation::computeStateHash() const noexcept
+{
+    // FNV-1a over the bit patterns of the hashed values
+    std::uint32_t hash{2166136261u};
+
+    const auto add = [&](const auto& value) {
+        unsigned char bytes[sizeof(value)];
+        std::memcpy(bytes, &value, sizeof(value));
+
+        for(const unsigned char b : bytes)
+        {
+            hash = (hash ^ b) * 16777619u;
+        }
+    };
+
+    add(player.getPosition().x);
+    add(player.getPosition().y);
+    add(player.getPlayerAngle());
+    add(status.getPlayedAccumulatedFrametime());
+    add(rng.fingerprint());
+    add(static_cast<std::uint32_t>(walls.size()));
+
+    for(std::size_t i = 0; i < walls.size(); ++i)
+    {
+        for(const sf::Vector2f& v : walls.getVertexPositions(i))
+        {
+            add(v.x);
+            add(v.y);
+        }
+    }
+
+    return hash;
+}
+
+} // namespace hg
@@ -0,0 +1,208 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Core/MappedReplay.hpp"
+
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+namespace hg
+{
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+[[nodiscard]] bool mapped_file::open(const std::filesystem::path& p)
+{
+    close();
+
+    const HANDLE file = CreateFileW(p.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    _file_handle = file;
+
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(file, &file_size))
+    {
+        close();
+        return false;
+    }
+
+    // Empty files cannot be mapped
+    if(file_size.QuadPart == 0)
+    {
+        return true;
+    }
+
+    const HANDLE mapping =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if(mapping == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    _mapping_handle = mapping;
+
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(view == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    _data = static_cast<const std::byte*>(view);
+    _size = static_cast<std::size_t>(file_size.QuadPart);
+    return true;
+}
+
+void mapped_file::close() noexcept
+{
+    if(_data != nullptr)
+    {
+        UnmapViewOfFile(_data);
+    }
+
+    if(_mapping_handle != nullptr)
+    {
+        CloseHandle(_mapping_handle);
+    }
+
+    if(_file_handle != nullptr)
+    {
+        CloseHandle(_file_handle);
+    }
+
+    _data = nullptr;
+    _size = 0;
+    _mapping_handle = nullptr;
+    _file_handle = nullptr;
+}
+
+#else
+
+[[nodiscard]] bool mapped_file::open(const std::filesystem::path& p)
+{
+    close();
+
+    const int fd = ::open(p.c_str(), O_RDONLY);
+    if(fd == -1)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if(::fstat(fd, &st) == -1)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // Empty files cannot be mapped
+    if(st.st_size == 0)
+    {
+        ::close(fd);
+        return true;
+    }
+
+    void* const view = ::mmap(nullptr, static_cast<std::size_t>(st.st_size),
+        PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping stays valid after closing the descriptor
+    ::close(fd);
+
+    if(view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    _data = static_cast<const std::byte*>(view);
+    _size = static_cast<std::size_t>(st.st_size);
+    return true;
+}
+
+void mapped_file::close() noexcept
+{
+    if(_data != nullptr)
+    {
+        ::munmap(const_cast<std::byte*>(_data), _size);
+    }
+
+    _data = nullptr;
+    _size = 0;
+}
+
+#endif
+
+[[nodiscard]] const std::byte* mapped_file::data() const noexcept
+{
+    return _data;
+}
+
+[[nodiscard]] std::size_t mapped_file::size() const noexcept
+{
+    return _size;
+}
+
+[[nodiscard]] bool mapped_replay_file::open(const std::filesystem::path& p)
+{
+    _inputs = packed_inputs{};
+
+    if(!_file.open(p))
+    {
+        return false;
+    }
+
+    const std::byte* const begin = _file.data();
+    return static_cast<bool>(
+        _replay_file.deserialize_view(begin, begin + _file.size(), _inputs));
+}
+
+[[nodiscard]] const replay_file&
+mapped_replay_file::get_replay_file() const noexcept
+{
+    return _replay_file;
+}
+
+[[nodiscard]] std::size_t mapped_replay_file::size() const noexcept
+{
+    return _replay_file._compressed ? _replay_file._data.size()
+                                    : _inputs._size;
+}
+
+[[nodiscard]] replay_player mapped_replay_file::make_player() const noexcept
+{
+    return _replay_file._compressed ? replay_player{_replay_file._data}
+                                    : replay_player{_inputs};
+}
+
+} // namespace hg
@@ -23,4 +23,11 @@ random_number_generator::seed() const noexcept
     return _seed;
 }
 
+[[nodiscard]] std::uint32_t
+random_number_generator::fingerprint() const noexcept
+{
+    pcg32_fast copy = _rng;
+    return static_cast<std::uint32_t>(copy());
+}
+
 } // namespace hg
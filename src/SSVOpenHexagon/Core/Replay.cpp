@@ -4,9 +4,15 @@
 
 #include "SSVOpenHexagon/Core/Replay.hpp"
 
+#include "SSVOpenHexagon/Online/Compression.hpp"
+
+#include <algorithm>
 #include <cassert>
 #include <fstream>
+#include <limits>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
 
 namespace hg
 {
@@ -56,33 +62,129 @@ static auto make_read(deserialization_result& result, const std::byte*& buffer,
     };
 }
 
-void replay_data::record_input(const bool left, const bool right,
-    const bool swap, const bool focus) noexcept
+[[nodiscard]] input_bitset make_input_bitset(const bool left,
+    const bool right, const bool swap, const bool focus) noexcept
 {
-    input_bitset& ib = _inputs.emplace_back();
+    input_bitset ib;
     ib[static_cast<unsigned int>(input_bit::left)] = left;
     ib[static_cast<unsigned int>(input_bit::right)] = right;
     ib[static_cast<unsigned int>(input_bit::swap)] = swap;
     ib[static_cast<unsigned int>(input_bit::focus)] = focus;
+    return ib;
+}
+
+void replay_data::append_run(
+    const std::uint8_t input, const std::size_t count)
+{
+    if(count == 0)
+    {
+        return;
+    }
+
+    const auto new_end = static_cast<std::uint32_t>(size() + count);
+
+    if(!_run_inputs.empty() && _run_inputs.back() == input)
+    {
+        _run_ends.back() = new_end;
+        return;
+    }
+
+    _run_ends.emplace_back(new_end);
+    _run_inputs.emplace_back(input);
+}
+
+void replay_data::record_input(const bool left, const bool right,
+    const bool swap, const bool focus) noexcept
+{
+    append_run(static_cast<std::uint8_t>(
+                   make_input_bitset(left, right, swap, focus).to_ulong()),
+        1);
 }
 
 [[nodiscard]] input_bitset replay_data::at(
     const std::size_t index) const noexcept
+{
+    return run_input(run_containing(index));
+}
+
+[[nodiscard]] std::size_t replay_data::run_containing(
+    const std::size_t index) const noexcept
 {
     assert(index < size());
-    return _inputs[index];
+
+    const auto it =
+        std::upper_bound(_run_ends.begin(), _run_ends.end(), index);
+
+    return static_cast<std::size_t>(it - _run_ends.begin());
+}
+
+[[nodiscard]] std::size_t replay_data::run_end(
+    const std::size_t run) const noexcept
+{
+    assert(run < run_count());
+    return _run_ends[run];
+}
+
+[[nodiscard]] input_bitset replay_data::run_input(
+    const std::size_t run) const noexcept
+{
+    assert(run < run_count());
+    return input_bitset{static_cast<unsigned long>(_run_inputs[run])};
 }
 
 [[nodiscard]] std::size_t replay_data::size() const noexcept
 {
-    return _inputs.size();
+    return _run_ends.empty() ? 0 : _run_ends.back();
+}
+
+[[nodiscard]] std::size_t replay_data::run_count() const noexcept
+{
+    return _run_ends.size();
+}
+
+void replay_data::append(const replay_data& rhs)
+{
+    std::size_t run_begin = 0;
+    for(std::size_t i = 0; i < rhs._run_ends.size(); ++i)
+    {
+        append_run(rhs._run_inputs[i], rhs._run_ends[i] - run_begin);
+        run_begin = rhs._run_ends[i];
+    }
 }
 
+[[nodiscard]] replay_data replay_data::slice(
+    const std::size_t begin, const std::size_t end) const
+{
+    replay_data result;
+
+    const std::size_t clamped_end = std::min(end, size());
+    if(begin >= clamped_end)
+    {
+        return result;
+    }
+
+    auto i = static_cast<std::size_t>(
+        std::upper_bound(_run_ends.begin(), _run_ends.end(), begin) -
+        _run_ends.begin());
+
+    std::size_t run_begin = begin;
+    for(; run_begin < clamped_end; ++i)
+    {
+        const std::size_t run_end = std::min<std::size_t>(
+            _run_ends[i], clamped_end);
+
+        result.append_run(_run_inputs[i], run_end - run_begin);
+        run_begin = run_end;
+    }
+
+    return result;
+}
 
 [[nodiscard]] bool replay_data::operator==(
     const replay_data& rhs) const noexcept
 {
-    return _inputs == rhs._inputs;
+    // Adjacent runs are always merged, so the representation is unique
+    return _run_ends == rhs._run_ends && _run_inputs == rhs._run_inputs;
 }
 
 [[nodiscard]] bool replay_data::operator!=(
@@ -91,98 +193,556 @@ void replay_data::record_input(const bool left, const bool right,
     return !(*this == rhs);
 }
 
-[[nodiscard]] serialization_result replay_data::serialize(
-    std::byte* buffer, const std::size_t buffer_size) const
+[[nodiscard]] serialization_result replay_data::serialize(std::byte* buffer,
+    const std::size_t buffer_size, const std::uint32_t version) const
 {
-    return serialize(buffer, buffer + buffer_size);
+    return serialize(buffer, buffer + buffer_size, version);
 }
 
 [[nodiscard]] deserialization_result replay_data::deserialize(
-    const std::byte* buffer, const std::size_t buffer_size)
+    const std::byte* buffer, const std::size_t buffer_size,
+    const std::uint32_t version)
 {
-    return deserialize(buffer, buffer + buffer_size);
+    return deserialize(buffer, buffer + buffer_size, version);
 }
 
-[[nodiscard]] serialization_result replay_data::serialize(
-    std::byte* buffer, const std::byte* const buffer_end) const
+// Packed (v1) input encoding. After the input count, the body is a sequence
+// of tokens, each starting with a tag byte:
+// * `0b1000'iiii`, then a varint `n`: input `i` repeated `n + min_run` times.
+// * `0b0nnn'nnnn`: `n + 1` literal inputs follow, two per byte (low nibble
+//   first).
+static constexpr std::uint8_t packed_run_flag{0x80};
+static constexpr std::size_t packed_min_run{4};
+static constexpr std::size_t packed_max_literals{128};
+
+// Walks the input data starting at `pos` (an input count and its inputs)
+// without decoding it, validating it like `replay_data::deserialize`. On
+// success, `pos` is moved past it and `n_inputs` is set.
+[[nodiscard]] static bool scan_inputs(const std::byte*& pos,
+    const std::byte* const end, const std::uint32_t version,
+    std::uint64_t& n_inputs) noexcept
+{
+    const auto remaining = [&] {
+        return static_cast<std::size_t>(end - pos);
+    };
+
+    if(remaining() < sizeof(std::uint64_t))
+    {
+        return false;
+    }
+
+    std::memcpy(&n_inputs, pos, sizeof(std::uint64_t));
+    pos += sizeof(std::uint64_t);
+
+    if(version < replay_version_packed)
+    {
+        if(n_inputs > remaining())
+        {
+            return false;
+        }
+
+        // Only the four input bits can be set
+        for(const std::byte* const inputs_end = pos + n_inputs;
+            pos != inputs_end; ++pos)
+        {
+            if(static_cast<std::uint8_t>(*pos) > 0x0F)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    if(n_inputs > std::numeric_limits<std::uint32_t>::max())
+    {
+        return false;
+    }
+
+    std::uint64_t scanned = 0;
+    while(scanned < n_inputs)
+    {
+        if(remaining() < 1)
+        {
+            return false;
+        }
+
+        const auto tag = static_cast<std::uint8_t>(*pos++);
+
+        if(tag & packed_run_flag)
+        {
+            std::uint64_t varint = 0;
+            std::uint8_t byte;
+            unsigned int shift = 0;
+
+            do
+            {
+                if(shift >= 35 || remaining() < 1)
+                {
+                    return false;
+                }
+
+                byte = static_cast<std::uint8_t>(*pos++);
+                varint |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                shift += 7;
+            } while(byte & 0x80);
+
+            const std::uint64_t run_length = varint + packed_min_run;
+            if(run_length > n_inputs - scanned)
+            {
+                return false;
+            }
+
+            scanned += run_length;
+            continue;
+        }
+
+        const std::size_t n_literals = tag + 1;
+        const std::size_t n_bytes = (n_literals + 1) / 2;
+
+        if(n_literals > n_inputs - scanned || n_bytes > remaining())
+        {
+            return false;
+        }
+
+        pos += n_bytes;
+        scanned += n_literals;
+    }
+
+    return true;
+}
+
+[[nodiscard]] serialization_result replay_data::serialize(std::byte* buffer,
+    const std::byte* const buffer_end, const std::uint32_t version) const
 {
     serialization_result result;
     const auto write = make_write(result, buffer, buffer_end);
 
-    const std::size_t n_inputs = _inputs.size();
+    if(version < replay_version_packed)
+    {
+        const std::size_t n_inputs = size();
+        SSVOH_TRY(write(n_inputs));
+
+        std::size_t run_begin = 0;
+        for(std::size_t i = 0; i < _run_ends.size(); ++i)
+        {
+            for(std::size_t j = run_begin; j < _run_ends[i]; ++j)
+            {
+                SSVOH_TRY(write(_run_inputs[i]));
+            }
+
+            run_begin = _run_ends[i];
+        }
+
+        return result;
+    }
+
+    const std::uint64_t n_inputs = size();
     SSVOH_TRY(write(n_inputs));
 
-    for(const input_bitset& ib : _inputs)
+    std::uint8_t literals[packed_max_literals];
+    std::size_t n_literals = 0;
+
+    const auto flush_literals = [&] {
+        if(n_literals == 0)
+        {
+            return result;
+        }
+
+        SSVOH_TRY(write(static_cast<std::uint8_t>(n_literals - 1)));
+
+        for(std::size_t i = 0; i < n_literals; i += 2)
+        {
+            const std::uint8_t high = i + 1 < n_literals ? literals[i + 1] : 0;
+            const auto packed =
+                static_cast<std::uint8_t>(literals[i] | high << 4);
+            SSVOH_TRY(write(packed));
+        }
+
+        n_literals = 0;
+        return result;
+    };
+
+    std::size_t run_begin = 0;
+    for(std::size_t i = 0; i < _run_ends.size(); ++i)
     {
-        // TODO: optimize! only need 4 bits
-        const std::uint8_t ib_byte = ib.to_ulong();
-        SSVOH_TRY(write(ib_byte));
+        const std::size_t run_length = _run_ends[i] - run_begin;
+        run_begin = _run_ends[i];
+
+        if(run_length < packed_min_run)
+        {
+            for(std::size_t j = 0; j < run_length; ++j)
+            {
+                literals[n_literals++] = _run_inputs[i];
+
+                if(n_literals == packed_max_literals)
+                {
+                    SSVOH_TRY(flush_literals());
+                }
+            }
+
+            continue;
+        }
+
+        SSVOH_TRY(flush_literals());
+        SSVOH_TRY(write(
+            static_cast<std::uint8_t>(packed_run_flag | _run_inputs[i])));
+
+        std::uint64_t varint = run_length - packed_min_run;
+        while(varint >= 0x80)
+        {
+            SSVOH_TRY(write(static_cast<std::uint8_t>(varint | 0x80)));
+            varint >>= 7;
+        }
+
+        SSVOH_TRY(write(static_cast<std::uint8_t>(varint)));
     }
 
+    SSVOH_TRY(flush_literals());
     return result;
 }
 
 [[nodiscard]] deserialization_result replay_data::deserialize(
-    const std::byte* buffer, const std::byte* const buffer_end)
+    const std::byte* buffer, const std::byte* const buffer_end,
+    const std::uint32_t version)
 {
     deserialization_result result;
     const auto read = make_read(result, buffer, buffer_end);
 
-    std::size_t n_inputs;
+    _run_ends.clear();
+    _run_inputs.clear();
+
+    const auto fail = [&] {
+        result._success = false;
+        return result;
+    };
+
+    if(version < replay_version_packed)
+    {
+        std::size_t n_inputs;
+        SSVOH_TRY(read(n_inputs));
+
+        if(n_inputs > static_cast<std::size_t>(buffer_end - buffer))
+        {
+            return fail();
+        }
+
+        for(std::size_t i = 0; i < n_inputs; ++i)
+        {
+            std::uint8_t ib_byte;
+            SSVOH_TRY(read(ib_byte));
+
+            // Only the four input bits can be set
+            if(ib_byte > 0x0F)
+            {
+                return fail();
+            }
+
+            append_run(ib_byte, 1);
+        }
+
+        return result;
+    }
+
+    std::uint64_t n_inputs;
     SSVOH_TRY(read(n_inputs));
 
-    _inputs.resize(n_inputs);
+    if(n_inputs > std::numeric_limits<std::uint32_t>::max())
+    {
+        return fail();
+    }
 
-    for(std::size_t i = 0; i < n_inputs; ++i)
+    while(size() < n_inputs)
     {
-        std::uint8_t ib_byte;
-        SSVOH_TRY(read(ib_byte));
+        std::uint8_t tag;
+        SSVOH_TRY(read(tag));
+
+        if(tag & packed_run_flag)
+        {
+            std::uint64_t varint = 0;
+            std::uint8_t byte;
+            unsigned int shift = 0;
+
+            do
+            {
+                if(shift >= 35)
+                {
+                    return fail();
+                }
+
+                SSVOH_TRY(read(byte));
+                varint |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                shift += 7;
+            } while(byte & 0x80);
+
+            const std::uint64_t run_length = varint + packed_min_run;
+            if(run_length > n_inputs - size())
+            {
+                return fail();
+            }
+
+            append_run(tag & 0x0F, run_length);
+            continue;
+        }
 
-        _inputs[i] = input_bitset{static_cast<unsigned long>(ib_byte)};
+        const std::size_t n_literals = tag + 1;
+        if(n_literals > n_inputs - size())
+        {
+            return fail();
+        }
+
+        for(std::size_t i = 0; i < n_literals; i += 2)
+        {
+            std::uint8_t byte;
+            SSVOH_TRY(read(byte));
+
+            append_run(byte & 0x0F, 1);
+
+            if(i + 1 < n_literals)
+            {
+                append_run(byte >> 4, 1);
+            }
+        }
     }
 
     return result;
 }
 
+packed_input_cursor::packed_input_cursor(const packed_inputs& inputs) noexcept
+    : _inputs{inputs}
+{
+    reset();
+}
+
+void packed_input_cursor::load_run() noexcept
+{
+    // Only called within the first `_inputs._size` inputs, whose bytes were
+    // validated when creating the view.
+    while(true)
+    {
+        if(_literals_left > 0)
+        {
+            const auto byte = static_cast<std::uint8_t>(*_pos);
+
+            if(_high_nibble)
+            {
+                _run_input = byte >> 4;
+                _high_nibble = false;
+                ++_pos;
+            }
+            else
+            {
+                _run_input = byte & 0x0F;
+                _high_nibble = _literals_left > 1;
+                _pos += _high_nibble ? 0 : 1;
+            }
+
+            --_literals_left;
+            _run_left = 1;
+            return;
+        }
+
+        if(_chunk_left == 0)
+        {
+            std::memcpy(&_chunk_left, _pos, sizeof(std::uint64_t));
+            _pos += sizeof(std::uint64_t);
+            continue;
+        }
+
+        if(_inputs._version < replay_version_packed)
+        {
+            _run_input = static_cast<std::uint8_t>(*_pos++);
+            _run_left = 1;
+            --_chunk_left;
+            return;
+        }
+
+        const auto tag = static_cast<std::uint8_t>(*_pos++);
+
+        if(tag & packed_run_flag)
+        {
+            std::uint64_t varint = 0;
+            std::uint8_t byte;
+            unsigned int shift = 0;
+
+            do
+            {
+                byte = static_cast<std::uint8_t>(*_pos++);
+                varint |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                shift += 7;
+            } while(byte & 0x80);
+
+            _run_input = tag & 0x0F;
+            _run_left = varint + packed_min_run;
+            _chunk_left -= _run_left;
+            return;
+        }
+
+        _literals_left = tag + 1;
+        _high_nibble = false;
+        _chunk_left -= _literals_left;
+    }
+}
+
+[[nodiscard]] input_bitset packed_input_cursor::next() noexcept
+{
+    assert(!done());
+
+    if(_run_left == 0)
+    {
+        load_run();
+    }
+
+    --_run_left;
+    ++_index;
+
+    return input_bitset{static_cast<unsigned long>(_run_input)};
+}
+
+void packed_input_cursor::skip(std::size_t count) noexcept
+{
+    count = std::min(count, size() - _index);
+
+    while(count > 0)
+    {
+        if(_run_left == 0)
+        {
+            load_run();
+        }
+
+        const auto n = static_cast<std::size_t>(
+            std::min<std::uint64_t>(count, _run_left));
+
+        _run_left -= n;
+        _index += n;
+        count -= n;
+    }
+}
+
+void packed_input_cursor::reset() noexcept
+{
+    _pos = _inputs._begin;
+    _index = 0;
+    _chunk_left = 0;
+    _literals_left = 0;
+    _high_nibble = false;
+    _run_input = 0;
+    _run_left = 0;
+}
+
+[[nodiscard]] bool packed_input_cursor::done() const noexcept
+{
+    return _index == size();
+}
+
+[[nodiscard]] std::size_t packed_input_cursor::index() const noexcept
+{
+    return _index;
+}
+
+[[nodiscard]] std::size_t packed_input_cursor::size() const noexcept
+{
+    return _inputs._size;
+}
+
 replay_player::replay_player(const replay_data& rd) noexcept
-    : _replay_data{rd}, _current_index{0}
+    : _replay_data{&rd},
+      _cursor{packed_inputs{}},
+      _current_index{0},
+      _current_run{0}
 {
 }
 
+replay_player::replay_player(const packed_inputs& inputs) noexcept
+    : _replay_data{nullptr},
+      _cursor{inputs},
+      _current_index{0},
+      _current_run{0}
+{
+}
+
+[[nodiscard]] std::size_t replay_player::size() const noexcept
+{
+    return _replay_data != nullptr ? _replay_data->size() : _cursor.size();
+}
+
 [[nodiscard]] input_bitset
 replay_player::get_current_and_move_forward() noexcept
 {
-    if(_replay_data.size() <= _current_index)
+    if(size() <= _current_index)
     {
         return {};
     }
 
-    return _replay_data.at(_current_index++);
+    if(_replay_data == nullptr)
+    {
+        ++_current_index;
+        return _cursor.next();
+    }
+
+    // Playback is sequential, no need to search for the run every time
+    while(_replay_data->run_end(_current_run) <= _current_index)
+    {
+        ++_current_run;
+    }
+
+    ++_current_index;
+    return _replay_data->run_input(_current_run);
 }
 
 [[nodiscard]] bool replay_player::done() const noexcept
 {
-    return _current_index == _replay_data.size();
+    return _current_index == size();
 }
 
 void replay_player::reset() noexcept
 {
     _current_index = 0;
+    _current_run = 0;
+    _cursor.reset();
+}
+
+[[nodiscard]] std::size_t replay_player::get_current_index() const noexcept
+{
+    return _current_index;
 }
 
+void replay_player::seek(const std::size_t index) noexcept
+{
+    _current_index = std::min(index, size());
+
+    if(_replay_data != nullptr)
+    {
+        _current_run = _current_index < size()
+                           ? _replay_data->run_containing(_current_index)
+                           : 0;
+
+        return;
+    }
+
+    // Packed inputs can only be decoded forwards
+    if(_current_index < _cursor.index())
+    {
+        _cursor.reset();
+    }
+
+    _cursor.skip(_current_index - _cursor.index());
+}
 
 [[nodiscard]] bool replay_file::operator==(
     const replay_file& rhs) const noexcept
 {
-    return _version == rhs._version &&                 //
-           _player_name == rhs._player_name &&         //
-           _seed == rhs._seed &&                       //
-           _data == rhs._data &&                       //
-           _pack_id == rhs._pack_id &&                 //
-           _level_id == rhs._level_id &&               //
-           _first_play == rhs._first_play &&           //
-           _difficulty_mult == rhs._difficulty_mult && //
-           _played_score == rhs._played_score;
+    return _version == rhs._version &&                         //
+           _player_name == rhs._player_name &&                 //
+           _seed == rhs._seed &&                               //
+           _data == rhs._data &&                               //
+           _pack_id == rhs._pack_id &&                         //
+           _level_id == rhs._level_id &&                       //
+           _first_play == rhs._first_play &&                   //
+           _difficulty_mult == rhs._difficulty_mult &&         //
+           _played_score == rhs._played_score &&               //
+           _state_hash_interval == rhs._state_hash_interval && //
+           _state_hashes == rhs._state_hashes;
 }
 
 [[nodiscard]] bool replay_file::operator!=(
@@ -220,33 +780,158 @@ void replay_player::reset() noexcept
         return result;
     };
 
+    const auto write_inputs = [&] {
+        // Compressed data is prefixed by its uncompressed and compressed
+        // sizes. The packed data is first written where the compressed one
+        // will end up, and then replaced.
+        constexpr std::size_t sizes_bytes{2 * sizeof(std::uint32_t)};
+
+        if(_compressed && _streamed)
+        {
+            result._success = false;
+            return result;
+        }
+
+        // A streamed replay without inputs has no chunks at all
+        if(_streamed && _data.size() == 0)
+        {
+            return result;
+        }
+
+        std::byte* const data_begin =
+            _compressed ? buffer + std::min<std::size_t>(sizes_bytes,
+                                       buffer_end - buffer)
+                        : buffer;
+
+        const serialization_result data_result =
+            _data.serialize(data_begin, buffer_end, _version);
+
+        if(!data_result._success)
+        {
+            result._success = false;
+            return result;
+        }
+
+        if(!_compressed)
+        {
+            buffer += data_result._written_bytes;
+            result._written_bytes += data_result._written_bytes;
+            return result;
+        }
+
+        std::string compressed;
+
+        try
+        {
+            compressed = getZLibCompress(
+                std::string(reinterpret_cast<const char*>(data_begin),
+                    data_result._written_bytes));
+        }
+        catch(const std::runtime_error& e)
+        {
+            ::std::cerr << e.what() << '\n';
+
+            result._success = false;
+            return result;
+        }
+
+        SSVOH_TRY(write(
+            static_cast<std::uint32_t>(data_result._written_bytes)));
+        SSVOH_TRY(write(static_cast<std::uint32_t>(compressed.size())));
+
+        if(buffer + compressed.size() > buffer_end)
+        {
+            result._success = false;
+            return result;
+        }
+
+        std::memcpy(buffer, compressed.data(), compressed.size());
+        buffer += compressed.size();
+        result._written_bytes += compressed.size();
+
+        return result;
+    };
+
+    const bool header_first = _version >= replay_version_header_first;
+
+    const bool has_state_hashes =
+        _state_hash_interval != 0 && !_state_hashes.empty();
+
     SSVOH_TRY(write(_version));
+
+    if(header_first)
+    {
+        const std::uint8_t flags =
+            (_compressed ? replay_flag_compressed : 0) |
+            (_streamed ? replay_flag_streamed : 0) |
+            (has_state_hashes ? replay_flag_state_hashes : 0);
+
+        SSVOH_TRY(write(flags));
+    }
+
     SSVOH_TRY(write_str(_player_name));
     SSVOH_TRY(write(_seed));
 
-    const serialization_result data_result =
-        _data.serialize(buffer, buffer_end);
-
-    if(!data_result._success)
+    if(!header_first)
     {
-        result._success = false;
-        return result;
+        SSVOH_TRY(write_inputs());
     }
 
-    buffer += data_result._written_bytes;
-    result._written_bytes += data_result._written_bytes;
-
     SSVOH_TRY(write_str(_pack_id));
     SSVOH_TRY(write_str(_level_id));
     SSVOH_TRY(write(_first_play));
     SSVOH_TRY(write(_difficulty_mult));
     SSVOH_TRY(write(_played_score));
 
+    if(header_first && has_state_hashes)
+    {
+        SSVOH_TRY(write(_state_hash_interval));
+        SSVOH_TRY(write(static_cast<std::uint32_t>(_state_hashes.size())));
+
+        for(const std::uint32_t hash : _state_hashes)
+        {
+            SSVOH_TRY(write(hash));
+        }
+    }
+
+    if(header_first)
+    {
+        SSVOH_TRY(write_inputs());
+    }
+
     return result;
 }
 
 [[nodiscard]] deserialization_result replay_file::deserialize(
     const std::byte* buffer, const std::byte* const buffer_end)
+{
+    return deserialize_impl(
+        buffer, buffer_end, input_handling::decode, nullptr /* view */);
+}
+
+[[nodiscard]] deserialization_result replay_file::deserialize_view(
+    const std::byte* buffer, const std::byte* const buffer_end,
+    packed_inputs& inputs)
+{
+    return deserialize_impl(buffer, buffer_end, input_handling::view, &inputs);
+}
+
+[[nodiscard]] deserialization_result replay_file::deserialize_header(
+    const std::byte* buffer, const std::size_t buffer_size)
+{
+    return deserialize_header(buffer, buffer + buffer_size);
+}
+
+[[nodiscard]] deserialization_result replay_file::deserialize_header(
+    const std::byte* buffer, const std::byte* const buffer_end)
+{
+    return deserialize_impl(
+        buffer, buffer_end, input_handling::skip, nullptr /* view */);
+}
+
+[[nodiscard]] deserialization_result replay_file::deserialize_impl(
+    const std::byte* buffer, const std::byte* const buffer_end,
+    const input_handling handling, packed_inputs* const view)
 {
     deserialization_result result;
     const auto read = make_read(result, buffer, buffer_end);
@@ -268,21 +953,173 @@ void replay_player::reset() noexcept
         return result;
     };
 
+    const auto read_inputs = [&] {
+        if(_streamed)
+        {
+            while(buffer < buffer_end)
+            {
+                replay_data chunk;
+
+                const deserialization_result chunk_result =
+                    chunk.deserialize(buffer, buffer_end, _version);
+
+                // Recording was interrupted while writing the last chunk
+                if(!chunk_result._success)
+                {
+                    buffer = buffer_end;
+                    break;
+                }
+
+                _data.append(chunk);
+
+                buffer += chunk_result._read_bytes;
+                result._read_bytes += chunk_result._read_bytes;
+            }
+
+            return result;
+        }
+
+        if(!_compressed)
+        {
+            const deserialization_result data_result =
+                _data.deserialize(buffer, buffer_end, _version);
+
+            if(!data_result._success)
+            {
+                result._success = false;
+                return result;
+            }
+
+            buffer += data_result._read_bytes;
+            result._read_bytes += data_result._read_bytes;
+            return result;
+        }
+
+        std::uint32_t uncompressed_size;
+        SSVOH_TRY(read(uncompressed_size));
+
+        std::uint32_t compressed_size;
+        SSVOH_TRY(read(compressed_size));
+
+        if(compressed_size > static_cast<std::size_t>(buffer_end - buffer) ||
+            uncompressed_size > replay_max_uncompressed_size)
+        {
+            result._success = false;
+            return result;
+        }
+
+        // Never inflates more than the declared size
+        std::vector<std::byte> uncompressed(uncompressed_size);
+
+        if(!getZLibDecompressExact(buffer, compressed_size,
+               uncompressed.data(), uncompressed.size()))
+        {
+            result._success = false;
+            return result;
+        }
+
+        buffer += compressed_size;
+        result._read_bytes += compressed_size;
+
+        const deserialization_result data_result =
+            _data.deserialize(uncompressed.data(),
+                uncompressed.data() + uncompressed.size(), _version);
+
+        if(!data_result._success)
+        {
+            result._success = false;
+        }
+
+        return result;
+    };
+
+    const auto view_inputs = [&](packed_inputs& inputs) {
+        inputs = packed_inputs{._begin{buffer},
+            ._end{buffer},
+            ._version{_version},
+            ._streamed{_streamed},
+            ._size{0}};
+
+        do
+        {
+            const std::byte* pos = buffer;
+            std::uint64_t n_inputs;
+
+            if(!scan_inputs(pos, buffer_end, _version, n_inputs))
+            {
+                // Recording was interrupted while writing the last chunk
+                if(_streamed)
+                {
+                    buffer = buffer_end;
+                    break;
+                }
+
+                result._success = false;
+                return result;
+            }
+
+            result._read_bytes += pos - buffer;
+            buffer = pos;
+
+            inputs._end = pos;
+            inputs._size += n_inputs;
+        } while(_streamed && buffer < buffer_end);
+
+        return result;
+    };
+
+    const auto handle_inputs = [&] {
+        if(handling == input_handling::decode ||
+            (handling == input_handling::view && _compressed))
+        {
+            return read_inputs();
+        }
+
+        // Skipped inputs still have to be walked if other fields follow
+        packed_inputs skipped;
+        return view_inputs(handling == input_handling::view ? *view : skipped);
+    };
+
+    _data = replay_data{};
+    _compressed = false;
+    _streamed = false;
+    _state_hash_interval = 0;
+    _state_hashes.clear();
+
+    bool has_state_hashes = false;
+
+    if(view != nullptr)
+    {
+        *view = packed_inputs{};
+    }
+
     SSVOH_TRY(read(_version));
-    SSVOH_TRY(read_str(_player_name));
-    SSVOH_TRY(read(_seed));
 
-    const deserialization_result data_result =
-        _data.deserialize(buffer, buffer_end);
+    const bool header_first = _version >= replay_version_header_first;
 
-    if(!data_result._success)
+    if(header_first)
     {
-        result._success = false;
-        return result;
+        std::uint8_t flags;
+        SSVOH_TRY(read(flags));
+
+        _compressed = (flags & replay_flag_compressed) != 0;
+        _streamed = (flags & replay_flag_streamed) != 0;
+        has_state_hashes = (flags & replay_flag_state_hashes) != 0;
+
+        if(_compressed && _streamed)
+        {
+            result._success = false;
+            return result;
+        }
     }
 
-    buffer += data_result._read_bytes;
-    result._read_bytes += data_result._read_bytes;
+    SSVOH_TRY(read_str(_player_name));
+    SSVOH_TRY(read(_seed));
+
+    if(!header_first)
+    {
+        SSVOH_TRY(handle_inputs());
+    }
 
     SSVOH_TRY(read_str(_pack_id));
     SSVOH_TRY(read_str(_level_id));
@@ -290,53 +1127,182 @@ void replay_player::reset() noexcept
     SSVOH_TRY(read(_difficulty_mult));
     SSVOH_TRY(read(_played_score));
 
+    if(has_state_hashes)
+    {
+        std::uint32_t n_hashes;
+        SSVOH_TRY(read(_state_hash_interval));
+        SSVOH_TRY(read(n_hashes));
+
+        if(_state_hash_interval == 0 ||
+            static_cast<std::size_t>(buffer_end - buffer) <
+                n_hashes * sizeof(std::uint32_t))
+        {
+            result._success = false;
+            return result;
+        }
+
+        _state_hashes.resize(n_hashes);
+
+        for(std::uint32_t& hash : _state_hashes)
+        {
+            SSVOH_TRY(read(hash));
+        }
+    }
+
+    if(header_first && handling != input_handling::skip)
+    {
+        SSVOH_TRY(handle_inputs());
+    }
+
     return result;
 }
 
 [[nodiscard]] bool replay_file::serialize_to_file(
     const std::filesystem::path& p) const
 {
-    constexpr std::size_t buf_size{2097152}; // 2MB
-    static std::byte buf[buf_size];
-
-    const serialization_result sr = serialize(buf, buf_size);
-    if(!sr)
+    std::vector<std::byte> buf;
+    if(!serialize_to_buffer(buf))
     {
         return false;
     }
 
-    const std::size_t written_bytes = sr.written_bytes();
-
     std::ofstream os(p, std::ios::binary | std::ios::out);
-    os.write(reinterpret_cast<const char*>(buf), written_bytes);
+    os.write(reinterpret_cast<const char*>(buf.data()), buf.size());
     os.flush();
 
     return static_cast<bool>(os);
 }
 
+[[nodiscard]] bool replay_file::serialize_to_buffer(
+    std::vector<std::byte>& buf) const
+{
+    // Grow the buffer until everything fits
+    constexpr std::size_t initial_buf_size{65536}; // 64KB
+    constexpr std::size_t max_buf_size{268435456}; // 256MB
+
+    for(std::size_t buf_size = initial_buf_size; buf_size <= max_buf_size;
+        buf_size *= 2)
+    {
+        buf.resize(buf_size);
+
+        const serialization_result sr = serialize(buf.data(), buf.size());
+        if(sr)
+        {
+            buf.resize(sr.written_bytes());
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Size of the file opened by `is`, which is left at the beginning.
+[[nodiscard]] static std::optional<std::size_t> get_file_size(
+    std::ifstream& is)
+{
+    if(!is)
+    {
+        return std::nullopt;
+    }
+
+    is.seekg(0, std::ios::end);
+    const std::streamoff end = is.tellg();
+    is.seekg(0, std::ios::beg);
+
+    if(!is || end < 0)
+    {
+        return std::nullopt;
+    }
+
+    return static_cast<std::size_t>(end);
+}
+
 [[nodiscard]] bool replay_file::deserialize_from_file(
     const std::filesystem::path& p)
 {
     std::ifstream is(p, std::ios::binary | std::ios::in);
 
-    is.seekg(0, std::ios::end);
-    const std::size_t bytes_to_read = is.tellg();
-    is.seekg(0, std::ios::beg);
+    const std::optional<std::size_t> file_size = get_file_size(is);
+    if(!file_size.has_value())
+    {
+        return false;
+    }
 
-    constexpr std::size_t buf_size{2097152}; // 2MB
-    static std::byte buf[buf_size];
+    const std::size_t bytes_to_read = *file_size;
 
-    is.read(reinterpret_cast<char*>(buf), bytes_to_read);
+    std::vector<std::byte> buf(bytes_to_read);
+    is.read(reinterpret_cast<char*>(buf.data()), bytes_to_read);
 
     if(!static_cast<bool>(is))
     {
         return false;
     }
 
-    const deserialization_result dr = deserialize(buf, bytes_to_read);
+    const deserialization_result dr = deserialize(buf.data(), bytes_to_read);
     return static_cast<bool>(dr);
 }
 
+[[nodiscard]] bool replay_file::deserialize_header_from_file(
+    const std::filesystem::path& p)
+{
+    std::ifstream is(p, std::ios::binary | std::ios::in);
+
+    const std::optional<std::size_t> opt_file_size = get_file_size(is);
+    if(!opt_file_size.has_value())
+    {
+        return false;
+    }
+
+    const std::size_t file_size = *opt_file_size;
+
+    // Headers are small, try with the beginning of the file first
+    constexpr std::size_t prefix_size{4096};
+    std::vector<std::byte> buf(std::min(file_size, prefix_size));
+
+    is.read(reinterpret_cast<char*>(buf.data()), buf.size());
+
+    if(!static_cast<bool>(is))
+    {
+        return false;
+    }
+
+    if(deserialize_header(buf.data(), buf.size()))
+    {
+        return true;
+    }
+
+    if(file_size <= prefix_size)
+    {
+        return false;
+    }
+
+    buf.resize(file_size);
+    is.read(reinterpret_cast<char*>(buf.data() + prefix_size),
+        file_size - prefix_size);
+
+    if(!static_cast<bool>(is))
+    {
+        return false;
+    }
+
+    return static_cast<bool>(deserialize_header(buf.data(), buf.size()));
+}
+
+[[nodiscard]] bool replay_file::has_state_hash(
+    const std::size_t n_inputs) const noexcept
+{
+    return _state_hash_interval != 0 && n_inputs != 0 &&
+           n_inputs % _state_hash_interval == 0 &&
+           n_inputs / _state_hash_interval <= _state_hashes.size();
+}
+
+[[nodiscard]] bool replay_file::state_hash_mismatch(
+    const std::size_t n_inputs, const std::uint32_t hash) const noexcept
+{
+    return has_state_hash(n_inputs) &&
+           _state_hashes[n_inputs / _state_hash_interval - 1] != hash;
+}
+
 [[nodiscard]] std::string replay_file::create_filename() const
 {
     std::ostringstream oss;
@@ -0,0 +1,267 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Core/ReplayIndex.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hg
+{
+
+// Index file layout: magic, entry count, then for every entry its filename,
+// write time, file size and header serialized as a `replay_file` without
+// input data.
+static constexpr std::uint32_t index_magic{0x4F485249}; // "OHRI"
+
+replay_index::replay_index(std::filesystem::path folder)
+    : _folder{std::move(folder)}
+{
+}
+
+[[nodiscard]] bool replay_index::load()
+{
+    _entries.clear();
+
+    std::ifstream is(_folder / index_filename, std::ios::binary | std::ios::in);
+    if(!is)
+    {
+        return false;
+    }
+
+    const std::vector<char> buf{std::istreambuf_iterator<char>{is},
+        std::istreambuf_iterator<char>{}};
+
+    const char* pos = buf.data();
+    const char* const end = buf.data() + buf.size();
+
+    const auto read = [&](auto& target) {
+        if(static_cast<std::size_t>(end - pos) < sizeof(target))
+        {
+            return false;
+        }
+
+        std::memcpy(&target, pos, sizeof(target));
+        pos += sizeof(target);
+        return true;
+    };
+
+    const auto fail = [&] {
+        _entries.clear();
+        return false;
+    };
+
+    std::uint32_t magic;
+    std::uint64_t n_entries;
+
+    if(!read(magic) || magic != index_magic || !read(n_entries))
+    {
+        return fail();
+    }
+
+    for(std::uint64_t i = 0; i < n_entries; ++i)
+    {
+        entry e;
+
+        std::uint32_t filename_size;
+        if(!read(filename_size) ||
+            static_cast<std::size_t>(end - pos) < filename_size)
+        {
+            return fail();
+        }
+
+        e._filename.assign(pos, filename_size);
+        pos += filename_size;
+
+        std::uint32_t header_size;
+        if(!read(e._write_time) || !read(e._file_size) || !read(header_size) ||
+            static_cast<std::size_t>(end - pos) < header_size)
+        {
+            return fail();
+        }
+
+        const auto* const header = reinterpret_cast<const std::byte*>(pos);
+        if(!e._header.deserialize_header(header, header + header_size))
+        {
+            return fail();
+        }
+
+        pos += header_size;
+        _entries.emplace_back(std::move(e));
+    }
+
+    return true;
+}
+
+[[nodiscard]] bool replay_index::save() const
+{
+    std::vector<char> buf;
+
+    const auto write = [&](const auto& datum) {
+        const auto* const bytes = reinterpret_cast<const char*>(&datum);
+        buf.insert(buf.end(), bytes, bytes + sizeof(datum));
+    };
+
+    write(index_magic);
+    write(static_cast<std::uint64_t>(_entries.size()));
+
+    std::vector<std::byte> header;
+
+    for(const entry& e : _entries)
+    {
+        write(static_cast<std::uint32_t>(e._filename.size()));
+        buf.insert(buf.end(), e._filename.begin(), e._filename.end());
+
+        if(!e._header.serialize_to_buffer(header))
+        {
+            return false;
+        }
+
+        write(e._write_time);
+        write(e._file_size);
+        write(static_cast<std::uint32_t>(header.size()));
+
+        const auto* const header_bytes =
+            reinterpret_cast<const char*>(header.data());
+
+        buf.insert(buf.end(), header_bytes, header_bytes + header.size());
+    }
+
+    // Replace the index atomically, a partially written one would be lost
+    const std::filesystem::path index_path = _folder / index_filename;
+    std::filesystem::path temp_path = index_path;
+    temp_path += ".tmp";
+
+    {
+        std::ofstream os(temp_path, std::ios::binary | std::ios::out);
+        os.write(buf.data(), buf.size());
+        os.flush();
+
+        if(!os)
+        {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp_path, index_path, ec);
+    return !ec;
+}
+
+std::size_t replay_index::refresh()
+{
+    std::unordered_map<std::string, entry*> indexed;
+    for(entry& e : _entries)
+    {
+        indexed.emplace(e._filename, &e);
+    }
+
+    std::vector<entry> refreshed;
+    std::size_t read_headers = 0;
+
+    std::error_code ec;
+    for(const auto& dir_entry :
+        std::filesystem::directory_iterator{_folder, ec})
+    {
+        if(!dir_entry.is_regular_file(ec) ||
+            dir_entry.path().extension() != ".ohreplay")
+        {
+            continue;
+        }
+
+        std::string filename = dir_entry.path().filename().string();
+
+        const auto write_time = static_cast<std::int64_t>(
+            dir_entry.last_write_time(ec).time_since_epoch().count());
+
+        const auto file_size =
+            static_cast<std::uint64_t>(dir_entry.file_size(ec));
+
+        if(ec)
+        {
+            continue;
+        }
+
+        if(const auto it = indexed.find(filename);
+            it != indexed.end() && it->second->_write_time == write_time &&
+            it->second->_file_size == file_size)
+        {
+            refreshed.emplace_back(std::move(*it->second));
+            continue;
+        }
+
+        entry e{._filename{std::move(filename)},
+            ._write_time{write_time},
+            ._file_size{file_size},
+            ._header{}};
+
+        ++read_headers;
+
+        if(e._header.deserialize_header_from_file(dir_entry.path()))
+        {
+            // State hashes are only needed to play replays back
+            e._header._state_hash_interval = 0;
+            e._header._state_hashes.clear();
+
+            refreshed.emplace_back(std::move(e));
+        }
+    }
+
+    std::sort(refreshed.begin(), refreshed.end(),
+        [](const entry& a, const entry& b) {
+            return a._filename < b._filename;
+        });
+
+    _entries = std::move(refreshed);
+    return read_headers;
+}
+
+[[nodiscard]] const std::vector<replay_index::entry>&
+replay_index::entries() const noexcept
+{
+    return _entries;
+}
+
+[[nodiscard]] std::vector<const replay_index::entry*>
+replay_index::best_for_level(const std::string_view pack_id,
+    const std::string_view level_id, const float difficulty_mult,
+    const std::size_t max_count) const
+{
+    std::vector<const entry*> result;
+
+    for(const entry& e : _entries)
+    {
+        if(e._header._pack_id == pack_id && e._header._level_id == level_id &&
+            e._header._difficulty_mult == difficulty_mult)
+        {
+            result.emplace_back(&e);
+        }
+    }
+
+    const auto by_score = [](const entry* a, const entry* b) {
+        return a->_header._played_score > b->_header._played_score;
+    };
+
+    if(result.size() > max_count)
+    {
+        std::partial_sort(result.begin(), result.begin() + max_count,
+            result.end(), by_score);
+
+        result.resize(max_count);
+    }
+    else
+    {
+        std::sort(result.begin(), result.end(), by_score);
+    }
+
+    return result;
+}
+
+} // namespace hg
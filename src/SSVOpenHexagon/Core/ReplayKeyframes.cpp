@@ -0,0 +1,77 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Core/ReplayKeyframes.hpp"
+
+#include <cassert>
+
+namespace hg
+{
+
+replay_keyframes::replay_keyframes(
+    const std::size_t interval, const std::size_t capacity)
+    : _interval{interval}, _capacity{capacity}
+{
+    assert(_interval > 0);
+    assert(_capacity > 0);
+
+    _keyframes.reserve(_capacity);
+}
+
+[[nodiscard]] bool replay_keyframes::contains_interval_of(
+    const std::size_t tick) const noexcept
+{
+    for(const keyframe& kf : _keyframes)
+    {
+        if(kf._tick / _interval == tick / _interval)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+[[nodiscard]] bool replay_keyframes::should_capture(const std::size_t tick,
+    const HexagonSimulation& simulation) const noexcept
+{
+    return simulation.canMakeSnapshot() && !contains_interval_of(tick);
+}
+
+void replay_keyframes::capture(
+    const std::size_t tick, HexagonSimulation& simulation)
+{
+    if(_keyframes.size() < _capacity)
+    {
+        _keyframes.push_back(keyframe{tick, simulation.makeSnapshot()});
+        return;
+    }
+
+    _keyframes[_next_slot] = keyframe{tick, simulation.makeSnapshot()};
+    _next_slot = (_next_slot + 1) % _capacity;
+}
+
+[[nodiscard]] const replay_keyframes::keyframe* replay_keyframes::find_nearest(
+    const std::size_t tick) const noexcept
+{
+    const keyframe* result = nullptr;
+
+    for(const keyframe& kf : _keyframes)
+    {
+        if(kf._tick <= tick && (result == nullptr || kf._tick > result->_tick))
+        {
+            result = &kf;
+        }
+    }
+
+    return result;
+}
+
+void replay_keyframes::clear() noexcept
+{
+    _keyframes.clear();
+    _next_slot = 0;
+}
+
+} // namespace hg
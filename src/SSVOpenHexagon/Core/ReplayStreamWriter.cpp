@@ -0,0 +1,269 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Core/ReplayStreamWriter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace hg
+{
+
+replay_stream_writer::replay_stream_writer(std::filesystem::path part_path)
+    : _part_path{std::move(part_path)}, _thread{[this] { run(); }}
+{
+    enqueue([this] {
+        std::error_code ec;
+        if(!std::filesystem::exists(_part_path, ec))
+        {
+            return;
+        }
+
+        const auto seconds =
+            std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count();
+
+        std::filesystem::path recovered = _part_path.parent_path();
+        recovered /= "recovered_" + std::to_string(seconds) + ".ohreplay";
+
+        std::filesystem::rename(_part_path, recovered, ec);
+
+        if(ec)
+        {
+            std::cerr << "Failed to recover interrupted replay recording '"
+                      << _part_path.string() << "': " << ec.message() << '\n';
+
+            return;
+        }
+
+        std::cerr << "Recovered interrupted replay recording to '"
+                  << recovered.string() << "'\n";
+    });
+}
+
+replay_stream_writer::~replay_stream_writer()
+{
+    discard();
+
+    {
+        const std::lock_guard lock{_mutex};
+        _stopping = true;
+    }
+
+    _cv.notify_all();
+    _thread.join();
+}
+
+void replay_stream_writer::enqueue(std::function<void()>&& job)
+{
+    {
+        const std::lock_guard lock{_mutex};
+        _jobs.emplace_back(std::move(job));
+    }
+
+    _cv.notify_all();
+}
+
+void replay_stream_writer::run()
+{
+    while(true)
+    {
+        std::function<void()> job;
+
+        {
+            std::unique_lock lock{_mutex};
+            _cv.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+
+            // Queued jobs are always completed before stopping
+            if(_jobs.empty())
+            {
+                return;
+            }
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+            _busy = true;
+        }
+
+        job();
+
+        {
+            const std::lock_guard lock{_mutex};
+            _busy = false;
+        }
+
+        _cv.notify_all();
+    }
+}
+
+void replay_stream_writer::write_header(const replay_file& header)
+{
+    _os.close();
+    _os.clear();
+
+    std::vector<std::byte> buf;
+    if(!header.serialize_to_buffer(buf))
+    {
+        std::cerr << "Failed to serialize replay recording header\n";
+        return;
+    }
+
+    std::error_code ec;
+    if(_part_path.has_parent_path())
+    {
+        std::filesystem::create_directories(_part_path.parent_path(), ec);
+    }
+
+    _os.open(_part_path, std::ios::binary | std::ios::out | std::ios::trunc);
+    _os.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+    _os.flush();
+
+    if(!_os)
+    {
+        std::cerr << "Failed to start replay recording '"
+                  << _part_path.string() << "'\n";
+
+        _os.close();
+        return;
+    }
+
+    // The score is the last header field without state hashes, the file has
+    // no chunks yet
+    _score_offset = buf.size() - sizeof(double);
+}
+
+void replay_stream_writer::write_chunk(
+    const replay_data& chunk, const double score)
+{
+    if(!_os.is_open())
+    {
+        return;
+    }
+
+    // Packed data never takes more than a byte per input
+    std::vector<std::byte> buf(sizeof(std::uint64_t) + chunk.size() + 16);
+
+    const serialization_result sr =
+        chunk.serialize(buf.data(), buf.size(), replay_version_packed);
+
+    if(!sr)
+    {
+        return;
+    }
+
+    _os.write(reinterpret_cast<const char*>(buf.data()), sr.written_bytes());
+
+    // Keep the score consistent with the streamed inputs
+    _os.seekp(_score_offset);
+    _os.write(reinterpret_cast<const char*>(&score), sizeof(score));
+    _os.seekp(0, std::ios::end);
+
+    _os.flush();
+
+    if(!_os)
+    {
+        std::cerr << "Failed to write replay recording chunk to '"
+                  << _part_path.string() << "'\n";
+
+        _os.close();
+    }
+}
+
+void replay_stream_writer::close_and_remove()
+{
+    _os.close();
+    _os.clear();
+
+    std::error_code ec;
+    std::filesystem::remove(_part_path, ec);
+}
+
+void replay_stream_writer::begin(const replay_file& header)
+{
+    replay_file rf = header;
+    rf._version = std::max(rf._version, replay_version_header_first);
+    rf._data = replay_data{};
+    rf._played_score = 0.0;
+    rf._compressed = false;
+    rf._streamed = true;
+    rf._state_hash_interval = 0;
+    rf._state_hashes.clear();
+
+    _recording = true;
+    _streamed_inputs = 0;
+
+    enqueue([this, rf = std::move(rf)] { write_header(rf); });
+}
+
+void replay_stream_writer::update(const replay_data& data, const double score)
+{
+    if(!_recording || data.size() < _streamed_inputs + chunk_inputs)
+    {
+        return;
+    }
+
+    replay_data chunk = data.slice(_streamed_inputs, data.size());
+    _streamed_inputs = data.size();
+
+    enqueue([this, chunk = std::move(chunk), score] {
+        write_chunk(chunk, score);
+    });
+}
+
+void replay_stream_writer::finish(
+    const replay_file& rf, const std::filesystem::path& path)
+{
+    _recording = false;
+
+    enqueue([this, rf, path] {
+        if(!rf.serialize_to_file(path))
+        {
+            // The streamed recording is a valid replay as well
+            _os.close();
+
+            std::error_code ec;
+            std::filesystem::rename(_part_path, path, ec);
+
+            std::cerr << "Failed to save replay file '" << path.string() << "'"
+                      << (ec ? "\n" : ", kept streamed recording instead\n");
+
+            return;
+        }
+
+        std::cerr << "Successfully saved replay file '" << path.string()
+                  << "'\n";
+        close_and_remove();
+    });
+}
+
+void replay_stream_writer::discard()
+{
+    if(!_recording)
+    {
+        return;
+    }
+
+    _recording = false;
+    enqueue([this] { close_and_remove(); });
+}
+
+[[nodiscard]] bool replay_stream_writer::recording() const noexcept
+{
+    return _recording;
+}
+
+void replay_stream_writer::wait_idle()
+{
+    std::unique_lock lock{_mutex};
+    _cv.wait(lock, [this] { return _jobs.empty() && !_busy; });
+}
+
+} // namespace hg
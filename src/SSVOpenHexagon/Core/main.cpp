@@ -142,7 +142,7 @@ int main(int argc, char* argv[])
 
     // ------------------------------------------------------------------------
     // Create the game and menu states
-    auto assets = std::make_unique<hg::HGAssets>(steamManager);
+    auto assets = std::make_unique<hg::HGAssets>(&steamManager);
 
     auto hg = std::make_unique<hg::HexagonGame>(
         steamManager, discordManager, *assets, window);
@@ -30,7 +30,7 @@ namespace hg
         ssvufs::Pick::ByName>(path, name);
 }
 
-HGAssets::HGAssets(Steam::steam_manager& mSteamManager, bool mLevelsOnly)
+HGAssets::HGAssets(Steam::steam_manager* mSteamManager, bool mLevelsOnly)
     : steamManager{mSteamManager}, levelsOnly{mLevelsOnly}
 {
     if(!levelsOnly)
@@ -164,11 +164,15 @@ HGAssets::HGAssets(Steam::steam_manager& mSteamManager, bool mLevelsOnly)
 
             ssvu::lo("::loadAssets") << errorMessage;
         }
-        else if(!levelsOnly)
+        else
         {
-            ssvu::lo("::loadAssets") << "loading " << packId << " music\n";
-            loadMusic(packId, packPath);
+            if(!levelsOnly)
+            {
+                ssvu::lo("::loadAssets") << "loading " << packId << " music\n";
+                loadMusic(packId, packPath);
+            }
 
+            // Music data is needed by the simulation even without audio
             ssvu::lo("::loadAssets") << "loading " << packId << " music data\n";
             loadMusicData(packId, packPath);
         }
@@ -265,22 +269,26 @@ HGAssets::HGAssets(Steam::steam_manager& mSteamManager, bool mLevelsOnly)
 
     // ------------------------------------------------------------------------
     // Load packs from Steam workshop.
-    steamManager.for_workshop_pack_folders([&](const std::string& folderPath) {
-        const ssvufs::Path packPath{folderPath};
+    if(steamManager != nullptr)
+    {
+        steamManager->for_workshop_pack_folders(
+            [&](const std::string& folderPath) {
+                const ssvufs::Path packPath{folderPath};
 
-        if(!loadPackData(packPath))
-        {
-            errorMessage =
-                "Error loading pack data '" + packPath.getStr() + "'\n";
-            loadInfo.errorMessages.emplace_back(errorMessage);
-            ssvu::lo("::loadAssets")
-                << "Error loading pack data '" << packPath << "'\n";
-        }
-        else
-        {
-            loadInfo.packs++;
-        }
-    });
+                if(!loadPackData(packPath))
+                {
+                    errorMessage =
+                        "Error loading pack data '" + packPath.getStr() + "'\n";
+                    loadInfo.errorMessages.emplace_back(errorMessage);
+                    ssvu::lo("::loadAssets")
+                        << "Error loading pack data '" << packPath << "'\n";
+                }
+                else
+                {
+                    loadInfo.packs++;
+                }
+            });
+    }
 
     // ------------------------------------------------------------------------
     // Load pack infos.
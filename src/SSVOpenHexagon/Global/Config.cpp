@@ -105,6 +105,9 @@ using namespace ssvu;
     X(keyIconsScale, float, "key_icons_scale")                             \
     X(firstTimePlaying, bool, "first_time_playing")                        \
     X(saveLocalBestReplayToFile, bool, "save_local_best_replay_to_file")   \
+    X(compressReplayFiles, bool, "compress_replay_files")                  \
+    X(luaProfiler, bool, "lua_profiler")                                   \
+    X(luaGCStepKB, int, "lua_gc_step_kb")                                  \
     X_BINDSLINKEDVALUES
 
 namespace hg::Config
@@ -598,6 +601,21 @@ void setSaveLocalBestReplayToFile(bool mX)
     saveLocalBestReplayToFile() = mX;
 }
 
+void setCompressReplayFiles(bool mX)
+{
+    compressReplayFiles() = mX;
+}
+
+void setLuaProfiler(bool mX)
+{
+    luaProfiler() = mX;
+}
+
+void setLuaGCStepKB(int mX)
+{
+    luaGCStepKB() = mX;
+}
+
 [[nodiscard]] bool getOnline()
 {
     return online();
@@ -912,6 +930,21 @@ void setSaveLocalBestReplayToFile(bool mX)
     return saveLocalBestReplayToFile();
 }
 
+[[nodiscard]] bool getCompressReplayFiles()
+{
+    return compressReplayFiles();
+}
+
+[[nodiscard]] bool getLuaProfiler()
+{
+    return luaProfiler();
+}
+
+[[nodiscard]] int getLuaGCStepKB()
+{
+    return luaGCStepKB();
+}
+
 //***********************************************************
 //
 // KEYBOARD/MOUSE BINDS
@@ -95,4 +95,39 @@ string getZLibDecompress(const string& mStr)
 
     return outstring;
 }
+
+bool getZLibDecompressExact(const void* mData, std::size_t mSize, void* mOut,
+    std::size_t mOutSize) noexcept
+{
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+
+    if(inflateInit(&zs) != Z_OK)
+    {
+        return false;
+    }
+
+    // One spare byte tells a stream that is too long from an exact one
+    unsigned char spare;
+
+    zs.next_in = static_cast<Bytef*>(const_cast<void*>(mData));
+    zs.avail_in = mSize;
+    zs.next_out = static_cast<Bytef*>(mOut);
+    zs.avail_out = mOutSize;
+
+    int ret = inflate(&zs, Z_FINISH);
+
+    if(ret != Z_STREAM_END && zs.avail_out == 0)
+    {
+        zs.next_out = &spare;
+        zs.avail_out = 1;
+        ret = inflate(&zs, Z_FINISH);
+    }
+
+    const bool exact = ret == Z_STREAM_END && zs.total_out == mOutSize &&
+                       zs.total_in == mSize;
+
+    inflateEnd(&zs);
+    return exact;
+}
 } // namespace hg
@@ -0,0 +1,91 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Utils/LuaBytecodeCache.hpp"
+#include "SSVOpenHexagon/Utils/LuaWrapper.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+namespace hg::Utils
+{
+
+[[nodiscard]] static std::string readFileContents(const std::string& mFileName)
+{
+    std::ifstream is{mFileName, std::ios::binary | std::ios::in};
+
+    return std::string{
+        std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+}
+
+// FNV-1a over the path and the contents. The path is included because the
+// bytecode embeds it as the chunk name.
+[[nodiscard]] static std::uint64_t hashScript(
+    const std::string& mFileName, const std::string& mContents) noexcept
+{
+    std::uint64_t hash{14695981039346656037ull};
+
+    const auto add = [&](const std::string& s) {
+        for(const char c : s)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+    };
+
+    add(mFileName);
+    add(mContents);
+
+    return hash;
+}
+
+[[nodiscard]] const LuaBytecodeCache::Entry* LuaBytecodeCache::find(
+    const std::string& mFileName, const std::uint64_t mContentHash)
+{
+    const auto it = entries.find(mFileName);
+    if(it == entries.end())
+    {
+        return nullptr;
+    }
+
+    if(it->second.contentHash != mContentHash)
+    {
+        // The script was edited since it was compiled
+        entries.erase(it);
+        return nullptr;
+    }
+
+    return &it->second;
+}
+
+void LuaBytecodeCache::runLuaFile(
+    Lua::LuaContext& mLua, const std::string& mFileName)
+{
+    const std::string source = readFileContents(mFileName);
+    const std::uint64_t contentHash = hashScript(mFileName, source);
+    const std::string chunkName = "@" + mFileName;
+
+    if(const Entry* entry = find(mFileName, contentHash); entry != nullptr)
+    {
+        mLua.executeBytecode(entry->bytecode, chunkName);
+        return;
+    }
+
+    Entry entry{.contentHash{contentHash}, .bytecode{}};
+    mLua.executeCode(source, chunkName, entry.bytecode);
+
+    entries.emplace(mFileName, std::move(entry));
+}
+
+void LuaBytecodeCache::clear() noexcept
+{
+    entries.clear();
+}
+
+[[nodiscard]] std::size_t LuaBytecodeCache::size() const noexcept
+{
+    return entries.size();
+}
+
+} // namespace hg::Utils
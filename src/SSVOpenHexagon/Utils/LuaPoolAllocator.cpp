@@ -0,0 +1,221 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Utils/LuaPoolAllocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+
+namespace hg::Utils
+{
+
+LuaPoolAllocator::~LuaPoolAllocator()
+{
+    for(std::byte* chunk : chunks)
+    {
+        std::free(chunk);
+    }
+}
+
+[[nodiscard]] std::size_t LuaPoolAllocator::sizeClassIndex(
+    const std::size_t mSize) noexcept
+{
+    if(mSize <= sizeClasses.front())
+    {
+        return 0;
+    }
+
+    // Size classes are consecutive powers of two starting at 16
+    return std::min<std::size_t>(
+        std::bit_width(mSize - 1) - 4, sizeClasses.size());
+}
+
+[[nodiscard]] bool LuaPoolAllocator::isInChunk(const void* mPtr) const noexcept
+{
+    const auto* const p = static_cast<const std::byte*>(mPtr);
+
+    return std::any_of(chunks.begin(), chunks.end(), [&](std::byte* chunk) {
+        return std::less_equal<>{}(chunk, p) &&
+               std::less<>{}(p, chunk + chunkSize);
+    });
+}
+
+void LuaPoolAllocator::pushFreeBlock(
+    void* mPtr, const std::size_t mIndex) noexcept
+{
+    Pool& pool = pools[mIndex];
+    pool.freeList = new(mPtr) FreeBlock{pool.freeList};
+}
+
+[[nodiscard]] void* LuaPoolAllocator::allocate(const std::size_t mSize) noexcept
+{
+    const std::size_t index = sizeClassIndex(mSize);
+
+    if(index == sizeClasses.size())
+    {
+        void* const ptr = std::malloc(mSize);
+        if(ptr != nullptr)
+        {
+            bytesInUse += mSize;
+            ++allocationCount;
+        }
+
+        return ptr;
+    }
+
+    Pool& pool = pools[index];
+    void* ptr;
+
+    if(pool.freeList != nullptr)
+    {
+        ptr = pool.freeList;
+        pool.freeList = pool.freeList->next;
+    }
+    else
+    {
+        if(pool.bump == pool.bumpEnd)
+        {
+            auto* const chunk = static_cast<std::byte*>(std::malloc(chunkSize));
+            if(chunk == nullptr)
+            {
+                return nullptr;
+            }
+
+            try
+            {
+                chunks.emplace_back(chunk);
+            }
+            catch(const std::bad_alloc&)
+            {
+                std::free(chunk);
+                return nullptr;
+            }
+
+            pool.bump = chunk;
+            pool.bumpEnd = chunk + chunkSize;
+        }
+
+        ptr = pool.bump;
+        pool.bump += sizeClasses[index];
+    }
+
+    bytesInUse += mSize;
+    ++allocationCount;
+
+    return ptr;
+}
+
+void LuaPoolAllocator::deallocate(void* mPtr, const std::size_t mSize) noexcept
+{
+    bytesInUse -= mSize;
+
+    const std::size_t index = sizeClassIndex(mSize);
+
+    if(index == sizeClasses.size())
+    {
+        std::free(mPtr);
+        return;
+    }
+
+    if(foreignBlocks > 0 && !isInChunk(mPtr))
+    {
+        --foreignBlocks;
+        std::free(mPtr);
+        return;
+    }
+
+    pushFreeBlock(mPtr, index);
+}
+
+[[nodiscard]] void* LuaPoolAllocator::reallocate(
+    void* mPtr, const std::size_t mOldSize, const std::size_t mNewSize) noexcept
+{
+    const std::size_t oldIndex = sizeClassIndex(mOldSize);
+    const std::size_t newIndex = sizeClassIndex(mNewSize);
+
+    if(oldIndex == newIndex)
+    {
+        if(newIndex != sizeClasses.size())
+        {
+            // The block already fits
+            bytesInUse = bytesInUse - mOldSize + mNewSize;
+            return mPtr;
+        }
+
+        void* const ptr = std::realloc(mPtr, mNewSize);
+        if(ptr != nullptr)
+        {
+            bytesInUse = bytesInUse - mOldSize + mNewSize;
+            ++allocationCount;
+        }
+
+        return ptr;
+    }
+
+    void* const ptr = allocate(mNewSize);
+    if(ptr == nullptr)
+    {
+        if(mNewSize > mOldSize)
+        {
+            return nullptr;
+        }
+
+        // Shrinking must not fail, the old block is kept
+        bytesInUse = bytesInUse - mOldSize + mNewSize;
+
+        if(oldIndex == sizeClasses.size())
+        {
+            ++foreignBlocks;
+        }
+        else if(foreignBlocks == 0 || isInChunk(mPtr))
+        {
+            // Size classes are powers of two: the block is split into one of
+            // the new class, which stays in place, and one of each class
+            // between the new and the old one, which become free
+            auto* const block = static_cast<std::byte*>(mPtr);
+
+            for(std::size_t i = newIndex; i < oldIndex; ++i)
+            {
+                pushFreeBlock(block + sizeClasses[i], i);
+            }
+        }
+
+        return mPtr;
+    }
+
+    std::memcpy(ptr, mPtr, std::min(mOldSize, mNewSize));
+    deallocate(mPtr, mOldSize);
+
+    return ptr;
+}
+
+void* LuaPoolAllocator::luaAlloc(void* mUserData, void* mPtr,
+    const std::size_t mOldSize, const std::size_t mNewSize) noexcept
+{
+    auto& allocator = *static_cast<LuaPoolAllocator*>(mUserData);
+
+    if(mNewSize == 0)
+    {
+        if(mPtr != nullptr)
+        {
+            allocator.deallocate(mPtr, mOldSize);
+        }
+
+        return nullptr;
+    }
+
+    // When `mPtr` is null, `mOldSize` is the type of the object instead
+    if(mPtr == nullptr)
+    {
+        return allocator.allocate(mNewSize);
+    }
+
+    return allocator.reallocate(mPtr, mOldSize, mNewSize);
+}
+
+} // namespace hg::Utils
@@ -0,0 +1,223 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Utils/LuaProfiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <system_error>
+
+namespace hg::Utils
+{
+
+namespace
+{
+
+// Address used as the registry key of the profiler owning a state
+constexpr char registryKey{};
+
+constexpr int maxStackDepth{64};
+
+constexpr const char* unknownRoot{"[lua]"};
+constexpr const char* engineStack{"[engine]"};
+
+} // namespace
+
+void LuaProfiler::hook(lua_State* mL, lua_Debug*)
+{
+    lua_rawgetp(mL, LUA_REGISTRYINDEX, &registryKey);
+    auto* const profiler = static_cast<LuaProfiler*>(lua_touserdata(mL, -1));
+    lua_pop(mL, 1);
+
+    if(profiler != nullptr)
+    {
+        profiler->sample(mL);
+    }
+}
+
+void LuaProfiler::attach(lua_State* mL)
+{
+    state = mL;
+    lastStack.clear();
+
+    lua_pushlightuserdata(mL, this);
+    lua_rawsetp(mL, LUA_REGISTRYINDEX, &registryKey);
+
+    lua_sethook(mL, &hook, LUA_MASKCOUNT, sampleInterval);
+}
+
+void LuaProfiler::account(
+    const std::string& mStack, const Clock::time_point mNow)
+{
+    const Clock::duration elapsed = mNow - mark;
+    mark = mNow;
+
+    if(scopeDepth == 0)
+    {
+        // Not called from an engine entry point, nothing to compare against
+        return;
+    }
+
+    inLua += elapsed;
+
+    if(const auto it = samples.find(mStack); it != samples.end())
+    {
+        it->second += elapsed;
+        return;
+    }
+
+    samples.emplace(mStack, elapsed);
+}
+
+void LuaProfiler::sample(lua_State* mL)
+{
+    const Clock::time_point now = Clock::now();
+
+    // Walk the stack from the innermost frame, and emit it root first
+    lua_Debug frames[maxStackDepth];
+    int depth = 0;
+
+    while(depth < maxStackDepth && lua_getstack(mL, depth, &frames[depth]))
+    {
+        lua_getinfo(mL, "Sln", &frames[depth]);
+        ++depth;
+    }
+
+    stackBuffer.assign(rootName != nullptr ? rootName : unknownRoot);
+
+    for(int i = depth - 1; i >= 0; --i)
+    {
+        const lua_Debug& ar = frames[i];
+
+        stackBuffer += ';';
+
+        if(ar.name != nullptr)
+        {
+            stackBuffer += ar.name;
+        }
+        else
+        {
+            stackBuffer += *ar.what == 'm' ? "main" : "?";
+        }
+
+        stackBuffer += '@';
+        stackBuffer += ar.short_src;
+
+        if(ar.currentline > 0)
+        {
+            stackBuffer += ':';
+            stackBuffer += std::to_string(ar.currentline);
+        }
+    }
+
+    account(stackBuffer, now);
+    lastStack.swap(stackBuffer);
+}
+
+void LuaProfiler::enterNative()
+{
+    // The Lua code since the last sample ran before the call
+    account(lastStack, Clock::now());
+}
+
+void LuaProfiler::leaveNative(const std::size_t mNativeId)
+{
+    stackBuffer.assign(rootName != nullptr ? rootName : unknownRoot);
+    stackBuffer += ';';
+    stackBuffer += nativeNames[mNativeId];
+
+    account(stackBuffer, Clock::now());
+}
+
+LuaProfiler::Scope::Scope(LuaProfiler& mProfiler, const char* mName)
+    : profiler{mProfiler.isAttached() ? &mProfiler : nullptr}
+{
+    if(profiler == nullptr || profiler->scopeDepth++ > 0)
+    {
+        return;
+    }
+
+    profiler->rootName = mName;
+    profiler->lastStack.assign(mName);
+    profiler->mark = Clock::now();
+}
+
+LuaProfiler::Scope::~Scope()
+{
+    if(profiler == nullptr)
+    {
+        return;
+    }
+
+    if(profiler->scopeDepth == 1)
+    {
+        profiler->account(profiler->lastStack, Clock::now());
+        profiler->rootName = nullptr;
+    }
+
+    --profiler->scopeDepth;
+}
+
+LuaProfiler::TickScope::TickScope(LuaProfiler& mProfiler)
+    : profiler{mProfiler.isAttached() ? &mProfiler : nullptr}
+{
+    if(profiler != nullptr)
+    {
+        profiler->tickStart = Clock::now();
+        profiler->inLuaAtTickStart = profiler->inLua;
+    }
+}
+
+LuaProfiler::TickScope::~TickScope()
+{
+    if(profiler == nullptr)
+    {
+        return;
+    }
+
+    const Clock::duration total = Clock::now() - profiler->tickStart;
+    const Clock::duration inLua = profiler->inLua - profiler->inLuaAtTickStart;
+    const Clock::duration engine = total - inLua;
+
+    profiler->samples[engineStack] +=
+        std::max(engine, Clock::duration::zero());
+}
+
+[[nodiscard]] bool LuaProfiler::writeAndClear(
+    const std::filesystem::path& mPath)
+{
+    std::vector<std::pair<const std::string*, Clock::duration>> sorted;
+    sorted.reserve(samples.size());
+
+    for(const auto& [stack, time] : samples)
+    {
+        sorted.emplace_back(&stack, time);
+    }
+
+    std::sort(sorted.begin(), sorted.end(),
+        [](const auto& a, const auto& b) { return *a.first < *b.first; });
+
+    std::error_code ec;
+    std::filesystem::create_directories(mPath.parent_path(), ec);
+
+    std::ofstream os{mPath};
+
+    for(const auto& [stack, time] : sorted)
+    {
+        const auto us =
+            std::chrono::duration_cast<std::chrono::microseconds>(time);
+
+        if(us.count() > 0)
+        {
+            os << *stack << ' ' << us.count() << '\n';
+        }
+    }
+
+    os.flush();
+    samples.clear();
+
+    return static_cast<bool>(os);
+}
+
+} // namespace hg::Utils
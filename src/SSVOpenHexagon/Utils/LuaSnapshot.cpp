@@ -0,0 +1,415 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Utils/LuaSnapshot.hpp"
+
+#include <cassert>
+#include <utility>
+
+namespace hg::Utils
+{
+
+namespace
+{
+
+// The snapshot is a table with two maps:
+// * `[tablesKey]`: original table -> { contents copy, metatable or `false` }
+// * `[functionsKey]`: original Lua function -> { upvalues..., n = count }
+//
+// Entries are never modified once created, so several snapshots can share
+// them.
+constexpr int tablesKey = 1;
+constexpr int functionsKey = 2;
+
+// Pushes the entry of the table at `mIdx` from the `mBaseTables` map if the
+// table still has the same contents and metatable, returns `false` and
+// pushes nothing otherwise.
+[[nodiscard]] bool pushUnchangedTableEntry(
+    lua_State* mL, const int mIdx, const int mBaseTables)
+{
+    lua_pushvalue(mL, mIdx);
+    if(lua_rawget(mL, mBaseTables) != LUA_TTABLE)
+    {
+        lua_pop(mL, 1);
+        return false;
+    }
+
+    const int entry = lua_gettop(mL);
+
+    lua_rawgeti(mL, entry, 2);
+    if(!lua_getmetatable(mL, mIdx))
+    {
+        lua_pushboolean(mL, false);
+    }
+
+    bool unchanged = lua_rawequal(mL, -1, -2);
+    lua_pop(mL, 2);
+
+    lua_rawgeti(mL, entry, 1);
+    const int contents = lua_gettop(mL);
+
+    lua_Integer count = 0;
+
+    lua_pushnil(mL);
+    while(unchanged && lua_next(mL, mIdx) != 0)
+    {
+        lua_pushvalue(mL, -2);
+        lua_rawget(mL, contents);
+        unchanged = lua_rawequal(mL, -1, -2);
+        lua_pop(mL, 2);
+        ++count;
+    }
+
+    if(!unchanged)
+    {
+        // Traversal stopped early, the key is still on the stack
+        lua_pop(mL, 3);
+        return false;
+    }
+
+    // All the current fields match, check that none were removed
+    lua_pushnil(mL);
+    while(lua_next(mL, contents) != 0)
+    {
+        lua_pop(mL, 1);
+        --count;
+    }
+
+    lua_pop(mL, 1);
+
+    if(count != 0)
+    {
+        lua_pop(mL, 1);
+        return false;
+    }
+
+    return true;
+}
+
+// Same as `pushUnchangedTableEntry`, for the upvalues of the Lua function at
+// `mIdx` in the `mBaseFunctions` map.
+[[nodiscard]] bool pushUnchangedFunctionEntry(
+    lua_State* mL, const int mIdx, const int mBaseFunctions)
+{
+    lua_pushvalue(mL, mIdx);
+    if(lua_rawget(mL, mBaseFunctions) != LUA_TTABLE)
+    {
+        lua_pop(mL, 1);
+        return false;
+    }
+
+    const int entry = lua_gettop(mL);
+
+    lua_getfield(mL, entry, "n");
+    const int count = static_cast<int>(lua_tointeger(mL, -1));
+    lua_pop(mL, 1);
+
+    for(int i = 1; i <= count; ++i)
+    {
+        if(lua_getupvalue(mL, mIdx, i) == nullptr)
+        {
+            lua_pop(mL, 1);
+            return false;
+        }
+
+        lua_rawgeti(mL, entry, i);
+        const bool unchanged = lua_rawequal(mL, -1, -2);
+        lua_pop(mL, 2);
+
+        if(!unchanged)
+        {
+            lua_pop(mL, 1);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Absolute stack indices of the maps being filled, and of the maps of the
+// base snapshot (0 if there is none).
+struct Maps
+{
+    int tables;
+    int functions;
+    int baseTables;
+    int baseFunctions;
+};
+
+// Records the value at `mIdx` and everything reachable from it into the maps.
+// Leaves the stack as-is.
+void visit(lua_State* mL, int mIdx, const Maps& mMaps)
+{
+    mIdx = lua_absindex(mL, mIdx);
+    luaL_checkstack(mL, 8, "LuaSnapshot");
+
+    const int type = lua_type(mL, mIdx);
+
+    if(type == LUA_TTABLE)
+    {
+        lua_pushvalue(mL, mIdx);
+        if(lua_rawget(mL, mMaps.tables) != LUA_TNIL)
+        {
+            lua_pop(mL, 1);
+            return;
+        }
+        lua_pop(mL, 1);
+
+        // Tables left untouched since the base snapshot share its copy
+        if(mMaps.baseTables == 0 ||
+            !pushUnchangedTableEntry(mL, mIdx, mMaps.baseTables))
+        {
+            lua_createtable(mL, 2, 0);
+            const int entry = lua_gettop(mL);
+
+            lua_newtable(mL);
+            const int copy = lua_gettop(mL);
+
+            lua_pushnil(mL);
+            while(lua_next(mL, mIdx) != 0)
+            {
+                lua_pushvalue(mL, -2);
+                lua_pushvalue(mL, -2);
+                lua_rawset(mL, copy);
+                lua_pop(mL, 1);
+            }
+
+            if(!lua_getmetatable(mL, mIdx))
+            {
+                lua_pushboolean(mL, false);
+            }
+
+            lua_rawseti(mL, entry, 2);
+            lua_rawseti(mL, entry, 1);
+        }
+
+        const int entry = lua_gettop(mL);
+
+        // Register before recursing, cycles stop at the lookup above
+        lua_pushvalue(mL, mIdx);
+        lua_pushvalue(mL, entry);
+        lua_rawset(mL, mMaps.tables);
+
+        lua_rawgeti(mL, entry, 1);
+        const int contents = lua_gettop(mL);
+
+        lua_pushnil(mL);
+        while(lua_next(mL, contents) != 0)
+        {
+            visit(mL, -2, mMaps);
+            visit(mL, -1, mMaps);
+            lua_pop(mL, 1);
+        }
+
+        lua_rawgeti(mL, entry, 2);
+        visit(mL, -1, mMaps);
+
+        lua_pop(mL, 3);
+        return;
+    }
+
+    if(type == LUA_TFUNCTION && !lua_iscfunction(mL, mIdx))
+    {
+        lua_pushvalue(mL, mIdx);
+        if(lua_rawget(mL, mMaps.functions) != LUA_TNIL)
+        {
+            lua_pop(mL, 1);
+            return;
+        }
+        lua_pop(mL, 1);
+
+        if(mMaps.baseFunctions == 0 ||
+            !pushUnchangedFunctionEntry(mL, mIdx, mMaps.baseFunctions))
+        {
+            lua_newtable(mL);
+            const int upvalues = lua_gettop(mL);
+
+            int count = 0;
+            while(lua_getupvalue(mL, mIdx, count + 1) != nullptr)
+            {
+                ++count;
+                lua_rawseti(mL, upvalues, count);
+            }
+
+            lua_pushinteger(mL, count);
+            lua_setfield(mL, upvalues, "n");
+        }
+
+        const int upvalues = lua_gettop(mL);
+
+        lua_pushvalue(mL, mIdx);
+        lua_pushvalue(mL, upvalues);
+        lua_rawset(mL, mMaps.functions);
+
+        lua_getfield(mL, upvalues, "n");
+        const int count = static_cast<int>(lua_tointeger(mL, -1));
+        lua_pop(mL, 1);
+
+        for(int i = 1; i <= count; ++i)
+        {
+            lua_rawgeti(mL, upvalues, i);
+            visit(mL, -1, mMaps);
+            lua_pop(mL, 1);
+        }
+
+        lua_pop(mL, 1);
+    }
+}
+
+} // namespace
+
+LuaSnapshot::LuaSnapshot(lua_State* mState, const LuaSnapshot* mBase)
+    : state{mState}
+{
+    assert(mBase == nullptr || mBase->state == mState);
+
+    luaL_checkstack(state, 8, "LuaSnapshot");
+
+    lua_createtable(state, 2, 0);
+    const int snapshot = lua_gettop(state);
+
+    lua_newtable(state);
+    lua_rawseti(state, snapshot, tablesKey);
+
+    lua_newtable(state);
+    lua_rawseti(state, snapshot, functionsKey);
+
+    Maps maps{};
+
+    lua_rawgeti(state, snapshot, tablesKey);
+    maps.tables = lua_gettop(state);
+
+    lua_rawgeti(state, snapshot, functionsKey);
+    maps.functions = lua_gettop(state);
+
+    if(mBase != nullptr && mBase->state != nullptr)
+    {
+        lua_rawgeti(state, LUA_REGISTRYINDEX, mBase->ref);
+        const int base = lua_gettop(state);
+
+        lua_rawgeti(state, base, tablesKey);
+        maps.baseTables = lua_gettop(state);
+
+        lua_rawgeti(state, base, functionsKey);
+        maps.baseFunctions = lua_gettop(state);
+    }
+
+    lua_rawgeti(state, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+    visit(state, -1, maps);
+
+    // Everything above the snapshot table
+    lua_settop(state, snapshot);
+
+    ref = luaL_ref(state, LUA_REGISTRYINDEX);
+}
+
+LuaSnapshot::~LuaSnapshot()
+{
+    if(state != nullptr)
+    {
+        luaL_unref(state, LUA_REGISTRYINDEX, ref);
+    }
+}
+
+LuaSnapshot::LuaSnapshot(LuaSnapshot&& mRhs) noexcept
+    : state{std::exchange(mRhs.state, nullptr)},
+      ref{std::exchange(mRhs.ref, LUA_NOREF)}
+{
+}
+
+LuaSnapshot& LuaSnapshot::operator=(LuaSnapshot&& mRhs) noexcept
+{
+    std::swap(state, mRhs.state);
+    std::swap(ref, mRhs.ref);
+    return *this;
+}
+
+void LuaSnapshot::restore() const
+{
+    if(state == nullptr)
+    {
+        return;
+    }
+
+    luaL_checkstack(state, 8, "LuaSnapshot");
+
+    lua_rawgeti(state, LUA_REGISTRYINDEX, ref);
+    const int snapshot = lua_gettop(state);
+
+    // Tables: clear them, then write back the copied contents and metatable
+    lua_rawgeti(state, snapshot, tablesKey);
+    const int tables = lua_gettop(state);
+
+    lua_pushnil(state);
+    while(lua_next(state, tables) != 0)
+    {
+        const int entry = lua_gettop(state);
+        const int table = entry - 1;
+
+        // Clearing existing fields is allowed during traversal
+        lua_pushnil(state);
+        while(lua_next(state, table) != 0)
+        {
+            lua_pop(state, 1);
+            lua_pushvalue(state, -1);
+            lua_pushnil(state);
+            lua_rawset(state, table);
+        }
+
+        lua_rawgeti(state, entry, 1);
+        const int contents = lua_gettop(state);
+
+        lua_pushnil(state);
+        while(lua_next(state, contents) != 0)
+        {
+            lua_pushvalue(state, -2);
+            lua_insert(state, -2);
+            lua_rawset(state, table);
+        }
+
+        lua_pop(state, 1);
+
+        lua_rawgeti(state, entry, 2);
+        if(!lua_istable(state, -1))
+        {
+            lua_pop(state, 1);
+            lua_pushnil(state);
+        }
+
+        lua_setmetatable(state, table);
+        lua_pop(state, 1);
+    }
+
+    lua_pop(state, 1);
+
+    // Lua functions: write back their upvalues
+    lua_rawgeti(state, snapshot, functionsKey);
+    const int functions = lua_gettop(state);
+
+    lua_pushnil(state);
+    while(lua_next(state, functions) != 0)
+    {
+        const int upvalues = lua_gettop(state);
+        const int function = upvalues - 1;
+
+        lua_getfield(state, upvalues, "n");
+        const int count = static_cast<int>(lua_tointeger(state, -1));
+        lua_pop(state, 1);
+
+        for(int i = 1; i <= count; ++i)
+        {
+            lua_rawgeti(state, upvalues, i);
+            if(lua_setupvalue(state, function, i) == nullptr)
+            {
+                lua_pop(state, 1);
+            }
+        }
+
+        lua_pop(state, 1);
+    }
+
+    lua_pop(state, 2);
+}
+
+} // namespace hg::Utils
@@ -10,133 +10,511 @@
 #include <utility>
 #include <chrono>
 #include <optional>
-#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cassert>
 
 namespace hg::Utils
 {
 
-void timeline2::clear()
+[[nodiscard]] void* timeline2_arena::allocate(
+    const std::size_t size, const std::size_t align)
+{
+    while(_current_chunk < _chunks.size())
+    {
+        chunk& c = _chunks[_current_chunk];
+
+        const auto base = reinterpret_cast<std::uintptr_t>(c._data.get());
+        const std::size_t offset =
+            ((base + _used + align - 1) & ~(align - 1)) - base;
+
+        if(offset + size <= c._size)
+        {
+            _used = offset + size;
+            return c._data.get() + offset;
+        }
+
+        ++_current_chunk;
+        _used = 0;
+    }
+
+    // Big enough for `size` bytes, however the chunk is aligned
+    const std::size_t n = std::max(chunk_size, size + align);
+    _chunks.push_back(chunk{std::unique_ptr<std::byte[]>{new std::byte[n]}, n});
+
+    _current_chunk = _chunks.size() - 1;
+    _used = 0;
+
+    return allocate(size, align);
+}
+
+void timeline2_arena::reset() noexcept
+{
+    _current_chunk = 0;
+    _used = 0;
+}
+
+[[nodiscard]] std::size_t timeline2_arena::bytes_reserved() const noexcept
+{
+    std::size_t result{0};
+
+    for(const chunk& c : _chunks)
+    {
+        result += c._size;
+    }
+
+    return result;
+}
+
+timeline2::execution_guard::execution_guard(timeline2& timeline) noexcept
+    : _timeline{timeline}
+{
+    ++_timeline._executing;
+}
+
+timeline2::execution_guard::~execution_guard()
+{
+    --_timeline._executing;
+
+    if(_timeline._count == 0)
+    {
+        // Emptied while the callable was running
+        _timeline.reclaim();
+    }
+}
+
+[[nodiscard]] std::uint64_t timeline2::next_generation() noexcept
 {
-    _actions.clear();
+    // Unique across all timelines, a copy never matches its original
+    static std::atomic<std::uint64_t> counter{0};
+    return ++counter;
 }
 
-void timeline2::append_do(const std::function<void()>& func)
+[[nodiscard]] timeline2::action& timeline2::slot(const std::size_t i) noexcept
 {
-    _actions.emplace_back(action{action_do{func}});
+    return _actions[(_head + i) & (_actions.size() - 1)];
+}
+
+[[nodiscard]] timeline2::action timeline2::clone(const action& a)
+{
+    return match(
+        a._inner, //
+        [&](const action_do& x) {
+            return action{action_do{{x._func, &_arena}}};
+        },
+        [&](const action_wait_for& x) { return action{x}; },
+        [&](const action_wait_until& x) { return action{x}; },
+        [&](const action_wait_until_fn& x) {
+            return action{action_wait_until_fn{{x._time_point_fn, &_arena}}};
+        },
+        [&](const action_coroutine& x) {
+            return action{action_coroutine{{x._resume_fn, &_arena}}};
+        } //
+    );
+}
+
+void timeline2::grow()
+{
+    std::vector<action> actions(
+        std::max(initial_capacity, _actions.size() * 2));
+
+    for(std::size_t i = 0; i < _count; ++i)
+    {
+        actions[i] = std::move(slot(i));
+    }
+
+    _actions = std::move(actions);
+    _head = 0;
+}
+
+void timeline2::push_back(action&& a)
+{
+    if(_count == _actions.size())
+    {
+        grow();
+    }
+
+    slot(_count) = std::move(a);
+    ++_count;
+}
+
+void timeline2::push_front(action&& a)
+{
+    if(_count == _actions.size())
+    {
+        grow();
+    }
+
+    _head = (_head - 1) & (_actions.size() - 1);
+    _actions[_head] = std::move(a);
+    ++_count;
+}
+
+void timeline2::pop_front()
+{
+    assert(_count > 0);
+
+    // Releases the resources of the action right away
+    _actions[_head] = action{};
+    _head = (_head + 1) & (_actions.size() - 1);
+    --_count;
+
+    if(_count == 0)
+    {
+        reclaim();
+    }
+}
+
+void timeline2::reclaim() noexcept
+{
+    _head = 0;
+
+    if(_executing == 0)
+    {
+        _arena.reset();
+    }
+}
+
+timeline2::timeline2(const timeline2& other) : _actions(other._actions.size())
+{
+    for(std::size_t i = 0; i < other._count; ++i)
+    {
+        _actions[i] = clone(other._actions[(other._head + i) &
+                                           (other._actions.size() - 1)]);
+    }
+
+    _count = other._count;
+}
+
+timeline2::timeline2(timeline2&& other) noexcept
+    : _arena{std::move(other._arena)},
+      _actions{std::move(other._actions)},
+      _head{other._head},
+      _count{other._count}
+{
+    other._actions.clear();
+    other._head = 0;
+    other._count = 0;
+    other._generation = next_generation();
+}
+
+timeline2& timeline2::operator=(const timeline2& other)
+{
+    if(this != &other)
+    {
+        timeline2 copy{other};
+        *this = std::move(copy);
+    }
+
+    return *this;
+}
+
+timeline2& timeline2::operator=(timeline2&& other) noexcept
+{
+    if(this != &other)
+    {
+        // The actions must go before the arena they might be stored in
+        _actions = std::move(other._actions);
+        _arena = std::move(other._arena);
+        _head = other._head;
+        _count = other._count;
+        _generation = next_generation();
+
+        other._actions.clear();
+        other._head = 0;
+        other._count = 0;
+        other._generation = next_generation();
+    }
+
+    return *this;
+}
+
+void timeline2::clear()
+{
+    for(std::size_t i = 0; i < _count; ++i)
+    {
+        slot(i) = action{};
+    }
+
+    _count = 0;
+    _generation = next_generation();
+    reclaim();
 }
 
 void timeline2::append_wait_for(const duration d)
 {
-    _actions.emplace_back(action{action_wait_for{d}});
+    push_back(action{action_wait_for{d}});
 }
 
 void timeline2::append_wait_for_seconds(const double s)
 {
-    append_wait_for(std::chrono::milliseconds(static_cast<int>(s * 1000.0)));
+    append_wait_for(duration_from_seconds(s));
 }
 
 void timeline2::append_wait_for_sixths(const double s)
 {
-    append_wait_for_seconds(s / 60.0);
+    append_wait_for(duration_from_sixths(s));
 }
 
 void timeline2::append_wait_until(const time_point tp)
 {
-    _actions.emplace_back(action{action_wait_until{tp}});
+    push_back(action{action_wait_until{tp}});
 }
 
-void timeline2::append_wait_until_fn(const std::function<time_point()>& tp_fn)
+[[nodiscard]] timeline2::duration timeline2::duration_from_seconds(
+    const double s)
 {
-    _actions.emplace_back(action{action_wait_until_fn{tp_fn}});
+    return clock::from_seconds(s);
+}
+
+[[nodiscard]] timeline2::duration timeline2::duration_from_sixths(
+    const double s)
+{
+    return clock::from_frametime(s);
 }
 
 [[nodiscard]] std::size_t timeline2::size() const noexcept
 {
-    return _actions.size();
+    return _count;
+}
+
+[[nodiscard]] bool timeline2::empty() const noexcept
+{
+    return _count == 0;
 }
 
 [[nodiscard]] timeline2::action& timeline2::action_at(
     const std::size_t i) noexcept
 {
     assert(i < size());
-    return _actions[i];
+    return slot(i);
+}
+
+[[nodiscard]] std::size_t timeline2::memory_usage() const noexcept
+{
+    return _actions.size() * sizeof(action) + _arena.bytes_reserved();
+}
+
+[[nodiscard]] std::uint64_t timeline2::generation() const noexcept
+{
+    return _generation;
+}
+
+[[nodiscard]] timeline2_runner::outcome timeline2_runner::wait_for(
+    const timeline2::action_wait_for& x, const time_point tp)
+{
+    if(!_wait_start_tp.has_value())
+    {
+        // Just started waiting.
+        _wait_start_tp = tp;
+    }
+
+    const auto elapsed = tp - _wait_start_tp.value();
+    if(elapsed < x._duration)
+    {
+        // Still waiting.
+        return outcome::waiting;
+    }
+
+    // Finished waiting.
+    _wait_start_tp.reset();
+    return outcome::proceed;
+}
+
+[[nodiscard]] timeline2_runner::outcome timeline2_runner::wait_until(
+    const timeline2::action_wait_until& x, const time_point tp)
+{
+    if(tp < x._time_point)
+    {
+        // Still waiting.
+        return outcome::waiting;
+    }
+
+    // Finished waiting.
+    return outcome::proceed;
+}
+
+[[nodiscard]] timeline2_runner::outcome timeline2_runner::wait_until_fn(
+    const timeline2::action_wait_until_fn& x, const time_point tp)
+{
+    if(tp < x._time_point_fn())
+    {
+        // Still waiting.
+        return outcome::waiting;
+    }
+
+    // Finished waiting.
+    return outcome::proceed;
+}
+
+[[nodiscard]] timeline2_runner::outcome timeline2_runner::wait(
+    const timeline2::wait_action& x, const time_point tp)
+{
+    return match(
+        x, //
+        [&](const timeline2::action_wait_for& y) { return wait_for(y, tp); },
+        [&](const timeline2::action_wait_until& y) {
+            return wait_until(y, tp);
+        }, //
+        [&](const timeline2::action_wait_until_fn& y) {
+            return wait_until_fn(y, tp);
+        } //
+    );
+}
+
+[[nodiscard]] timeline2_runner::outcome timeline2_runner::resume(
+    const timeline2::action_coroutine& x, const time_point tp)
+{
+    while(true)
+    {
+        if(_coroutine_wait.has_value())
+        {
+            if(wait(*_coroutine_wait, tp) == outcome::waiting)
+            {
+                return outcome::waiting;
+            }
+
+            _coroutine_wait.reset();
+        }
+
+        // Waits that are already over are skipped within the same update,
+        // like consecutive actions of the timeline.
+        _coroutine_wait = x._resume_fn();
+        if(!_coroutine_wait.has_value())
+        {
+            // The coroutine has finished.
+            return outcome::proceed;
+        }
+    }
+}
+
+[[nodiscard]] std::optional<timeline2_runner::time_point>
+timeline2_runner::due(const timeline2::wait_action& x) const
+{
+    return match(
+        x, //
+        [&](const timeline2::action_wait_for& y) -> std::optional<time_point> {
+            return _wait_start_tp.value() + y._duration;
+        },
+        [&](const timeline2::action_wait_until& y)
+            -> std::optional<time_point> { return y._time_point; }, //
+        [&](const timeline2::action_wait_until_fn&)
+            -> std::optional<time_point> {
+            // Might change at any time
+            return std::nullopt;
+        } //
+    );
+}
+
+[[nodiscard]] std::optional<timeline2_runner::time_point>
+timeline2_runner::due(const timeline2::action& x) const
+{
+    return match(
+        x._inner, //
+        [&](const timeline2::action_do&) -> std::optional<time_point> {
+            return std::nullopt;
+        },
+        [&](const timeline2::action_wait_for& y) {
+            return due(timeline2::wait_action{y});
+        },
+        [&](const timeline2::action_wait_until& y) {
+            return due(timeline2::wait_action{y});
+        }, //
+        [&](const timeline2::action_wait_until_fn&)
+            -> std::optional<time_point> { return std::nullopt; }, //
+        [&](const timeline2::action_coroutine&) -> std::optional<time_point> {
+            if(!_coroutine_wait.has_value())
+            {
+                return std::nullopt;
+            }
+
+            return due(*_coroutine_wait);
+        } //
+    );
 }
 
 timeline2_runner::outcome timeline2_runner::update(
     timeline2& timeline, const time_point tp)
 {
-    if(_current_idx >= timeline.size())
+    if(_due_tp.has_value())
     {
-        // Empty timeline or reached the end.
-        return outcome::finished;
+        if(tp < *_due_tp && timeline.generation() == _due_generation)
+        {
+            // Nothing can have changed before then.
+            return outcome::waiting;
+        }
+
+        _due_tp.reset();
     }
 
-    while(_current_idx < timeline.size())
+    // Executed actions are popped, the next one is always at the front.
+    while(!timeline.empty())
     {
-        timeline2::action& a = timeline.action_at(_current_idx);
+        const auto done = [&](const outcome o) {
+            if(o == outcome::proceed)
+            {
+                timeline.pop_front();
+            }
+
+            return o;
+        };
 
         const outcome o = match(
-            a._inner, //
-            [&](const timeline2::action_do& x) {
-                x._func();
-                return outcome::proceed;
-            },
-            [&](const timeline2::action_wait_for& x) {
-                if(!_wait_start_tp.has_value())
-                {
-                    // Just started waiting.
-                    _wait_start_tp = tp;
-                }
+            timeline.action_at(0)._inner, //
+            [&](timeline2::action_do& x) {
+                // The callable can append to or clear the timeline, so it is
+                // taken out of it before running.
+                const timeline2::execution_guard guard{timeline};
+                const timeline2::action_do current{std::move(x)};
 
-                const auto elapsed = tp - _wait_start_tp.value();
-                if(elapsed < x._duration)
-                {
-                    // Still waiting.
-                    return outcome::waiting;
-                }
+                timeline.pop_front();
+                current._func();
 
-                // Finished waiting.
-                _wait_start_tp.reset();
                 return outcome::proceed;
             },
+            [&](const timeline2::action_wait_for& x) {
+                return done(wait_for(x, tp));
+            },
             [&](const timeline2::action_wait_until& x) {
-                if(tp < x._time_point)
-                {
-                    // Still waiting.
-                    return outcome::waiting;
-                }
-
-                // Finished waiting.
-                return outcome::proceed;
+                return done(wait_until(x, tp));
             }, //
             [&](const timeline2::action_wait_until_fn& x) {
-                if(tp < x._time_point_fn())
+                return done(wait_until_fn(x, tp));
+            }, //
+            [&](timeline2::action_coroutine& x) {
+                // Same as above, it goes back to the front while suspended.
+                const timeline2::execution_guard guard{timeline};
+                timeline2::action_coroutine current{std::move(x)};
+
+                timeline.pop_front();
+
+                const outcome result = resume(current, tp);
+                if(result == outcome::waiting)
                 {
-                    // Still waiting.
-                    return outcome::waiting;
+                    timeline.push_front(timeline2::action{std::move(current)});
                 }
 
-                // Finished waiting.
-                return outcome::proceed;
+                return result;
             } //
         );
 
-        if(o == outcome::proceed)
-        {
-            ++_current_idx;
-            continue;
-        }
-
         if(o == outcome::waiting)
         {
+            _due_tp = due(timeline.action_at(0));
+            _due_generation = timeline.generation();
+
             return o;
         }
-
-        assert(false);
     }
 
     return outcome::finished;
 }
 
+[[nodiscard]] std::optional<timeline2_runner::time_point>
+timeline2_runner::next_due() const noexcept
+{
+    return _due_tp;
+}
+
 } // namespace hg::Utils
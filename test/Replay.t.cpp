@@ -2,11 +2,19 @@
 // License: Academic Free License ("AFL") v. 3.0
 // AFL License page: https://opensource.org/licenses/AFL-3.0
 
+#include "SSVOpenHexagon/Core/MappedReplay.hpp"
 #include "SSVOpenHexagon/Core/Replay.hpp"
+#include "SSVOpenHexagon/Core/ReplayIndex.hpp"
+#include "SSVOpenHexagon/Core/ReplayStreamWriter.hpp"
 
 #include "TestUtils.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <random>
+#include <vector>
 
 static void test_replay_data_basic()
 {
@@ -80,6 +88,151 @@ static void test_replay_data_serialization_to_buffer_too_small()
     TEST_ASSERT_NS(!rd.serialize(buf, buf_size));
 }
 
+static void test_replay_data_serialization_unpacked()
+{
+    hg::replay_data rd;
+
+    rd.record_input(false, false, false, false);
+    rd.record_input(false, true, false, false);
+    rd.record_input(false, true, false, false);
+    rd.record_input(true, false, false, true);
+
+    constexpr std::size_t buf_size{1024};
+    std::byte buf[buf_size];
+
+    const auto sr = rd.serialize(buf, buf_size, hg::replay_version_unpacked);
+    TEST_ASSERT_NS(sr);
+    TEST_ASSERT_EQ(sr.written_bytes(), sizeof(std::size_t) + 4);
+
+    // One byte per input
+    TEST_ASSERT_NS_EQ(buf[sizeof(std::size_t) + 0], std::byte{0b0000});
+    TEST_ASSERT_NS_EQ(buf[sizeof(std::size_t) + 1], std::byte{0b0010});
+    TEST_ASSERT_NS_EQ(buf[sizeof(std::size_t) + 2], std::byte{0b0010});
+    TEST_ASSERT_NS_EQ(buf[sizeof(std::size_t) + 3], std::byte{0b1001});
+
+    hg::replay_data rd_out;
+    TEST_ASSERT_NS(
+        rd_out.deserialize(buf, buf_size, hg::replay_version_unpacked));
+
+    TEST_ASSERT_NS_EQ(rd_out, rd);
+}
+
+static void test_replay_data_deserialization_unpacked_invalid_input()
+{
+    hg::replay_data rd;
+    rd.record_input(false, true, false, false);
+    rd.record_input(true, false, false, true);
+
+    constexpr std::size_t buf_size{1024};
+    std::byte buf[buf_size];
+
+    TEST_ASSERT_NS(rd.serialize(buf, buf_size, hg::replay_version_unpacked));
+
+    // A byte with bits other than the four inputs set would be confused with
+    // a run tag once re-serialized in the packed format
+    buf[sizeof(std::size_t) + 1] = std::byte{0x82};
+
+    hg::replay_data rd_out;
+    TEST_ASSERT_NS(
+        !rd_out.deserialize(buf, buf_size, hg::replay_version_unpacked));
+}
+
+static void test_replay_data_serialization_packed_long_runs()
+{
+    hg::replay_data rd;
+
+    // Long stretches of unchanged input, as in a typical survival run
+    for(int i = 0; i < 1000; ++i)
+    {
+        const bool left = i % 2 == 0;
+        const int run_length = 20 + (i * 7) % 100;
+
+        for(int j = 0; j < run_length; ++j)
+        {
+            rd.record_input(left, !left, false, i % 3 == 0);
+        }
+    }
+
+    rd.record_input(true, false, true, false);
+    rd.record_input(false, true, false, false);
+    rd.record_input(false, false, false, true);
+
+    TEST_ASSERT_EQ(rd.run_count(), 1003);
+
+    constexpr std::size_t buf_size{262144};
+    static std::byte buf[buf_size];
+
+    const auto sr_unpacked =
+        rd.serialize(buf, buf_size, hg::replay_version_unpacked);
+    TEST_ASSERT_NS(sr_unpacked);
+
+    const auto sr_packed =
+        rd.serialize(buf, buf_size, hg::replay_version_packed);
+    TEST_ASSERT_NS(sr_packed);
+
+    TEST_ASSERT_GT(sr_unpacked.written_bytes(), sr_packed.written_bytes() * 10);
+
+    hg::replay_data rd_out;
+    const auto dr =
+        rd_out.deserialize(buf, buf_size, hg::replay_version_packed);
+    TEST_ASSERT_NS(dr);
+    TEST_ASSERT_EQ(dr.read_bytes(), sr_packed.written_bytes());
+
+    TEST_ASSERT_NS_EQ(rd_out, rd);
+
+    for(std::size_t i = 0; i < rd.size(); ++i)
+    {
+        TEST_ASSERT_EQ(rd_out.at(i), rd.at(i));
+    }
+}
+
+static void test_replay_data_deserialization_packed_truncated()
+{
+    hg::replay_data rd;
+
+    for(int i = 0; i < 64; ++i)
+    {
+        rd.record_input(i % 5 == 0, i % 3 == 0, false, i % 2 == 0);
+    }
+
+    constexpr std::size_t buf_size{1024};
+    std::byte buf[buf_size];
+
+    const auto sr = rd.serialize(buf, buf_size, hg::replay_version_packed);
+    TEST_ASSERT_NS(sr);
+
+    hg::replay_data rd_out;
+    TEST_ASSERT_NS(!rd_out.deserialize(
+        buf, sr.written_bytes() - 1, hg::replay_version_packed));
+}
+
+static void test_replay_data_append_and_slice()
+{
+    hg::replay_data rd;
+
+    for(int i = 0; i < 100; ++i)
+    {
+        rd.record_input(i < 50, i >= 50, i % 10 == 0, false);
+    }
+
+    hg::replay_data joined;
+    joined.append(rd.slice(0, 37));
+    joined.append(rd.slice(37, 50));
+    joined.append(rd.slice(50, 1000));
+
+    TEST_ASSERT_NS_EQ(joined, rd);
+    TEST_ASSERT_EQ(rd.slice(60, 60).size(), 0);
+    TEST_ASSERT_EQ(rd.slice(200, 300).size(), 0);
+
+    const hg::replay_data middle = rd.slice(45, 55);
+    TEST_ASSERT_EQ(middle.size(), 10);
+
+    for(std::size_t i = 0; i < middle.size(); ++i)
+    {
+        TEST_ASSERT_EQ(middle.at(i), rd.at(45 + i));
+    }
+}
+
 static void test_replay_player_basic()
 {
     hg::replay_data rd;
@@ -124,6 +277,56 @@ static void test_replay_player_basic()
     TEST_ASSERT(rp.done());
 }
 
+static void test_replay_player_seek()
+{
+    hg::replay_data rd;
+
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<int> run_length_dist{1, 30};
+    std::uniform_int_distribution<int> bit_dist{0, 1};
+
+    for(int i = 0; i < 200; ++i)
+    {
+        const bool left = bit_dist(rng);
+        const bool swap = bit_dist(rng);
+        const int run_length = run_length_dist(rng);
+
+        for(int j = 0; j < run_length; ++j)
+        {
+            rd.record_input(left, !left, swap, false);
+        }
+    }
+
+    hg::replay_player rp{rd};
+
+    // Sequential playback follows the runs
+    for(std::size_t i = 0; i < rd.size(); ++i)
+    {
+        TEST_ASSERT_EQ(rp.get_current_and_move_forward(), rd.at(i));
+    }
+
+    TEST_ASSERT(rp.done());
+
+    // Seeking backwards and forwards resumes from the right run
+    std::uniform_int_distribution<std::size_t> index_dist{0, rd.size()};
+
+    for(int i = 0; i < 100; ++i)
+    {
+        const std::size_t index = index_dist(rng);
+        rp.seek(index);
+
+        TEST_ASSERT_EQ(rp.get_current_index(), index);
+
+        for(std::size_t j = index; j < std::min(index + 50, rd.size()); ++j)
+        {
+            TEST_ASSERT_EQ(rp.get_current_and_move_forward(), rd.at(j));
+        }
+    }
+
+    rp.reset();
+    TEST_ASSERT_EQ(rp.get_current_and_move_forward(), rd.at(0));
+}
+
 static void test_replay_file_serialization_to_buffer()
 {
     hg::replay_data rd;
@@ -160,6 +363,353 @@ static void test_replay_file_serialization_to_buffer()
     TEST_ASSERT_NS_EQ(rf_out, rf);
 }
 
+static void test_replay_file_serialization_unpacked_version()
+{
+    hg::replay_data rd;
+
+    rd.record_input(false, false, false, false);
+    rd.record_input(true, false, true, false);
+
+    hg::replay_file rf{
+        //
+        ._version{hg::replay_version_unpacked},
+        ._player_name{"old replay"},
+        ._seed{42},
+        ._data{rd},
+        ._pack_id{"pack"},
+        ._level_id{"level"},
+        ._first_play{true},
+        ._difficulty_mult{1.f},
+        ._played_score{5.f}
+        //
+    };
+
+    constexpr std::size_t buf_size{2048};
+    std::byte buf[buf_size];
+
+    TEST_ASSERT_NS(rf.serialize(buf, buf_size));
+
+    hg::replay_file rf_out;
+    TEST_ASSERT_NS(rf_out.deserialize(buf, buf_size));
+
+    TEST_ASSERT_NS_EQ(rf_out, rf);
+    TEST_ASSERT_EQ(rf_out._version, hg::replay_version_unpacked);
+}
+
+static void test_replay_file_serialization_compressed()
+{
+    hg::replay_data rd;
+
+    for(int i = 0; i < 4096; ++i)
+    {
+        rd.record_input(i % 7 == 0, i % 11 == 0, i % 13 == 0, i % 2 == 0);
+    }
+
+    hg::replay_file rf{
+        //
+        ._version{hg::replay_version_latest},
+        ._player_name{"hello world"},
+        ._seed{12345},
+        ._data{rd},
+        ._pack_id{"totally real pack id"},
+        ._level_id{"legit level id"},
+        ._first_play{false},
+        ._difficulty_mult{2.5f},
+        ._played_score{100.f},
+        ._compressed{true}
+        //
+    };
+
+    constexpr std::size_t buf_size{8192};
+    std::byte buf[buf_size];
+
+    const auto sr = rf.serialize(buf, buf_size);
+    TEST_ASSERT_NS(sr);
+
+    hg::replay_file rf_out;
+    const auto dr = rf_out.deserialize(buf, buf_size);
+    TEST_ASSERT_NS(dr);
+    TEST_ASSERT_EQ(dr.read_bytes(), sr.written_bytes());
+
+    TEST_ASSERT_NS_EQ(rf_out, rf);
+    TEST_ASSERT(rf_out._compressed);
+
+    // The data ends the file, after its uncompressed and compressed sizes
+    std::size_t sizes_offset = 0;
+    for(std::size_t i = 0; i + 8 <= sr.written_bytes(); ++i)
+    {
+        std::uint32_t compressed_size;
+        std::memcpy(&compressed_size, buf + i + 4, sizeof(std::uint32_t));
+
+        if(compressed_size == sr.written_bytes() - i - 8)
+        {
+            sizes_offset = i;
+            break;
+        }
+    }
+
+    TEST_ASSERT(sizes_offset > 0);
+
+    std::uint32_t uncompressed_size;
+    std::memcpy(&uncompressed_size, buf + sizes_offset, sizeof(std::uint32_t));
+
+    // Data inflating to more or less than the declared size, or declared too
+    // large, must be rejected without being inflated
+    for(const std::uint32_t declared_size : {uncompressed_size - 1,
+            uncompressed_size + 1, std::uint32_t{0xFFFFFFFF}})
+    {
+        std::memcpy(buf + sizes_offset, &declared_size, sizeof(std::uint32_t));
+        TEST_ASSERT_NS(!rf_out.deserialize(buf, sr.written_bytes()));
+    }
+
+    std::memcpy(buf + sizes_offset, &uncompressed_size, sizeof(std::uint32_t));
+    TEST_ASSERT_NS(rf_out.deserialize(buf, sr.written_bytes()));
+
+    // Corrupted compressed data must be rejected
+    buf[sr.written_bytes() - 4] ^= std::byte{0xFF};
+    TEST_ASSERT_NS(!rf_out.deserialize(buf, sr.written_bytes()));
+}
+
+static void test_replay_file_deserialize_header()
+{
+    hg::replay_data rd;
+
+    rd.record_input(false, false, false, false);
+    rd.record_input(true, false, true, false);
+
+    for(const std::uint32_t version :
+        {hg::replay_version_unpacked, hg::replay_version_packed,
+            hg::replay_version_header_first, hg::replay_version_tick_clock})
+    {
+        for(const bool compressed : {false, true})
+        {
+            hg::replay_file rf{
+                //
+                ._version{version},
+                ._player_name{"hello world"},
+                ._seed{12345},
+                ._data{rd},
+                ._pack_id{"totally real pack id"},
+                ._level_id{"legit level id"},
+                ._first_play{true},
+                ._difficulty_mult{1.5f},
+                ._played_score{42.f},
+                ._compressed{
+                    compressed && version >= hg::replay_version_header_first}
+                //
+            };
+
+            constexpr std::size_t buf_size{2048};
+            std::byte buf[buf_size];
+
+            const auto sr = rf.serialize(buf, buf_size);
+            TEST_ASSERT_NS(sr);
+
+            // From version 2 the input data is not needed to read the header
+            const bool header_first =
+                version >= hg::replay_version_header_first;
+
+            const std::size_t header_bytes =
+                header_first ? sr.written_bytes() - 1 : sr.written_bytes();
+
+            hg::replay_file rf_out;
+            TEST_ASSERT_NS(rf_out.deserialize_header(buf, header_bytes));
+
+            TEST_ASSERT_EQ(rf_out._version, rf._version);
+            TEST_ASSERT_EQ(rf_out._player_name, rf._player_name);
+            TEST_ASSERT_EQ(rf_out._pack_id, rf._pack_id);
+            TEST_ASSERT_EQ(rf_out._level_id, rf._level_id);
+            TEST_ASSERT_EQ(rf_out._difficulty_mult, rf._difficulty_mult);
+            TEST_ASSERT_EQ(rf_out._played_score, rf._played_score);
+            TEST_ASSERT_EQ(rf_out._data.size(), 0);
+        }
+    }
+}
+
+static void test_replay_file_state_hashes()
+{
+    hg::replay_data rd;
+
+    for(int i = 0; i < 1000; ++i)
+    {
+        rd.record_input(i % 3 == 0, i % 5 == 0, false, i % 2 == 0);
+    }
+
+    hg::replay_file rf{
+        //
+        ._version{hg::replay_version_latest},
+        ._player_name{"hello world"},
+        ._seed{12345},
+        ._data{rd},
+        ._pack_id{"totally real pack id"},
+        ._level_id{"legit level id"},
+        ._first_play{true},
+        ._difficulty_mult{1.f},
+        ._played_score{500.f},
+        ._compressed{false},
+        ._streamed{false},
+        ._state_hash_interval{300},
+        ._state_hashes{0xDEADBEEF, 0x12345678, 0xCAFEBABE}
+        //
+    };
+
+    constexpr std::size_t buf_size{4096};
+    std::byte buf[buf_size];
+
+    const auto sr = rf.serialize(buf, buf_size);
+    TEST_ASSERT_NS(sr);
+
+    hg::replay_file rf_out;
+    const auto dr = rf_out.deserialize(buf, buf_size);
+    TEST_ASSERT_NS(dr);
+    TEST_ASSERT_EQ(dr.read_bytes(), sr.written_bytes());
+    TEST_ASSERT_NS_EQ(rf_out, rf);
+
+    // Hashes are part of the header
+    hg::replay_file header_out;
+    TEST_ASSERT_NS(header_out.deserialize_header(buf, sr.written_bytes()));
+    TEST_ASSERT_EQ(header_out._state_hash_interval, 300);
+    TEST_ASSERT_EQ(header_out._state_hashes.size(), 3);
+
+    // Hash `k` is checked after `(k + 1) * interval` inputs
+    TEST_ASSERT(!rf.has_state_hash(0));
+    TEST_ASSERT(!rf.has_state_hash(299));
+    TEST_ASSERT(rf.has_state_hash(300));
+    TEST_ASSERT(rf.has_state_hash(900));
+    TEST_ASSERT(!rf.has_state_hash(1200));
+
+    TEST_ASSERT(!rf.state_hash_mismatch(600, 0x12345678));
+    TEST_ASSERT(rf.state_hash_mismatch(600, 0x12345679));
+    TEST_ASSERT(!rf.state_hash_mismatch(1200, 0));
+
+    // Hashes are not stored by older versions
+    rf._version = hg::replay_version_packed;
+    const auto sr_old = rf.serialize(buf, buf_size);
+    TEST_ASSERT_NS(sr_old);
+    TEST_ASSERT_NS(rf_out.deserialize(buf, buf_size));
+    TEST_ASSERT(rf_out._state_hashes.empty());
+}
+
+static void test_replay_file_serialization_streamed()
+{
+    hg::replay_data rd;
+
+    for(int i = 0; i < 1000; ++i)
+    {
+        rd.record_input(i % 3 == 0, i % 5 == 0, false, i % 7 == 0);
+    }
+
+    hg::replay_file rf{
+        //
+        ._version{hg::replay_version_latest},
+        ._player_name{"hello world"},
+        ._seed{12345},
+        ._data{},
+        ._pack_id{"totally real pack id"},
+        ._level_id{"legit level id"},
+        ._first_play{false},
+        ._difficulty_mult{2.5f},
+        ._played_score{100.f},
+        ._compressed{false},
+        ._streamed{true}
+        //
+    };
+
+    constexpr std::size_t buf_size{8192};
+    std::byte buf[buf_size];
+
+    // Header, then one chunk per `replay_data` serialization
+    const auto sr = rf.serialize(buf, buf_size);
+    TEST_ASSERT_NS(sr);
+
+    std::size_t size = sr.written_bytes();
+
+    for(std::size_t i = 0; i < rd.size(); i += 300)
+    {
+        const auto chunk_sr = rd.slice(i, i + 300).serialize(
+            buf + size, buf_size - size, hg::replay_version_packed);
+
+        TEST_ASSERT_NS(chunk_sr);
+        size += chunk_sr.written_bytes();
+    }
+
+    hg::replay_file rf_out;
+    TEST_ASSERT_NS(rf_out.deserialize(buf, size));
+    TEST_ASSERT(rf_out._streamed);
+    TEST_ASSERT_NS_EQ(rf_out._data, rd);
+
+    // An interrupted last chunk is dropped
+    TEST_ASSERT_NS(rf_out.deserialize(buf, size - 1));
+    TEST_ASSERT_EQ(rf_out._data.size(), 900);
+    TEST_ASSERT_NS_EQ(rf_out._data, rd.slice(0, 900));
+
+    // Streamed data cannot be compressed
+    rf._compressed = true;
+    TEST_ASSERT_NS(!rf.serialize(buf, buf_size));
+}
+
+static void test_replay_stream_writer()
+{
+    const std::filesystem::path part_path{"test.ohr.part"};
+    const std::filesystem::path final_path{"test_final.ohr"};
+
+    std::filesystem::remove(part_path);
+    std::filesystem::remove(final_path);
+
+    hg::replay_data rd;
+
+    hg::replay_file rf{
+        //
+        ._version{hg::replay_version_latest},
+        ._player_name{"hello world"},
+        ._seed{12345},
+        ._data{},
+        ._pack_id{"totally real pack id"},
+        ._level_id{"legit level id"},
+        ._first_play{true},
+        ._difficulty_mult{1.5f},
+        ._played_score{0.f}
+        //
+    };
+
+    {
+        hg::replay_stream_writer writer{part_path};
+        writer.begin(rf);
+
+        const std::size_t n_inputs = hg::replay_stream_writer::chunk_inputs * 3;
+        for(std::size_t i = 0; i < n_inputs + 10; ++i)
+        {
+            rd.record_input(i % 40 < 20, i % 40 >= 20, false, i % 100 < 3);
+            writer.update(rd, static_cast<double>(i));
+        }
+
+        writer.wait_idle();
+
+        // What was streamed so far is a playable replay
+        hg::replay_file rf_part;
+        TEST_ASSERT(rf_part.deserialize_from_file(part_path));
+        TEST_ASSERT_EQ(rf_part._data.size(), n_inputs);
+        TEST_ASSERT_NS_EQ(rf_part._data, rd.slice(0, n_inputs));
+        TEST_ASSERT_EQ(rf_part._played_score, n_inputs - 1);
+        TEST_ASSERT_EQ(rf_part._player_name, rf._player_name);
+
+        rf._data = rd;
+        rf._played_score = 1234.0;
+        rf._compressed = true;
+
+        writer.finish(rf, final_path);
+        writer.wait_idle();
+    }
+
+    TEST_ASSERT(!std::filesystem::exists(part_path));
+
+    hg::replay_file rf_out;
+    TEST_ASSERT(rf_out.deserialize_from_file(final_path));
+    TEST_ASSERT_NS_EQ(rf_out, rf);
+
+    std::filesystem::remove(final_path);
+}
+
 static void test_replay_file_serialization_to_file()
 {
     hg::replay_data rd;
@@ -191,6 +741,177 @@ static void test_replay_file_serialization_to_file()
     TEST_ASSERT(rf_out.deserialize_from_file("test.ohr"));
 
     TEST_ASSERT_NS_EQ(rf_out, rf);
+
+    // Missing files are reported, not read
+    TEST_ASSERT(!rf_out.deserialize_from_file("missing.ohr"));
+    TEST_ASSERT(!rf_out.deserialize_header_from_file("missing.ohr"));
+}
+
+static void test_mapped_replay_file()
+{
+    hg::replay_data rd;
+
+    for(int i = 0; i < 3000; ++i)
+    {
+        rd.record_input(i % 50 < 30, i % 50 >= 30, i % 9 == 0, i % 400 < 100);
+    }
+
+    for(const std::uint32_t version :
+        {hg::replay_version_unpacked, hg::replay_version_packed,
+            hg::replay_version_header_first, hg::replay_version_tick_clock})
+    {
+        for(const bool compressed : {false, true})
+        {
+            hg::replay_file rf{
+                //
+                ._version{version},
+                ._player_name{"hello world"},
+                ._seed{12345},
+                ._data{rd},
+                ._pack_id{"totally real pack id"},
+                ._level_id{"legit level id"},
+                ._first_play{true},
+                ._difficulty_mult{1.5f},
+                ._played_score{42.f},
+                ._compressed{
+                    compressed && version >= hg::replay_version_header_first}
+                //
+            };
+
+            TEST_ASSERT(rf.serialize_to_file("test.ohr"));
+
+            hg::mapped_replay_file mrf;
+            TEST_ASSERT(mrf.open("test.ohr"));
+
+            const hg::replay_file& rf_out = mrf.get_replay_file();
+            TEST_ASSERT_EQ(rf_out._version, rf._version);
+            TEST_ASSERT_EQ(rf_out._level_id, rf._level_id);
+            TEST_ASSERT_EQ(rf_out._played_score, rf._played_score);
+            TEST_ASSERT_EQ(mrf.size(), rd.size());
+
+            hg::replay_player rp = mrf.make_player();
+
+            for(std::size_t i = 0; i < rd.size(); ++i)
+            {
+                TEST_ASSERT(!rp.done());
+                TEST_ASSERT_EQ(rp.get_current_and_move_forward(), rd.at(i));
+            }
+
+            TEST_ASSERT(rp.done());
+
+            // Seeking backwards and forwards
+            for(const std::size_t index : {2500, 17, 1234, 1235, 0, 2999})
+            {
+                rp.seek(index);
+                TEST_ASSERT_EQ(rp.get_current_index(), index);
+                TEST_ASSERT_EQ(rp.get_current_and_move_forward(), rd.at(index));
+            }
+        }
+    }
+
+    // Corrupted input data is rejected when opening
+    hg::replay_file rf{
+        //
+        ._version{hg::replay_version_latest},
+        ._player_name{"hello world"},
+        ._seed{12345},
+        ._data{rd},
+        ._pack_id{"totally real pack id"},
+        ._level_id{"legit level id"},
+        ._first_play{true},
+        ._difficulty_mult{1.5f},
+        ._played_score{42.f}
+        //
+    };
+
+    std::vector<std::byte> buf;
+    TEST_ASSERT(rf.serialize_to_buffer(buf));
+
+    {
+        std::ofstream os("test.ohr", std::ios::binary | std::ios::out);
+        os.write(reinterpret_cast<const char*>(buf.data()), buf.size() - 1);
+    }
+
+    hg::mapped_replay_file mrf;
+    TEST_ASSERT(!mrf.open("test.ohr"));
+}
+
+static void test_replay_index()
+{
+    const std::filesystem::path folder{"test_replay_index"};
+    std::filesystem::remove_all(folder);
+    std::filesystem::create_directory(folder);
+
+    hg::replay_data rd;
+    rd.record_input(false, true, false, false);
+
+    const auto write_replay = [&](const std::string& filename,
+                                  const std::string& level_id,
+                                  const float difficulty_mult,
+                                  const double score) {
+        const hg::replay_file rf{
+            //
+            ._version{hg::replay_version_latest},
+            ._player_name{"hello world"},
+            ._seed{12345},
+            ._data{rd},
+            ._pack_id{"pack"},
+            ._level_id{level_id},
+            ._first_play{false},
+            ._difficulty_mult{difficulty_mult},
+            ._played_score{score}
+            //
+        };
+
+        TEST_ASSERT(rf.serialize_to_file(folder / filename));
+    };
+
+    write_replay("a.ohreplay", "level", 1.f, 10.0);
+    write_replay("b.ohreplay", "level", 1.f, 30.0);
+    write_replay("c.ohreplay", "level", 2.f, 50.0);
+    write_replay("d.ohreplay", "other", 1.f, 70.0);
+    write_replay("e.ohreplay", "level", 1.f, 20.0);
+
+    {
+        hg::replay_index index{folder};
+        TEST_ASSERT(!index.load());
+        TEST_ASSERT_EQ(index.refresh(), 5);
+        TEST_ASSERT_EQ(index.entries().size(), 5);
+        TEST_ASSERT(index.save());
+    }
+
+    hg::replay_index index{folder};
+    TEST_ASSERT(index.load());
+    TEST_ASSERT_EQ(index.entries().size(), 5);
+    TEST_ASSERT_EQ(index.entries()[3]._header._level_id, "other");
+
+    // Unchanged files are not read again
+    TEST_ASSERT_EQ(index.refresh(), 0);
+
+    const auto best = index.best_for_level("pack", "level", 1.f, 2);
+    TEST_ASSERT_EQ(best.size(), 2);
+    TEST_ASSERT_EQ(best[0]->_filename, "b.ohreplay");
+    TEST_ASSERT_EQ(best[1]->_filename, "e.ohreplay");
+
+    TEST_ASSERT_EQ(index.best_for_level("pack", "level", 1.f, 10).size(), 3);
+    TEST_ASSERT_EQ(index.best_for_level("pack", "level", 3.f, 10).size(), 0);
+
+    // Changed and removed files are picked up, the size changes as well in
+    // case of coarse modification times
+    rd.record_input(true, false, false, false);
+    rd.record_input(false, true, false, false);
+    rd.record_input(true, false, false, false);
+
+    write_replay("a.ohreplay", "level", 1.f, 1000.0);
+    std::filesystem::remove(folder / "d.ohreplay");
+
+    TEST_ASSERT_EQ(index.refresh(), 1);
+    TEST_ASSERT_EQ(index.entries().size(), 4);
+    TEST_ASSERT_EQ(
+        index.best_for_level("pack", "level", 1.f, 1)[0]->_filename,
+        "a.ohreplay");
+
+    std::filesystem::remove_all(folder);
 }
 
 [[nodiscard]] static auto& getRng()
@@ -253,10 +974,24 @@ int main()
     test_replay_data_basic();
     test_replay_data_serialization_to_buffer();
     test_replay_data_serialization_to_buffer_too_small();
+    test_replay_data_serialization_unpacked();
+    test_replay_data_deserialization_unpacked_invalid_input();
+    test_replay_data_serialization_packed_long_runs();
+    test_replay_data_deserialization_packed_truncated();
+    test_replay_data_append_and_slice();
 
     test_replay_player_basic();
+    test_replay_player_seek();
 
     test_replay_file_serialization_to_buffer();
+    test_replay_file_serialization_unpacked_version();
+    test_replay_file_serialization_compressed();
+    test_replay_file_deserialize_header();
+    test_replay_file_state_hashes();
+    test_replay_file_serialization_streamed();
+    test_replay_stream_writer();
+    test_mapped_replay_file();
+    test_replay_index();
     test_replay_file_serialization_to_file();
 
     for(int i = 0; i < 256; ++i)
@@ -0,0 +1,213 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Core/HexagonSimulation.hpp"
+#include "SSVOpenHexagon/Core/Replay.hpp"
+#include "SSVOpenHexagon/Core/ReplayKeyframes.hpp"
+#include "SSVOpenHexagon/Global/Assets.hpp"
+#include "SSVOpenHexagon/Global/Config.hpp"
+
+#include "TestUtils.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// A level that spends part of every step inside a pattern coroutine, so that
+// some keyframe intervals start while one is alive.
+static constexpr const char* seek_level_script = R"(
+function onInit()
+    l_setSides(6)
+    l_setSpeedMult(1)
+    l_setRotationSpeed(0.1)
+    l_setIncTime(15)
+end
+
+function onLoad()
+end
+
+function onStep()
+    t_spawnPattern(function()
+        for i = 0, 3 do
+            w_wall(3, 20)
+            t_wait(8)
+        end
+    end)
+
+    w_wall(2, 20)
+    t_wait(40)
+end
+
+function onIncrement()
+end
+
+function onUnload()
+end
+
+function onUpdate(mFrameTime)
+end
+)";
+
+static void write_file(const std::filesystem::path& path, const char* contents)
+{
+    std::ofstream os(path, std::ios::binary | std::ios::out);
+    os << contents;
+}
+
+// Creates a pack with a single level in the current directory, reusing the
+// style and music data of the example workshop pack.
+static void make_seek_pack()
+{
+    const std::filesystem::path example{
+        std::filesystem::path{__FILE__}.parent_path().parent_path() /
+        "_RELEASE"};
+
+    const std::filesystem::path pack{"Packs/seektest"};
+    std::filesystem::create_directories(pack / "Levels");
+    std::filesystem::create_directories(pack / "Styles");
+    std::filesystem::create_directories(pack / "Music");
+    std::filesystem::create_directories(pack / "Scripts");
+
+    std::filesystem::copy_file(example / "default_config.json", "config.json");
+
+    std::filesystem::copy_file(
+        example / "Packs/workshopexample/Styles/examplelevel.json",
+        pack / "Styles/examplelevel.json");
+
+    std::filesystem::copy_file(
+        example / "Packs/workshopexample/Music/jackRussel.json",
+        pack / "Music/jackRussel.json");
+
+    write_file(pack / "pack.json", R"({
+    "disambiguator": "seektest",
+    "name": "seektest",
+    "author": "test",
+    "description": "",
+    "version": 1,
+    "priority": 0
+})");
+
+    write_file(pack / "Levels/seek.json", R"({
+    "id": "seek",
+    "name": "seek",
+    "description": "",
+    "author": "test",
+    "menuPriority": 0,
+    "selectable": true,
+    "styleId": "examplelevel",
+    "musicId": "jackRussel",
+    "luaFile": "Scripts/seek.lua",
+    "difficultyMults": []
+})");
+
+    write_file(pack / "Scripts/seek.lua", seek_level_script);
+}
+
+[[nodiscard]] static hg::input_bitset input_at(const std::size_t tick)
+{
+    return hg::make_input_bitset(tick % 90 < 30, tick % 200 > 150, false,
+        tick % 70 < 10);
+}
+
+static void test_replay_seek_with_patterns(hg::HGAssets& assets)
+{
+    const std::string& pack_id = assets.getPackInfos().at(0).id;
+    const std::string& level_id = assets.getLevelIdsByPack(pack_id).at(0);
+
+    constexpr std::size_t tick_count{1200};
+    constexpr std::size_t keyframe_interval{7};
+
+    hg::HexagonSimulation simulation{assets};
+
+    const auto start = [&] {
+        simulation.newGame(pack_id, level_id, true /* mFirstPlay */,
+            1.f /* mDifficultyMult */, 12345 /* mSeed */);
+
+        simulation.start();
+    };
+
+    // Reference run, without any keyframe
+    start();
+    TEST_ASSERT(!simulation.getLuaErrorRaised());
+
+    std::vector<std::uint32_t> hashes;
+    for(std::size_t tick = 0; tick < tick_count; ++tick)
+    {
+        simulation.step(input_at(tick));
+        hashes.emplace_back(simulation.computeStateHash());
+    }
+
+    // Same run, capturing keyframes as a replay does
+    start();
+
+    hg::replay_keyframes keyframes{keyframe_interval, tick_count};
+    bool skippedInterval{false};
+
+    for(std::size_t tick = 0; tick < tick_count; ++tick)
+    {
+        if(tick % keyframe_interval == 0 && !simulation.canMakeSnapshot())
+        {
+            skippedInterval = true;
+        }
+
+        if(keyframes.should_capture(tick, simulation))
+        {
+            keyframes.capture(tick, simulation);
+        }
+
+        simulation.step(input_at(tick));
+        TEST_ASSERT_EQ(simulation.computeStateHash(), hashes[tick]);
+    }
+
+    TEST_ASSERT(skippedInterval);
+
+    // Seek back from a state with a live pattern, to targets both inside and
+    // outside of patterns
+    for(const std::size_t target : {tick_count - 1, std::size_t{1000},
+            std::size_t{613}, std::size_t{250}, std::size_t{99},
+            std::size_t{1}})
+    {
+        const hg::replay_keyframes::keyframe* kf =
+            keyframes.find_nearest(target);
+
+        TEST_ASSERT(kf != nullptr);
+        TEST_ASSERT(kf->_tick <= target);
+
+        simulation.restoreSnapshot(kf->_snapshot);
+
+        for(std::size_t tick = kf->_tick; tick < target; ++tick)
+        {
+            simulation.step(input_at(tick));
+            TEST_ASSERT_EQ(simulation.computeStateHash(), hashes[tick]);
+        }
+    }
+
+    TEST_ASSERT(!simulation.getLuaErrorRaised());
+}
+
+int main()
+{
+    const std::filesystem::path folder{"test_replay_seek"};
+    std::filesystem::remove_all(folder);
+    std::filesystem::create_directory(folder);
+
+    const std::filesystem::path previous_path =
+        std::filesystem::current_path();
+
+    std::filesystem::current_path(folder);
+    make_seek_pack();
+
+    hg::Config::loadConfig({});
+
+    {
+        hg::HGAssets assets{nullptr, true /* mLevelsOnly */};
+        test_replay_seek_with_patterns(assets);
+    }
+
+    std::filesystem::current_path(previous_path);
+    std::filesystem::remove_all(folder);
+}
@@ -0,0 +1,311 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Utils/Timeline2.hpp"
+
+#include "TestUtils.hpp"
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using hg::Utils::timeline2;
+using hg::Utils::timeline2_runner;
+
+static constexpr timeline2::duration one_tick{1};
+
+// Callable too big to be stored inline, it goes to the timeline's arena.
+struct big_action
+{
+    std::vector<int>* _log;
+    int _value;
+    std::array<int, 16> _payload;
+
+    big_action(std::vector<int>& log, const int value)
+        : _log{&log}, _value{value}
+    {
+        _payload.fill(value);
+    }
+
+    void operator()() const
+    {
+        for(const int x : _payload)
+        {
+            TEST_ASSERT_EQ(x, _value);
+        }
+
+        _log->emplace_back(_value);
+    }
+};
+
+static_assert(sizeof(big_action) >
+              hg::Utils::timeline2_function<void()>::buffer_size);
+
+[[nodiscard]] static bool stored_inline_at(timeline2& tl, const std::size_t i)
+{
+    return std::get<timeline2::action_do>(tl.action_at(i)._inner)
+        ._func.stored_inline();
+}
+
+// Runs `tl` one tick at a time until it is finished.
+static void run_to_end(timeline2& tl, timeline2_runner& runner,
+    timeline2::time_point& tp, const int max_ticks = 1000)
+{
+    for(int i = 0; i < max_ticks; ++i)
+    {
+        if(runner.update(tl, tp) == timeline2_runner::outcome::finished)
+        {
+            return;
+        }
+
+        tp += one_tick;
+    }
+
+    TEST_ASSERT(false);
+}
+
+[[nodiscard]] static std::vector<int> iota_vector(const int n)
+{
+    std::vector<int> result;
+
+    for(int i = 0; i < n; ++i)
+    {
+        result.emplace_back(i);
+    }
+
+    return result;
+}
+
+static void test_timeline2_wraparound_across_grow()
+{
+    timeline2 tl;
+    timeline2_runner runner;
+    timeline2::time_point tp{};
+    std::vector<int> log;
+
+    // Fills the initial capacity exactly
+    int next = 0;
+    for(int i = 0; i < 8; ++i)
+    {
+        tl.append_do([&log, v = next++] { log.emplace_back(v); });
+        tl.append_wait_for(one_tick);
+    }
+
+    TEST_ASSERT_EQ(tl.size(), 16);
+    const std::size_t full_usage = tl.memory_usage();
+
+    // Moves the head forward, freeing slots at the start of the ring
+    TEST_ASSERT(runner.update(tl, tp) == timeline2_runner::outcome::waiting);
+    tp += one_tick;
+    TEST_ASSERT(runner.update(tl, tp) == timeline2_runner::outcome::waiting);
+    TEST_ASSERT((log == std::vector<int>{0, 1}));
+    TEST_ASSERT_EQ(tl.size(), 13);
+
+    // Wraps the tail around without growing
+    for(int i = 0; i < 3; ++i)
+    {
+        tl.append_do([&log, v = next++] { log.emplace_back(v); });
+    }
+
+    TEST_ASSERT_EQ(tl.size(), 16);
+    TEST_ASSERT_EQ(tl.memory_usage(), full_usage);
+
+    // Grows while wrapped around, with a big callable across the boundary
+    tl.append_do(big_action{log, next++});
+    tl.append_do([&log, v = next++] { log.emplace_back(v); });
+
+    TEST_ASSERT_EQ(tl.size(), 18);
+    TEST_ASSERT_GT(tl.memory_usage(), full_usage);
+    TEST_ASSERT(!stored_inline_at(tl, 16));
+    TEST_ASSERT(stored_inline_at(tl, 17));
+
+    run_to_end(tl, runner, tp);
+    TEST_ASSERT((log == iota_vector(next)));
+    TEST_ASSERT(tl.empty());
+}
+
+static void test_timeline2_clear_from_running_action()
+{
+    timeline2 tl;
+    timeline2_runner runner;
+    timeline2::time_point tp{};
+    std::vector<int> log;
+
+    struct clearing_action
+    {
+        timeline2* _tl;
+        std::vector<int>* _log;
+        std::array<int, 16> _payload;
+
+        void operator()() const
+        {
+            _tl->clear();
+
+            // Would overwrite this very callable if the arena was reset
+            _tl->append_do(big_action{*_log, 2});
+            _tl->append_do(big_action{*_log, 3});
+
+            for(const int x : _payload)
+            {
+                TEST_ASSERT_EQ(x, 1);
+            }
+
+            _log->emplace_back(1);
+        }
+    };
+
+    clearing_action ca{&tl, &log, {}};
+    ca._payload.fill(1);
+
+    tl.append_do(big_action{log, 0});
+    tl.append_do(ca);
+    tl.append_do(big_action{log, -1}); // Cleared before running
+    TEST_ASSERT(!stored_inline_at(tl, 1));
+
+    run_to_end(tl, runner, tp);
+    TEST_ASSERT((log == std::vector<int>{0, 1, 2, 3}));
+
+    // Once the timeline is empty and nothing runs, the arena is reused
+    const std::size_t usage = tl.memory_usage();
+    for(int i = 0; i < 4; ++i)
+    {
+        tl.append_do(big_action{log, 4});
+    }
+
+    TEST_ASSERT_EQ(tl.memory_usage(), usage);
+}
+
+static void test_timeline2_copy_and_move()
+{
+    std::vector<int> log;
+    timeline2::time_point tp{};
+
+    timeline2 tl;
+    for(int i = 0; i < 20; ++i)
+    {
+        tl.append_do(big_action{log, i});
+        tl.append_wait_for(one_tick);
+    }
+
+    // Copy construction and assignment
+    timeline2 copy{tl};
+    timeline2 copy_assigned;
+    copy_assigned.append_do(big_action{log, -1});
+    copy_assigned = tl;
+
+    TEST_ASSERT_EQ(copy.size(), tl.size());
+    TEST_ASSERT_EQ(copy_assigned.size(), tl.size());
+    TEST_ASSERT(!stored_inline_at(copy, 0));
+    TEST_ASSERT(copy.generation() != tl.generation());
+
+    {
+        timeline2_runner runner;
+        run_to_end(copy, runner, tp);
+        TEST_ASSERT((log == iota_vector(20)));
+    }
+
+    // Running a copy does not affect the original
+    TEST_ASSERT_EQ(tl.size(), 40);
+
+    log.clear();
+
+    {
+        timeline2_runner runner;
+        run_to_end(copy_assigned, runner, tp);
+        TEST_ASSERT((log == iota_vector(20)));
+    }
+
+    log.clear();
+
+    // Move construction and assignment keep the arena the callables are in
+    timeline2 moved{std::move(tl)};
+    TEST_ASSERT(tl.empty());
+    TEST_ASSERT_EQ(moved.size(), 40);
+
+    timeline2 move_assigned;
+    move_assigned.append_do(big_action{log, -1});
+    move_assigned = std::move(moved);
+    TEST_ASSERT(moved.empty());
+    TEST_ASSERT_EQ(move_assigned.size(), 40);
+
+    {
+        timeline2_runner runner;
+        run_to_end(move_assigned, runner, tp);
+        TEST_ASSERT((log == iota_vector(20)));
+    }
+
+    // Moved-from timelines are usable
+    log.clear();
+    tl.append_do(big_action{log, 7});
+
+    {
+        timeline2_runner runner;
+        run_to_end(tl, runner, tp);
+        TEST_ASSERT((log == std::vector<int>{7}));
+    }
+}
+
+static void test_timeline2_coroutine_push_front()
+{
+    timeline2 tl;
+    timeline2_runner runner;
+    timeline2::time_point tp{};
+    std::vector<int> log;
+
+    int step = 0;
+
+    // Appends while running, so that the timeline grows before the suspended
+    // coroutine goes back to its front
+    tl.append_coroutine(
+        [&]() -> std::optional<timeline2::wait_action> {
+            log.emplace_back(100 + step);
+
+            if(step == 0)
+            {
+                for(int i = 0; i < 20; ++i)
+                {
+                    tl.append_do([&log, i] { log.emplace_back(i); });
+                }
+            }
+
+            if(step++ < 3)
+            {
+                return timeline2::action_wait_for{one_tick};
+            }
+
+            return std::nullopt;
+        });
+
+    TEST_ASSERT(runner.update(tl, tp) == timeline2_runner::outcome::waiting);
+    TEST_ASSERT_EQ(tl.size(), 21);
+    TEST_ASSERT(std::holds_alternative<timeline2::action_coroutine>(
+        tl.action_at(0)._inner));
+
+    // Appended actions only run once the coroutine has finished
+    tp += one_tick;
+    TEST_ASSERT(runner.update(tl, tp) == timeline2_runner::outcome::waiting);
+    TEST_ASSERT((log == std::vector<int>{100, 101}));
+
+    run_to_end(tl, runner, tp);
+
+    std::vector<int> expected{100, 101, 102, 103};
+    for(int i = 0; i < 20; ++i)
+    {
+        expected.emplace_back(i);
+    }
+
+    TEST_ASSERT((log == expected));
+    TEST_ASSERT(tl.empty());
+}
+
+int main()
+{
+    test_timeline2_wraparound_across_grow();
+    test_timeline2_clear_from_running_action();
+    test_timeline2_copy_and_move();
+    test_timeline2_coroutine_push_front();
+}
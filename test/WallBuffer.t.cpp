@@ -0,0 +1,247 @@
+// Copyright (c) 2013-2020 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: https://opensource.org/licenses/AFL-3.0
+
+#include "SSVOpenHexagon/Components/WallBuffer.hpp"
+
+#include "TestUtils.hpp"
+
+#include <SFML/System/Vector2.hpp>
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <random>
+
+[[nodiscard]] static bool bitwise_equal(
+    const std::array<sf::Vector2f, 4>& a, const std::array<sf::Vector2f, 4>& b)
+{
+    for(std::size_t i = 0; i < 4; ++i)
+    {
+        if(std::bit_cast<std::uint32_t>(a[i].x) !=
+                std::bit_cast<std::uint32_t>(b[i].x) ||
+            std::bit_cast<std::uint32_t>(a[i].y) !=
+                std::bit_cast<std::uint32_t>(b[i].y))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// A step of `mStep` and a rotation of `mAngle` with a frametime of 1.
+static void add_wall(hg::WallBuffer& mWb,
+    const std::array<sf::Vector2f, 4>& mVertices, const float mStep,
+    const float mAngle)
+{
+    mWb.add(mVertices, hg::SpeedData{mStep / 5.f},
+        hg::SpeedData{mAngle * 60.f}, 0.f);
+}
+
+static void test_wall_buffer_empty()
+{
+    hg::WallBuffer wb;
+    TEST_ASSERT_EQ(wb.size(), 0);
+    TEST_ASSERT(wb.empty());
+
+    wb.updateSpeeds(1.f);
+    wb.moveTowardsCenter(sf::Vector2f{0.f, 0.f}, 10.f);
+    wb.rotateAroundCenter(sf::Vector2f{0.f, 0.f});
+    wb.applyMovement();
+    wb.eraseKilled();
+    TEST_ASSERT_EQ(wb.size(), 0);
+}
+
+static void test_wall_buffer_kill()
+{
+    hg::WallBuffer wb;
+
+    // Entirely within the radius, partially, and outside
+    add_wall(wb,
+        {sf::Vector2f{1.f, 1.f}, sf::Vector2f{-1.f, 1.f},
+            sf::Vector2f{-1.f, -1.f}, sf::Vector2f{1.f, -1.f}},
+        5.f, 0.f);
+    add_wall(wb,
+        {sf::Vector2f{1.f, 1.f}, sf::Vector2f{-1.f, 1.f},
+            sf::Vector2f{-1.f, -1.f}, sf::Vector2f{100.f, 0.f}},
+        5.f, 0.f);
+    add_wall(wb,
+        {sf::Vector2f{100.f, 0.f}, sf::Vector2f{0.f, 100.f},
+            sf::Vector2f{-100.f, 0.f}, sf::Vector2f{0.f, -100.f}},
+        5.f, 0.f);
+
+    wb.updateSpeeds(1.f);
+    wb.moveTowardsCenter(sf::Vector2f{0.f, 0.f}, 10.f);
+    TEST_ASSERT_EQ(wb.size(), 3);
+    TEST_ASSERT_EQ(wb.getMovedCount(), 3);
+    TEST_ASSERT(wb.isKilled(0));
+    TEST_ASSERT(!wb.isKilled(1));
+    TEST_ASSERT(!wb.isKilled(2));
+
+    TEST_ASSERT_EQ(wb.getMoved(1)[0].x, 1.f);
+    TEST_ASSERT_EQ(wb.getMoved(1)[3].x, 95.f);
+    TEST_ASSERT_EQ(wb.getMoved(2)[1].y, 95.f);
+    TEST_ASSERT_EQ(wb.getMoved(2)[2].x, -95.f);
+
+    // Positions only change once the movement is applied
+    TEST_ASSERT_EQ(wb.getVertexPositions(2)[2].x, -100.f);
+
+    wb.rotateAroundCenter(sf::Vector2f{0.f, 0.f});
+
+    // Walls added after the movement was computed are left in place
+    add_wall(wb,
+        {sf::Vector2f{200.f, 0.f}, sf::Vector2f{0.f, 200.f},
+            sf::Vector2f{-200.f, 0.f}, sf::Vector2f{0.f, -200.f}},
+        5.f, 0.f);
+
+    wb.applyMovement();
+    TEST_ASSERT_EQ(wb.getMovedCount(), 0);
+    TEST_ASSERT_EQ(wb.getVertexPositions(2)[2].x, -95.f);
+    TEST_ASSERT_EQ(wb.getVertexPositions(3)[2].x, -200.f);
+
+    // Previous positions are kept for drawing
+    TEST_ASSERT_EQ(wb.getPrevVertexPositions(2)[2].x, -100.f);
+    wb.savePreviousState();
+    TEST_ASSERT_EQ(wb.getPrevVertexPositions(2)[2].x, -95.f);
+
+    wb.eraseKilled();
+    TEST_ASSERT_EQ(wb.size(), 3);
+    TEST_ASSERT_EQ(wb.getVertexPositions(0)[3].x, 95.f);
+    TEST_ASSERT_EQ(wb.getVertexPositions(1)[2].x, -95.f);
+    TEST_ASSERT_EQ(wb.getVertexPositions(2)[2].x, -200.f);
+    TEST_ASSERT_EQ(wb.getPrevVertexPositions(2)[2].x, -200.f);
+
+    wb.clear();
+    TEST_ASSERT_EQ(wb.size(), 0);
+}
+
+// Accelerations are applied exactly as `SpeedData::update` does.
+static void test_wall_buffer_speeds()
+{
+    const std::array<hg::SpeedData, 4> speedData{hg::SpeedData{3.f},
+        hg::SpeedData{1.f, 0.37f, 0.f, 2.f, false},
+        hg::SpeedData{1.f, 0.37f, 0.5f, 2.f, true},
+        hg::SpeedData{1.f, -0.21f, -1.f, 1.5f, true}};
+
+    hg::WallBuffer wb;
+    const std::array<sf::Vector2f, 4> vertices{sf::Vector2f{100.f, 0.f},
+        sf::Vector2f{0.f, 100.f}, sf::Vector2f{-100.f, 0.f},
+        sf::Vector2f{0.f, -100.f}};
+
+    for(const hg::SpeedData& sd : speedData)
+    {
+        wb.add(vertices, sd, sd, 0.f);
+    }
+
+    std::array<hg::SpeedData, 4> expected{speedData};
+    const float ft{0.5f};
+
+    for(int tick = 0; tick < 100; ++tick)
+    {
+        wb.updateSpeeds(ft);
+
+        for(std::size_t i = 0; i < expected.size(); ++i)
+        {
+            expected[i].update(ft);
+
+            TEST_ASSERT_EQ(std::bit_cast<std::uint32_t>(wb.getSpeed(i)),
+                std::bit_cast<std::uint32_t>(expected[i].speed));
+            TEST_ASSERT_EQ(std::bit_cast<std::uint32_t>(wb.getCurveSpeed(i)),
+                std::bit_cast<std::uint32_t>(expected[i].speed));
+        }
+
+        wb.applyMovement();
+    }
+}
+
+// The vectorized kernels must match the scalar ones bit for bit, or replays
+// would desync between builds for different instruction sets.
+static void test_wall_buffer_determinism(const std::size_t mWallCount)
+{
+    std::mt19937 rng{static_cast<std::mt19937::result_type>(mWallCount)};
+
+    std::uniform_real_distribution<float> posDist{-1200.f, 1200.f};
+    std::uniform_real_distribution<float> stepDist{-2.f, 40.f};
+    std::uniform_real_distribution<float> angleDist{-0.2f, 0.2f};
+    std::uniform_int_distribution<int> kindDist{0, 7};
+
+    const sf::Vector2f center{0.f, 0.f};
+    const float radius{48.f};
+
+    hg::WallBuffer vectorized;
+    hg::WallBuffer scalar;
+
+    std::array<sf::Vector2f, 4> vertices;
+
+    for(std::size_t i = 0; i < mWallCount; ++i)
+    {
+        for(sf::Vector2f& vp : vertices)
+        {
+            vp = sf::Vector2f{posDist(rng), posDist(rng)};
+        }
+
+        const int kind = kindDist(rng);
+
+        if(kind == 0)
+        {
+            // On the center, where the direction is undefined
+            vertices[0] = center;
+        }
+        else if(kind == 1)
+        {
+            vertices[1] = sf::Vector2f{radius * 0.5f, -radius * 0.5f};
+        }
+
+        const float step = kind == 2 ? 0.f : stepDist(rng);
+        const float angle = kind == 3 ? 0.f : angleDist(rng);
+
+        add_wall(vectorized, vertices, step, angle);
+        add_wall(scalar, vertices, step, angle);
+    }
+
+    for(int tick = 0; tick < 240; ++tick)
+    {
+        vectorized.updateSpeeds(1.f);
+        scalar.updateSpeeds(1.f);
+
+        vectorized.moveTowardsCenter(center, radius);
+        scalar.moveTowardsCenterScalar(center, radius);
+
+        vectorized.rotateAroundCenter(center);
+        scalar.rotateAroundCenterScalar(center);
+
+        TEST_ASSERT_EQ(vectorized.size(), scalar.size());
+
+        for(std::size_t i = 0; i < mWallCount; ++i)
+        {
+            TEST_ASSERT_EQ(vectorized.isKilled(i), scalar.isKilled(i));
+            TEST_ASSERT(
+                bitwise_equal(vectorized.getMoved(i), scalar.getMoved(i)));
+            TEST_ASSERT(
+                bitwise_equal(vectorized.getCurved(i), scalar.getCurved(i)));
+        }
+
+        vectorized.applyMovement();
+        scalar.applyMovement();
+
+        for(std::size_t i = 0; i < mWallCount; ++i)
+        {
+            TEST_ASSERT(bitwise_equal(vectorized.getVertexPositions(i),
+                scalar.getVertexPositions(i)));
+        }
+    }
+}
+
+int main()
+{
+    test_wall_buffer_empty();
+    test_wall_buffer_kill();
+    test_wall_buffer_speeds();
+
+    // Odd counts exercise the remainder of the wider kernels
+    for(const std::size_t wallCount : {1, 2, 3, 7, 64, 257})
+    {
+        test_wall_buffer_determinism(wallCount);
+    }
+}